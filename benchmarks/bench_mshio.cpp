@@ -0,0 +1,393 @@
+#include "mesh_generator.h"
+#include "perf_counters.h"
+
+#include <mshio/mshio.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Benchmark load_msh() and save_msh() on generated meshes, for MSH 2.2 and
+// 4.1 in ASCII and binary, and print the results as JSON. Loads are also
+// broken down into phases, with hardware counters where available.
+
+namespace {
+
+using namespace mshio;
+
+struct Config
+{
+    std::vector<bench::MeshKind> kinds = {
+        bench::MeshKind::Tet, bench::MeshKind::Hex, bench::MeshKind::Mixed};
+    size_t size = 40;
+    size_t repeat = 3;
+    size_t num_threads = 1;
+    std::string dir = ".";
+    std::string output;
+    bool keep_files = false;
+};
+
+struct Format
+{
+    const char* version;
+    bool binary;
+};
+
+const Format formats[] = {{"2.2", false}, {"2.2", true}, {"4.1", false}, {"4.1", true}};
+
+// Phases of load_msh(), reported through LoadOptions::on_phase.
+enum Phase { Header, Nodes, Elements, Data, PostProcess, Other, NumPhases };
+const char* phase_names[NumPhases] = {
+    "header", "nodes", "elements", "data", "post_process", "other"};
+
+Phase phase_of(const std::string& section)
+{
+    if (section == "$MeshFormat") return Header;
+    if (section == "$Nodes") return Nodes;
+    if (section == "$Elements") return Elements;
+    if (section == "$NodeData" || section == "$ElementData" || section == "$ElementNodeData") {
+        return Data;
+    }
+    if (section == "post_process") return PostProcess;
+    return Other; // Entities, physical groups...
+}
+
+// Wall clock time and counters of an operation or a phase.
+struct Sample
+{
+    double seconds = 0.0;
+    bench::PerfCounters::Values counters = {};
+
+    void add(const Sample& end, const Sample& begin)
+    {
+        seconds += end.seconds - begin.seconds;
+        for (size_t i = 0; i < counters.size(); i++) {
+            counters[i] += end.counters[i] - begin.counters[i];
+        }
+    }
+
+    void scale(double factor)
+    {
+        seconds *= factor;
+        for (auto& counter : counters) {
+            counter = static_cast<uint64_t>(static_cast<double>(counter) * factor);
+        }
+    }
+};
+
+Sample sample(const bench::PerfCounters& perf)
+{
+    Sample s;
+    s.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+    s.counters = perf.read();
+    return s;
+}
+
+struct Result
+{
+    std::string mesh;
+    Format format;
+    std::string operation;
+    size_t num_nodes = 0;
+    size_t num_elements = 0;
+    size_t file_size = 0;
+    double seconds = std::numeric_limits<double>::max(); // Best of all repetitions.
+    size_t peak_rss = 0; // Bytes.
+
+    // Means over all repetitions. Phases are only measured for loads.
+    Sample total;
+    std::array<Sample, NumPhases> phases;
+};
+
+void usage(const char* name)
+{
+    std::cerr << "Usage: " << name << " [options]\n"
+              << "  --mesh tet|hex|mixed|all  Generated meshes (default: all)\n"
+              << "  --size N                  Cells per side of the cube (default: 40)\n"
+              << "  --repeat N                Runs of each benchmark, the best is kept "
+                 "(default: 3)\n"
+              << "  --threads N               LoadOptions/SaveOptions::num_threads "
+                 "(default: 1)\n"
+              << "  --dir DIR                 Directory of the generated files (default: .)\n"
+              << "  --output FILE             JSON output file (default: stdout)\n"
+              << "  --keep                    Keep the generated files\n";
+}
+
+bool parse_args(int argc, char** argv, Config& config)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--keep") {
+            config.keep_files = true;
+            continue;
+        }
+        if (i + 1 == argc) return false;
+        const std::string value = argv[++i];
+        if (arg == "--mesh") {
+            bench::MeshKind kind;
+            if (value == "all") continue;
+            if (!bench::parse_mesh_kind(value, kind)) return false;
+            config.kinds = {kind};
+        } else if (arg == "--size") {
+            config.size = std::strtoul(value.c_str(), nullptr, 10);
+            if (config.size == 0) return false;
+        } else if (arg == "--repeat") {
+            config.repeat = std::max<size_t>(1, std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--threads") {
+            config.num_threads = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--dir") {
+            config.dir = value;
+        } else if (arg == "--output") {
+            config.output = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reset the peak resident set size, so that the next reading only covers the
+// following benchmark. Only supported on Linux, elsewhere the peak covers the
+// whole process.
+void reset_peak_rss()
+{
+#ifdef __GLIBC__
+    // Return the memory freed by earlier benchmarks to the system.
+    malloc_trim(0);
+#endif
+#ifdef __linux__
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif
+}
+
+size_t peak_rss()
+{
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::strtoul(line.c_str() + 6, nullptr, 10) * 1024;
+        }
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+size_t file_size(const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    return in ? static_cast<size_t>(in.tellg()) : 0;
+}
+
+// Run `fn` `repeat` times and record the best time, the mean counters and
+// the peak RSS.
+template <typename Fn>
+void measure(const bench::PerfCounters& perf, Result& result, size_t repeat, Fn&& fn)
+{
+    reset_peak_rss();
+    for (size_t i = 0; i < repeat; i++) {
+        const Sample begin = sample(perf);
+        fn();
+        const Sample end = sample(perf);
+        result.seconds = std::min(result.seconds, end.seconds - begin.seconds);
+        result.total.add(end, begin);
+    }
+    result.peak_rss = peak_rss();
+
+    const double factor = 1.0 / static_cast<double>(repeat);
+    result.total.scale(factor);
+    for (auto& phase : result.phases) {
+        phase.scale(factor);
+    }
+}
+
+std::string filename_of(const Config& config, bench::MeshKind kind, const Format& format)
+{
+    return config.dir + "/bench_" + bench::to_string(kind) + "_" + format.version +
+           (format.binary ? "_bin" : "_ascii") + ".msh";
+}
+
+void run(const Config& config,
+    const bench::PerfCounters& perf,
+    bench::MeshKind kind,
+    std::vector<Result>& results)
+{
+    std::vector<Result> saves;
+    {
+        std::cerr << "Generating " << bench::to_string(kind) << " mesh..." << std::endl;
+        MshSpec spec = bench::generate_mesh(kind, config.size);
+        SaveOptions options;
+        options.num_threads = config.num_threads;
+        for (const Format& format : formats) {
+            spec.mesh_format.version = format.version;
+            spec.mesh_format.file_type = format.binary ? 1 : 0;
+            const std::string filename = filename_of(config, kind, format);
+
+            Result result;
+            result.mesh = bench::to_string(kind);
+            result.format = format;
+            result.operation = "save";
+            result.num_nodes = spec.nodes.num_nodes;
+            result.num_elements = spec.elements.num_elements;
+            measure(perf, result, config.repeat, [&]() { save_msh(filename, spec, options); });
+            result.file_size = file_size(filename);
+            saves.push_back(result);
+        }
+    }
+
+    // Files are loaded once the generated spec is released.
+    for (size_t i = 0; i < saves.size(); i++) {
+        Result result = saves[i];
+        result.operation = "load";
+        result.seconds = std::numeric_limits<double>::max();
+        result.total = Sample();
+
+        Sample phase_begin;
+        LoadOptions options;
+        options.num_threads = config.num_threads;
+        options.on_phase = [&](const std::string& section, bool begin) {
+            const Sample now = sample(perf);
+            if (begin) {
+                phase_begin = now;
+            } else {
+                result.phases[phase_of(section)].add(now, phase_begin);
+            }
+        };
+
+        const std::string filename = filename_of(config, kind, result.format);
+        measure(perf, result, config.repeat, [&]() {
+            const MshSpec spec = load_msh(filename, options);
+            if (spec.elements.num_elements != result.num_elements) {
+                throw std::runtime_error("Unexpected number of elements in " + filename);
+            }
+        });
+        results.push_back(saves[i]);
+        results.push_back(result);
+        if (!config.keep_files) std::remove(filename.c_str());
+    }
+}
+
+// Seconds and available counters of `s` as JSON members.
+void write_sample(std::ostream& out, const bench::PerfCounters& perf, const Sample& s)
+{
+    out << "\"seconds\": " << s.seconds;
+    for (size_t i = 0; i < s.counters.size(); i++) {
+        const auto counter = static_cast<bench::PerfCounters::Counter>(i);
+        if (perf.available(counter)) {
+            out << ", \"" << bench::PerfCounters::name(counter) << "\": " << s.counters[i];
+        }
+    }
+}
+
+void write_json(std::ostream& out,
+    const Config& config,
+    const bench::PerfCounters& perf,
+    const std::vector<Result>& results)
+{
+    constexpr double MB = 1024.0 * 1024.0;
+    out << "{\n";
+    out << "  \"size\": " << config.size << ",\n";
+    out << "  \"repeat\": " << config.repeat << ",\n";
+    out << "  \"num_threads\": " << config.num_threads << ",\n";
+    out << "  \"perf_counters\": [";
+    const char* separator = "";
+    for (int i = 0; i < bench::PerfCounters::NumCounters; i++) {
+        const auto counter = static_cast<bench::PerfCounters::Counter>(i);
+        if (perf.available(counter)) {
+            out << separator << "\"" << bench::PerfCounters::name(counter) << "\"";
+            separator = ", ";
+        }
+    }
+    out << "],\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "    {\"mesh\": \"" << r.mesh << "\", \"version\": \"" << r.format.version
+            << "\", \"binary\": " << (r.format.binary ? "true" : "false")
+            << ", \"operation\": \"" << r.operation << "\", \"nodes\": " << r.num_nodes
+            << ", \"elements\": " << r.num_elements << ", \"bytes\": " << r.file_size
+            << ", \"seconds\": " << r.seconds
+            << ", \"mb_per_s\": " << static_cast<double>(r.file_size) / MB / r.seconds
+            << ", \"elements_per_s\": " << static_cast<double>(r.num_elements) / r.seconds
+            << ", \"peak_rss_mb\": " << static_cast<double>(r.peak_rss) / MB;
+        out << ",\n     \"mean\": {";
+        write_sample(out, perf, r.total);
+        out << "}";
+        if (r.operation == "load") {
+            out << ",\n     \"phases\": {";
+            for (int p = 0; p < NumPhases; p++) {
+                out << (p > 0 ? ",\n                " : "") << "\"" << phase_names[p] << "\": {";
+                write_sample(out, perf, r.phases[p]);
+                out << "}";
+            }
+            out << "}";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Config config;
+    if (!parse_args(argc, argv, config)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const bench::PerfCounters perf;
+    if (!perf.any_available()) {
+        std::cerr << "perf_event_open() is unavailable, only timings are reported." << std::endl;
+    }
+
+    std::vector<Result> results;
+    try {
+        for (bench::MeshKind kind : config.kinds) {
+            run(config, perf, kind, results);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (config.output.empty()) {
+        write_json(std::cout, config, perf, results);
+    } else {
+        std::ofstream out(config.output);
+        write_json(out, config, perf, results);
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "mesh_generator.h"
+
+#include <mshio/mshio.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mshio {
+namespace bench {
+
+namespace {
+
+constexpr int tet_type = 4;
+constexpr int hex_type = 5;
+constexpr int prism_type = 6;
+constexpr int triangle_type = 2;
+constexpr int quad_type = 3;
+
+// Corners of a cell in Gmsh hexahedron order.
+using Cell = std::array<size_t, 8>;
+
+// Sub-elements of a cell, as indices of its corners.
+const std::vector<std::vector<int>> tets_of_cell = {
+    {0, 1, 2, 6}, {0, 2, 3, 6}, {0, 3, 7, 6}, {0, 7, 4, 6}, {0, 4, 5, 6}, {0, 5, 1, 6}};
+const std::vector<std::vector<int>> hexes_of_cell = {{0, 1, 2, 3, 4, 5, 6, 7}};
+const std::vector<std::vector<int>> prisms_of_cell = {{0, 1, 2, 4, 5, 6}, {0, 2, 3, 4, 6, 7}};
+const std::vector<std::vector<int>> triangles_of_face = {{0, 1, 2}, {0, 2, 3}};
+const std::vector<std::vector<int>> quads_of_face = {{0, 1, 2, 3}};
+
+uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Deterministic value in [-0.5, 0.5).
+double jitter(uint64_t seed)
+{
+    return static_cast<double>(splitmix64(seed) >> 11) / static_cast<double>(uint64_t(1) << 53) -
+           0.5;
+}
+
+class Builder
+{
+public:
+    explicit Builder(MshSpec& spec)
+        : m_spec(spec)
+    {}
+
+    // Block of the entity `(dim, tag)`, created on first use.
+    ElementBlock& block(int dim, int tag, int element_type)
+    {
+        for (auto& block : m_spec.elements.entity_blocks) {
+            if (block.entity_dim == dim && block.entity_tag == tag) return block;
+        }
+        m_spec.elements.entity_blocks.emplace_back();
+        ElementBlock& block = m_spec.elements.entity_blocks.back();
+        block.entity_dim = dim;
+        block.entity_tag = tag;
+        block.element_type = element_type;
+        return block;
+    }
+
+    void add(ElementBlock& block, const size_t* corners, const std::vector<std::vector<int>>& parts)
+    {
+        for (const auto& part : parts) {
+            block.data.push_back(++m_num_elements);
+            for (int corner : part) {
+                block.data.push_back(corners[corner]);
+            }
+            block.num_elements_in_block++;
+        }
+    }
+
+    size_t num_elements() const { return m_num_elements; }
+
+private:
+    MshSpec& m_spec;
+    size_t m_num_elements = 0;
+};
+
+Data make_data(const std::string& name, int num_fields, size_t num_entries)
+{
+    Data data;
+    data.header.string_tags = {name};
+    data.header.real_tags = {0.0};
+    data.header.int_tags = {0, num_fields, static_cast<int>(num_entries), 0};
+    data.entries.resize(num_entries);
+    return data;
+}
+
+} // namespace
+
+const char* to_string(MeshKind kind)
+{
+    switch (kind) {
+    case MeshKind::Tet: return "tet";
+    case MeshKind::Hex: return "hex";
+    default: return "mixed";
+    }
+}
+
+bool parse_mesh_kind(const std::string& name, MeshKind& kind)
+{
+    for (MeshKind k : {MeshKind::Tet, MeshKind::Hex, MeshKind::Mixed}) {
+        if (name == to_string(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+MshSpec generate_mesh(MeshKind kind, size_t cells_per_side)
+{
+    const size_t n = cells_per_side;
+    const size_t m = n + 1; // Nodes per side.
+    const double h = 1.0 / static_cast<double>(n);
+    auto node_tag = [&](size_t i, size_t j, size_t k) { return 1 + i + m * (j + m * k); };
+
+    MshSpec spec;
+
+    // Nodes, all on the first volume.
+    spec.nodes.entity_blocks.emplace_back();
+    NodeBlock& nodes = spec.nodes.entity_blocks.back();
+    nodes.entity_dim = 3;
+    nodes.num_nodes_in_block = m * m * m;
+    nodes.tags.reserve(nodes.num_nodes_in_block);
+    nodes.data.reserve(nodes.num_nodes_in_block * 3);
+    for (size_t k = 0; k < m; k++) {
+        for (size_t j = 0; j < m; j++) {
+            for (size_t i = 0; i < m; i++) {
+                const size_t tag = node_tag(i, j, k);
+                nodes.tags.push_back(tag);
+                const size_t index[] = {i, j, k};
+                for (size_t d = 0; d < 3; d++) {
+                    // Boundary nodes stay on the faces of the cube.
+                    const bool interior = index[d] > 0 && index[d] < n;
+                    const double offset = interior ? 0.2 * jitter(3 * tag + d) : 0.0;
+                    nodes.data.push_back((static_cast<double>(index[d]) + offset) * h);
+                }
+            }
+        }
+    }
+    spec.nodes.num_entity_blocks = 1;
+    spec.nodes.num_nodes = nodes.num_nodes_in_block;
+    spec.nodes.min_node_tag = 1;
+    spec.nodes.max_node_tag = nodes.num_nodes_in_block;
+
+    // Volume elements: volume 1 holds tetrahedra, 2 hexahedra and 3 prisms.
+    Builder builder(spec);
+    for (size_t k = 0; k < n; k++) {
+        for (size_t j = 0; j < n; j++) {
+            for (size_t i = 0; i < n; i++) {
+                const Cell cell = {node_tag(i, j, k),
+                    node_tag(i + 1, j, k),
+                    node_tag(i + 1, j + 1, k),
+                    node_tag(i, j + 1, k),
+                    node_tag(i, j, k + 1),
+                    node_tag(i + 1, j, k + 1),
+                    node_tag(i + 1, j + 1, k + 1),
+                    node_tag(i, j + 1, k + 1)};
+                const size_t cycle = (kind == MeshKind::Mixed) ? (i + j + k) % 3 : 0;
+                if (kind == MeshKind::Hex || cycle == 1) {
+                    builder.add(builder.block(3, 2, hex_type), cell.data(), hexes_of_cell);
+                } else if (cycle == 2) {
+                    builder.add(builder.block(3, 3, prism_type), cell.data(), prisms_of_cell);
+                } else {
+                    builder.add(builder.block(3, 1, tet_type), cell.data(), tets_of_cell);
+                }
+            }
+        }
+    }
+
+    // Bottom face, surface 1.
+    const bool quads = kind != MeshKind::Tet;
+    ElementBlock& bottom = builder.block(2, 1, quads ? quad_type : triangle_type);
+    for (size_t j = 0; j < n; j++) {
+        for (size_t i = 0; i < n; i++) {
+            const size_t face[] = {
+                node_tag(i, j, 0), node_tag(i, j + 1, 0), node_tag(i + 1, j + 1, 0),
+                node_tag(i + 1, j, 0)};
+            builder.add(bottom, face, quads ? quads_of_face : triangles_of_face);
+        }
+    }
+
+    auto& blocks = spec.elements.entity_blocks;
+    spec.elements.num_entity_blocks = blocks.size();
+    spec.elements.num_elements = builder.num_elements();
+    spec.elements.min_element_tag = 1;
+    spec.elements.max_element_tag = builder.num_elements();
+
+    // Entities and physical groups.
+    spec.entities.surfaces.emplace_back();
+    spec.entities.surfaces.back().tag = 1;
+    spec.entities.surfaces.back().max_x = 1.0;
+    spec.entities.surfaces.back().max_y = 1.0;
+    spec.entities.surfaces.back().physical_group_tags = {2};
+    for (const auto& block : blocks) {
+        if (block.entity_dim != 3) continue;
+        spec.entities.volumes.emplace_back();
+        VolumeEntity& volume = spec.entities.volumes.back();
+        volume.tag = block.entity_tag;
+        volume.max_x = volume.max_y = volume.max_z = 1.0;
+        volume.physical_group_tags = {1};
+    }
+    spec.nodes.entity_blocks.front().entity_tag = spec.entities.volumes.front().tag;
+    spec.physical_groups = {{3, 1, "domain"}, {2, 2, "bottom"}};
+
+    // Post-processing data.
+    Data temperature = make_data("temperature", 1, spec.nodes.num_nodes);
+    Data velocity = make_data("velocity", 3, spec.nodes.num_nodes);
+    for (size_t i = 0; i < spec.nodes.num_nodes; i++) {
+        const double* xyz = nodes.data.data() + 3 * i;
+        temperature.entries[i].tag = nodes.tags[i];
+        temperature.entries[i].data = {xyz[0] + xyz[1] * xyz[2]};
+        velocity.entries[i].tag = nodes.tags[i];
+        velocity.entries[i].data = {-xyz[1], xyz[0], 0.5 * xyz[2]};
+    }
+    spec.node_data.push_back(std::move(temperature));
+    spec.node_data.push_back(std::move(velocity));
+
+    Data pressure = make_data("pressure", 1, spec.elements.num_elements);
+    size_t e = 0;
+    for (const auto& block : blocks) {
+        const size_t stride = nodes_per_element(block.element_type) + 1;
+        for (size_t i = 0; i < block.num_elements_in_block; i++, e++) {
+            pressure.entries[e].tag = block.data[i * stride];
+            pressure.entries[e].data = {jitter(pressure.entries[e].tag)};
+        }
+    }
+    spec.element_data.push_back(std::move(pressure));
+
+    return spec;
+}
+
+} // namespace bench
+} // namespace mshio
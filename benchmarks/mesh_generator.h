@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <mshio/MshSpec.h>
+
+namespace mshio {
+namespace bench {
+
+enum class MeshKind { Tet, Hex, Mixed };
+
+const char* to_string(MeshKind kind);
+
+// Returns false for unknown names.
+bool parse_mesh_kind(const std::string& name, MeshKind& kind);
+
+// Structured mesh of the unit cube with `cells_per_side`^3 cells, split into
+// 6 tetrahedra (Tet), kept as hexahedra (Hex), or cycling through hexahedra,
+// 2 prisms and 6 tetrahedra (Mixed), with one volume entity per element type
+// and the bottom face as a surface of triangles or quads. Nodes are slightly
+// and deterministically jittered so that ASCII coordinates have realistic
+// lengths. The spec also holds 1 and 3 component node data and 1 component
+// element data. The same arguments always generate the same spec.
+MshSpec generate_mesh(MeshKind kind, size_t cells_per_side);
+
+} // namespace bench
+} // namespace mshio
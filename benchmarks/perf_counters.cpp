@@ -0,0 +1,96 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstring>
+#endif
+
+namespace mshio {
+namespace bench {
+
+namespace {
+
+#ifdef __linux__
+int open_counter(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1; // Include the threads of parallel loads.
+    attr.exclude_hv = 1;
+    // Kernel time is part of the cost of loading, but is often restricted.
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) {
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    return static_cast<int>(fd);
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+    m_fds.fill(-1);
+#ifdef __linux__
+    m_fds[Cycles] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    m_fds[Instructions] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    m_fds[BranchMisses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    // Usually last level cache misses.
+    m_fds[CacheMisses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    m_fds[PageFaults] = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int fd : m_fds) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+const char* PerfCounters::name(Counter counter)
+{
+    switch (counter) {
+    case Cycles: return "cycles";
+    case Instructions: return "instructions";
+    case BranchMisses: return "branch_misses";
+    case CacheMisses: return "llc_misses";
+    default: return "page_faults";
+    }
+}
+
+bool PerfCounters::any_available() const
+{
+    for (int fd : m_fds) {
+        if (fd >= 0) return true;
+    }
+    return false;
+}
+
+PerfCounters::Values PerfCounters::read() const
+{
+    Values values;
+    values.fill(0);
+#ifdef __linux__
+    for (size_t i = 0; i < m_fds.size(); i++) {
+        uint64_t value = 0;
+        if (m_fds[i] >= 0 && ::read(m_fds[i], &value, sizeof(value)) == sizeof(value)) {
+            values[i] = value;
+        }
+    }
+#endif
+    return values;
+}
+
+} // namespace bench
+} // namespace mshio
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace mshio {
+namespace bench {
+
+// Hardware and software counters of the calling process, read through Linux
+// perf_event_open(). Threads created after construction are included once
+// they exit. Counters that cannot be opened, e.g. in containers or with a
+// restrictive perf_event_paranoid, or on other platforms, are unavailable and
+// only wall clock times are reported.
+class PerfCounters
+{
+public:
+    enum Counter { Cycles, Instructions, BranchMisses, CacheMisses, PageFaults, NumCounters };
+    using Values = std::array<uint64_t, NumCounters>;
+
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    static const char* name(Counter counter);
+
+    bool available(Counter counter) const { return m_fds[counter] >= 0; }
+    bool any_available() const;
+
+    // Current values, 0 for unavailable counters.
+    Values read() const;
+
+private:
+    std::array<int, NumCounters> m_fds;
+};
+
+} // namespace bench
+} // namespace mshio
@@ -0,0 +1,33 @@
+# Find zstd and define the imported target `mshio::zstd`, setting
+# MSHIO_ZSTD_TARGET to it when found.
+#
+# The zstd CMake package is used when installed.  Otherwise the header and
+# library are searched for directly.  This file is also installed next to the
+# package config, so that consumers of the static mshio library define the
+# same target, whichever way their zstd is installed.
+
+if (NOT TARGET mshio::zstd)
+    find_package(zstd CONFIG QUIET)
+    if (TARGET zstd::libzstd_shared)
+        add_library(mshio::zstd INTERFACE IMPORTED)
+        set_target_properties(mshio::zstd PROPERTIES
+            INTERFACE_LINK_LIBRARIES zstd::libzstd_shared)
+    elseif (TARGET zstd::libzstd_static)
+        add_library(mshio::zstd INTERFACE IMPORTED)
+        set_target_properties(mshio::zstd PROPERTIES
+            INTERFACE_LINK_LIBRARIES zstd::libzstd_static)
+    else()
+        find_path(ZSTD_INCLUDE_DIR zstd.h)
+        find_library(ZSTD_LIBRARY zstd)
+        if (ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+            add_library(mshio::zstd UNKNOWN IMPORTED)
+            set_target_properties(mshio::zstd PROPERTIES
+                IMPORTED_LOCATION "${ZSTD_LIBRARY}"
+                INTERFACE_INCLUDE_DIRECTORIES "${ZSTD_INCLUDE_DIR}")
+        endif()
+    endif()
+endif()
+
+if (TARGET mshio::zstd)
+    set(MSHIO_ZSTD_TARGET mshio::zstd)
+endif()
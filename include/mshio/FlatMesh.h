@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+
+namespace mshio {
+
+// Elements of a single type with 0-based, contiguous node indices.
+struct FlatElements
+{
+    int element_type = 0;
+    size_t nodes_per_element = 0;
+    size_t num_elements = 0;
+    std::vector<size_t> connectivity; // num_elements * nodes_per_element node indices.
+    std::vector<size_t> tags; // Original element tags.
+    std::vector<int> entity_tags;
+    std::vector<int> physical_tags; // First physical group of the entity, 0 if none.
+};
+
+// Mesh with all nodes in a single coordinate array and one connectivity array
+// per element type, as expected by most solvers.
+struct FlatMesh
+{
+    size_t num_nodes = 0;
+    std::vector<double> coords; // num_nodes * 3 values: x, y and z of each node.
+    std::vector<size_t> node_tags; // Original tag of each node.
+    std::vector<FlatElements> element_types; // In order of first appearance.
+};
+
+// Renumber the nodes of `spec` contiguously, in block order, and gather its
+// elements by type on up to `num_threads` threads (0 means all hardware
+// threads). Throws CorruptData if an element refers to an unknown node.
+FlatMesh flatten(const MshSpec& spec, size_t num_threads = 1);
+
+} // namespace mshio
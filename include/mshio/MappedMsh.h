@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+
+namespace mshio {
+
+class MappedFile;
+
+// Binary payloads in a MSH file are not aligned, so mapped blocks expose raw
+// byte pointers into the file along with accessors that read individual values.
+struct MappedNodeBlock
+{
+    int entity_dim = 0;
+    int entity_tag = 0;
+    int parametric = 0;
+    size_t num_nodes_in_block = 0;
+    const char* tags = nullptr; // num_nodes_in_block size_t values.
+    const char* data = nullptr; // num_nodes_in_block * entries_per_node double values.
+
+    size_t entries_per_node() const
+    {
+        return static_cast<size_t>(3 + ((parametric == 1) ? entity_dim : 0));
+    }
+
+    size_t tag(size_t i) const
+    {
+        size_t value;
+        std::memcpy(&value, tags + i * sizeof(size_t), sizeof(size_t));
+        return value;
+    }
+
+    double coordinate(size_t i) const
+    {
+        double value;
+        std::memcpy(&value, data + i * sizeof(double), sizeof(double));
+        return value;
+    }
+};
+
+struct MappedNodes
+{
+    size_t num_entity_blocks = 0;
+    size_t num_nodes = 0;
+    size_t min_node_tag = 0;
+    size_t max_node_tag = 0;
+    std::vector<MappedNodeBlock> entity_blocks;
+};
+
+struct MappedElementBlock
+{
+    int entity_dim = 0;
+    int entity_tag = 0;
+    int element_type = 0;
+    size_t num_elements_in_block = 0;
+    const char* data = nullptr; // num_elements_in_block * (nodes_per_element + 1) size_t values.
+
+    size_t entry(size_t i) const
+    {
+        size_t value;
+        std::memcpy(&value, data + i * sizeof(size_t), sizeof(size_t));
+        return value;
+    }
+};
+
+struct MappedElements
+{
+    size_t num_entity_blocks = 0;
+    size_t num_elements = 0;
+    size_t min_element_tag = 0;
+    size_t max_element_tag = 0;
+    std::vector<MappedElementBlock> entity_blocks;
+};
+
+// Memory-mapped, zero-copy view of a binary MSH 4.1 file.
+//
+// $Nodes and $Elements blocks are not copied: they point straight into the
+// mapped file and stay valid for the lifetime of this object. All other
+// sections are small and are loaded into `spec()` as usual.
+class MappedMsh
+{
+public:
+    explicit MappedMsh(const std::string& filename);
+    MappedMsh(MappedMsh&& other) noexcept;
+    MappedMsh& operator=(MappedMsh&& other) noexcept;
+    ~MappedMsh();
+
+    MappedMsh(const MappedMsh&) = delete;
+    MappedMsh& operator=(const MappedMsh&) = delete;
+
+    // Every section except $Nodes and $Elements.
+    const MshSpec& spec() const { return m_spec; }
+    const MappedNodes& nodes() const { return m_nodes; }
+    const MappedElements& elements() const { return m_elements; }
+
+private:
+    std::unique_ptr<MappedFile> m_file;
+    MshSpec m_spec;
+    MappedNodes m_nodes;
+    MappedElements m_elements;
+};
+
+} // namespace mshio
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+#include <mshio/options.h>
+
+namespace mshio {
+
+struct SectionInfo
+{
+    std::string name; // Section header, e.g. "$Nodes".
+    std::streamoff begin = 0; // Offset right after the section header.
+    std::streamoff end = 0; // Offset right after the closing "$End..." token.
+};
+
+// Random access handle to a MSH file.
+//
+// Opening a file only builds a table of contents of its sections (plus the
+// mesh format and the headers of post-processing data). Sections are then
+// parsed on demand, so e.g. a single $NodeData view can be read from a large
+// results file without touching the mesh.
+//
+// For MSH 2.2 files, `load_nodes()` returns all nodes in a single block since
+// regrouping nodes by entity requires the elements. With `options.partition`,
+// `load_nodes()` and `load_elements()` also parse the $PartitionedEntities
+// section, from which the blocks of the partition are selected.
+//
+// The file is opened like in load_msh(), following `options`. Compressed files
+// cannot be read at random offsets, so they are decompressed into memory.
+class MshFile
+{
+public:
+    explicit MshFile(const std::string& filename, const LoadOptions& options = {});
+
+    const MeshFormat& mesh_format() const { return m_mesh_format; }
+    const std::vector<SectionInfo>& sections() const { return m_sections; }
+    bool has_section(const std::string& name) const;
+
+    Nodes load_nodes();
+    Elements load_elements();
+    Entities load_entities();
+    Vector<PhysicalGroup> load_physical_groups();
+
+    const std::vector<DataHeader>& node_data_headers() const { return m_node_data.headers; }
+    const std::vector<DataHeader>& element_data_headers() const { return m_element_data.headers; }
+    const std::vector<DataHeader>& element_node_data_headers() const
+    {
+        return m_element_node_data.headers;
+    }
+
+    Data load_node_data(size_t index);
+    Data load_element_data(size_t index);
+    Data load_element_node_data(size_t index);
+
+private:
+    struct DataSections
+    {
+        std::vector<size_t> sections; // Indices into m_sections.
+        std::vector<DataHeader> headers;
+    };
+
+    MshSpec load_sections(const std::string& name);
+    Data load_data(const DataSections& data_sections, size_t index);
+    void seek(const SectionInfo& section);
+
+private:
+    std::unique_ptr<std::istream> m_in;
+    LoadOptions m_options;
+    MeshFormat m_mesh_format;
+    std::vector<SectionInfo> m_sections;
+    DataSections m_node_data;
+    DataSections m_element_data;
+    DataSections m_element_node_data;
+};
+
+} // namespace mshio
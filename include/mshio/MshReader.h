@@ -0,0 +1,72 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+#include <mshio/options.h>
+
+namespace mshio {
+
+class NodeBlockLoader;
+class ElementBlockLoader;
+
+// Pull-based incremental reader, keeping a single block in memory:
+//
+//     MshReader reader("mesh.msh");
+//     while (const NodeBlock* block = reader.next_node_block()) { ... }
+//     while (const ElementBlock* block = reader.next_element_block()) { ... }
+//
+// Sections are read in file order. Small sections (format, physical groups,
+// entities) are loaded into the reader as they are reached. Asking for
+// element blocks skips any remaining node blocks, while asking for node blocks
+// stops at the next $Elements section. Post-processing data is not read.
+//
+// The returned block is reused by the next call. MSH 2.2 blocks are formed as
+// in the streaming visitor API, see MshVisitor.
+class MshReader
+{
+public:
+    explicit MshReader(const std::string& filename, const LoadOptions& options = {});
+    explicit MshReader(std::istream& in, const LoadOptions& options = {});
+    ~MshReader();
+
+    MshReader(const MshReader&) = delete;
+    MshReader& operator=(const MshReader&) = delete;
+
+    const MeshFormat& mesh_format() const { return m_spec.mesh_format; }
+    const Vector<PhysicalGroup>& physical_groups() const { return m_spec.physical_groups; }
+    // For MSH 2.2, entities are only known once all element blocks are read.
+    const Entities& entities() const { return m_spec.entities; }
+
+    // Headers of the last $Nodes/$Elements section reached, without blocks.
+    // For MSH 2.2, min/max tags are only known once all blocks are read.
+    const Nodes& nodes() const { return m_spec.nodes; }
+    const Elements& elements() const { return m_spec.elements; }
+
+    // Returns nullptr when there are no more blocks of this kind.
+    const NodeBlock* next_node_block();
+    const ElementBlock* next_element_block();
+
+private:
+    void init();
+    bool advance();
+    void skip_current_section();
+    void finish_current_section();
+
+private:
+    std::unique_ptr<std::istream> m_file; // Owned stream, when reading a file.
+    std::istream* m_in = nullptr;
+    LoadOptions m_options;
+    MshSpec m_spec;
+
+    std::string m_section; // Current $Nodes/$Elements/data section, if any.
+    std::unique_ptr<NodeBlockLoader> m_node_loader;
+    std::unique_ptr<ElementBlockLoader> m_element_loader;
+    NodeBlock m_node_block;
+    ElementBlock m_element_block;
+};
+
+} // namespace mshio
@@ -1,9 +1,9 @@
 #pragma once
 
 #include <string>
-#include <vector>
 
 #include <mshio/MshSpecExt.h>
+#include <mshio/allocator.h>
 
 namespace mshio {
 
@@ -20,8 +20,16 @@ struct NodeBlock
     int entity_tag = 0;
     int parametric = 0;
     size_t num_nodes_in_block = 0;
-    std::vector<size_t> tags;
-    std::vector<double> data;
+    Vector<size_t> tags;
+    Vector<double> data;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(NodeBlock)
+    explicit NodeBlock(const allocator_type& alloc)
+        : tags(alloc)
+        , data(alloc)
+    {}
+#endif
 };
 
 struct Nodes
@@ -30,7 +38,14 @@ struct Nodes
     size_t num_nodes = 0;
     size_t min_node_tag = 0;
     size_t max_node_tag = 0;
-    std::vector<NodeBlock> entity_blocks;
+    Vector<NodeBlock> entity_blocks;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(Nodes)
+    explicit Nodes(const allocator_type& alloc)
+        : entity_blocks(alloc)
+    {}
+#endif
 };
 
 struct ElementBlock
@@ -39,7 +54,14 @@ struct ElementBlock
     int entity_tag = 0;
     int element_type = 0;
     size_t num_elements_in_block = 0;
-    std::vector<size_t> data;
+    Vector<size_t> data;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(ElementBlock)
+    explicit ElementBlock(const allocator_type& alloc)
+        : data(alloc)
+    {}
+#endif
 };
 
 struct Elements
@@ -48,35 +70,91 @@ struct Elements
     size_t num_elements = 0;
     size_t min_element_tag = 0;
     size_t max_element_tag = 0;
-    std::vector<ElementBlock> entity_blocks;
+    Vector<ElementBlock> entity_blocks;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(Elements)
+    explicit Elements(const allocator_type& alloc)
+        : entity_blocks(alloc)
+    {}
+#endif
 };
 
 struct DataHeader
 {
-    std::vector<std::string> string_tags; // [view name, <interpolation scheeme>]
-    std::vector<double> real_tags; // [time value]
-    std::vector<int> int_tags; // [time step, num fields, num entries, partition id]
+    Vector<std::string> string_tags; // [view name, <interpolation scheeme>]
+    Vector<double> real_tags; // [time value]
+    Vector<int> int_tags; // [time step, num fields, num entries, partition id]
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(DataHeader)
+    explicit DataHeader(const allocator_type& alloc)
+        : string_tags(alloc)
+        , real_tags(alloc)
+        , int_tags(alloc)
+    {}
+#endif
 };
 
 struct DataEntry
 {
     size_t tag = 0;
     int num_nodes_per_element = 0; // Only used by ElementNodeData.
-    std::vector<double> data;
+    Vector<double> data;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(DataEntry)
+    explicit DataEntry(const allocator_type& alloc)
+        : data(alloc)
+    {}
+#endif
 };
 
 struct Data
 {
     DataHeader header;
-    std::vector<DataEntry> entries;
+    Vector<DataEntry> entries;
+
+    // Compact alternative to `entries`, filled instead of it when loading with
+    // `LoadOptions::compact_data`. Entry `i` targets `tags[i]` and its values
+    // are stored contiguously in `values`: `values[i * num_fields + k]` for
+    // node and element data, and `values[offsets[i] + j * num_fields + k]`
+    // for the j-th node of element-node data, with `offsets` of size
+    // `tags.size() + 1`. `num_fields` is `header.int_tags[1]`.
+    Vector<size_t> tags;
+    Vector<size_t> offsets; // Only used by ElementNodeData.
+    Vector<double> values;
+
+    bool is_compact() const { return entries.empty() && !tags.empty(); }
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(Data)
+    explicit Data(const allocator_type& alloc)
+        : header(alloc)
+        , entries(alloc)
+        , tags(alloc)
+        , offsets(alloc)
+        , values(alloc)
+    {}
+#endif
 };
 
+// Section holding a post-processing view.
+enum class DataKind { NodeData, ElementData, ElementNodeData };
+
 struct PointEntity {
     int tag = 0;
     double x = 0.0;
     double y = 0.0;
     double z = 0.0;
-    std::vector<int> physical_group_tags;
+    Vector<int> physical_group_tags;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(PointEntity)
+    explicit PointEntity(const allocator_type& alloc)
+        : physical_group_tags(alloc)
+    {}
+#endif
 };
 
 struct CurveEntity {
@@ -87,8 +165,16 @@ struct CurveEntity {
     double max_x = 0.0;
     double max_y = 0.0;
     double max_z = 0.0;
-    std::vector<int> physical_group_tags;
-    std::vector<int> boundary_point_tags;
+    Vector<int> physical_group_tags;
+    Vector<int> boundary_point_tags;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(CurveEntity)
+    explicit CurveEntity(const allocator_type& alloc)
+        : physical_group_tags(alloc)
+        , boundary_point_tags(alloc)
+    {}
+#endif
 };
 
 struct SurfaceEntity {
@@ -99,8 +185,16 @@ struct SurfaceEntity {
     double max_x = 0.0;
     double max_y = 0.0;
     double max_z = 0.0;
-    std::vector<int> physical_group_tags;
-    std::vector<int> boundary_curve_tags;
+    Vector<int> physical_group_tags;
+    Vector<int> boundary_curve_tags;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(SurfaceEntity)
+    explicit SurfaceEntity(const allocator_type& alloc)
+        : physical_group_tags(alloc)
+        , boundary_curve_tags(alloc)
+    {}
+#endif
 };
 
 struct VolumeEntity {
@@ -111,20 +205,116 @@ struct VolumeEntity {
     double max_x = 0.0;
     double max_y = 0.0;
     double max_z = 0.0;
-    std::vector<int> physical_group_tags;
-    std::vector<int> boundary_surface_tags;
+    Vector<int> physical_group_tags;
+    Vector<int> boundary_surface_tags;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(VolumeEntity)
+    explicit VolumeEntity(const allocator_type& alloc)
+        : physical_group_tags(alloc)
+        , boundary_surface_tags(alloc)
+    {}
+#endif
 };
 
 struct Entities {
-    std::vector<PointEntity> points;
-    std::vector<CurveEntity> curves;
-    std::vector<SurfaceEntity> surfaces;
-    std::vector<VolumeEntity> volumes;
+    Vector<PointEntity> points;
+    Vector<CurveEntity> curves;
+    Vector<SurfaceEntity> surfaces;
+    Vector<VolumeEntity> volumes;
 
     bool empty() const {
         return points.size() == 0 && curves.size() == 0 && surfaces.size() == 0
             && volumes.size() == 0;
     }
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(Entities)
+    explicit Entities(const allocator_type& alloc)
+        : points(alloc)
+        , curves(alloc)
+        , surfaces(alloc)
+        , volumes(alloc)
+    {}
+#endif
+};
+
+// Entity of a partitioned mesh, as listed in the $PartitionedEntities section.
+// Node and element blocks refer to these tags, and each of them is a piece of
+// the model entity `parent_tag` of dimension `parent_dim`.
+struct PartitionedEntity
+{
+    int tag = 0;
+    int parent_dim = 0;
+    int parent_tag = 0;
+    Vector<int> partition_tags;
+    // Bounding box. Points only use min_x, min_y and min_z, their coordinates.
+    double min_x = 0.0;
+    double min_y = 0.0;
+    double min_z = 0.0;
+    double max_x = 0.0;
+    double max_y = 0.0;
+    double max_z = 0.0;
+    Vector<int> physical_group_tags;
+    Vector<int> boundary_tags; // Entities of one dimension less. Unused by points.
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(PartitionedEntity)
+    explicit PartitionedEntity(const allocator_type& alloc)
+        : partition_tags(alloc)
+        , physical_group_tags(alloc)
+        , boundary_tags(alloc)
+    {}
+#endif
+};
+
+// Entity holding the ghost elements of a partition.
+struct GhostEntity
+{
+    int tag = 0;
+    int partition = 0;
+};
+
+struct PartitionedEntities
+{
+    size_t num_partitions = 0;
+    Vector<GhostEntity> ghost_entities;
+    Vector<PartitionedEntity> points;
+    Vector<PartitionedEntity> curves;
+    Vector<PartitionedEntity> surfaces;
+    Vector<PartitionedEntity> volumes;
+
+    bool empty() const
+    {
+        return num_partitions == 0 && ghost_entities.empty() && points.empty() &&
+               curves.empty() && surfaces.empty() && volumes.empty();
+    }
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(PartitionedEntities)
+    explicit PartitionedEntities(const allocator_type& alloc)
+        : ghost_entities(alloc)
+        , points(alloc)
+        , curves(alloc)
+        , surfaces(alloc)
+        , volumes(alloc)
+    {}
+#endif
+};
+
+// Element owned by `partition` and present as a ghost in `ghost_partition_tags`.
+struct GhostElement
+{
+    size_t tag = 0;
+    int partition = 0;
+    Vector<int> ghost_partition_tags;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(GhostElement)
+    explicit GhostElement(const allocator_type& alloc)
+        : ghost_partition_tags(alloc)
+    {}
+#endif
 };
 
 struct PhysicalGroup
@@ -140,15 +330,36 @@ struct MshSpec
     Nodes nodes;
     Elements elements;
     Entities entities;
-    std::vector<PhysicalGroup> physical_groups;
-    std::vector<Data> node_data;
-    std::vector<Data> element_data;
-    std::vector<Data> element_node_data;
+    Vector<PhysicalGroup> physical_groups;
+    Vector<Data> node_data;
+    Vector<Data> element_data;
+    Vector<Data> element_node_data;
+
+    // Partitioned meshes (MSH 4.1 only).
+    PartitionedEntities partitioned_entities;
+    Vector<GhostElement> ghost_elements;
 
     // Custom sections
     NanoSplineFormat nanospline_format;
-    std::vector<Curve> curves;
-    std::vector<Patch> patches;
+    Vector<Curve> curves;
+    Vector<Patch> patches;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(MshSpec)
+    explicit MshSpec(const allocator_type& alloc)
+        : nodes(alloc)
+        , elements(alloc)
+        , entities(alloc)
+        , physical_groups(alloc)
+        , node_data(alloc)
+        , element_data(alloc)
+        , element_node_data(alloc)
+        , partitioned_entities(alloc)
+        , ghost_elements(alloc)
+        , curves(alloc)
+        , patches(alloc)
+    {}
+#endif
 };
 
 } // namespace mshio
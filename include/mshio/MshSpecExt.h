@@ -1,7 +1,8 @@
 #pragma once
 
 #include <string>
-#include <vector>
+
+#include <mshio/allocator.h>
 
 namespace mshio {
 
@@ -18,7 +19,14 @@ struct Curve
     size_t num_control_points = 0;
     size_t num_knots = 0;
     size_t with_weights = 0;
-    std::vector<double> data;
+    Vector<double> data;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(Curve)
+    explicit Curve(const allocator_type& alloc)
+        : data(alloc)
+    {}
+#endif
 };
 
 struct Patch
@@ -31,7 +39,14 @@ struct Patch
     size_t num_u_knots = 0;
     size_t num_v_knots = 0;
     size_t with_weights = 0;
-    std::vector<double> data;
+    Vector<double> data;
+
+#ifdef MSHIO_WITH_PMR
+    MSHIO_ALLOCATOR_AWARE(Patch)
+    explicit Patch(const allocator_type& alloc)
+        : data(alloc)
+    {}
+#endif
 };
 
 }
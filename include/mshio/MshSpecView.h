@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+
+namespace mshio {
+
+// Non-owning counterparts of NodeBlock, ElementBlock and Data, pointing to
+// arrays owned by the caller. They are written by `save_msh()` and
+// `MshWriter` straight from these arrays, without being copied into a
+// MshSpec first. The arrays must stay valid until writing is done.
+//
+// Tag arrays may be left null, in which case consecutive tags starting from
+// `first_tag` are written.
+
+struct NodeBlockView
+{
+    int entity_dim = 0;
+    int entity_tag = 0;
+    int parametric = 0;
+    size_t num_nodes_in_block = 0;
+    const size_t* tags = nullptr; // num_nodes_in_block node tags.
+    size_t first_tag = 1;
+    const double* data = nullptr; // num_nodes_in_block * (3 + parametric dims) values.
+};
+
+struct ElementBlockView
+{
+    int entity_dim = 0;
+    int entity_tag = 0;
+    int element_type = 0;
+    size_t num_elements_in_block = 0;
+    const size_t* tags = nullptr; // num_elements_in_block element tags.
+    size_t first_tag = 1;
+    const size_t* connectivity = nullptr; // num_elements_in_block * nodes_per_element values.
+    size_t node_offset = 0; // Added to each connectivity value, e.g. 1 for 0-based indices.
+};
+
+// Same layout as the compact storage of `Data`.
+struct DataView
+{
+    DataHeader header; // int_tags[2] must match num_entries.
+    size_t num_entries = 0;
+    const size_t* tags = nullptr;
+    size_t first_tag = 1;
+    const size_t* offsets = nullptr; // num_entries + 1 offsets, only used by ElementNodeData.
+    const double* values = nullptr;
+};
+
+// MshSpec made of views. Only the small header sections are held by value.
+struct MshSpecView
+{
+    MeshFormat mesh_format;
+    Vector<PhysicalGroup> physical_groups;
+    Entities entities;
+    std::vector<NodeBlockView> node_blocks;
+    std::vector<ElementBlockView> element_blocks;
+    std::vector<DataView> node_data;
+    std::vector<DataView> element_data;
+    std::vector<DataView> element_node_data;
+};
+
+} // namespace mshio
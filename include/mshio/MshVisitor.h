@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include <mshio/MshSpec.h>
+
+namespace mshio {
+
+// Callbacks for streaming a MSH file with `load_msh(in, visitor)`, which never
+// holds more than one node block, element block or data entry in memory.
+//
+// Blocks and entries are scratch buffers reused for the next callback: copy or
+// move out anything that needs to outlive the call. `Nodes` and `Elements`
+// headers are passed without their entity blocks.
+//
+// MSH 2.2 files have no entity blocks. Their nodes are reported in chunks with
+// entity 0 and elements in chunks of consecutive elements sharing the same type
+// and entity. The entities implied by the element tags are reported after the
+// $Elements section, and min/max tags are only filled in the `on_*_end()`
+// headers. Unlike `load_msh()`, nodes are not regrouped by entity.
+class MshVisitor
+{
+public:
+    virtual ~MshVisitor() = default;
+
+    virtual void on_mesh_format(const MeshFormat& /*format*/) {}
+    virtual void on_physical_groups(const Vector<PhysicalGroup>& /*groups*/) {}
+    virtual void on_entities(const Entities& /*entities*/) {}
+
+    virtual void on_nodes_begin(const Nodes& /*header*/) {}
+    virtual void on_node_block(NodeBlock& /*block*/) {}
+    virtual void on_nodes_end(const Nodes& /*header*/) {}
+
+    virtual void on_elements_begin(const Elements& /*header*/) {}
+    virtual void on_element_block(ElementBlock& /*block*/) {}
+    virtual void on_elements_end(const Elements& /*header*/) {}
+
+    virtual void on_data_begin(DataKind /*kind*/, const DataHeader& /*header*/) {}
+    virtual void on_data_entry(DataKind /*kind*/, DataEntry& /*entry*/) {}
+    virtual void on_data_end(DataKind /*kind*/) {}
+};
+
+} // namespace mshio
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
+#include <mshio/options.h>
+
+namespace mshio {
+
+// Incremental writer, emitting blocks as they are produced instead of
+// requiring a complete MshSpec:
+//
+//     MshWriter writer("mesh.msh");
+//     writer.begin_nodes();
+//     for (...) writer.write_node_block(block);
+//     writer.end_nodes();
+//     writer.begin_elements();
+//     ...
+//
+// Section headers are written by `begin_*()` from the given counts. Counts
+// left at 0 (num_nodes, num_elements or the number of data entries in
+// int_tags[2]) are filled in by `end_*()`, which requires a seekable output.
+// Counts that do not match the written blocks raise InvalidFormat unless they
+// can be patched in place. For the same reason, file names with a compressed
+// extension (".gz" or ".zst") are rejected with UnsupportedFeature; use
+// save_msh() to write compressed files.
+//
+// `close()` flushes the output and throws std::runtime_error if anything
+// failed to be written. The destructor closes the file too, but cannot report
+// errors.
+class MshWriter
+{
+public:
+    explicit MshWriter(const std::string& filename,
+        const MeshFormat& format = {},
+        const SaveOptions& options = {});
+    explicit MshWriter(
+        std::ostream& out, const MeshFormat& format = {}, const SaveOptions& options = {});
+    ~MshWriter();
+
+    MshWriter(const MshWriter&) = delete;
+    MshWriter& operator=(const MshWriter&) = delete;
+
+    const MeshFormat& mesh_format() const { return m_format; }
+
+    void write_physical_groups(const Vector<PhysicalGroup>& physical_groups);
+    void write_entities(const Entities& entities);
+
+    // The entity blocks of `header` are ignored.
+    void begin_nodes(const Nodes& header = {});
+    void write_node_block(const NodeBlock& block);
+    void write_node_block(const NodeBlockView& block);
+    void end_nodes();
+
+    // The entity blocks of `header` are ignored.
+    void begin_elements(const Elements& header = {});
+    void write_element_block(const ElementBlock& block);
+    void write_element_block(const ElementBlockView& block);
+    void end_elements();
+
+    // `header` requires at least 3 int tags: time step, fields per entry and
+    // number of entries.
+    void begin_data(DataKind kind, const DataHeader& header);
+    void write_data_entry(const DataEntry& entry);
+    void end_data();
+
+    // Flush the output, and close the file if the writer opened it. Throws
+    // std::runtime_error if writing failed. Nothing may be written afterwards.
+    void close();
+
+private:
+    void init();
+    void begin_section(const std::string& name);
+    void check_section(const std::string& name) const;
+    void end_section();
+    void write_header(const std::string& header, bool patchable);
+    void finish_header(const std::string& header);
+
+private:
+    std::vector<char> m_buffer;
+    std::unique_ptr<std::ofstream> m_file;
+    std::ostream* m_out = nullptr;
+    MeshFormat m_format;
+    SaveOptions m_options;
+
+    std::string m_section; // Currently open section, if any.
+    std::string m_header; // Header written for the open section.
+    std::streampos m_header_pos = -1; // Where `m_header` starts, if it can be patched.
+    size_t m_header_padding = 0; // Spaces reserved in front of `m_header`.
+
+    Nodes m_nodes; // Counts of the blocks written so far.
+    Elements m_elements;
+    DataKind m_data_kind = DataKind::NodeData;
+    DataHeader m_data_header;
+};
+
+} // namespace mshio
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+
+namespace mshio {
+
+// Lookup of nodes by tag, e.g. to resolve the node tags of element blocks.
+//
+// Tags are used directly as offsets into a dense array when they are compact
+// (`max_node_tag - min_node_tag` less than twice the number of nodes), and are
+// otherwise hashed into a flat open addressing table. Both are built on up to
+// `num_threads` threads, and lookups are O(1).
+//
+// The index refers to the blocks of `nodes`, which must outlive it and keep
+// their tags and coordinates in place. Node tags are expected to be unique; a
+// duplicated tag resolves to its last occurrence in block order, whatever the
+// number of threads.
+class NodeIndex
+{
+public:
+    static constexpr size_t invalid = std::numeric_limits<size_t>::max();
+
+    struct Location
+    {
+        size_t block = invalid; // Index in `nodes.entity_blocks`.
+        size_t index = invalid; // Index of the node in the block.
+
+        bool valid() const { return block != invalid; }
+    };
+
+    NodeIndex() = default;
+    explicit NodeIndex(const Nodes& nodes, size_t num_threads = 1);
+
+    // Number of indexed nodes.
+    size_t size() const { return m_size; }
+    bool is_dense() const { return m_dense; }
+
+    bool contains(size_t tag) const { return lookup(tag) != empty_value; }
+
+    // Returns an invalid location for unknown tags.
+    Location find(size_t tag) const
+    {
+        const uint64_t value = lookup(tag);
+        if (value == empty_value) return Location();
+        return {static_cast<size_t>(value >> index_bits),
+            static_cast<size_t>(value & ((uint64_t(1) << index_bits) - 1))};
+    }
+
+    // Pointer to the x, y and z coordinates of node `tag`, or nullptr for
+    // unknown tags.
+    const double* coords(size_t tag) const
+    {
+        const Location location = find(tag);
+        if (!location.valid()) return nullptr;
+        return m_block_data[location.block] + location.index * m_block_strides[location.block];
+    }
+
+    // Copy the x, y and z coordinates of `num_tags` nodes to `coords`, which
+    // must hold 3 * num_tags values. Throws CorruptData for unknown tags.
+    void gather_coords(
+        const size_t* tags, size_t num_tags, double* coords, size_t num_threads = 1) const;
+
+    // Coordinates of the nodes of every element of `block`, in element order:
+    // `nodes_per_element * 3` values per element.
+    std::vector<double> gather_coords(const ElementBlock& block, size_t num_threads = 1) const;
+
+private:
+    static constexpr int index_bits = 40;
+    static constexpr uint64_t empty_value = std::numeric_limits<uint64_t>::max();
+
+    struct Slot
+    {
+        size_t tag = invalid;
+        uint64_t value = empty_value; // Block and index packed into 64 bits.
+    };
+
+    static uint64_t hash(size_t tag)
+    {
+        return static_cast<uint64_t>(tag) * 0x9E3779B97F4A7C15ull;
+    }
+
+    uint64_t lookup(size_t tag) const
+    {
+        if (m_dense) {
+            return (tag >= m_min_tag && tag - m_min_tag < m_dense_values.size())
+                       ? m_dense_values[tag - m_min_tag]
+                       : empty_value;
+        }
+        if (m_slots.empty()) return empty_value;
+
+        // The table is split into regions selected by the top bits of the
+        // hash, and probing wraps around within a region.
+        const uint64_t h = hash(tag);
+        const size_t region =
+            m_region_bits > 0 ? static_cast<size_t>(h >> (64 - m_region_bits)) : 0;
+        const Slot* slots = m_slots.data() + (region << m_slot_bits);
+        const size_t mask = (size_t(1) << m_slot_bits) - 1;
+        size_t i = static_cast<size_t>(h >> (64 - m_region_bits - m_slot_bits)) & mask;
+        while (true) {
+            const Slot& slot = slots[i];
+            if (slot.tag == tag) return slot.value;
+            if (slot.value == empty_value) return empty_value;
+            i = (i + 1) & mask;
+        }
+    }
+
+private:
+    size_t m_size = 0;
+    bool m_dense = true;
+
+    // Dense storage: value of node `m_min_tag + i` at index i.
+    size_t m_min_tag = 0;
+    std::vector<uint64_t> m_dense_values;
+
+    // Hash table: 2^m_region_bits regions of 2^m_slot_bits slots.
+    int m_region_bits = 0;
+    int m_slot_bits = 0;
+    std::vector<Slot> m_slots;
+
+    std::vector<const double*> m_block_data;
+    std::vector<size_t> m_block_strides;
+};
+
+} // namespace mshio
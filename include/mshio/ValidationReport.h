@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <mshio/MshSpec.h>
+
+namespace mshio {
+
+enum class IssueKind {
+    InvalidHeader, // Counts, tag ranges or data headers that do not match the content.
+    InvalidBlock, // Block sizes or element types.
+    DuplicateNodeTag,
+    DuplicateElementTag,
+    MissingNode, // Element referring to an unknown node.
+    MissingEntity, // Block or entity referring to an unknown entity.
+    MissingPhysicalGroup, // Physical group not used by any entity.
+    InvalidData, // Data entry with an unknown tag or an unexpected number of values.
+};
+
+enum class IssueSeverity {
+    // The spec is corrupt: inconsistent counts, tag ranges or block sizes,
+    // duplicate tags or elements referring to unknown nodes.
+    Error,
+    // The spec can be saved, but refers to unknown entities, has unused
+    // physical groups, element types not matching the dimension of their
+    // entity, or inconsistent data views.
+    Warning,
+};
+
+struct ValidationIssue
+{
+    IssueKind kind;
+    IssueSeverity severity;
+    std::string message;
+};
+
+struct ValidationReport
+{
+    // The first `max_issues` issues, in section order.
+    std::vector<ValidationIssue> issues;
+    size_t num_issues = 0; // Total number of issues found.
+    size_t num_errors = 0; // Number of issues with IssueSeverity::Error.
+
+    bool valid() const { return num_issues == 0; }
+    bool has_errors() const { return num_errors > 0; }
+};
+
+// Check `spec` on up to `num_threads` threads (0 means all hardware threads)
+// and report every issue instead of stopping at the first one. Besides sizes
+// and tag ranges, it checks that node and element tags are unique, that
+// elements only refer to existing nodes, and that blocks, entities, physical
+// groups and data entries only refer to existing entities, nodes and
+// elements. References are only checked if `spec` has nodes, elements or
+// entities of that dimension, as data and hand written files often omit them.
+// Only errors make `validate_spec()` throw.
+ValidationReport check_spec(const MshSpec& spec, size_t num_threads = 1, size_t max_issues = 100);
+
+} // namespace mshio
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#ifdef MSHIO_WITH_PMR
+#include <memory_resource>
+#endif
+
+namespace mshio {
+
+// Containers of MshSpec. When built with MSHIO_WITH_PMR, they are std::pmr
+// vectors: a spec constructed with an allocator, e.g. by load_msh() with
+// `LoadOptions::memory_resource`, allocates all of its nested vectors from the
+// same memory resource. Strings, such as names and tags of data views, are
+// short and kept as std::string.
+#ifdef MSHIO_WITH_PMR
+
+template <typename T>
+using Vector = std::pmr::vector<T>;
+using Allocator = std::pmr::polymorphic_allocator<char>;
+
+// Constructors through which std::pmr containers pass their allocator to the
+// structs they hold. Each struct also defines `T(const allocator_type&)`,
+// constructing all of its containers with that allocator.
+#define MSHIO_ALLOCATOR_AWARE(T)                                        \
+    using allocator_type = Allocator;                                   \
+    T() = default;                                                      \
+    T(const T& other, const allocator_type& alloc)                      \
+        : T(alloc)                                                      \
+    {                                                                   \
+        *this = other;                                                  \
+    }                                                                   \
+    T(T&& other, const allocator_type& alloc)                           \
+        : T(alloc)                                                      \
+    {                                                                   \
+        *this = std::move(other);                                       \
+    }
+
+#else
+
+template <typename T>
+using Vector = std::vector<T>;
+
+#endif
+
+} // namespace mshio
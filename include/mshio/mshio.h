@@ -2,18 +2,58 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include <mshio/FlatMesh.h>
+#include <mshio/MappedMsh.h>
+#include <mshio/MshFile.h>
+#include <mshio/MshReader.h>
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
+#include <mshio/MshVisitor.h>
+#include <mshio/MshWriter.h>
+#include <mshio/NodeIndex.h>
+#include <mshio/ValidationReport.h>
+#include <mshio/options.h>
 
 namespace mshio {
 
-MshSpec load_msh(std::istream& in);
-MshSpec load_msh(const std::string& filename);
-
-void save_msh(std::ostream& out, const MshSpec& spec);
-void save_msh(const std::string& filename, const MshSpec& spec);
-
-void validate_spec(const MshSpec& spec);
+MshSpec load_msh(std::istream& in, const LoadOptions& options = {});
+MshSpec load_msh(const std::string& filename, const LoadOptions& options = {});
+
+// Stream the content of a MSH file to `visitor` section by section.
+void load_msh(std::istream& in, MshVisitor& visitor, const LoadOptions& options = {});
+void load_msh(const std::string& filename, MshVisitor& visitor, const LoadOptions& options = {});
+
+// Load the partition files "<basename>_1.msh", "<basename>_2.msh", ... that
+// Gmsh writes with Mesh.PartitionSplitMeshFiles, up to `options.num_threads`
+// files at a time. A trailing ".msh" in `basename` is ignored. Partitions are
+// allocated from the default memory resource, as `options.memory_resource`
+// would be used from several threads.
+std::vector<MshSpec> load_msh_partitions(
+    const std::string& basename, const LoadOptions& options = {});
+
+// Load the partition files of `basename` and merge them into a single spec.
+MshSpec load_partitioned_msh(const std::string& basename, const LoadOptions& options = {});
+
+// Merge partitions into a single spec. Blocks and data views of the same
+// entity or view are concatenated in partition order, and the nodes,
+// elements and data entries whose tags already appeared in an earlier
+// partition, e.g. nodes on partition boundaries, are dropped.
+MshSpec merge_partitions(const std::vector<MshSpec>& partitions, size_t num_threads = 1);
+
+void save_msh(std::ostream& out, const MshSpec& spec, const SaveOptions& options = {});
+void save_msh(
+    const std::string& filename, const MshSpec& spec, const SaveOptions& options = {});
+
+// Save a mesh whose node, element and data arrays are owned by the caller.
+void save_msh(std::ostream& out, const MshSpecView& spec, const SaveOptions& options = {});
+void save_msh(
+    const std::string& filename, const MshSpecView& spec, const SaveOptions& options = {});
+
+// Throw CorruptData describing the first error found by `check_spec()`.
+// Warnings, e.g. unused physical groups, are ignored.
+void validate_spec(const MshSpec& spec, size_t num_threads = 1);
 
 size_t nodes_per_element(int element_type);
 int get_element_dim(int element_type);
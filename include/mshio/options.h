@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef MSHIO_WITH_PMR
+#include <memory_resource>
+#endif
+
+namespace mshio {
+
+struct LoadOptions
+{
+    // Number of threads used to parse large ASCII $Nodes and $Elements blocks
+    // of MSH 4.1 files and to regroup the nodes of MSH 2.2 files by entity. 1
+    // disables threading and 0 uses all hardware threads.
+    size_t num_threads = 1;
+
+    // Sections to skip without parsing, e.g. {"$ElementNodeData"}. Binary
+    // payloads of known sections are seeked over based on their headers.
+    std::vector<std::string> skipped_sections;
+
+    // Size in bytes of the buffers filled by a background I/O thread ahead of
+    // the parser when loading from a file, e.g. 4 << 20, so that disk access
+    // overlaps with parsing. 0 disables read-ahead.
+    size_t read_ahead_buffer_size = 0;
+
+    // Read files with several large requests in flight, batched through
+    // io_uring on Linux and falling back to pread() on an I/O thread where it
+    // is unavailable.
+    // Buffers are `read_ahead_buffer_size` bytes, or 4 MiB if it is 0. Ignored
+    // on platforms without POSIX file I/O and for files that are not regular
+    // files, e.g. pipes.
+    bool use_io_uring = false;
+
+    // Load post-processing data into the compact `tags`/`offsets`/`values`
+    // arrays of `Data` instead of one `DataEntry` per node or element.
+    bool compact_data = false;
+
+    // Partition to load from a partitioned MSH 4.1 file, 0 for all of them.
+    // Only the node and element blocks of the entities in this partition and
+    // of its ghost entities are kept, and binary blocks of other partitions
+    // are seeked over, as are ghost elements not involving this partition.
+    // Ghost elements may refer to nodes of other partitions.
+    int partition = 0;
+
+    // Called by load_msh() with `begin` true before, and false after, loading
+    // each section, named e.g. "$Nodes", and the final "post_process" step,
+    // e.g. to profile them. Partitions loaded by load_msh_partitions() call it
+    // from several threads.
+    std::function<void(const std::string& phase, bool begin)> on_phase;
+
+#ifdef MSHIO_WITH_PMR
+    // Memory resource of all the containers of the loaded spec, e.g. a
+    // std::pmr::monotonic_buffer_resource that outlives it, so that loading
+    // makes a few large allocations and freeing is a single release. nullptr
+    // uses std::pmr::get_default_resource(). It is only used from the calling
+    // thread, and is ignored by load_msh_partitions().
+    std::pmr::memory_resource* memory_resource = nullptr;
+#endif
+};
+
+struct SaveOptions
+{
+    // Significant digits of floating point numbers in ASCII files. 0 writes
+    // the shortest representation that reads back to the same value. Note that
+    // this differs from earlier versions, which wrote the 6 digits of the
+    // stream's default precision; set it to 6 to get the former output.
+    int precision = 0;
+
+    // Number of threads used to encode large node, element and data payloads,
+    // and by zstd to compress ".zst" files. The output does not depend on it. 1
+    // disables threading and 0 uses all hardware threads.
+    size_t num_threads = 1;
+
+    // Write files with several large 4 MiB requests in flight, batched through
+    // io_uring on Linux and falling back to pwrite() on an I/O thread where it
+    // is unavailable.
+    // Ignored on platforms without POSIX file I/O, and by MshWriter, which
+    // seeks back to patch section headers.
+    bool use_io_uring = false;
+};
+
+} // namespace mshio
@@ -104,6 +104,10 @@ NB_MODULE(pymshio, m)
         .def(nb::init<>())
         .def_rw("header", &mshio::Data::header)
         .def_rw("entries", &mshio::Data::entries)
+        .def_rw("tags", &mshio::Data::tags)
+        .def_rw("offsets", &mshio::Data::offsets)
+        .def_rw("values", &mshio::Data::values)
+        .def("is_compact", &mshio::Data::is_compact)
         .def("__repr__", [](const mshio::Data& self) {
             auto py_header = nb::cast(self.header);
             auto py_entries = nb::cast(self.entries);
@@ -208,6 +212,66 @@ NB_MODULE(pymshio, m)
                    ", volumes=" + std::to_string(self.volumes.size()) + ")";
         });
 
+    nb::class_<mshio::PartitionedEntity>(m, "PartitionedEntity")
+        .def(nb::init<>())
+        .def_rw("tag", &mshio::PartitionedEntity::tag)
+        .def_rw("parent_dim", &mshio::PartitionedEntity::parent_dim)
+        .def_rw("parent_tag", &mshio::PartitionedEntity::parent_tag)
+        .def_rw("partition_tags", &mshio::PartitionedEntity::partition_tags)
+        .def_rw("min_x", &mshio::PartitionedEntity::min_x)
+        .def_rw("min_y", &mshio::PartitionedEntity::min_y)
+        .def_rw("min_z", &mshio::PartitionedEntity::min_z)
+        .def_rw("max_x", &mshio::PartitionedEntity::max_x)
+        .def_rw("max_y", &mshio::PartitionedEntity::max_y)
+        .def_rw("max_z", &mshio::PartitionedEntity::max_z)
+        .def_rw("physical_group_tags", &mshio::PartitionedEntity::physical_group_tags)
+        .def_rw("boundary_tags", &mshio::PartitionedEntity::boundary_tags)
+        .def("__repr__", [](const mshio::PartitionedEntity& self) {
+            return "PartitionedEntity(tag=" + std::to_string(self.tag) +
+                   ", parent_dim=" + std::to_string(self.parent_dim) +
+                   ", parent_tag=" + std::to_string(self.parent_tag) +
+                   ", partition_tags=" + std::to_string(self.partition_tags.size()) + ")";
+        });
+
+    nb::class_<mshio::GhostEntity>(m, "GhostEntity")
+        .def(nb::init<>())
+        .def_rw("tag", &mshio::GhostEntity::tag)
+        .def_rw("partition", &mshio::GhostEntity::partition)
+        .def("__repr__", [](const mshio::GhostEntity& self) {
+            return "GhostEntity(tag=" + std::to_string(self.tag) +
+                   ", partition=" + std::to_string(self.partition) + ")";
+        });
+
+    nb::class_<mshio::PartitionedEntities>(m, "PartitionedEntities")
+        .def(nb::init<>())
+        .def("empty", &mshio::PartitionedEntities::empty)
+        .def_rw("num_partitions", &mshio::PartitionedEntities::num_partitions)
+        .def_rw("ghost_entities", &mshio::PartitionedEntities::ghost_entities)
+        .def_rw("points", &mshio::PartitionedEntities::points)
+        .def_rw("curves", &mshio::PartitionedEntities::curves)
+        .def_rw("surfaces", &mshio::PartitionedEntities::surfaces)
+        .def_rw("volumes", &mshio::PartitionedEntities::volumes)
+        .def("__repr__", [](const mshio::PartitionedEntities& self) {
+            return "PartitionedEntities(num_partitions=" + std::to_string(self.num_partitions) +
+                   ", ghost_entities=" + std::to_string(self.ghost_entities.size()) +
+                   ", points=" + std::to_string(self.points.size()) +
+                   ", curves=" + std::to_string(self.curves.size()) +
+                   ", surfaces=" + std::to_string(self.surfaces.size()) +
+                   ", volumes=" + std::to_string(self.volumes.size()) + ")";
+        });
+
+    nb::class_<mshio::GhostElement>(m, "GhostElement")
+        .def(nb::init<>())
+        .def_rw("tag", &mshio::GhostElement::tag)
+        .def_rw("partition", &mshio::GhostElement::partition)
+        .def_rw("ghost_partition_tags", &mshio::GhostElement::ghost_partition_tags)
+        .def("__repr__", [](const mshio::GhostElement& self) {
+            return "GhostElement(tag=" + std::to_string(self.tag) +
+                   ", partition=" + std::to_string(self.partition) +
+                   ", ghost_partition_tags=" + std::to_string(self.ghost_partition_tags.size()) +
+                   ")";
+        });
+
     nb::class_<mshio::PhysicalGroup>(m, "PhysicalGroup")
         .def(nb::init<>())
         .def_rw("dim", &mshio::PhysicalGroup::dim)
@@ -228,6 +292,8 @@ NB_MODULE(pymshio, m)
         .def_rw("node_data", &mshio::MshSpec::node_data)
         .def_rw("element_data", &mshio::MshSpec::element_data)
         .def_rw("element_node_data", &mshio::MshSpec::element_node_data)
+        .def_rw("partitioned_entities", &mshio::MshSpec::partitioned_entities)
+        .def_rw("ghost_elements", &mshio::MshSpec::ghost_elements)
         .def("__repr__", [](const mshio::MshSpec& self) {
             auto py_mesh_format = nb::cast(self.mesh_format);
             auto py_nodes = nb::cast(self.nodes);
@@ -251,10 +317,73 @@ NB_MODULE(pymshio, m)
                    nb::cast<std::string>(py_element_node_data.attr("__repr__")()) + ")";
         });
 
-    m.def("load_msh", nb::overload_cast<const std::string&>(&mshio::load_msh));
-    m.def(
-        "save_msh", nb::overload_cast<const std::string&, const mshio::MshSpec&>(&mshio::save_msh));
-    m.def("validate_spec", &mshio::validate_spec);
+    nb::class_<mshio::FlatElements>(m, "FlatElements")
+        .def(nb::init<>())
+        .def_rw("element_type", &mshio::FlatElements::element_type)
+        .def_rw("nodes_per_element", &mshio::FlatElements::nodes_per_element)
+        .def_rw("num_elements", &mshio::FlatElements::num_elements)
+        .def_rw("connectivity", &mshio::FlatElements::connectivity)
+        .def_rw("tags", &mshio::FlatElements::tags)
+        .def_rw("entity_tags", &mshio::FlatElements::entity_tags)
+        .def_rw("physical_tags", &mshio::FlatElements::physical_tags)
+        .def("__repr__", [](const mshio::FlatElements& self) {
+            return "FlatElements(element_type=" + std::to_string(self.element_type) +
+                   ", nodes_per_element=" + std::to_string(self.nodes_per_element) +
+                   ", num_elements=" + std::to_string(self.num_elements) + ")";
+        });
+
+    nb::class_<mshio::FlatMesh>(m, "FlatMesh")
+        .def(nb::init<>())
+        .def_rw("num_nodes", &mshio::FlatMesh::num_nodes)
+        .def_rw("coords", &mshio::FlatMesh::coords)
+        .def_rw("node_tags", &mshio::FlatMesh::node_tags)
+        .def_rw("element_types", &mshio::FlatMesh::element_types)
+        .def("__repr__", [](const mshio::FlatMesh& self) {
+            return "FlatMesh(num_nodes=" + std::to_string(self.num_nodes) +
+                   ", element_types=" + std::to_string(self.element_types.size()) + ")";
+        });
+
+    nb::enum_<mshio::IssueKind>(m, "IssueKind")
+        .value("InvalidHeader", mshio::IssueKind::InvalidHeader)
+        .value("InvalidBlock", mshio::IssueKind::InvalidBlock)
+        .value("DuplicateNodeTag", mshio::IssueKind::DuplicateNodeTag)
+        .value("DuplicateElementTag", mshio::IssueKind::DuplicateElementTag)
+        .value("MissingNode", mshio::IssueKind::MissingNode)
+        .value("MissingEntity", mshio::IssueKind::MissingEntity)
+        .value("MissingPhysicalGroup", mshio::IssueKind::MissingPhysicalGroup)
+        .value("InvalidData", mshio::IssueKind::InvalidData);
+
+    nb::enum_<mshio::IssueSeverity>(m, "IssueSeverity")
+        .value("Error", mshio::IssueSeverity::Error)
+        .value("Warning", mshio::IssueSeverity::Warning);
+
+    nb::class_<mshio::ValidationIssue>(m, "ValidationIssue")
+        .def_ro("kind", &mshio::ValidationIssue::kind)
+        .def_ro("severity", &mshio::ValidationIssue::severity)
+        .def_ro("message", &mshio::ValidationIssue::message)
+        .def("__repr__", [](const mshio::ValidationIssue& self) { return self.message; });
+
+    nb::class_<mshio::ValidationReport>(m, "ValidationReport")
+        .def_ro("issues", &mshio::ValidationReport::issues)
+        .def_ro("num_issues", &mshio::ValidationReport::num_issues)
+        .def_ro("num_errors", &mshio::ValidationReport::num_errors)
+        .def("valid", &mshio::ValidationReport::valid)
+        .def("has_errors", &mshio::ValidationReport::has_errors)
+        .def("__repr__", [](const mshio::ValidationReport& self) {
+            return "ValidationReport(num_issues=" + std::to_string(self.num_issues) + ")";
+        });
+
+    m.def("load_msh", [](const std::string& filename) { return mshio::load_msh(filename); });
+    m.def("save_msh", [](const std::string& filename, const mshio::MshSpec& spec) {
+        mshio::save_msh(filename, spec);
+    });
+    m.def("validate_spec", &mshio::validate_spec, nb::arg("spec"), nb::arg("num_threads") = 1);
+    m.def("check_spec",
+        &mshio::check_spec,
+        nb::arg("spec"),
+        nb::arg("num_threads") = 1,
+        nb::arg("max_issues") = 100);
+    m.def("flatten", &mshio::flatten, nb::arg("spec"), nb::arg("num_threads") = 1);
     m.def("nodes_per_element", &mshio::nodes_per_element);
     m.def("get_element_dim", &mshio::get_element_dim);
 }
@@ -0,0 +1,470 @@
+#include "ascii_reader.h"
+
+#include "memory_streambuf.h"
+#include "parallel_utils.h"
+
+#include <mshio/exception.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+namespace mshio {
+
+double AsciiReader::read_double()
+{
+    // Long enough for any round-trip representation of a double.
+    constexpr size_t max_length = 64;
+    char token[max_length + 1];
+    size_t length = 0;
+
+    int ch = skip_white_space();
+    while (ch != std::char_traits<char>::eof() && !is_space(ch)) {
+        if (length == max_length) invalid_token("floating point number");
+        token[length++] = static_cast<char>(ch);
+        ch = next();
+    }
+    check_delimiter(ch, "floating point number");
+    if (length == 0) invalid_token("floating point number");
+    token[length] = '\0';
+
+    // `from_chars` does not accept a leading '+', which `operator>>` does.
+    const char* first = token;
+    const char* last = token + length;
+    if (*first == '+') first++;
+
+    double value = 0.0;
+#if defined(__cpp_lib_to_chars)
+    auto result = std::from_chars(first, last, value);
+    if (result.ec == std::errc::result_out_of_range) {
+        // Match `operator>>` and saturate to +/-inf or 0 instead of failing.
+        value = std::strtod(first, nullptr);
+    } else if (result.ec != std::errc() || result.ptr != last) {
+        invalid_token("floating point number");
+    }
+#else
+    char* end = nullptr;
+    value = std::strtod(first, &end);
+    if (end != last) invalid_token("floating point number");
+#endif
+    return value;
+}
+
+void AsciiReader::invalid_token(const char* expected)
+{
+    m_in.setstate(std::ios_base::failbit);
+    throw InvalidFormat(std::string("Invalid ASCII token, expecting ") + expected + ".");
+}
+
+namespace {
+
+// Rows below this count are not worth the threading overhead.
+constexpr size_t min_parallel_rows = 1 << 14;
+
+// Text is parsed in windows of about this many bytes, split into chunks of
+// lines of at least `min_chunk_bytes` bytes.
+constexpr size_t window_bytes = 1 << 22;
+constexpr size_t min_chunk_bytes = 1 << 16;
+
+bool is_space(char ch)
+{
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\v' || ch == '\f';
+}
+
+size_t count_tokens(const char* begin, const char* end)
+{
+    size_t count = 0;
+    bool in_token = false;
+    for (const char* ch = begin; ch != end; ++ch) {
+        if (!is_space(*ch) && !in_token) count++;
+        in_token = !is_space(*ch);
+    }
+    return count;
+}
+
+// End of the `n`-th line of [begin, end), which holds at least `n` lines.
+const char* skip_lines(const char* begin, const char* end, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        begin = std::find(begin, end, '\n') + 1;
+    }
+    return begin;
+}
+
+// Access to the get area of any stream buffer, through pointers to the
+// protected members of std::streambuf.
+struct GetArea : public std::streambuf
+{
+    static const char* begin(std::streambuf* buf) { return (buf->*&GetArea::gptr)(); }
+    static const char* end(std::streambuf* buf) { return (buf->*&GetArea::egptr)(); }
+
+    // Move the next character to `pos`, which lies in the get area.
+    static void set_next(std::streambuf* buf, const char* pos)
+    {
+        char* first = (buf->*&GetArea::eback)();
+        (buf->*&GetArea::setg)(first, first + (pos - first), (buf->*&GetArea::egptr)());
+    }
+};
+
+template <typename T>
+void parse_chunk(const char* begin, const char* end, T* values, size_t num_values)
+{
+    MemoryStreamBuf buffer(begin, static_cast<size_t>(end - begin));
+    std::istream in(&buffer);
+    AsciiReader reader(in);
+    for (size_t i = 0; i < num_values; i++) {
+        reader.read(values[i]);
+    }
+    in >> std::ws;
+    if (!in.eof()) {
+        throw InvalidFormat("Unexpected number of values on a line.");
+    }
+}
+
+// Complete lines of text, either in place in the get area of the stream buffer
+// or copied out of it, split into chunks that are parsed independently.
+struct Window
+{
+    std::vector<char> storage; // Copy of the text, unless parsed in place.
+    bool in_place = false;
+    std::streambuf::pos_type position = 0; // Stream position of the copied text.
+    std::vector<const char*> offsets; // Chunk boundaries.
+    std::vector<size_t> rows; // First row of each chunk, and the row after the last.
+    size_t next_chunk = 0; // Next chunk to parse.
+    size_t num_pending = 0; // Chunks not parsed yet.
+    bool busy = false; // Filled, or being filled, and not entirely parsed.
+
+    size_t num_chunks() const { return offsets.size() - 1; }
+};
+
+// Parse rows one per line on a single parallel_for, whose threads both pull
+// windows of text from the stream buffer and parse their chunks.
+//
+// One thread at a time fills a window, while the others parse the chunks of the
+// previous one. Get areas of at least `window_bytes` bytes, those holding the
+// last row and those of stream buffers that cannot seek back are parsed in
+// place: the stream buffer must then not refill its get area before they are
+// parsed. Other get areas are copied into the window until it holds
+// `window_bytes` bytes.
+//
+// If a chunk fails to parse, the rows before it are kept and the stream buffer
+// goes back to its start, so that the caller parses the rest serially.
+template <typename T>
+class RowReader
+{
+public:
+    RowReader(std::istream& in, size_t num_rows, size_t row_size, T* values)
+        : m_in(in)
+        , m_buf(in.rdbuf())
+        , m_num_rows(num_rows)
+        , m_row_size(row_size)
+        , m_values(values)
+    {
+        m_seekable = m_buf->pubseekoff(0, std::ios_base::cur, std::ios_base::in) !=
+                     std::streambuf::pos_type(std::streambuf::off_type(-1));
+    }
+
+    size_t run(size_t num_threads)
+    {
+        parallel_for(num_threads, num_threads, [&](size_t) {
+            try {
+                work();
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_cv.notify_all();
+                throw;
+            }
+        });
+        if (m_failed_row == none) return m_rows_filled;
+
+        if (m_failed_in_place) {
+            GetArea::set_next(m_buf, m_failed_pointer);
+        } else if (m_buf->pubseekpos(m_failed_position, std::ios_base::in) !=
+                   m_failed_position) {
+            throw InvalidFormat("Unable to seek back to unparsed ASCII rows.");
+        }
+        return m_failed_row;
+    }
+
+private:
+    static constexpr size_t none = static_cast<size_t>(-1);
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop) {
+            if (!m_queue.empty()) {
+                parse_next_chunk(lock);
+                continue;
+            }
+            if (m_done) break;
+
+            Window* window = nullptr;
+            if (!m_filling) {
+                for (auto& w : m_windows) {
+                    if (!w.busy) window = &w;
+                }
+            }
+            if (window == nullptr) {
+                m_cv.wait(lock);
+                continue;
+            }
+
+            m_filling = true;
+            window->busy = true;
+            lock.unlock();
+            const bool more = fill(*window);
+            lock.lock();
+            m_filling = false;
+            window->num_pending = more ? window->num_chunks() : 0;
+            window->busy = window->num_pending > 0;
+            if (more) m_rows_filled = window->rows.back();
+            if (window->busy) {
+                m_queue.push_back(window);
+                if (window->in_place) m_num_in_place++;
+            }
+            m_done = !more || m_rows_filled == m_num_rows;
+            m_cv.notify_all();
+        }
+    }
+
+    void parse_next_chunk(std::unique_lock<std::mutex>& lock)
+    {
+        Window& window = *m_queue.front();
+        const size_t c = window.next_chunk++;
+        if (window.next_chunk == window.num_chunks()) m_queue.pop_front();
+        lock.unlock();
+
+        bool parsed = true;
+        try {
+            parse_chunk(window.offsets[c],
+                window.offsets[c + 1],
+                m_values + window.rows[c] * m_row_size,
+                (window.rows[c + 1] - window.rows[c]) * m_row_size);
+        } catch (const InvalidFormat&) {
+            // Rows spanning several lines (or several rows on a line): let the
+            // serial parser deal with it.
+            parsed = false;
+        }
+
+        lock.lock();
+        if (!parsed && window.rows[c] < m_failed_row) {
+            // Chunks are handed out in order, so the ones before have been
+            // parsed once the threads are done.
+            m_failed_row = window.rows[c];
+            m_failed_in_place = window.in_place;
+            m_failed_pointer = window.offsets[c];
+            if (!window.in_place) {
+                m_failed_position =
+                    window.position + (window.offsets[c] - window.storage.data());
+            }
+            m_stop = true;
+        }
+        if (--window.num_pending == 0) {
+            window.busy = false;
+            if (window.in_place) m_num_in_place--;
+        }
+        m_cv.notify_all();
+    }
+
+    // Wait, helping with the parsing, until no window is parsed in place, so
+    // that the get area can be refilled. Returns false if reading stopped.
+    bool wait_for_get_area()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_num_in_place > 0 && !m_stop) {
+            if (!m_queue.empty()) {
+                parse_next_chunk(lock);
+            } else {
+                m_cv.wait(lock);
+            }
+        }
+        return !m_stop;
+    }
+
+    // Fill `window` with the next lines. Returns false if there is nothing
+    // left to parse in parallel.
+    bool fill(Window& window)
+    {
+        // Skip to the next row.
+        while (true) {
+            const char* begin = GetArea::begin(m_buf);
+            const char* end = GetArea::end(m_buf);
+            const char* next = std::find_if(begin, end, [](char ch) { return !is_space(ch); });
+            GetArea::set_next(m_buf, next);
+            if (next != end) break;
+            if (!wait_for_get_area()) return false;
+            if (m_buf->sgetc() == std::char_traits<char>::eof()) return false;
+        }
+
+        const char* begin = GetArea::begin(m_buf);
+        const char* end = GetArea::end(m_buf);
+        const char* first_eol = std::find(begin, end, '\n');
+        if (m_rows_filled == 0 && first_eol != end &&
+            count_tokens(begin, first_eol) != m_row_size) {
+            // The first line tells cheaply whether the file uses the
+            // one-row-per-line layout at all.
+            return false;
+        }
+
+        const size_t max_rows = m_num_rows - m_rows_filled;
+        const size_t size = static_cast<size_t>(end - begin);
+        if (size >= window_bytes || !m_seekable ||
+            static_cast<size_t>(std::count(begin, end, '\n')) >= max_rows) {
+            const char* last_eol = end;
+            if (size > window_bytes) {
+                last_eol = std::find(begin + window_bytes, end, '\n');
+                if (last_eol != end) last_eol++;
+            }
+            while (last_eol != begin && *(last_eol - 1) != '\n') --last_eol;
+            if (last_eol != begin) {
+                window.in_place = true;
+                GetArea::set_next(m_buf, split(window, begin, last_eol));
+                return true;
+            }
+            if (!m_seekable) {
+                // The get area holds no complete line: read the row serially,
+                // which refills the get area.
+                if (!wait_for_get_area()) return false;
+                AsciiReader reader(m_in);
+                for (size_t k = 0; k < m_row_size; k++) {
+                    reader.read(m_values[m_rows_filled * m_row_size + k]);
+                }
+                window.offsets.assign(1, nullptr);
+                window.rows.assign(1, m_rows_filled + 1);
+                return true;
+            }
+        }
+
+        // Copy complete lines, up to the last row, until the window is full.
+        window.in_place = false;
+        window.position = m_buf->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+        window.storage.clear();
+        size_t num_rows = 0;
+        while (true) {
+            begin = GetArea::begin(m_buf);
+            end = GetArea::end(m_buf);
+            if (begin == end) {
+                if (!wait_for_get_area()) return false;
+                if (m_buf->sgetc() != std::char_traits<char>::eof()) continue;
+                // Terminate the last line of the stream.
+                const char* text_end = window.storage.data() + window.storage.size();
+                const char* last_line = text_end;
+                while (last_line != window.storage.data() && *(last_line - 1) != '\n') --last_line;
+                if (count_tokens(last_line, text_end) > 0) window.storage.push_back('\n');
+                break;
+            }
+
+            const char* next = end;
+            const size_t wanted = window_bytes - std::min(window_bytes, window.storage.size());
+            if (static_cast<size_t>(end - begin) > wanted) {
+                const char* eol = std::find(begin + wanted, end, '\n');
+                if (eol != end) next = eol + 1;
+            }
+            const size_t n = static_cast<size_t>(std::count(begin, next, '\n'));
+            if (num_rows + n >= max_rows) {
+                next = skip_lines(begin, next, max_rows - num_rows);
+                num_rows = max_rows;
+            } else {
+                num_rows += n;
+            }
+            window.storage.insert(window.storage.end(), begin, next);
+            GetArea::set_next(m_buf, next);
+            if (num_rows == max_rows ||
+                (window.storage.size() >= window_bytes && window.storage.back() == '\n')) {
+                break;
+            }
+        }
+        if (window.storage.empty()) return false;
+        split(window, window.storage.data(), window.storage.data() + window.storage.size());
+        return true;
+    }
+
+    // Split the lines in [begin, end) into chunks, up to the last row. Returns
+    // the end of the last chunk.
+    const char* split(Window& window, const char* begin, const char* end)
+    {
+        const size_t last_row = m_num_rows;
+        size_t row = m_rows_filled;
+        window.offsets.assign(1, begin);
+        window.rows.assign(1, row);
+        window.next_chunk = 0;
+        while (begin != end && row < last_row) {
+            const char* next = end;
+            if (static_cast<size_t>(end - begin) > min_chunk_bytes) {
+                const char* eol = std::find(begin + min_chunk_bytes, end, '\n');
+                if (eol != end) next = eol + 1;
+            }
+            const size_t n = static_cast<size_t>(std::count(begin, next, '\n'));
+            if (row + n >= last_row) {
+                next = skip_lines(begin, next, last_row - row);
+                row = last_row;
+            } else {
+                row += n;
+            }
+            window.offsets.push_back(next);
+            window.rows.push_back(row);
+            begin = next;
+        }
+        return begin;
+    }
+
+private:
+    std::istream& m_in;
+    std::streambuf* m_buf;
+    const size_t m_num_rows;
+    const size_t m_row_size;
+    T* const m_values;
+    bool m_seekable = false;
+
+    Window m_windows[2];
+    std::deque<Window*> m_queue; // Windows with chunks left to parse, in order.
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    size_t m_rows_filled = 0; // Rows of the windows filled so far.
+    size_t m_num_in_place = 0; // Windows parsed in place, not parsed yet.
+    bool m_filling = false;
+    bool m_done = false;
+    bool m_stop = false;
+
+    size_t m_failed_row = none;
+    bool m_failed_in_place = false;
+    const char* m_failed_pointer = nullptr;
+    std::streambuf::pos_type m_failed_position = 0;
+};
+
+template <typename T>
+size_t read_rows_parallel_impl(
+    std::istream& in, size_t num_rows, size_t row_size, T* values, size_t num_threads)
+{
+    num_threads = resolve_num_threads(num_threads);
+    if (num_threads <= 1 || num_rows < min_parallel_rows) return 0;
+    return RowReader<T>(in, num_rows, row_size, values).run(num_threads);
+}
+
+} // namespace
+
+size_t read_rows_parallel(
+    std::istream& in, size_t num_rows, size_t row_size, size_t* values, size_t num_threads)
+{
+    return read_rows_parallel_impl(in, num_rows, row_size, values, num_threads);
+}
+
+size_t read_rows_parallel(
+    std::istream& in, size_t num_rows, size_t row_size, double* values, size_t num_threads)
+{
+    return read_rows_parallel_impl(in, num_rows, row_size, values, num_threads);
+}
+
+} // namespace mshio
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <istream>
+#include <limits>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+namespace mshio {
+
+// Locale-free tokenizer for the ASCII encoding of MSH files.
+//
+// Characters are pulled straight from the stream buffer of `in`, so reading can
+// be freely interleaved with regular `std::istream` operations on `in`.
+// Integers are parsed inline and floating point numbers with `std::from_chars`.
+// Malformed numbers, and integers out of the range of the destination type,
+// raise `InvalidFormat`.
+class AsciiReader
+{
+public:
+    explicit AsciiReader(std::istream& in)
+        : m_in(in)
+        , m_buf(in.rdbuf())
+    {}
+
+    template <typename T>
+    void read(T& value)
+    {
+        static_assert(std::is_arithmetic<T>::value, "Only numbers can be read.");
+        read_number(value, std::is_integral<T>());
+    }
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        read(value);
+        return value;
+    }
+
+private:
+    template <typename T>
+    void read_number(T& value, std::true_type /*is_integral*/)
+    {
+        int ch = skip_white_space();
+        bool negative = false;
+        if (ch == '-' || ch == '+') {
+            negative = (ch == '-');
+            ch = next();
+        }
+        if (!is_digit(ch)) invalid_token("integer");
+
+        constexpr unsigned long long max_value = std::numeric_limits<unsigned long long>::max();
+        unsigned long long result = 0;
+        bool overflow = false;
+        do {
+            const auto digit = static_cast<unsigned long long>(ch - '0');
+            overflow = overflow || result > (max_value - digit) / 10;
+            result = result * 10 + digit;
+            ch = next();
+        } while (is_digit(ch));
+        check_delimiter(ch, "integer");
+
+        // Like `std::from_chars`, reject values that do not fit in T.
+        unsigned long long limit = static_cast<unsigned long long>(std::numeric_limits<T>::max());
+        if (negative) limit = std::is_signed<T>::value ? limit + 1 : 0;
+        if (overflow || result > limit) invalid_token("integer in range");
+
+        value = negative ? static_cast<T>(0 - result) : static_cast<T>(result);
+    }
+
+    template <typename T>
+    void read_number(T& value, std::false_type /*is_integral*/)
+    {
+        value = static_cast<T>(read_double());
+    }
+
+    double read_double();
+
+    static bool is_digit(int ch) { return ch >= '0' && ch <= '9'; }
+    static bool is_space(int ch)
+    {
+        return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\v' || ch == '\f';
+    }
+
+    int next()
+    {
+        m_buf->sbumpc();
+        return m_buf->sgetc();
+    }
+
+    int skip_white_space()
+    {
+        int ch = m_buf->sgetc();
+        while (is_space(ch)) {
+            ch = next();
+        }
+        return ch;
+    }
+
+    void check_delimiter(int ch, const char* expected)
+    {
+        if (ch == std::char_traits<char>::eof()) {
+            m_in.setstate(std::ios_base::eofbit);
+        } else if (!is_space(ch)) {
+            invalid_token(expected);
+        }
+    }
+
+    [[noreturn]] void invalid_token(const char* expected);
+
+private:
+    std::istream& m_in;
+    std::streambuf* m_buf;
+};
+
+// Parse up to `num_rows` rows of `row_size` numbers each from `in` on up to
+// `num_threads` threads. Text is taken from the stream buffer in windows of a
+// few MiB of complete lines, parsed in place in large get areas (e.g. the whole
+// region of a memory-mapped file) and copied out of smaller ones if the stream
+// can seek back. Windows are split into chunks on line boundaries, so each row
+// has to be on its own line, as written by Gmsh and MshIO. The same threads
+// fill the next window while parsing the chunks of the current one.
+//
+// Returns the number of rows read, with `in` positioned right after them. It
+// stops early if the parallel path does not apply: too few rows or a different
+// line layout. The caller should then parse the remaining rows serially.
+size_t read_rows_parallel(
+    std::istream& in, size_t num_rows, size_t row_size, size_t* values, size_t num_threads);
+size_t read_rows_parallel(
+    std::istream& in, size_t num_rows, size_t row_size, double* values, size_t num_threads);
+
+} // namespace mshio
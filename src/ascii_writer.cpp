@@ -0,0 +1,87 @@
+#include "ascii_writer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
+#if !defined(__cpp_lib_to_chars)
+#include <clocale>
+#endif
+
+namespace mshio {
+
+#if !defined(__cpp_lib_to_chars)
+namespace {
+
+// `snprintf` writes the decimal point of the C locale, which MSH files do not
+// follow. Replace it with '.' in the `length` characters at `str`, and return
+// the new length.
+int use_dot_as_decimal_point(char* str, int length)
+{
+    const char* point = std::localeconv()->decimal_point;
+    const size_t point_length = std::strlen(point);
+    if (point_length == 0 || (point_length == 1 && point[0] == '.')) return length;
+    char* pos = std::strstr(str, point);
+    if (pos == nullptr) return length;
+    *pos = '.';
+    std::memmove(pos + 1, pos + point_length, std::strlen(pos + point_length) + 1);
+    return length - static_cast<int>(point_length - 1);
+}
+
+} // namespace
+#endif
+
+AsciiWriter& AsciiWriter::operator<<(double value)
+{
+    reserve(max_number_length);
+    char* first = m_buffer.get() + m_size;
+#if defined(__cpp_lib_to_chars)
+    char* last = first + max_number_length;
+    auto result = (m_precision > 0)
+                      ? std::to_chars(first, last, value, std::chars_format::general, m_precision)
+                      : std::to_chars(first, last, value);
+    m_size += static_cast<size_t>(result.ptr - first);
+#else
+    int length = 0;
+    if (m_precision > 0) {
+        length = std::snprintf(first, max_number_length, "%.*g", m_precision, value);
+    } else {
+        // Use the fewest digits that read back to the same value.
+        for (int precision = 15; precision <= 17; precision++) {
+            length = std::snprintf(first, max_number_length, "%.*g", precision, value);
+            if (std::strtod(first, nullptr) == value) break;
+        }
+    }
+    length = use_dot_as_decimal_point(first, length);
+    m_size += static_cast<size_t>(length);
+#endif
+    return *this;
+}
+
+AsciiWriter& AsciiWriter::operator<<(const char* str)
+{
+    const size_t length = std::strlen(str);
+    if (length > m_capacity) {
+        flush();
+        m_out.write(str, static_cast<std::streamsize>(length));
+        return *this;
+    }
+    reserve(length);
+    std::memcpy(m_buffer.get() + m_size, str, length);
+    m_size += length;
+    return *this;
+}
+
+void AsciiWriter::flush()
+{
+    if (m_size == 0) return;
+    const size_t size = m_size;
+    m_size = 0;
+    m_out.write(m_buffer.get(), static_cast<std::streamsize>(size));
+}
+
+} // namespace mshio
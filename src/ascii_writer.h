@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+
+namespace mshio {
+
+// Buffered, locale-free formatter for the ASCII encoding of MSH files.
+//
+// Text is accumulated in a buffer of `buffer_size` bytes and handed to `out` in
+// bulk, so there is no per-line flush or per-number stream overhead. Integers
+// are formatted inline and floating point numbers with `std::to_chars`, either
+// with `precision` significant digits or, if `precision` is 0, with the
+// shortest representation that reads back to the same value. Without
+// `std::to_chars`, numbers fall back to `snprintf`, and the decimal point of
+// the C locale is replaced by '.'.
+//
+// The buffer is written to `out` by `flush()`, so writes to `out` must not be
+// interleaved with writes to the AsciiWriter. Callers flush explicitly: the
+// destructor writes what is left, but drops any error, e.g. the exception of a
+// stream with badbit exceptions enabled.
+class AsciiWriter
+{
+public:
+    static constexpr size_t default_buffer_size = 1 << 14;
+
+    // Enough for any integer or round-trip representation of a double, and
+    // the smallest buffer size.
+    static constexpr size_t max_number_length = 32;
+
+    explicit AsciiWriter(
+        std::ostream& out, int precision = 0, size_t buffer_size = default_buffer_size)
+        : m_out(out)
+        , m_precision(precision < 0 ? 0 : (precision > 17 ? 17 : precision))
+        , m_capacity(buffer_size > max_number_length ? buffer_size : size_t(max_number_length))
+        , m_buffer(new char[m_capacity])
+    {}
+
+    ~AsciiWriter()
+    {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    AsciiWriter(const AsciiWriter&) = delete;
+    AsciiWriter& operator=(const AsciiWriter&) = delete;
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, AsciiWriter&>::type operator<<(T value)
+    {
+        reserve(max_number_length);
+        if (std::is_signed<T>::value && value < 0) {
+            m_buffer[m_size++] = '-';
+            write_digits(0 - static_cast<unsigned long long>(value));
+        } else {
+            write_digits(static_cast<unsigned long long>(value));
+        }
+        return *this;
+    }
+
+    AsciiWriter& operator<<(double value);
+
+    AsciiWriter& operator<<(char ch)
+    {
+        reserve(1);
+        m_buffer[m_size++] = ch;
+        return *this;
+    }
+
+    AsciiWriter& operator<<(const char* str);
+
+    void flush();
+
+private:
+    void reserve(size_t n)
+    {
+        if (m_size + n > m_capacity) flush();
+    }
+
+    void write_digits(unsigned long long value)
+    {
+        char digits[max_number_length];
+        size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        while (n > 0) {
+            m_buffer[m_size++] = digits[--n];
+        }
+    }
+
+private:
+    std::ostream& m_out;
+    int m_precision;
+    size_t m_capacity;
+    size_t m_size = 0;
+    std::unique_ptr<char[]> m_buffer;
+};
+
+} // namespace mshio
@@ -0,0 +1,613 @@
+#include "async_file_streambuf.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef MSHIO_WITH_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mshio {
+
+#ifndef _WIN32
+
+namespace {
+
+constexpr size_t num_buffers = 4;
+constexpr size_t page_size = 4096;
+// Largest transfer of a single read or write on Linux (MAX_RW_COUNT).
+constexpr size_t max_request_size = 0x7ffff000;
+
+std::runtime_error io_error(const std::string& what, int error)
+{
+    return std::runtime_error(what + ": " + std::strerror(error));
+}
+
+#ifdef MSHIO_WITH_IO_URING
+
+// Minimal io_uring wrapper on top of the raw system calls, so that liburing is
+// not required. Requests are queued in the submission ring and handed to the
+// kernel together by `submit()`, with a single io_uring_enter() call; the
+// caller never has more than `entries` of them in flight.
+class IoUring
+{
+public:
+    // Returns nullptr if io_uring is not available.
+    static std::unique_ptr<IoUring> create(unsigned entries)
+    {
+        std::unique_ptr<IoUring> ring(new IoUring());
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring->m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring->m_fd < 0) return nullptr;
+
+        ring->m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            ring->m_sq_size = ring->m_cq_size = std::max(ring->m_sq_size, ring->m_cq_size);
+        }
+        ring->m_sq_ptr = ring->map(ring->m_sq_size, IORING_OFF_SQ_RING);
+        if (ring->m_sq_ptr == nullptr) return nullptr;
+        ring->m_cq_ptr =
+            single_mmap ? ring->m_sq_ptr : ring->map(ring->m_cq_size, IORING_OFF_CQ_RING);
+        if (ring->m_cq_ptr == nullptr) return nullptr;
+        ring->m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        ring->m_sqes = static_cast<io_uring_sqe*>(ring->map(ring->m_sqes_size, IORING_OFF_SQES));
+        if (ring->m_sqes == nullptr) return nullptr;
+
+        char* sq = static_cast<char*>(ring->m_sq_ptr);
+        ring->m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(ring->m_cq_ptr);
+        ring->m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return ring;
+    }
+
+    ~IoUring()
+    {
+        if (m_sqes != nullptr) munmap(m_sqes, m_sqes_size);
+        if (m_cq_ptr != nullptr && m_cq_ptr != m_sq_ptr) munmap(m_cq_ptr, m_cq_size);
+        if (m_sq_ptr != nullptr) munmap(m_sq_ptr, m_sq_size);
+        if (m_fd >= 0) close(m_fd);
+    }
+
+    // Returns false if the buffers cannot be registered, e.g. because of
+    // RLIMIT_MEMLOCK.
+    bool register_buffers(const std::vector<iovec>& buffers)
+    {
+        return syscall(__NR_io_uring_register,
+                   m_fd,
+                   IORING_REGISTER_BUFFERS,
+                   buffers.data(),
+                   static_cast<unsigned>(buffers.size())) == 0;
+    }
+
+    void queue(const io_uring_sqe& request)
+    {
+        const unsigned tail = *m_sq_tail;
+        const unsigned index = tail & m_sq_mask;
+        m_sqes[index] = request;
+        m_sq_array[index] = index;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        m_num_queued++;
+    }
+
+    // Submit all queued requests.
+    void submit()
+    {
+        while (m_num_queued > 0) {
+            const long n = syscall(__NR_io_uring_enter, m_fd, m_num_queued, 0, 0, nullptr, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw io_error("io_uring submission failed", errno);
+            }
+            if (n == 0) throw std::runtime_error("io_uring submission failed");
+            m_num_queued -= static_cast<unsigned>(n);
+        }
+    }
+
+    // Wait for the next completion, returning its user data and result.
+    std::pair<uint64_t, int> wait()
+    {
+        submit();
+        while (true) {
+            const unsigned head = *m_cq_head;
+            if (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe& completion = m_cqes[head & m_cq_mask];
+                const auto result = std::make_pair(
+                    static_cast<uint64_t>(completion.user_data), static_cast<int>(completion.res));
+                __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+                return result;
+            }
+            if (syscall(__NR_io_uring_enter, m_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                errno != EINTR) {
+                throw io_error("io_uring wait failed", errno);
+            }
+        }
+    }
+
+private:
+    IoUring() = default;
+
+    void* map(size_t size, off_t offset)
+    {
+        void* ptr =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+private:
+    int m_fd = -1;
+    void* m_sq_ptr = nullptr;
+    void* m_cq_ptr = nullptr;
+    size_t m_sq_size = 0;
+    size_t m_cq_size = 0;
+    size_t m_sqes_size = 0;
+    io_uring_sqe* m_sqes = nullptr;
+    unsigned* m_sq_tail = nullptr;
+    unsigned* m_sq_array = nullptr;
+    unsigned m_sq_mask = 0;
+    unsigned* m_cq_head = nullptr;
+    unsigned* m_cq_tail = nullptr;
+    unsigned m_cq_mask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+    unsigned m_num_queued = 0;
+};
+
+#endif
+
+// A file with one outstanding read or write per buffer. Requests go through
+// io_uring when available. Otherwise they are performed in order with
+// pread()/pwrite() by a worker thread, so that they still overlap with the
+// caller.
+class AsyncFile
+{
+public:
+    AsyncFile(int fd, size_t buffer_size)
+        : m_fd(fd)
+        , m_requests(num_buffers)
+    {
+        for (auto& request : m_requests) {
+            request.storage.reset(new char[buffer_size + page_size]);
+            const auto address = reinterpret_cast<uintptr_t>(request.storage.get());
+            request.data = request.storage.get() + (page_size - address % page_size) % page_size;
+        }
+
+#ifdef MSHIO_WITH_IO_URING
+        m_ring = IoUring::create(2 * num_buffers);
+        if (m_ring != nullptr) {
+            std::vector<iovec> buffers(num_buffers);
+            for (size_t i = 0; i < num_buffers; i++) {
+                buffers[i].iov_base = m_requests[i].data;
+                buffers[i].iov_len = buffer_size;
+            }
+            m_registered = m_ring->register_buffers(buffers);
+        }
+#endif
+    }
+
+    ~AsyncFile()
+    {
+        // The kernel or the worker may still be writing into the buffers.
+        for (size_t i = 0; i < num_buffers; i++) {
+            try {
+                wait(i);
+            } catch (...) {
+            }
+        }
+        if (m_worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_queued_cv.notify_one();
+            m_worker.join();
+        }
+        close(m_fd);
+    }
+
+    char* data(size_t slot) { return m_requests[slot].data; }
+
+    // Queue the transfer of `size` bytes between buffer `slot` and the file at
+    // `offset`. The slot must not have a pending request. Queued requests start
+    // on the next call to `submit()` or `wait()`.
+    void start(size_t slot, size_t size, off_t offset, bool is_write)
+    {
+        Request& request = m_requests[slot];
+        request.pending = true;
+        request.completed = false;
+        request.error = 0;
+        request.done = 0;
+        request.size = size;
+        request.offset = offset;
+        request.is_write = is_write;
+
+#ifdef MSHIO_WITH_IO_URING
+        if (m_ring != nullptr) {
+            io_uring_sqe sqe;
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.fd = m_fd;
+            sqe.off = static_cast<uint64_t>(offset);
+            sqe.user_data = slot;
+            if (m_registered) {
+                sqe.opcode = is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                sqe.addr = reinterpret_cast<uint64_t>(request.data);
+                // Larger buffers are transferred in several requests, see
+                // `finish()`.
+                sqe.len = static_cast<uint32_t>(std::min<size_t>(size, max_request_size));
+                sqe.buf_index = static_cast<uint16_t>(slot);
+            } else {
+                request.iov.iov_base = request.data;
+                request.iov.iov_len = size;
+                sqe.opcode = is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+                sqe.addr = reinterpret_cast<uint64_t>(&request.iov);
+                sqe.len = 1;
+            }
+            m_ring->queue(sqe);
+            return;
+        }
+#endif
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(slot);
+        }
+        m_queued_cv.notify_one();
+        if (!m_worker.joinable()) {
+            m_worker = std::thread(&AsyncFile::work, this);
+        }
+    }
+
+    // Start all queued requests at once.
+    void submit()
+    {
+#ifdef MSHIO_WITH_IO_URING
+        if (m_ring != nullptr) m_ring->submit();
+#endif
+    }
+
+    // Wait for the request of `slot`, if any, and returns the number of bytes
+    // transferred. Fewer bytes than requested are only transferred at the end
+    // of the file.
+    size_t wait(size_t slot)
+    {
+        Request& request = m_requests[slot];
+        if (!request.pending) return 0;
+        request.pending = false;
+
+#ifdef MSHIO_WITH_IO_URING
+        if (m_ring != nullptr) {
+            while (!request.completed) {
+                const auto completion = m_ring->wait();
+                Request& completed = m_requests[completion.first];
+                completed.completed = true;
+                if (completion.second < 0) {
+                    completed.error = -completion.second;
+                } else {
+                    completed.done = static_cast<size_t>(completion.second);
+                }
+            }
+            // Short transfers are completed synchronously.
+            finish(request);
+        }
+#endif
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_completed_cv.wait(lock, [&]() { return request.completed; });
+        }
+        if (request.error != 0) {
+            throw io_error(request.is_write ? "Write failed" : "Read failed", request.error);
+        }
+        return request.done;
+    }
+
+private:
+    struct Request
+    {
+        std::unique_ptr<char[]> storage;
+        char* data = nullptr; // Page aligned start of storage.
+        bool pending = false;
+        bool completed = false;
+        int error = 0;
+        size_t done = 0; // Bytes transferred.
+        size_t size = 0;
+        off_t offset = 0;
+        bool is_write = false;
+        iovec iov = {};
+    };
+
+    // Transfer what is left of `request` with pread()/pwrite().
+    void finish(Request& request)
+    {
+        while (request.error == 0 && request.done < request.size) {
+            const off_t offset = request.offset + static_cast<off_t>(request.done);
+            char* data = request.data + request.done;
+            const size_t size = request.size - request.done;
+            const ssize_t n = request.is_write ? pwrite(m_fd, data, size, offset)
+                                               : pread(m_fd, data, size, offset);
+            if (n < 0) {
+                if (errno != EINTR) request.error = errno;
+                continue;
+            }
+            if (n == 0) break;
+            request.done += static_cast<size_t>(n);
+        }
+    }
+
+    // Worker thread performing the requests without io_uring.
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_queued_cv.wait(lock, [&]() { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            Request& request = m_requests[m_queue.front()];
+            m_queue.pop_front();
+
+            // The request is not touched by the caller until it is completed.
+            lock.unlock();
+            finish(request);
+            lock.lock();
+            request.completed = true;
+            m_completed_cv.notify_all();
+        }
+    }
+
+private:
+    int m_fd;
+    std::vector<Request> m_requests;
+#ifdef MSHIO_WITH_IO_URING
+    std::unique_ptr<IoUring> m_ring;
+    bool m_registered = false;
+#endif
+
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_queued_cv;
+    std::condition_variable m_completed_cv;
+    std::deque<size_t> m_queue; // Slots of the requests for the worker.
+    bool m_stop = false;
+};
+
+class AsyncInputStreamBuf : public std::streambuf
+{
+public:
+    AsyncInputStreamBuf(int fd, off_t file_size, size_t buffer_size)
+        : m_file(fd, buffer_size)
+        , m_file_size(file_size)
+        , m_buffer_size(buffer_size)
+        , m_offsets(num_buffers, 0)
+    {
+        start(0);
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+        if (m_has_current) {
+            // Reuse the consumed buffer for the next read.
+            m_position = m_offsets[m_current] + (egptr() - eback());
+            submit(m_current);
+            m_file.submit();
+            m_current = (m_current + 1) % num_buffers;
+        }
+        m_has_current = true;
+        const size_t size = m_file.wait(m_current);
+        char* data = m_file.data(m_current);
+        setg(data, data, data + size);
+        if (size == 0) return traits_type::eof();
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off,
+        std::ios_base::seekdir dir,
+        std::ios_base::openmode which = std::ios_base::in) override
+    {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+
+        const off_type current =
+            m_has_current ? m_offsets[m_current] + (gptr() - eback()) : m_position;
+        off_type target = off;
+        if (dir == std::ios_base::cur) target += current;
+        if (dir == std::ios_base::end) target += m_file_size;
+        if (target < 0) return pos_type(off_type(-1));
+
+        if (m_has_current && target >= m_offsets[m_current] &&
+            target <= m_offsets[m_current] + (egptr() - eback())) {
+            setg(eback(), eback() + (target - m_offsets[m_current]), egptr());
+        } else if (target != current) {
+            start(target);
+        }
+        return pos_type(target);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+private:
+    // Drop the buffered data and read ahead from `offset`.
+    void start(off_type offset)
+    {
+        for (size_t i = 0; i < num_buffers; i++) {
+            m_file.wait(i);
+        }
+        setg(nullptr, nullptr, nullptr);
+        m_has_current = false;
+        m_current = 0;
+        m_position = offset;
+        m_next_offset = offset;
+        for (size_t i = 0; i < num_buffers; i++) {
+            submit(i);
+        }
+        m_file.submit();
+    }
+
+    void submit(size_t slot)
+    {
+        m_offsets[slot] = std::min<off_type>(m_next_offset, m_file_size);
+        if (m_next_offset >= m_file_size) return;
+        const size_t size =
+            std::min(m_buffer_size, static_cast<size_t>(m_file_size - m_next_offset));
+        m_file.start(slot, size, static_cast<off_t>(m_next_offset), false);
+        m_next_offset += static_cast<off_type>(size);
+    }
+
+private:
+    AsyncFile m_file;
+    off_type m_file_size;
+    size_t m_buffer_size;
+    std::vector<off_type> m_offsets; // File offset of each buffer.
+    size_t m_current = 0; // Buffer backing the get area, if m_has_current.
+    bool m_has_current = false;
+    off_type m_position = 0; // Position when no buffer is current.
+    off_type m_next_offset = 0; // Offset of the next read to submit.
+};
+
+class AsyncOutputStreamBuf : public std::streambuf
+{
+public:
+    AsyncOutputStreamBuf(int fd, size_t buffer_size)
+        : m_file(fd, buffer_size)
+        , m_buffer_size(buffer_size)
+        , m_sizes(num_buffers, 0)
+    {
+        setp(m_file.data(0), m_file.data(0) + m_buffer_size);
+    }
+
+    ~AsyncOutputStreamBuf() override { sync(); }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        submit_current();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        try {
+            submit_current();
+            for (size_t i = 0; i < num_buffers; i++) {
+                wait(i);
+            }
+        } catch (...) {
+            return -1;
+        }
+        return 0;
+    }
+
+private:
+    // Start writing the put area, then switch to the next buffer.
+    void submit_current()
+    {
+        const size_t size = static_cast<size_t>(pptr() - pbase());
+        if (size == 0) return;
+        m_sizes[m_current] = size;
+        m_file.start(m_current, size, static_cast<off_t>(m_offset), true);
+        m_file.submit();
+        m_offset += static_cast<off_type>(size);
+
+        m_current = (m_current + 1) % num_buffers;
+        wait(m_current);
+        setp(m_file.data(m_current), m_file.data(m_current) + m_buffer_size);
+    }
+
+    void wait(size_t slot)
+    {
+        const size_t expected = m_sizes[slot];
+        m_sizes[slot] = 0;
+        if (m_file.wait(slot) != expected) {
+            throw std::runtime_error("Unable to write output file!");
+        }
+    }
+
+private:
+    AsyncFile m_file;
+    size_t m_buffer_size;
+    std::vector<size_t> m_sizes; // Size of the pending write of each buffer.
+    size_t m_current = 0; // Buffer backing the put area.
+    off_type m_offset = 0; // File offset of the put area.
+};
+
+} // namespace
+
+std::unique_ptr<std::streambuf> open_async_input_file(
+    const std::string& filename, size_t buffer_size)
+{
+    // Reads are sized from the file length, which only regular files have.
+    // Pipes, character devices and procfs files are left to a std::filebuf,
+    // and checked before opening so that they are only opened once.
+    struct stat info;
+    if (stat(filename.c_str(), &info) == 0 && !S_ISREG(info.st_mode)) {
+        return nullptr;
+    }
+    const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Input file does not exist!");
+    }
+    if (fstat(fd, &info) != 0) {
+        const int error = errno;
+        close(fd);
+        throw io_error("Unable to read input file", error);
+    }
+    return std::unique_ptr<std::streambuf>(
+        new AsyncInputStreamBuf(fd, info.st_size, std::max<size_t>(buffer_size, 1)));
+}
+
+std::unique_ptr<std::streambuf> open_async_output_file(
+    const std::string& filename, size_t buffer_size)
+{
+    const int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open output file to write!");
+    }
+    return std::unique_ptr<std::streambuf>(
+        new AsyncOutputStreamBuf(fd, std::max<size_t>(buffer_size, 1)));
+}
+
+#else
+
+std::unique_ptr<std::streambuf> open_async_input_file(const std::string&, size_t)
+{
+    return nullptr;
+}
+
+std::unique_ptr<std::streambuf> open_async_output_file(const std::string&, size_t)
+{
+    return nullptr;
+}
+
+#endif
+
+} // namespace mshio
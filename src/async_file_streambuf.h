@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <streambuf>
+#include <string>
+
+namespace mshio {
+
+// Stream buffers over a file with several large reads or writes in flight at
+// once. On Linux, requests are batched through io_uring with registered
+// buffers. Where io_uring is unavailable (old kernel, seccomp, or built
+// without MSHIO_WITH_IO_URING), they fall back to pread()/pwrite() on a worker
+// thread, one request at a time.
+//
+// Both return nullptr on platforms without POSIX file I/O, and
+// open_async_input_file() also for files that are not regular files, e.g.
+// pipes. The caller should then use a std::fstream instead. They throw
+// std::runtime_error if the file cannot be opened.
+
+constexpr size_t default_async_buffer_size = 4 << 20;
+
+// Input stream buffer keeping up to 4 reads of `buffer_size` bytes in flight
+// ahead of the consumer. It is seekable.
+std::unique_ptr<std::streambuf> open_async_input_file(
+    const std::string& filename, size_t buffer_size);
+
+// Output stream buffer writing `buffer_size` chunks asynchronously. pubsync()
+// waits for all pending writes and returns -1 if any of them failed.
+std::unique_ptr<std::streambuf> open_async_output_file(
+    const std::string& filename, size_t buffer_size);
+
+} // namespace mshio
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "parallel_utils.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace mshio {
+
+// Output stream buffer appending to a std::vector<char>. The storage is kept
+// across `clear()` calls, so a buffer encoding chunk after chunk only
+// allocates until it has reached the size of the largest chunk.
+class ChunkBuffer : public std::streambuf
+{
+public:
+    void clear() { m_data.clear(); }
+    const char* data() const { return m_data.data(); }
+    size_t size() const { return m_data.size(); }
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        m_data.insert(m_data.end(), s, s + n);
+        return n;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            m_data.push_back(traits_type::to_char_type(ch));
+        }
+        return traits_type::not_eof(ch);
+    }
+
+private:
+    std::vector<char> m_data;
+};
+
+// Buffer of write_rows(), with the index of the chunk it holds until the chunk
+// is written.
+struct ChunkSlot
+{
+    static constexpr size_t none = static_cast<size_t>(-1);
+
+    ChunkBuffer buffer;
+    size_t chunk = none;
+};
+
+// Write the `num_rows` rows of a section payload, where
+// `write_range(out, begin, end)` writes rows [begin, end) to `out`.
+//
+// With more than one thread, large payloads are split into chunks of rows that
+// are encoded concurrently by a single parallel_for into a ring of 2 buffers
+// per thread. Finished chunks are written in order by whichever thread
+// completes the next one, while the other threads keep encoding later chunks.
+// The output is therefore identical to the serial one.
+template <typename Fn>
+void write_rows(std::ostream& out, size_t num_rows, size_t num_threads, Fn&& write_range)
+{
+    constexpr size_t chunk_size = 1 << 14;
+    num_threads = resolve_num_threads(num_threads);
+    if (num_threads <= 1 || num_rows < 2 * chunk_size) {
+        write_range(out, size_t(0), num_rows);
+        return;
+    }
+
+    const size_t num_chunks = (num_rows + chunk_size - 1) / chunk_size;
+    num_threads = std::min(num_threads, num_chunks);
+    const size_t num_slots = 2 * num_threads;
+    std::vector<ChunkSlot> slots(num_slots);
+    std::mutex mutex;
+    std::condition_variable slot_freed;
+    size_t next_chunk_to_write = 0;
+    bool writing = false;
+    bool failed = false;
+
+    parallel_for(num_chunks, num_threads, [&](size_t c) {
+        ChunkSlot& slot = slots[c % num_slots];
+        try {
+            {
+                // Wait for the previous chunk of the slot to be written.
+                std::unique_lock<std::mutex> lock(mutex);
+                slot_freed.wait(
+                    lock, [&]() { return failed || c < next_chunk_to_write + num_slots; });
+                if (failed) return;
+            }
+
+            slot.buffer.clear();
+            std::ostream chunk(&slot.buffer);
+            const size_t begin = c * chunk_size;
+            write_range(chunk, begin, std::min(begin + chunk_size, num_rows));
+
+            std::unique_lock<std::mutex> lock(mutex);
+            slot.chunk = c;
+            if (writing) return; // The writing thread will pick it up.
+            writing = true;
+            while (true) {
+                ChunkSlot& next = slots[next_chunk_to_write % num_slots];
+                if (next.chunk != next_chunk_to_write) break;
+                lock.unlock();
+                out.write(next.buffer.data(), static_cast<std::streamsize>(next.buffer.size()));
+                lock.lock();
+                next.chunk = ChunkSlot::none;
+                next_chunk_to_write++;
+                slot_freed.notify_all();
+            }
+            writing = false;
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = true;
+            }
+            slot_freed.notify_all();
+            throw;
+        }
+    });
+}
+
+} // namespace mshio
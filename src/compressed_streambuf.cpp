@@ -0,0 +1,373 @@
+#include "compressed_streambuf.h"
+#include "parallel_utils.h"
+
+#include <mshio/exception.h>
+
+#ifdef MSHIO_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MSHIO_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <stdexcept>
+#include <vector>
+
+namespace mshio {
+
+namespace {
+
+constexpr size_t buffer_size = 1 << 20;
+
+bool ends_with(const std::string& str, const std::string& suffix)
+{
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Input stream buffer over the decompressed content of `source`. Subclasses
+// implement the actual decompression step.
+class DecompressingStreamBuf : public std::streambuf
+{
+public:
+    explicit DecompressingStreamBuf(std::streambuf& source)
+        : m_source(source)
+        , m_input(buffer_size)
+        , m_output(buffer_size)
+    {
+        setg(m_output.data(), m_output.data(), m_output.data());
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+        while (true) {
+            // The decompressor may hold back output when the output buffer is
+            // full, so input is only refilled once it stops producing.
+            if (m_input_begin == m_input_end && !m_has_pending_output) {
+                m_input_begin = 0;
+                m_input_end = static_cast<size_t>(m_source.sgetn(
+                    m_input.data(), static_cast<std::streamsize>(m_input.size())));
+                if (m_input_end == 0) {
+                    check_end();
+                    return traits_type::eof();
+                }
+            }
+
+            const size_t size = decompress();
+            m_has_pending_output = size == m_output.size();
+            if (size > 0) {
+                setg(m_output.data(), m_output.data(), m_output.data() + size);
+                return traits_type::to_int_type(*gptr());
+            }
+        }
+    }
+
+    // Decompress from m_input[m_input_begin, m_input_end) into m_output,
+    // advancing m_input_begin. Returns the number of bytes produced.
+    virtual size_t decompress() = 0;
+
+    // Called once the source is exhausted.
+    virtual void check_end() const = 0;
+
+protected:
+    std::streambuf& m_source;
+    std::vector<char> m_input;
+    std::vector<char> m_output;
+    size_t m_input_begin = 0;
+    size_t m_input_end = 0;
+    bool m_has_pending_output = false;
+};
+
+// Output stream buffer compressing into `sink`. Subclasses implement the actual
+// compression step.
+class BufferedCompressingStreamBuf : public CompressingStreamBuf
+{
+public:
+    explicit BufferedCompressingStreamBuf(std::streambuf& sink)
+        : m_sink(sink)
+        , m_input(buffer_size)
+        , m_output(buffer_size)
+    {
+        setp(m_input.data(), m_input.data() + m_input.size());
+    }
+
+    void finish() override
+    {
+        if (m_finished) return;
+        compress(pbase(), static_cast<size_t>(pptr() - pbase()), true);
+        m_finished = true;
+        setp(m_input.data(), m_input.data());
+        m_sink.pubsync();
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (m_finished) return traits_type::eof();
+        compress(pbase(), static_cast<size_t>(pptr() - pbase()), false);
+        setp(m_input.data(), m_input.data() + m_input.size());
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        if (!m_finished) {
+            compress(pbase(), static_cast<size_t>(pptr() - pbase()), false);
+            setp(m_input.data(), m_input.data() + m_input.size());
+        }
+        return m_sink.pubsync();
+    }
+
+    // Compress `size` bytes of `data`, writing the result to the sink with
+    // `write_output()`. With `end`, also flush and write the end of stream.
+    virtual void compress(const char* data, size_t size, bool end) = 0;
+
+    void write_output(size_t size)
+    {
+        if (static_cast<size_t>(m_sink.sputn(m_output.data(),
+                static_cast<std::streamsize>(size))) != size) {
+            throw std::runtime_error("Unable to write compressed data!");
+        }
+    }
+
+protected:
+    std::streambuf& m_sink;
+    std::vector<char> m_input;
+    std::vector<char> m_output;
+    bool m_finished = false;
+};
+
+#ifdef MSHIO_WITH_ZLIB
+
+class GzipDecompressingStreamBuf : public DecompressingStreamBuf
+{
+public:
+    explicit GzipDecompressingStreamBuf(std::streambuf& source)
+        : DecompressingStreamBuf(source)
+    {
+        // 15 + 16: maximum window size and gzip header.
+        if (inflateInit2(&m_stream, 15 + 16) != Z_OK) {
+            throw std::runtime_error("Unable to initialize gzip decompression!");
+        }
+    }
+
+    ~GzipDecompressingStreamBuf() override { inflateEnd(&m_stream); }
+
+protected:
+    size_t decompress() override
+    {
+        // A gzip file may consist of several concatenated members.
+        if (m_member_end && m_input_begin < m_input_end) {
+            inflateReset(&m_stream);
+            m_member_end = false;
+        }
+
+        m_stream.next_in = reinterpret_cast<Bytef*>(m_input.data() + m_input_begin);
+        m_stream.avail_in = static_cast<uInt>(m_input_end - m_input_begin);
+        m_stream.next_out = reinterpret_cast<Bytef*>(m_output.data());
+        m_stream.avail_out = static_cast<uInt>(m_output.size());
+        const int ret = inflate(&m_stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            m_member_end = true;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            throw CorruptData(std::string("Invalid gzip data: ") +
+                              (m_stream.msg != nullptr ? m_stream.msg : "unknown error"));
+        }
+        m_input_begin = m_input_end - m_stream.avail_in;
+        return m_output.size() - m_stream.avail_out;
+    }
+
+    void check_end() const override
+    {
+        if (!m_member_end) throw CorruptData("Unexpected end of gzip data.");
+    }
+
+private:
+    z_stream m_stream = {};
+    bool m_member_end = false;
+};
+
+class GzipCompressingStreamBuf : public BufferedCompressingStreamBuf
+{
+public:
+    explicit GzipCompressingStreamBuf(std::streambuf& sink)
+        : BufferedCompressingStreamBuf(sink)
+    {
+        if (deflateInit2(&m_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("Unable to initialize gzip compression!");
+        }
+    }
+
+    ~GzipCompressingStreamBuf() override { deflateEnd(&m_stream); }
+
+protected:
+    void compress(const char* data, size_t size, bool end) override
+    {
+        m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        m_stream.avail_in = static_cast<uInt>(size);
+        int ret;
+        do {
+            m_stream.next_out = reinterpret_cast<Bytef*>(m_output.data());
+            m_stream.avail_out = static_cast<uInt>(m_output.size());
+            ret = deflate(&m_stream, end ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR) {
+                throw std::runtime_error("gzip compression failed!");
+            }
+            write_output(m_output.size() - m_stream.avail_out);
+        } while (m_stream.avail_out == 0 || (end && ret != Z_STREAM_END));
+    }
+
+private:
+    z_stream m_stream = {};
+};
+
+#endif
+
+#ifdef MSHIO_WITH_ZSTD
+
+class ZstdDecompressingStreamBuf : public DecompressingStreamBuf
+{
+public:
+    explicit ZstdDecompressingStreamBuf(std::streambuf& source)
+        : DecompressingStreamBuf(source)
+        , m_stream(ZSTD_createDStream())
+    {
+        if (m_stream == nullptr) {
+            throw std::runtime_error("Unable to initialize zstd decompression!");
+        }
+    }
+
+    ~ZstdDecompressingStreamBuf() override { ZSTD_freeDStream(m_stream); }
+
+protected:
+    size_t decompress() override
+    {
+        // Concatenated frames are decoded one after the other.
+        ZSTD_inBuffer in = {m_input.data(), m_input_end, m_input_begin};
+        ZSTD_outBuffer out = {m_output.data(), m_output.size(), 0};
+        const size_t ret = ZSTD_decompressStream(m_stream, &out, &in);
+        if (ZSTD_isError(ret)) {
+            throw CorruptData(std::string("Invalid zstd data: ") + ZSTD_getErrorName(ret));
+        }
+        m_frame_end = ret == 0;
+        m_input_begin = in.pos;
+        return out.pos;
+    }
+
+    void check_end() const override
+    {
+        if (!m_frame_end) throw CorruptData("Unexpected end of zstd data.");
+    }
+
+private:
+    ZSTD_DStream* m_stream = nullptr;
+    bool m_frame_end = false;
+};
+
+class ZstdCompressingStreamBuf : public BufferedCompressingStreamBuf
+{
+public:
+    ZstdCompressingStreamBuf(std::streambuf& sink, size_t num_threads)
+        : BufferedCompressingStreamBuf(sink)
+        , m_context(ZSTD_createCCtx())
+    {
+        if (m_context == nullptr) {
+            throw std::runtime_error("Unable to initialize zstd compression!");
+        }
+        // Fails harmlessly when libzstd is built without multithreading.
+        num_threads = resolve_num_threads(num_threads);
+        if (num_threads > 1) {
+            ZSTD_CCtx_setParameter(m_context, ZSTD_c_nbWorkers, static_cast<int>(num_threads));
+        }
+    }
+
+    ~ZstdCompressingStreamBuf() override { ZSTD_freeCCtx(m_context); }
+
+protected:
+    void compress(const char* data, size_t size, bool end) override
+    {
+        ZSTD_inBuffer in = {data, size, 0};
+        bool done = false;
+        while (!done) {
+            ZSTD_outBuffer out = {m_output.data(), m_output.size(), 0};
+            const size_t remaining =
+                ZSTD_compressStream2(m_context, &out, &in, end ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError(remaining)) {
+                throw std::runtime_error(
+                    std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+            }
+            write_output(out.pos);
+            done = end ? remaining == 0 : in.pos == in.size;
+        }
+    }
+
+private:
+    ZSTD_CCtx* m_context = nullptr;
+};
+
+#endif
+
+} // namespace
+
+Compression compression_from_extension(const std::string& filename)
+{
+    if (ends_with(filename, ".gz")) return Compression::Gzip;
+    if (ends_with(filename, ".zst")) return Compression::Zstd;
+    return Compression::None;
+}
+
+std::unique_ptr<std::streambuf> open_decompressing_streambuf(std::istream& in)
+{
+    // MSH files start with "$MeshFormat", so the first byte of the gzip
+    // (1f 8b) and zstd (28 b5 2f fd) magic numbers is enough to tell them apart.
+    const int first = in.peek();
+    if (first == 0x1f) {
+#ifdef MSHIO_WITH_ZLIB
+        return std::unique_ptr<std::streambuf>(new GzipDecompressingStreamBuf(*in.rdbuf()));
+#else
+        throw UnsupportedFeature("Reading gzip compressed files requires MshIO built with zlib.");
+#endif
+    }
+    if (first == 0x28) {
+#ifdef MSHIO_WITH_ZSTD
+        return std::unique_ptr<std::streambuf>(new ZstdDecompressingStreamBuf(*in.rdbuf()));
+#else
+        throw UnsupportedFeature("Reading zstd compressed files requires MshIO built with zstd.");
+#endif
+    }
+    return nullptr;
+}
+
+std::unique_ptr<CompressingStreamBuf> open_compressing_streambuf(
+    Compression compression, std::streambuf& sink, size_t num_threads)
+{
+    (void)sink;
+    (void)num_threads;
+    switch (compression) {
+    case Compression::Gzip:
+#ifdef MSHIO_WITH_ZLIB
+        return std::unique_ptr<CompressingStreamBuf>(new GzipCompressingStreamBuf(sink));
+#else
+        throw UnsupportedFeature("Writing gzip compressed files requires MshIO built with zlib.");
+#endif
+    case Compression::Zstd:
+#ifdef MSHIO_WITH_ZSTD
+        return std::unique_ptr<CompressingStreamBuf>(
+            new ZstdCompressingStreamBuf(sink, num_threads));
+#else
+        throw UnsupportedFeature("Writing zstd compressed files requires MshIO built with zstd.");
+#endif
+    case Compression::None: break;
+    }
+    throw std::invalid_argument("No compression method given.");
+}
+
+} // namespace mshio
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+namespace mshio {
+
+enum class Compression { None, Gzip, Zstd };
+
+// Compression implied by the extension of `filename` (".gz" or ".zst").
+Compression compression_from_extension(const std::string& filename);
+
+// If `in` starts with a gzip or zstd magic number, returns a stream buffer
+// decompressing it on the fly, otherwise nullptr. Decompression errors are
+// thrown as CorruptData from the stream buffer, so the istream reading from it
+// should have badbit exceptions enabled to see them.
+//
+// Throws UnsupportedFeature if MshIO was built without the matching library.
+std::unique_ptr<std::streambuf> open_decompressing_streambuf(std::istream& in);
+
+// Output stream buffer compressing everything written to it into `sink`.
+class CompressingStreamBuf : public std::streambuf
+{
+public:
+    // Compress the remaining data and write the end of the compressed stream.
+    // Nothing may be written afterwards.
+    virtual void finish() = 0;
+};
+
+// Returns a stream buffer compressing into `sink` with the given method, which
+// must not be Compression::None. Zstd compression uses up to `num_threads`
+// worker threads (0 means all hardware threads).
+//
+// Throws UnsupportedFeature if MshIO was built without the matching library.
+std::unique_ptr<CompressingStreamBuf> open_compressing_streambuf(
+    Compression compression, std::streambuf& sink, size_t num_threads);
+
+} // namespace mshio
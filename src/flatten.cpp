@@ -0,0 +1,170 @@
+#include "parallel_utils.h"
+
+#include <mshio/FlatMesh.h>
+#include <mshio/NodeIndex.h>
+#include <mshio/exception.h>
+#include <mshio/mshio.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mshio {
+
+namespace {
+
+// Number of nodes or elements handled by each task.
+constexpr size_t chunk_size = size_t(1) << 16;
+
+struct BlockRange
+{
+    size_t block;
+    size_t begin;
+    size_t end;
+};
+
+template <typename Block, typename Size>
+std::vector<BlockRange> split_blocks(const Vector<Block>& blocks, Size block_size)
+{
+    std::vector<BlockRange> ranges;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        const size_t size = block_size(blocks[i]);
+        for (size_t begin = 0; begin < size; begin += chunk_size) {
+            ranges.push_back({i, begin, std::min(size, begin + chunk_size)});
+        }
+    }
+    return ranges;
+}
+
+template <typename Entity>
+void add_physical_tags(
+    std::map<std::pair<int, int>, int>& physical_tags, const Vector<Entity>& entities, int dim)
+{
+    for (const auto& entity : entities) {
+        physical_tags.emplace(std::make_pair(dim, entity.tag),
+            entity.physical_group_tags.empty() ? 0 : entity.physical_group_tags.front());
+    }
+}
+
+// First physical group of every (dim, tag) entity, including the entities of
+// partitioned meshes that elements refer to.
+std::map<std::pair<int, int>, int> get_physical_tags(const MshSpec& spec)
+{
+    std::map<std::pair<int, int>, int> physical_tags;
+    add_physical_tags(physical_tags, spec.entities.points, 0);
+    add_physical_tags(physical_tags, spec.entities.curves, 1);
+    add_physical_tags(physical_tags, spec.entities.surfaces, 2);
+    add_physical_tags(physical_tags, spec.entities.volumes, 3);
+    add_physical_tags(physical_tags, spec.partitioned_entities.points, 0);
+    add_physical_tags(physical_tags, spec.partitioned_entities.curves, 1);
+    add_physical_tags(physical_tags, spec.partitioned_entities.surfaces, 2);
+    add_physical_tags(physical_tags, spec.partitioned_entities.volumes, 3);
+    return physical_tags;
+}
+
+} // namespace
+
+FlatMesh flatten(const MshSpec& spec, size_t num_threads)
+{
+    FlatMesh mesh;
+
+    // Nodes are numbered in block order.
+    const auto& node_blocks = spec.nodes.entity_blocks;
+    std::vector<size_t> node_offsets(node_blocks.size(), 0);
+    for (size_t i = 0; i < node_blocks.size(); i++) {
+        node_offsets[i] = mesh.num_nodes;
+        mesh.num_nodes += node_blocks[i].tags.size();
+    }
+
+    // The index validates the coordinate count of each block.
+    const NodeIndex index(spec.nodes, num_threads);
+
+    mesh.coords.resize(mesh.num_nodes * 3);
+    mesh.node_tags.resize(mesh.num_nodes);
+    const auto node_ranges =
+        split_blocks(node_blocks, [](const NodeBlock& block) { return block.tags.size(); });
+    parallel_for(node_ranges.size(), num_threads, [&](size_t i) {
+        const BlockRange& range = node_ranges[i];
+        const NodeBlock& block = node_blocks[range.block];
+        const size_t stride =
+            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
+        const size_t offset = node_offsets[range.block];
+        for (size_t j = range.begin; j < range.end; j++) {
+            const double* xyz = block.data.data() + j * stride;
+            std::copy(xyz, xyz + 3, mesh.coords.data() + (offset + j) * 3);
+            mesh.node_tags[offset + j] = block.tags[j];
+        }
+    });
+
+    // Assign each element block a type and an offset within that type.
+    const auto& element_blocks = spec.elements.entity_blocks;
+    const auto physical_tags = get_physical_tags(spec);
+    std::vector<size_t> block_types(element_blocks.size());
+    std::vector<size_t> element_offsets(element_blocks.size());
+    std::vector<int> block_physical_tags(element_blocks.size());
+    for (size_t i = 0; i < element_blocks.size(); i++) {
+        const ElementBlock& block = element_blocks[i];
+        const size_t n = nodes_per_element(block.element_type);
+        if (block.data.size() < block.num_elements_in_block * (n + 1)) {
+            throw CorruptData("Element block " + std::to_string(block.entity_tag) +
+                              " has fewer values than expected.");
+        }
+
+        auto type = std::find_if(mesh.element_types.begin(),
+            mesh.element_types.end(),
+            [&](const FlatElements& elements) {
+                return elements.element_type == block.element_type;
+            });
+        if (type == mesh.element_types.end()) {
+            mesh.element_types.emplace_back();
+            mesh.element_types.back().element_type = block.element_type;
+            mesh.element_types.back().nodes_per_element = n;
+            type = mesh.element_types.end() - 1;
+        }
+        block_types[i] = static_cast<size_t>(type - mesh.element_types.begin());
+        element_offsets[i] = type->num_elements;
+        type->num_elements += block.num_elements_in_block;
+
+        const auto itr = physical_tags.find(std::make_pair(block.entity_dim, block.entity_tag));
+        block_physical_tags[i] = itr == physical_tags.end() ? 0 : itr->second;
+    }
+    for (auto& elements : mesh.element_types) {
+        elements.connectivity.resize(elements.num_elements * elements.nodes_per_element);
+        elements.tags.resize(elements.num_elements);
+        elements.entity_tags.resize(elements.num_elements);
+        elements.physical_tags.resize(elements.num_elements);
+    }
+
+    const auto element_ranges = split_blocks(
+        element_blocks, [](const ElementBlock& block) { return block.num_elements_in_block; });
+    parallel_for(element_ranges.size(), num_threads, [&](size_t i) {
+        const BlockRange& range = element_ranges[i];
+        const ElementBlock& block = element_blocks[range.block];
+        FlatElements& elements = mesh.element_types[block_types[range.block]];
+        const size_t n = elements.nodes_per_element;
+        const size_t offset = element_offsets[range.block];
+        const int physical_tag = block_physical_tags[range.block];
+        for (size_t j = range.begin; j < range.end; j++) {
+            // Each element is stored as its tag followed by its node tags.
+            const size_t* element = block.data.data() + j * (n + 1);
+            size_t* connectivity = elements.connectivity.data() + (offset + j) * n;
+            for (size_t k = 0; k < n; k++) {
+                const auto location = index.find(element[k + 1]);
+                if (!location.valid()) {
+                    throw CorruptData("Element " + std::to_string(element[0]) +
+                                      " refers to unknown node " + std::to_string(element[k + 1]));
+                }
+                connectivity[k] = node_offsets[location.block] + location.index;
+            }
+            elements.tags[offset + j] = element[0];
+            elements.entity_tags[offset + j] = block.entity_tag;
+            elements.physical_tags[offset + j] = physical_tag;
+        }
+    });
+
+    return mesh;
+}
+
+} // namespace mshio
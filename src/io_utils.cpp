@@ -1,9 +1,89 @@
 #include "io_utils.h"
+#include "async_file_streambuf.h"
+#include "compressed_streambuf.h"
+#include "memory_streambuf.h"
+#include "read_ahead_streambuf.h"
 
+#include <mshio/exception.h>
+
+#include <algorithm>
+#include <fstream>
 #include <istream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace mshio {
 
+namespace {
+
+// Input stream owning the stream buffers it reads from. Members are destroyed
+// in reverse order, from the top of the stack of buffers down to the file.
+class InputStream : public std::istream
+{
+public:
+    InputStream(const std::string& filename, const LoadOptions& options, bool seekable)
+        : std::istream(nullptr)
+    {
+        if (options.use_io_uring) {
+            const size_t buffer_size = options.read_ahead_buffer_size > 0
+                                           ? options.read_ahead_buffer_size
+                                           : default_async_buffer_size;
+            m_file = open_async_input_file(filename, buffer_size);
+        }
+        if (m_file == nullptr) {
+            // A large stream buffer keeps the number of read calls low. It
+            // must be installed before the file is opened to take effect.
+            m_file_buffer.resize(1 << 20);
+            std::unique_ptr<std::filebuf> file(new std::filebuf());
+            file->pubsetbuf(m_file_buffer.data(), static_cast<std::streamsize>(m_file_buffer.size()));
+            if (file->open(filename.c_str(), std::ios::in | std::ios::binary) == nullptr) {
+                throw std::runtime_error("Input file does not exist!");
+            }
+            m_file = std::move(file);
+
+            // The asynchronous file already reads ahead.
+            if (options.read_ahead_buffer_size > 0) {
+                m_read_ahead.reset(
+                    new ReadAheadStreamBuf(*m_file, options.read_ahead_buffer_size));
+            }
+        }
+        rdbuf(m_read_ahead != nullptr ? m_read_ahead.get() : m_file.get());
+        exceptions(std::ios_base::badbit);
+
+        m_decompressed = open_decompressing_streambuf(*this);
+        if (m_decompressed == nullptr) return;
+        if (!seekable) {
+            rdbuf(m_decompressed.get());
+            return;
+        }
+
+        constexpr size_t chunk_size = 1 << 20;
+        size_t size = 0;
+        while (true) {
+            m_contents.resize(size + chunk_size);
+            const auto n = m_decompressed->sgetn(
+                m_contents.data() + size, static_cast<std::streamsize>(chunk_size));
+            size += static_cast<size_t>(n);
+            if (static_cast<size_t>(n) < chunk_size) break;
+        }
+        m_contents.resize(size);
+        m_memory.reset(new MemoryStreamBuf(m_contents.data(), m_contents.size()));
+        rdbuf(m_memory.get());
+    }
+
+private:
+    std::vector<char> m_file_buffer;
+    std::unique_ptr<std::streambuf> m_file;
+    std::unique_ptr<ReadAheadStreamBuf> m_read_ahead;
+    std::unique_ptr<std::streambuf> m_decompressed;
+    std::vector<char> m_contents; // Decompressed file, if seekable.
+    std::unique_ptr<MemoryStreamBuf> m_memory;
+};
+
+} // namespace
+
 void eat_white_space(std::istream& in, size_t count)
 {
     char ch = static_cast<char>(in.peek());
@@ -18,5 +98,39 @@ void eat_white_space(std::istream& in, size_t count)
     }
 }
 
-} // namespace mshio
+void forward_to(std::istream& in, const std::string& flag)
+{
+    std::string buf;
+    while (!in.eof() && buf != flag) {
+        in >> buf;
+    }
+}
+
+void skip_bytes(std::istream& in, size_t num_bytes)
+{
+    // Seeking discards the stream buffer, so short skips are cheaper to read
+    // through.
+    constexpr size_t seek_threshold = 1 << 16;
+    if (num_bytes >= seek_threshold) {
+        in.seekg(static_cast<std::streamoff>(num_bytes), std::ios_base::cur);
+        if (!in.fail()) return;
+        in.clear(); // Not seekable.
+    }
+    constexpr size_t max_chunk = static_cast<size_t>(std::numeric_limits<std::streamsize>::max());
+    while (num_bytes > 0) {
+        const size_t chunk = std::min(num_bytes, max_chunk);
+        in.ignore(static_cast<std::streamsize>(chunk));
+        if (static_cast<size_t>(in.gcount()) != chunk) {
+            throw InvalidFormat("Unexpected end of file in binary section.");
+        }
+        num_bytes -= chunk;
+    }
+}
 
+std::unique_ptr<std::istream> open_input(
+    const std::string& filename, const LoadOptions& options, bool seekable)
+{
+    return std::unique_ptr<std::istream>(new InputStream(filename, options, seekable));
+}
+
+} // namespace mshio
@@ -1,11 +1,36 @@
 #pragma once
 
+#include <mshio/options.h>
+
 #include <istream>
 #include <limits>
+#include <memory>
+#include <string>
 
 namespace mshio {
 
 void eat_white_space(std::istream& in, size_t count = std::numeric_limits<size_t>::max());
 
+void forward_to(std::istream& in, const std::string& flag);
+
+// Skip `num_bytes` bytes of binary payload, seeking over large spans when the
+// stream allows it. Throws InvalidFormat if the stream ends first.
+void skip_bytes(std::istream& in, size_t num_bytes);
+
+// Open `filename` for loading, as every file based entry point does. The
+// returned stream owns the stream buffers layered below it:
+//
+//  - the file, read through io_uring if `options.use_io_uring` is set and it
+//    is supported, otherwise through a std::filebuf with a 1 MiB buffer;
+//  - a read-ahead I/O thread if `options.read_ahead_buffer_size` is not 0;
+//  - gzip or zstd decompression, detected from the first byte of the file.
+//
+// If `seekable` is set, compressed files are decompressed into memory so that
+// the stream can seek. The stream throws on badbit, so that I/O and
+// decompression errors propagate. Throws std::runtime_error if the file cannot
+// be opened.
+std::unique_ptr<std::istream> open_input(
+    const std::string& filename, const LoadOptions& options, bool seekable = false);
+
 } // namespace mshio
 
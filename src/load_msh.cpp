@@ -1,5 +1,7 @@
 #include <mshio/MshSpec.h>
 
+#include "compressed_streambuf.h"
+#include "io_utils.h"
 #include "load_msh_curves.h"
 #include "load_msh_data.h"
 #include "load_msh_elements.h"
@@ -7,28 +9,77 @@
 #include "load_msh_format.h"
 #include "load_msh_nanospline_format.h"
 #include "load_msh_nodes.h"
+#include "load_msh_partitioned_entities.h"
 #include "load_msh_patches.h"
 #include "load_msh_physical_groups.h"
 #include "load_msh_post_process.h"
+#include "load_msh_sections.h"
+#include "skip_msh_section.h"
 
+#include <algorithm>
 #include <cassert>
-#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace mshio {
 
-void forward_to(std::istream& in, const std::string& flag)
+bool load_section(
+    std::istream& in, const std::string& section, MshSpec& spec, const LoadOptions& options)
 {
-    std::string buf;
-    while (!in.eof() && buf != flag) {
-        in >> buf;
+    if (section == "$MeshFormat") {
+        load_mesh_format(in, spec);
+    } else if (section == "$Entities") {
+        load_entities(in, spec);
+    } else if (section == "$PartitionedEntities") {
+        load_partitioned_entities(in, spec);
+    } else if (section == "$PhysicalNames") {
+        load_physical_groups(in, spec);
+    } else if (section == "$Nodes") {
+        load_nodes(in, spec, options);
+    } else if (section == "$Elements") {
+        load_elements(in, spec, options);
+    } else if (section == "$GhostElements") {
+        load_ghost_elements(in, spec, options);
+    } else if (section == "$NodeData") {
+        load_node_data(in, spec, options);
+    } else if (section == "$ElementData") {
+        load_element_data(in, spec, options);
+    } else if (section == "$ElementNodeData") {
+        load_element_node_data(in, spec, options);
+    } else if (section == "$NanoSplineFormat") {
+        load_nanospline_format(in, spec);
+    } else if (section == "$Curves") {
+        load_curves(in, spec);
+    } else if (section == "$Patches") {
+        load_patches(in, spec);
+    } else {
+        std::cerr << "Warning: skipping section \"" << section << "\"" << std::endl;
+        return false;
     }
+    return true;
+}
+
+bool is_skipped_section(const std::string& section, const LoadOptions& options)
+{
+    const auto& skipped = options.skipped_sections;
+    return std::find(skipped.begin(), skipped.end(), section) != skipped.end();
 }
 
-MshSpec load_msh(std::istream& in)
+MshSpec load_msh(std::istream& in, const LoadOptions& options)
 {
+    if (auto buffer = open_decompressing_streambuf(in)) {
+        std::istream decompressed(buffer.get());
+        decompressed.exceptions(std::ios_base::badbit);
+        return load_msh(decompressed, options);
+    }
+
+#ifdef MSHIO_WITH_PMR
+    MshSpec spec(Allocator(options.memory_resource != nullptr ? options.memory_resource
+                                                              : std::pmr::get_default_resource()));
+#else
     MshSpec spec;
+#endif
     std::string buf, end_str;
 
     while (!in.eof()) {
@@ -36,45 +87,29 @@ MshSpec load_msh(std::istream& in)
         in >> buf;
         if (buf.size() == 0 || buf[0] != '$') continue;
         end_str = "$End" + buf.substr(1);
-        if (buf == "$MeshFormat") {
-            load_mesh_format(in, spec);
-        } else if (buf == "$Entities") {
-            load_entities(in, spec);
-        } else if (buf == "$PhysicalNames") {
-            load_physical_groups(in, spec);
-        } else if (buf == "$Nodes") {
-            load_nodes(in, spec);
-        } else if (buf == "$Elements") {
-            load_elements(in, spec);
-        } else if (buf == "$NodeData") {
-            load_node_data(in, spec);
-        } else if (buf == "$ElementData") {
-            load_element_data(in, spec);
-        } else if (buf == "$ElementNodeData") {
-            load_element_node_data(in, spec);
-        } else if (buf == "$NanoSplineFormat") {
-            load_nanospline_format(in, spec);
-        } else if (buf == "$Curves") {
-            load_curves(in, spec);
-        } else if (buf == "$Patches") {
-            load_patches(in, spec);
+        if (is_skipped_section(buf, options)) {
+            skip_section(in, buf, spec.mesh_format);
+            continue;
+        }
+        if (options.on_phase) options.on_phase(buf, true);
+        if (!load_section(in, buf, spec, options)) {
+            skip_section(in, buf, spec.mesh_format);
         } else {
-            std::cerr << "Warning: skipping section \"" << buf << "\"" << std::endl;
+            forward_to(in, end_str);
         }
-        forward_to(in, end_str);
+        if (options.on_phase) options.on_phase(buf, false);
     }
 
-    load_msh_post_process(spec);
+    if (options.on_phase) options.on_phase("post_process", true);
+    load_msh_post_process(spec, options);
+    if (options.on_phase) options.on_phase("post_process", false);
     return spec;
 }
 
-MshSpec load_msh(const std::string& filename)
+MshSpec load_msh(const std::string& filename, const LoadOptions& options)
 {
-    std::ifstream fin(filename.c_str(), std::ios::binary);
-    if (!fin.is_open()) {
-        throw std::runtime_error("Input file does not exist!");
-    }
-    return load_msh(fin);
+    auto in = open_input(filename, options);
+    return load_msh(*in, options);
 }
 
 } // namespace mshio
@@ -1,4 +1,5 @@
 #include "load_msh_curves.h"
+#include "ascii_reader.h"
 #include "io_utils.h"
 
 namespace mshio {
@@ -8,25 +9,26 @@ namespace {
 void load_curves_ascii(std::istream& in, MshSpec& spec)
 {
 #ifdef MSHIO_EXT_NANOSPLINE
+    AsciiReader reader(in);
     auto& curves = spec.curves;
     size_t num_curves;
-    in >> num_curves;
+    reader.read(num_curves);
 
     curves.resize(num_curves);
     for (size_t i = 0; i < num_curves; i++) {
         auto& curve = curves[i];
-        in >> curve.curve_tag;
-        in >> curve.curve_type;
-        in >> curve.curve_degree;
-        in >> curve.num_control_points;
-        in >> curve.num_knots;
-        in >> curve.with_weights;
+        reader.read(curve.curve_tag);
+        reader.read(curve.curve_type);
+        reader.read(curve.curve_degree);
+        reader.read(curve.num_control_points);
+        reader.read(curve.num_knots);
+        reader.read(curve.with_weights);
 
         size_t num_entries =
             curve.num_control_points * ((curve.with_weights > 0) ? 4 : 3) + curve.num_knots;
         curve.data.resize(num_entries);
         for (size_t j = 0; j < num_entries; j++) {
-            in >> curve.data[j];
+            reader.read(curve.data[j]);
         }
     }
 #endif
@@ -2,12 +2,16 @@
 
 #include <mshio/MshSpec.h>
 #include <mshio/exception.h>
+#include "ascii_reader.h"
 #include "io_utils.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <vector>
 
 namespace mshio {
 
@@ -15,24 +19,25 @@ namespace internal {
 
 void load_data_header(std::istream& in, DataHeader& header)
 {
+    AsciiReader reader(in);
     size_t num_string_tags, num_real_tags, num_int_tags;
 
-    in >> num_string_tags;
+    reader.read(num_string_tags);
     header.string_tags.resize(num_string_tags);
     for (size_t i = 0; i < num_string_tags; i++) {
         in >> std::quoted(header.string_tags[i]);
     }
 
-    in >> num_real_tags;
+    reader.read(num_real_tags);
     header.real_tags.resize(num_real_tags);
     for (size_t i = 0; i < num_real_tags; i++) {
-        in >> header.real_tags[i];
+        reader.read(header.real_tags[i]);
     }
 
-    in >> num_int_tags;
+    reader.read(num_int_tags);
     header.int_tags.resize(num_int_tags);
     for (size_t i = 0; i < num_int_tags; i++) {
-        in >> header.int_tags[i];
+        reader.read(header.int_tags[i]);
     }
     assert(in.good());
 }
@@ -80,83 +85,173 @@ void load_data_entry(
 }
 } // namespace v22
 
-void load_data(std::istream& in,
-    Data& data,
-    const std::string& version,
-    bool is_binary,
-    bool is_element_node_data = false)
+} // namespace internal
+
+DataEntryLoader::DataEntryLoader(
+    std::istream& in, const MeshFormat& format, bool is_element_node_data)
+    : m_in(in)
+    , m_reader(in)
+    , m_is_v41(format.version == "4.1")
+    , m_is_binary(format.file_type > 0)
+    , m_is_element_node_data(is_element_node_data)
 {
-    load_data_header(in, data.header);
+    internal::load_data_header(in, m_header);
 
-    if (data.header.int_tags.size() < 3) {
+    if (m_header.int_tags.size() < 3) {
         throw InvalidFormat("Data requires at least 3 int tags.");
     }
 
-    size_t fields_per_entry = static_cast<size_t>(data.header.int_tags[1]);
-    size_t num_entries = static_cast<size_t>(data.header.int_tags[2]);
-    data.entries.resize(num_entries);
+    m_fields_per_entry = static_cast<size_t>(m_header.int_tags[1]);
+    m_remaining = static_cast<size_t>(m_header.int_tags[2]);
 
-    if (is_binary) {
+    if (m_is_binary) {
         eat_white_space(in, 1);
-        if (version == "4.1") {
-            for (size_t i = 0; i < num_entries; i++) {
-                v41::load_data_entry(in, data.entries[i], fields_per_entry, is_element_node_data);
-            }
-        } else if (version == "2.2") {
-            for (size_t i = 0; i < num_entries; i++) {
-                v22::load_data_entry(in, data.entries[i], fields_per_entry, is_element_node_data);
-            }
+        if (!m_is_v41 && format.version != "2.2") {
+            throw InvalidFormat("Unsupported version " + format.version);
+        }
+    }
+}
+
+bool DataEntryLoader::load_next(DataEntry& entry)
+{
+    if (m_remaining == 0) return false;
+    m_remaining--;
+
+    if (m_is_binary) {
+        if (m_is_v41) {
+            internal::v41::load_data_entry(
+                m_in, entry, m_fields_per_entry, m_is_element_node_data);
         } else {
-            throw InvalidFormat("Unsupported version " + version);
+            internal::v22::load_data_entry(
+                m_in, entry, m_fields_per_entry, m_is_element_node_data);
+        }
+    } else {
+        m_reader.read(entry.tag);
+        if (m_is_element_node_data) {
+            m_reader.read(entry.num_nodes_per_element);
+            entry.data.resize(m_fields_per_entry * static_cast<size_t>(entry.num_nodes_per_element));
+        } else {
+            entry.data.resize(m_fields_per_entry);
+        }
+        for (auto& value : entry.data) {
+            m_reader.read(value);
         }
+    }
+    assert(m_in.good());
+    return true;
+}
+
+void DataEntryLoader::load_compact(Data& data)
+{
+    const size_t num_fields = m_fields_per_entry;
+    data.tags.reserve(data.tags.size() + m_remaining);
+    if (m_is_element_node_data) {
+        if (data.offsets.empty()) data.offsets.push_back(data.values.size());
+        data.offsets.reserve(data.offsets.size() + m_remaining);
     } else {
-        for (size_t i = 0; i < num_entries; i++) {
-            DataEntry& entry = data.entries[i];
-            in >> entry.tag;
-            if (is_element_node_data) {
-                in >> entry.num_nodes_per_element;
-                entry.data.resize(fields_per_entry * entry.num_nodes_per_element);
-                for (size_t j = 0; j < entry.num_nodes_per_element; j++) {
-                    for (size_t k = 0; k < fields_per_entry; k++) {
-                        in >> entry.data[j * fields_per_entry + k];
-                    }
-                }
-            } else {
-                entry.data.resize(fields_per_entry);
-                for (size_t j = 0; j < fields_per_entry; j++) {
-                    in >> entry.data[j];
-                }
+        data.values.reserve(data.values.size() + m_remaining * num_fields);
+    }
+
+    if (m_is_binary && !m_is_element_node_data) {
+        // Fixed size records of a 32 bits tag followed by the values, see
+        // `load_data_entry()`. They are read in batches.
+        constexpr size_t batch_size = 1 << 12;
+        const size_t record_size = 4 + sizeof(double) * num_fields;
+        std::vector<char> buffer(std::min(m_remaining, batch_size) * record_size);
+        while (m_remaining > 0) {
+            const size_t count = std::min(m_remaining, batch_size);
+            m_in.read(buffer.data(), static_cast<std::streamsize>(count * record_size));
+            const size_t first = data.values.size();
+            data.values.resize(first + count * num_fields);
+            for (size_t i = 0; i < count; i++) {
+                const char* record = buffer.data() + i * record_size;
+                int32_t tag_32;
+                std::memcpy(&tag_32, record, 4);
+                data.tags.push_back(static_cast<size_t>(tag_32));
+                std::memcpy(data.values.data() + first + i * num_fields,
+                    record + 4,
+                    sizeof(double) * num_fields);
             }
+            m_remaining -= count;
         }
+        assert(m_in.good());
+        return;
+    }
+
+    for (; m_remaining > 0; m_remaining--) {
+        size_t tag = 0;
+        int num_nodes_per_element = 1;
+        if (m_is_binary) {
+            // Element-node data record: 32 bits tag and node count in both
+            // v2.2 and v4.1.
+            int32_t tag_32, num_nodes_32;
+            m_in.read(reinterpret_cast<char*>(&tag_32), 4);
+            m_in.read(reinterpret_cast<char*>(&num_nodes_32), 4);
+            tag = static_cast<size_t>(tag_32);
+            num_nodes_per_element = static_cast<int>(num_nodes_32);
+        } else {
+            m_reader.read(tag);
+            if (m_is_element_node_data) m_reader.read(num_nodes_per_element);
+        }
+        if (num_nodes_per_element < 1) {
+            throw InvalidFormat("Invalid number of nodes per element in element node data.");
+        }
+        data.tags.push_back(tag);
+
+        const size_t first = data.values.size();
+        data.values.resize(first + num_fields * static_cast<size_t>(num_nodes_per_element));
+        if (m_is_binary) {
+            m_in.read(reinterpret_cast<char*>(data.values.data() + first),
+                static_cast<std::streamsize>(sizeof(double) * (data.values.size() - first)));
+        } else {
+            for (size_t i = first; i < data.values.size(); i++) {
+                m_reader.read(data.values[i]);
+            }
+        }
+        if (m_is_element_node_data) data.offsets.push_back(data.values.size());
+    }
+    assert(m_in.good());
+}
+
+namespace internal {
+
+void load_data(std::istream& in,
+    Data& data,
+    const MeshFormat& format,
+    bool is_element_node_data,
+    const LoadOptions& options)
+{
+    DataEntryLoader loader(in, format, is_element_node_data);
+    data.header = loader.header();
+    if (options.compact_data) {
+        loader.load_compact(data);
+        return;
+    }
+    data.entries.resize(static_cast<size_t>(data.header.int_tags[2]));
+    for (auto& entry : data.entries) {
+        loader.load_next(entry);
     }
-    assert(in.good());
 }
 
 } // namespace internal
 
 
-void load_node_data(std::istream& in, MshSpec& spec)
+void load_node_data(std::istream& in, MshSpec& spec, const LoadOptions& options)
 {
-    const std::string& version = spec.mesh_format.version;
-    bool is_binary = spec.mesh_format.file_type > 0;
     spec.node_data.emplace_back();
-    internal::load_data(in, spec.node_data.back(), version, is_binary, false);
+    internal::load_data(in, spec.node_data.back(), spec.mesh_format, false, options);
 }
 
-void load_element_data(std::istream& in, MshSpec& spec)
+void load_element_data(std::istream& in, MshSpec& spec, const LoadOptions& options)
 {
-    const std::string& version = spec.mesh_format.version;
-    bool is_binary = spec.mesh_format.file_type > 0;
     spec.element_data.emplace_back();
-    internal::load_data(in, spec.element_data.back(), version, is_binary, false);
+    internal::load_data(in, spec.element_data.back(), spec.mesh_format, false, options);
 }
 
-void load_element_node_data(std::istream& in, MshSpec& spec)
+void load_element_node_data(std::istream& in, MshSpec& spec, const LoadOptions& options)
 {
-    const std::string& version = spec.mesh_format.version;
-    bool is_binary = spec.mesh_format.file_type > 0;
     spec.element_node_data.emplace_back();
-    internal::load_data(in, spec.element_node_data.back(), version, is_binary, true);
+    internal::load_data(in, spec.element_node_data.back(), spec.mesh_format, true, options);
 }
 
 } // namespace mshio
@@ -1,14 +1,52 @@
 #pragma once
 
+#include "ascii_reader.h"
+
 #include <mshio/MshSpec.h>
+#include <mshio/options.h>
+
 #include <iostream>
 
 namespace mshio {
 
-void load_node_data(std::istream& in, MshSpec& spec);
+namespace internal {
+
+void load_data_header(std::istream& in, DataHeader& header);
+
+} // namespace internal
+
+// Incremental loader for the body of a $NodeData, $ElementData or
+// $ElementNodeData section, shared by the full and streaming loaders. The data
+// header is read on construction, then each call to `load_next()` parses one
+// entry into `entry`, reusing its storage.
+class DataEntryLoader
+{
+public:
+    DataEntryLoader(std::istream& in, const MeshFormat& format, bool is_element_node_data);
+
+    const DataHeader& header() const { return m_header; }
+
+    // Returns false once all entries have been loaded.
+    bool load_next(DataEntry& entry);
+
+    // Append all remaining entries to the compact arrays of `data`.
+    void load_compact(Data& data);
+
+private:
+    std::istream& m_in;
+    AsciiReader m_reader;
+    DataHeader m_header;
+    bool m_is_v41 = false;
+    bool m_is_binary = false;
+    bool m_is_element_node_data = false;
+    size_t m_fields_per_entry = 0;
+    size_t m_remaining = 0;
+};
+
+void load_node_data(std::istream& in, MshSpec& spec, const LoadOptions& options);
 
-void load_element_data(std::istream& in, MshSpec& spec);
+void load_element_data(std::istream& in, MshSpec& spec, const LoadOptions& options);
 
-void load_element_node_data(std::istream& in, MshSpec& spec);
+void load_element_node_data(std::istream& in, MshSpec& spec, const LoadOptions& options);
 
 } // namespace mshio
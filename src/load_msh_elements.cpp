@@ -1,6 +1,9 @@
+#include "load_msh_elements.h"
+#include "ascii_reader.h"
 #include "element_utils.h"
 #include "io_utils.h"
 #include "load_msh_format.h"
+#include "load_msh_partitioned_entities.h"
 
 #include <mshio/MshSpec.h>
 #include <mshio/exception.h>
@@ -10,272 +13,403 @@
 #include <cassert>
 #include <fstream>
 #include <limits>
-#include <map>
-#include <set>
 #include <sstream>
 #include <string>
+#include <utility>
 
 
 namespace mshio {
 
 namespace v41 {
 
-void load_elements_ascii(std::istream& in, MshSpec& spec)
+void load_elements_header_ascii(std::istream& in, Elements& elements)
 {
-    Elements& elements = spec.elements;
-    in >> elements.num_entity_blocks;
-    in >> elements.num_elements;
-    in >> elements.min_element_tag;
-    in >> elements.max_element_tag;
+    AsciiReader reader(in);
+    reader.read(elements.num_entity_blocks);
+    reader.read(elements.num_elements);
+    reader.read(elements.min_element_tag);
+    reader.read(elements.max_element_tag);
     assert(in.good());
-
-    elements.entity_blocks.resize(elements.num_entity_blocks);
-    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
-        ElementBlock& block = elements.entity_blocks[i];
-
-        in >> block.entity_dim;
-        in >> block.entity_tag;
-        in >> block.element_type;
-        in >> block.num_elements_in_block;
-
-        const size_t n = nodes_per_element(block.element_type);
-        block.data.resize(block.num_elements_in_block * (n + 1));
-        for (size_t j = 0; j < block.num_elements_in_block; j++) {
-            for (size_t k = 0; k <= n; k++) {
-                in >> block.data[j * (n + 1) + k];
-            }
-        }
-        assert(in.good());
-    }
 }
 
-void load_elements_binary(std::istream& in, MshSpec& spec)
+void load_elements_header_binary(std::istream& in, Elements& elements)
 {
     eat_white_space(in, 1);
-    Elements& elements = spec.elements;
     in.read(reinterpret_cast<char*>(&elements.num_entity_blocks), sizeof(size_t));
     in.read(reinterpret_cast<char*>(&elements.num_elements), sizeof(size_t));
     in.read(reinterpret_cast<char*>(&elements.min_element_tag), sizeof(size_t));
     in.read(reinterpret_cast<char*>(&elements.max_element_tag), sizeof(size_t));
     assert(in.good());
+}
+
+void load_element_block_ascii(std::istream& in, ElementBlock& block, const LoadOptions& options)
+{
+    AsciiReader reader(in);
+    reader.read(block.entity_dim);
+    reader.read(block.entity_tag);
+    reader.read(block.element_type);
+    reader.read(block.num_elements_in_block);
+
+    const size_t n = nodes_per_element(block.element_type);
+    block.data.resize(block.num_elements_in_block * (n + 1));
+    for (size_t j = read_rows_parallel(
+             in, block.num_elements_in_block, n + 1, block.data.data(), options.num_threads);
+         j < block.num_elements_in_block;
+         j++) {
+        for (size_t k = 0; k <= n; k++) {
+            reader.read(block.data[j * (n + 1) + k]);
+        }
+    }
+    assert(in.good());
+}
 
-    elements.entity_blocks.resize(elements.num_entity_blocks);
-    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
-        ElementBlock& block = elements.entity_blocks[i];
+void load_element_block_header_binary(std::istream& in, ElementBlock& block)
+{
+    in.read(reinterpret_cast<char*>(&block.entity_dim), sizeof(int));
+    in.read(reinterpret_cast<char*>(&block.entity_tag), sizeof(int));
+    in.read(reinterpret_cast<char*>(&block.element_type), sizeof(int));
+    in.read(reinterpret_cast<char*>(&block.num_elements_in_block), sizeof(size_t));
+}
 
-        in.read(reinterpret_cast<char*>(&block.entity_dim), sizeof(int));
-        in.read(reinterpret_cast<char*>(&block.entity_tag), sizeof(int));
-        in.read(reinterpret_cast<char*>(&block.element_type), sizeof(int));
-        in.read(reinterpret_cast<char*>(&block.num_elements_in_block), sizeof(size_t));
+void load_element_block_data_binary(std::istream& in, ElementBlock& block)
+{
+    const size_t n = nodes_per_element(block.element_type);
+    block.data.resize(block.num_elements_in_block * (n + 1));
+    in.read(reinterpret_cast<char*>(block.data.data()),
+        static_cast<std::streamsize>(sizeof(size_t) * block.data.size()));
+    assert(in.good());
+}
 
-        const size_t n = nodes_per_element(block.element_type);
-        block.data.resize(block.num_elements_in_block * (n + 1));
-        in.read(reinterpret_cast<char*>(block.data.data()),
-            static_cast<std::streamsize>(sizeof(size_t) * block.data.size()));
-        assert(in.good());
-    }
+void skip_element_block_data_binary(std::istream& in, const ElementBlock& block)
+{
+    const size_t n = nodes_per_element(block.element_type);
+    skip_bytes(in, block.num_elements_in_block * (n + 1) * sizeof(size_t));
 }
+
 } // namespace v41
 
 namespace v22 {
 
 namespace {
-template <typename Entity>
-void create_entities(
-    const std::map<int, std::set<int>>& entity_tag_to_physical_tags, std::vector<Entity>& entities)
+
+uint64_t pack_tags(int entity_tag, int physical_tag)
 {
-    for (const auto& entry : entity_tag_to_physical_tags) {
-        entities.emplace_back();
-        Entity& entity = entities.back();
-        entity.tag = entry.first;
-        entity.physical_group_tags.insert(
-            entity.physical_group_tags.end(), entry.second.begin(), entry.second.end());
-    }
+    return (static_cast<uint64_t>(static_cast<uint32_t>(entity_tag)) << 32) |
+           static_cast<uint32_t>(physical_tag);
 }
-} // namespace
 
-void load_elements_ascii(std::istream& in, MshSpec& spec)
+// Key of the block an element belongs to. The entity dimension is implied by
+// the element type.
+uint64_t block_key(int element_type, int entity_tag)
 {
-    Elements& elements = spec.elements;
-    size_t num_elements;
-    in >> num_elements;
-
-    // Due to v2.2 constraints, each element is parsed as a separate block, and
-    // a regrouping will happen at post-processing time.
-    elements.num_entity_blocks += num_elements;
-    elements.num_elements += num_elements;
-
-    int element_num, element_type;
-    int num_tags;
-    std::vector<int> tags;
-    std::vector<int> node_ids;
-
-    std::array<std::map<int, std::set<int>>, 4> entity_tag_to_physical_tags;
-
-    for (size_t i = 0; i < num_elements; i++) {
-        in >> element_num;
-        in >> element_type;
-        in >> num_tags;
-        tags.resize(static_cast<size_t>(num_tags));
-        for (int j = 0; j < num_tags; j++) {
-            in >> tags[static_cast<size_t>(j)];
-        }
-
-        const size_t n = nodes_per_element(element_type);
-        node_ids.resize(n);
-        for (size_t j = 0; j < n; j++) {
-            in >> node_ids[j];
-        }
+    return pack_tags(entity_tag, element_type);
+}
 
-        elements.min_element_tag =
-            std::min(elements.min_element_tag, static_cast<size_t>(element_num));
-        elements.max_element_tag =
-            std::max(elements.max_element_tag, static_cast<size_t>(element_num));
+void sort_unique(std::vector<uint64_t>& keys)
+{
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
 
-        elements.entity_blocks.emplace_back();
-        auto& block = elements.entity_blocks.back();
-        block.num_elements_in_block = 1;
-        block.entity_dim = get_element_dim(element_type);
-        if (tags.size() > 1) {
-            // By default, the first tag is the tag of the physical entity to which the element
-            // belongs; the second is the tag of the elementary model entity to which the element
-            // belongs; [...]. Gmsh and most codes using the MSH 2 format require at least the
-            // first two tags (physical and elementary tags).
-            block.entity_tag = tags[1];
-            auto it = entity_tag_to_physical_tags[block.entity_dim].find(tags[1]);
-            if (it == entity_tag_to_physical_tags[block.entity_dim].end()) {
-                entity_tag_to_physical_tags[block.entity_dim][tags[1]] = {tags[0]};
-            } else {
-                it->second.insert(tags[0]);
+// Add the (entity tag, physical tag) pairs of `physical_tags` to `entities`,
+// which are sorted by tag. Pairs of entities that already exist, e.g. from a
+// previous $Elements section, are merged into them.
+template <typename Entity>
+void create_entities(const std::vector<uint64_t>& physical_tags, Vector<Entity>& entities)
+{
+    std::vector<std::pair<int, int>> pairs;
+    pairs.reserve(physical_tags.size());
+    for (uint64_t key : physical_tags) {
+        pairs.emplace_back(static_cast<int>(static_cast<uint32_t>(key >> 32)),
+            static_cast<int>(static_cast<uint32_t>(key)));
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    auto by_tag = [](const Entity& entity, int tag) { return entity.tag < tag; };
+    const size_t num_existing = entities.size();
+    for (const auto& entry : pairs) {
+        const auto existing = std::lower_bound(entities.begin(),
+            entities.begin() + static_cast<std::ptrdiff_t>(num_existing),
+            entry.first,
+            by_tag);
+        if (existing != entities.begin() + static_cast<std::ptrdiff_t>(num_existing) &&
+            existing->tag == entry.first) {
+            auto& tags = existing->physical_group_tags;
+            if (std::find(tags.begin(), tags.end(), entry.second) == tags.end()) {
+                tags.push_back(entry.second);
             }
-        } else if (tags.size() > 0) {
-            // This is undefined
-            block.entity_tag = tags.front();
-        } else {
-            block.entity_tag = 1;
+            continue;
         }
-        block.element_type = element_type;
-        block.data.resize(n + 1);
-
-        block.data[0] = static_cast<size_t>(element_num);
-        for (size_t j = 0; j < n; j++) {
-            block.data[j + 1] = static_cast<size_t>(node_ids[j]);
+        if (entities.size() == num_existing || entities.back().tag != entry.first) {
+            entities.emplace_back();
+            entities.back().tag = entry.first;
         }
+        entities.back().physical_group_tags.push_back(entry.second);
+    }
+    if (entities.size() > num_existing && num_existing > 0) {
+        std::inplace_merge(entities.begin(),
+            entities.begin() + static_cast<std::ptrdiff_t>(num_existing),
+            entities.end(),
+            [](const Entity& a, const Entity& b) { return a.tag < b.tag; });
     }
-
-    create_entities(entity_tag_to_physical_tags[0], spec.entities.points);
-    create_entities(entity_tag_to_physical_tags[1], spec.entities.curves);
-    create_entities(entity_tag_to_physical_tags[2], spec.entities.surfaces);
-    create_entities(entity_tag_to_physical_tags[3], spec.entities.volumes);
 }
 
-void load_elements_binary(std::istream& in, MshSpec& spec)
-{
-    Elements& elements = spec.elements;
-    in >> elements.num_elements;
-    elements.entity_blocks.reserve(elements.num_elements);
-    eat_white_space(in, 1);
-
-    std::array<std::map<int, std::set<int>>, 4> entity_tag_to_physical_tags;
-
-    std::vector<int32_t> tags, node_ids;
-    int32_t min_tag = std::numeric_limits<int32_t>::max();
-    int32_t max_tag = 0;
-    size_t num_processed_elements = 0;
-    while (num_processed_elements != elements.num_elements) {
-        int32_t element_type, num_elements_in_block, num_tags, element_id;
-        in.read(reinterpret_cast<char*>(&element_type), 4);
-        in.read(reinterpret_cast<char*>(&num_elements_in_block), 4);
-        in.read(reinterpret_cast<char*>(&num_tags), 4);
-
-        tags.resize(static_cast<size_t>(num_tags));
-
-        const size_t n = nodes_per_element(element_type);
-        node_ids.resize(n);
+} // namespace
 
-        // Due to v2.2 constraints, each element is parsed as a separate block, and
-        // a regrouping will happen at post-processing time.
-        for (size_t i = 0; i < num_elements_in_block; i++) {
-            in.read(reinterpret_cast<char*>(&element_id), 4);
-            in.read(reinterpret_cast<char*>(tags.data()), 4 * num_tags);
-            in.read(reinterpret_cast<char*>(node_ids.data()), static_cast<int>(4 * n));
+} // namespace v22
 
-            min_tag = std::min(min_tag, element_id);
-            max_tag = std::max(max_tag, element_id);
+ElementBlockLoader::ElementBlockLoader(std::istream& in,
+    const MeshFormat& format,
+    const LoadOptions& options,
+    size_t max_block_size)
+    : m_in(in)
+    , m_reader(in)
+    , m_options(options)
+    , m_is_v22(format.version == "2.2")
+    , m_is_binary(format.file_type > 0)
+    , m_max_block_size(std::max<size_t>(max_block_size, 1))
+{
+    if (format.version == "4.1") {
+        if (m_is_binary)
+            v41::load_elements_header_binary(in, m_header);
+        else
+            v41::load_elements_header_ascii(in, m_header);
+        m_remaining = m_header.num_entity_blocks;
+    } else if (m_is_v22) {
+        m_reader.read(m_header.num_elements);
+        assert(in.good());
+        if (m_is_binary) eat_white_space(in, 1);
+        m_remaining = m_header.num_elements;
+    } else {
+        std::stringstream msg;
+        msg << "Unsupported MSH version: " << format.version;
+        throw UnsupportedFeature(msg.str());
+    }
+}
 
-            elements.entity_blocks.emplace_back();
-            ElementBlock& block = elements.entity_blocks.back();
-            block.num_elements_in_block = 1;
-            block.entity_dim = get_element_dim(element_type);
-            if (tags.size() > 1) {
-                // "By default, the first tag is the tag of the physical entity to which the element
-                // belongs; the second is the tag of the elementary model entity to which the
-                // element belongs; [...]. Gmsh and most codes using the MSH 2 format require at
-                // least the first two tags (physical and elementary tags).
-                block.entity_tag = tags[1];
-                auto it = entity_tag_to_physical_tags[block.entity_dim].find(tags[1]);
-                if (it == entity_tag_to_physical_tags[block.entity_dim].end()) {
-                    entity_tag_to_physical_tags[block.entity_dim][tags[1]] = {tags[0]};
-                } else {
-                    it->second.insert(tags[0]);
-                }
-            } else if (tags.size() > 0) {
-                // This is undefined
-                block.entity_tag = tags.front();
-            } else {
-                block.entity_tag = 1;
+bool ElementBlockLoader::load_next(ElementBlock& block)
+{
+    if (!m_is_v22) {
+        while (m_remaining > 0) {
+            m_remaining--;
+            if (!m_is_binary) {
+                // ASCII blocks have to be parsed to find their end anyway.
+                v41::load_element_block_ascii(m_in, block, m_options);
+                if (is_selected(block.entity_dim, block.entity_tag)) return true;
+                continue;
             }
-            block.element_type = static_cast<int>(element_type);
-            block.data.resize(n + 1);
-
-            block.data[0] = static_cast<size_t>(element_id);
-            for (size_t j = 0; j < n; j++) {
-                block.data[j + 1] = static_cast<size_t>(node_ids[j]);
+            v41::load_element_block_header_binary(m_in, block);
+            if (is_selected(block.entity_dim, block.entity_tag)) {
+                v41::load_element_block_data_binary(m_in, block);
+                return true;
             }
+            v41::skip_element_block_data_binary(m_in, block);
+        }
+        return false;
+    }
+
+    if (!m_has_pending) {
+        if (m_remaining == 0) return false;
+        load_element_v22();
+    }
 
-            num_processed_elements++;
-            if (num_processed_elements > elements.num_elements) {
+    block.entity_dim = get_element_dim(m_pending_type);
+    block.entity_tag = m_pending_entity_tag;
+    block.element_type = m_pending_type;
+    block.num_elements_in_block = 1;
+    block.data.assign(m_pending_data.begin(), m_pending_data.end());
+    m_has_pending = false;
+
+    while (m_remaining > 0 && block.num_elements_in_block < m_max_block_size) {
+        load_element_v22();
+        if (m_pending_type != block.element_type || m_pending_entity_tag != block.entity_tag) {
+            break;
+        }
+        block.data.insert(block.data.end(), m_pending_data.begin(), m_pending_data.end());
+        block.num_elements_in_block++;
+        m_has_pending = false;
+    }
+    m_header.num_entity_blocks++;
+    return true;
+}
+
+void ElementBlockLoader::load_element_v22()
+{
+    assert(m_remaining > 0);
+    int element_num = 0;
+    int element_type = 0;
+    if (m_is_binary) {
+        if (m_group_remaining == 0) {
+            int32_t group_size;
+            m_in.read(reinterpret_cast<char*>(&m_group_type), 4);
+            m_in.read(reinterpret_cast<char*>(&group_size), 4);
+            m_in.read(reinterpret_cast<char*>(&m_group_num_tags), 4);
+            m_group_remaining = static_cast<size_t>(group_size);
+            if (m_group_remaining == 0 || m_group_remaining > m_remaining) {
                 throw InvalidFormat("Inconsistent element count detected!");
             }
         }
+        element_type = m_group_type;
+        const size_t n = nodes_per_element(element_type);
+        m_tags.resize(static_cast<size_t>(m_group_num_tags));
+        m_node_ids.resize(n);
+        m_in.read(reinterpret_cast<char*>(&element_num), 4);
+        m_in.read(reinterpret_cast<char*>(m_tags.data()),
+            static_cast<std::streamsize>(4 * m_tags.size()));
+        m_in.read(reinterpret_cast<char*>(m_node_ids.data()), static_cast<std::streamsize>(4 * n));
+        m_group_remaining--;
+    } else {
+        int num_tags;
+        m_reader.read(element_num);
+        m_reader.read(element_type);
+        m_reader.read(num_tags);
+        m_tags.resize(static_cast<size_t>(num_tags));
+        for (auto& tag : m_tags) {
+            m_reader.read(tag);
+        }
+        m_node_ids.resize(nodes_per_element(element_type));
+        for (auto& node_id : m_node_ids) {
+            m_reader.read(node_id);
+        }
+    }
+    m_remaining--;
+
+    const size_t element_tag = static_cast<size_t>(element_num);
+    const bool first_element = m_remaining + 1 == m_header.num_elements;
+    m_header.min_element_tag =
+        first_element ? element_tag : std::min(m_header.min_element_tag, element_tag);
+    m_header.max_element_tag =
+        first_element ? element_tag : std::max(m_header.max_element_tag, element_tag);
+
+    const int entity_dim = get_element_dim(element_type);
+    if (m_tags.size() > 1) {
+        // By default, the first tag is the tag of the physical entity to which the element
+        // belongs; the second is the tag of the elementary model entity to which the element
+        // belongs; [...]. Gmsh and most codes using the MSH 2 format require at least the
+        // first two tags (physical and elementary tags).
+        m_pending_entity_tag = m_tags[1];
+        const uint64_t key = v22::pack_tags(m_tags[1], m_tags[0]);
+        if (entity_dim != m_last_physical_dim || key != m_last_physical_key) {
+            const size_t dim = static_cast<size_t>(entity_dim);
+            auto& keys = m_physical_tags[dim];
+            keys.push_back(key);
+            if (keys.size() >= m_physical_tags_limit[dim]) {
+                v22::sort_unique(keys);
+                m_physical_tags_limit[dim] = std::max<size_t>(2 * keys.size(), 64);
+            }
+            m_last_physical_dim = entity_dim;
+            m_last_physical_key = key;
+        }
+    } else if (m_tags.size() > 0) {
+        // This is undefined
+        m_pending_entity_tag = m_tags.front();
+    } else {
+        m_pending_entity_tag = 1;
     }
+    m_pending_type = element_type;
 
-    elements.num_entity_blocks = elements.entity_blocks.size();
-    elements.min_element_tag = std::min(elements.min_element_tag, static_cast<size_t>(min_tag));
-    elements.max_element_tag = std::max(elements.max_element_tag, static_cast<size_t>(max_tag));
+    m_pending_data.resize(m_node_ids.size() + 1);
+    m_pending_data[0] = element_tag;
+    for (size_t j = 0; j < m_node_ids.size(); j++) {
+        m_pending_data[j + 1] = static_cast<size_t>(m_node_ids[j]);
+    }
+    m_has_pending = true;
+}
 
-    create_entities(entity_tag_to_physical_tags[0], spec.entities.points);
-    create_entities(entity_tag_to_physical_tags[1], spec.entities.curves);
-    create_entities(entity_tag_to_physical_tags[2], spec.entities.surfaces);
-    create_entities(entity_tag_to_physical_tags[3], spec.entities.volumes);
+void ElementBlockLoader::create_entities(Entities& entities) const
+{
+    v22::create_entities(m_physical_tags[0], entities.points);
+    v22::create_entities(m_physical_tags[1], entities.curves);
+    v22::create_entities(m_physical_tags[2], entities.surfaces);
+    v22::create_entities(m_physical_tags[3], entities.volumes);
 }
 
-} // namespace v22
+void ElementBlockLoader::load_grouped(Vector<ElementBlock>& blocks)
+{
+    assert(m_is_v22);
+    std::unordered_map<uint64_t, size_t> block_indices;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        block_indices.emplace(v22::block_key(blocks[i].element_type, blocks[i].entity_tag), i);
+    }
+
+    ElementBlock* block = nullptr;
+    while (m_has_pending || m_remaining > 0) {
+        if (!m_has_pending) load_element_v22();
+        m_has_pending = false;
+
+        if (block == nullptr || m_pending_type != block->element_type ||
+            m_pending_entity_tag != block->entity_tag) {
+            const auto entry = block_indices.emplace(
+                v22::block_key(m_pending_type, m_pending_entity_tag), blocks.size());
+            if (entry.second) {
+                blocks.emplace_back();
+                blocks.back().entity_dim = get_element_dim(m_pending_type);
+                blocks.back().entity_tag = m_pending_entity_tag;
+                blocks.back().element_type = m_pending_type;
+                m_header.num_entity_blocks++;
+            }
+            block = &blocks[entry.first->second];
+        }
+        block->data.insert(block->data.end(), m_pending_data.begin(), m_pending_data.end());
+        block->num_elements_in_block++;
+    }
+}
 
-void load_elements(std::istream& in, MshSpec& spec)
+void load_elements(std::istream& in, MshSpec& spec, const LoadOptions& options)
 {
-    if (spec.elements.entity_blocks.size() == 0) {
-        spec.elements.min_element_tag = std::numeric_limits<size_t>::max();
-        spec.elements.max_element_tag = 0;
+    Elements& elements = spec.elements;
+    ElementBlockLoader loader(in, spec.mesh_format, options);
+    const Elements& header = loader.header();
+
+    if (spec.mesh_format.version == "4.1" && options.partition > 0) {
+        loader.select_entities(get_partition_entities(spec, options.partition));
+        elements = Elements();
+        // Blocks are loaded in place, so that they use the allocator of the spec.
+        elements.entity_blocks.emplace_back();
+        while (loader.load_next(elements.entity_blocks.back())) {
+            const ElementBlock& block = elements.entity_blocks.back();
+            const size_t n = nodes_per_element(block.element_type);
+            for (size_t i = 0; i < block.num_elements_in_block; i++) {
+                const size_t tag = block.data[i * (n + 1)];
+                const bool first = elements.num_elements == 0;
+                elements.min_element_tag = first ? tag : std::min(elements.min_element_tag, tag);
+                elements.max_element_tag = first ? tag : std::max(elements.max_element_tag, tag);
+                elements.num_elements++;
+            }
+            elements.entity_blocks.emplace_back();
+        }
+        elements.entity_blocks.pop_back();
+        elements.num_entity_blocks = elements.entity_blocks.size();
+        return;
     }
 
-    const std::string& version = spec.mesh_format.version;
-    const bool is_ascii = spec.mesh_format.file_type == 0;
-    if (version == "4.1") {
-        if (is_ascii)
-            v41::load_elements_ascii(in, spec);
-        else
-            v41::load_elements_binary(in, spec);
-    } else if (version == "2.2") {
-        if (is_ascii)
-            v22::load_elements_ascii(in, spec);
-        else
-            v22::load_elements_binary(in, spec);
-    } else {
-        std::stringstream msg;
-        msg << "Unsupported MSH version: " << version;
-        throw UnsupportedFeature(msg.str());
+    if (spec.mesh_format.version == "4.1") {
+        elements.num_entity_blocks = header.num_entity_blocks;
+        elements.num_elements = header.num_elements;
+        elements.min_element_tag = header.min_element_tag;
+        elements.max_element_tag = header.max_element_tag;
+        elements.entity_blocks.resize(elements.num_entity_blocks);
+        for (auto& block : elements.entity_blocks) {
+            loader.load_next(block);
+        }
+        return;
+    }
+
+    // MSH 2.2 files may contain several $Elements sections, whose elements are
+    // appended to the blocks of the previous ones.
+    if (elements.entity_blocks.size() == 0) {
+        elements.min_element_tag = std::numeric_limits<size_t>::max();
+        elements.max_element_tag = 0;
+    }
+    loader.load_grouped(elements.entity_blocks);
+    elements.num_entity_blocks = elements.entity_blocks.size();
+    elements.num_elements += header.num_elements;
+    if (header.num_elements > 0) {
+        elements.min_element_tag = std::min(elements.min_element_tag, header.min_element_tag);
+        elements.max_element_tag = std::max(elements.max_element_tag, header.max_element_tag);
     }
+    loader.create_entities(spec.entities);
 }
 
 } // namespace mshio
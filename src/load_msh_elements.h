@@ -1,11 +1,105 @@
 #pragma once
 
+#include "ascii_reader.h"
+
 #include <mshio/MshSpec.h>
+#include <mshio/options.h>
 
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace mshio {
 
-void load_elements(std::istream& in, MshSpec& spec);
+void load_elements(std::istream& in, MshSpec& spec, const LoadOptions& options);
+
+// Incremental loader for the body of an $Elements section, shared by
+// load_elements() and the streaming APIs. The section header is read on
+// construction, then each call to `load_next()` parses one element block into
+// `block`, reusing its storage.
+//
+// MSH 2.2 files list elements one by one: consecutive elements with the same
+// type and entity are grouped into blocks of at most `max_block_size`
+// elements. The block count and min/max element tags of the header, as well as
+// the entities implied by the element tags, are only known once all blocks
+// have been loaded.
+class ElementBlockLoader
+{
+public:
+    ElementBlockLoader(std::istream& in,
+        const MeshFormat& format,
+        const LoadOptions& options,
+        size_t max_block_size = std::numeric_limits<size_t>::max());
+
+    const Elements& header() const { return m_header; }
+
+    // Returns false once all blocks have been loaded.
+    bool load_next(ElementBlock& block);
+
+    // Only load the MSH 4.1 blocks of the given (dim, tag) entities. Binary
+    // blocks of other entities are skipped without being read.
+    void select_entities(std::set<std::pair<int, int>> entities)
+    {
+        m_selected_entities = std::move(entities);
+        m_select_entities = true;
+    }
+
+    // Load all remaining MSH 2.2 elements, appending each of them to the block
+    // of `blocks` with the same entity and element type. Blocks are created in
+    // order of first appearance.
+    void load_grouped(Vector<ElementBlock>& blocks);
+
+    // Add the MSH 2.2 entities seen so far, with their physical tags, to
+    // `entities`. Entities that already exist, e.g. because they were created
+    // from a previous $Elements section, are merged.
+    void create_entities(Entities& entities) const;
+
+private:
+    void load_element_v22();
+
+    bool is_selected(int entity_dim, int entity_tag) const
+    {
+        return !m_select_entities ||
+               m_selected_entities.count(std::make_pair(entity_dim, entity_tag)) > 0;
+    }
+
+private:
+    std::istream& m_in;
+    AsciiReader m_reader;
+    const LoadOptions& m_options;
+    Elements m_header;
+    bool m_is_v22 = false;
+    bool m_is_binary = false;
+    size_t m_max_block_size;
+    size_t m_remaining = 0; // Blocks for MSH 4.1, elements for MSH 2.2.
+    bool m_select_entities = false;
+    std::set<std::pair<int, int>> m_selected_entities;
+
+    // MSH 2.2 state: the element read ahead of the current block, the
+    // remainder of the current binary element group and scratch buffers.
+    bool m_has_pending = false;
+    int m_pending_type = 0;
+    int m_pending_entity_tag = 0;
+    std::vector<size_t> m_pending_data;
+    int m_group_type = 0;
+    int m_group_num_tags = 0;
+    size_t m_group_remaining = 0;
+    std::vector<int> m_tags;
+    std::vector<int> m_node_ids;
+
+    // (entity tag, physical tag) pairs per entity dimension, packed into 64
+    // bits. Consecutive elements almost always share the same pair, so the
+    // last inserted pair is cached. Other duplicates are appended, and removed
+    // by sorting once the array reaches its limit, twice its deduplicated size.
+    std::array<std::vector<uint64_t>, 4> m_physical_tags;
+    std::array<size_t, 4> m_physical_tags_limit = {{64, 64, 64, 64}};
+    int m_last_physical_dim = -1;
+    uint64_t m_last_physical_key = 0;
+};
 
-}
+} // namespace mshio
@@ -1,3 +1,4 @@
+#include "ascii_reader.h"
 #include "io_utils.h"
 
 #include <mshio/MshSpec.h>
@@ -12,11 +13,12 @@ namespace v41 {
 
 void load_entities_ascii(std::istream& in, MshSpec& spec)
 {
+    AsciiReader reader(in);
     size_t num_points, num_curves, num_surfaces, num_volumes;
-    in >> num_points;
-    in >> num_curves;
-    in >> num_surfaces;
-    in >> num_volumes;
+    reader.read(num_points);
+    reader.read(num_curves);
+    reader.read(num_surfaces);
+    reader.read(num_volumes);
     assert(in.good());
 
     Entities& entities = spec.entities;
@@ -27,84 +29,84 @@ void load_entities_ascii(std::istream& in, MshSpec& spec)
 
     for (size_t i = 0; i < num_points; i++) {
         PointEntity& point = entities.points[i];
-        in >> point.tag;
-        in >> point.x;
-        in >> point.y;
-        in >> point.z;
+        reader.read(point.tag);
+        reader.read(point.x);
+        reader.read(point.y);
+        reader.read(point.z);
         size_t num_physical_groups;
-        in >> num_physical_groups;
+        reader.read(num_physical_groups);
         point.physical_group_tags.resize(num_physical_groups);
         for (size_t j = 0; j < num_physical_groups; j++) {
-            in >> point.physical_group_tags[j];
+            reader.read(point.physical_group_tags[j]);
         }
     }
 
     for (size_t i = 0; i < num_curves; i++) {
         CurveEntity& curve = entities.curves[i];
-        in >> curve.tag;
-        in >> curve.min_x;
-        in >> curve.min_y;
-        in >> curve.min_z;
-        in >> curve.max_x;
-        in >> curve.max_y;
-        in >> curve.max_z;
+        reader.read(curve.tag);
+        reader.read(curve.min_x);
+        reader.read(curve.min_y);
+        reader.read(curve.min_z);
+        reader.read(curve.max_x);
+        reader.read(curve.max_y);
+        reader.read(curve.max_z);
         size_t num_physical_groups;
-        in >> num_physical_groups;
+        reader.read(num_physical_groups);
         curve.physical_group_tags.resize(num_physical_groups);
         for (size_t j = 0; j < num_physical_groups; j++) {
-            in >> curve.physical_group_tags[j];
+            reader.read(curve.physical_group_tags[j]);
         }
         size_t num_boundary_points;
-        in >> num_boundary_points;
+        reader.read(num_boundary_points);
         curve.boundary_point_tags.resize(num_boundary_points);
         for (size_t j = 0; j < num_boundary_points; j++) {
-            in >> curve.boundary_point_tags[j];
+            reader.read(curve.boundary_point_tags[j]);
         }
     }
 
     for (size_t i = 0; i < num_surfaces; i++) {
         SurfaceEntity& surface = entities.surfaces[i];
-        in >> surface.tag;
-        in >> surface.min_x;
-        in >> surface.min_y;
-        in >> surface.min_z;
-        in >> surface.max_x;
-        in >> surface.max_y;
-        in >> surface.max_z;
+        reader.read(surface.tag);
+        reader.read(surface.min_x);
+        reader.read(surface.min_y);
+        reader.read(surface.min_z);
+        reader.read(surface.max_x);
+        reader.read(surface.max_y);
+        reader.read(surface.max_z);
         size_t num_physical_groups;
-        in >> num_physical_groups;
+        reader.read(num_physical_groups);
         surface.physical_group_tags.resize(num_physical_groups);
         for (size_t j = 0; j < num_physical_groups; j++) {
-            in >> surface.physical_group_tags[j];
+            reader.read(surface.physical_group_tags[j]);
         }
         size_t num_boundary_curves;
-        in >> num_boundary_curves;
+        reader.read(num_boundary_curves);
         surface.boundary_curve_tags.resize(num_boundary_curves);
         for (size_t j = 0; j < num_boundary_curves; j++) {
-            in >> surface.boundary_curve_tags[j];
+            reader.read(surface.boundary_curve_tags[j]);
         }
     }
 
     for (size_t i = 0; i < num_volumes; i++) {
         VolumeEntity& volume = entities.volumes[i];
-        in >> volume.tag;
-        in >> volume.min_x;
-        in >> volume.min_y;
-        in >> volume.min_z;
-        in >> volume.max_x;
-        in >> volume.max_y;
-        in >> volume.max_z;
+        reader.read(volume.tag);
+        reader.read(volume.min_x);
+        reader.read(volume.min_y);
+        reader.read(volume.min_z);
+        reader.read(volume.max_x);
+        reader.read(volume.max_y);
+        reader.read(volume.max_z);
         size_t num_physical_groups;
-        in >> num_physical_groups;
+        reader.read(num_physical_groups);
         volume.physical_group_tags.resize(num_physical_groups);
         for (size_t j = 0; j < num_physical_groups; j++) {
-            in >> volume.physical_group_tags[j];
+            reader.read(volume.physical_group_tags[j]);
         }
         size_t num_boundary_surfaces;
-        in >> num_boundary_surfaces;
+        reader.read(num_boundary_surfaces);
         volume.boundary_surface_tags.resize(num_boundary_surfaces);
         for (size_t j = 0; j < num_boundary_surfaces; j++) {
-            in >> volume.boundary_surface_tags[j];
+            reader.read(volume.boundary_surface_tags[j]);
         }
     }
 
@@ -0,0 +1,163 @@
+#include "element_utils.h"
+#include "io_utils.h"
+#include "load_msh_sections.h"
+#include "mapped_file.h"
+#include "memory_streambuf.h"
+#include "skip_msh_section.h"
+
+#include <mshio/MappedMsh.h>
+#include <mshio/MshSpec.h>
+#include <mshio/exception.h>
+
+#include <cstring>
+#include <istream>
+#include <string>
+
+namespace mshio {
+
+namespace {
+
+// Sequential reader over the mapped bytes of a single section.
+class MappedCursor
+{
+public:
+    MappedCursor(const char* begin, const char* end, const std::string& section)
+        : m_curr(begin)
+        , m_end(end)
+        , m_section(section)
+    {}
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        std::memcpy(&value, skip(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    const char* skip(size_t num_bytes)
+    {
+        if (static_cast<size_t>(m_end - m_curr) < num_bytes) {
+            throw InvalidFormat("Truncated " + m_section + " section.");
+        }
+        const char* p = m_curr;
+        m_curr += num_bytes;
+        return p;
+    }
+
+    // Skip `count` items of `item_size` bytes. The count is checked before
+    // computing the size, so that crafted counts cannot wrap it around.
+    const char* skip(size_t count, size_t item_size)
+    {
+        check_count(count, item_size);
+        return skip(count * item_size);
+    }
+
+    // Check that `count` items of at least `item_size` bytes fit in the rest
+    // of the section.
+    void check_count(size_t count, size_t item_size) const
+    {
+        if (count > static_cast<size_t>(m_end - m_curr) / item_size) {
+            throw InvalidFormat("Truncated " + m_section + " section.");
+        }
+    }
+
+    const char* position() const { return m_curr; }
+
+private:
+    const char* m_curr;
+    const char* m_end;
+    std::string m_section;
+};
+
+void map_nodes(MappedCursor& cursor, MappedNodes& nodes)
+{
+    nodes.num_entity_blocks = cursor.read<size_t>();
+    nodes.num_nodes = cursor.read<size_t>();
+    nodes.min_node_tag = cursor.read<size_t>();
+    nodes.max_node_tag = cursor.read<size_t>();
+
+    cursor.check_count(nodes.num_entity_blocks, 3 * sizeof(int) + sizeof(size_t));
+    nodes.entity_blocks.resize(nodes.num_entity_blocks);
+    for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
+        MappedNodeBlock& block = nodes.entity_blocks[i];
+        block.entity_dim = cursor.read<int>();
+        block.entity_tag = cursor.read<int>();
+        block.parametric = cursor.read<int>();
+        block.num_nodes_in_block = cursor.read<size_t>();
+        if (block.parametric == 1 && (block.entity_dim < 0 || block.entity_dim > 3)) {
+            throw InvalidFormat("Invalid entity dimension in $Nodes section.");
+        }
+
+        block.tags = cursor.skip(block.num_nodes_in_block, sizeof(size_t));
+        block.data =
+            cursor.skip(block.num_nodes_in_block, sizeof(double) * block.entries_per_node());
+    }
+}
+
+void map_elements(MappedCursor& cursor, MappedElements& elements)
+{
+    elements.num_entity_blocks = cursor.read<size_t>();
+    elements.num_elements = cursor.read<size_t>();
+    elements.min_element_tag = cursor.read<size_t>();
+    elements.max_element_tag = cursor.read<size_t>();
+
+    cursor.check_count(elements.num_entity_blocks, 3 * sizeof(int) + sizeof(size_t));
+    elements.entity_blocks.resize(elements.num_entity_blocks);
+    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
+        MappedElementBlock& block = elements.entity_blocks[i];
+        block.entity_dim = cursor.read<int>();
+        block.entity_tag = cursor.read<int>();
+        block.element_type = cursor.read<int>();
+        block.num_elements_in_block = cursor.read<size_t>();
+
+        const size_t n = nodes_per_element(block.element_type);
+        block.data = cursor.skip(block.num_elements_in_block, sizeof(size_t) * (n + 1));
+    }
+}
+
+} // namespace
+
+MappedMsh::MappedMsh(const std::string& filename)
+    : m_file(new MappedFile(filename))
+{
+    const char* base = m_file->data();
+    const char* end = base + m_file->size();
+    MemoryStreamBuf buffer(base, m_file->size());
+    std::istream in(&buffer);
+
+    // Map a binary section in place and move the stream past its payload.
+    auto map_section = [&](const std::string& section, auto&& mapper) {
+        const MeshFormat& format = m_spec.mesh_format;
+        if (format.version != "4.1" || format.file_type == 0) {
+            throw UnsupportedFeature("Memory mapped loading requires a binary MSH 4.1 file.");
+        }
+        eat_white_space(in, 1);
+        MappedCursor cursor(base + static_cast<std::streamoff>(in.tellg()), end, section);
+        mapper(cursor);
+        in.seekg(cursor.position() - base);
+    };
+
+    std::string buf, end_str;
+    while (!in.eof()) {
+        buf.clear();
+        in >> buf;
+        if (buf.size() == 0 || buf[0] != '$') continue;
+        end_str = "$End" + buf.substr(1);
+        if (buf == "$Nodes") {
+            map_section(buf, [&](MappedCursor& cursor) { map_nodes(cursor, m_nodes); });
+        } else if (buf == "$Elements") {
+            map_section(buf, [&](MappedCursor& cursor) { map_elements(cursor, m_elements); });
+        } else if (!load_section(in, buf, m_spec, LoadOptions())) {
+            skip_section(in, buf, m_spec.mesh_format);
+            continue;
+        }
+        forward_to(in, end_str);
+    }
+}
+
+MappedMsh::MappedMsh(MappedMsh&& other) noexcept = default;
+MappedMsh& MappedMsh::operator=(MappedMsh&& other) noexcept = default;
+MappedMsh::~MappedMsh() = default;
+
+} // namespace mshio
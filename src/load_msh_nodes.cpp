@@ -1,5 +1,7 @@
 #include "load_msh_nodes.h"
+#include "ascii_reader.h"
 #include "io_utils.h"
+#include "load_msh_partitioned_entities.h"
 
 #include <mshio/MshSpec.h>
 #include <mshio/exception.h>
@@ -14,170 +16,258 @@
 namespace mshio {
 namespace v41 {
 
-void load_nodes_ascii(std::istream& in, MshSpec& spec)
+void load_nodes_header_ascii(std::istream& in, Nodes& nodes)
 {
-    Nodes& nodes = spec.nodes;
-    in >> nodes.num_entity_blocks;
-    in >> nodes.num_nodes;
-    in >> nodes.min_node_tag;
-    in >> nodes.max_node_tag;
+    AsciiReader reader(in);
+    reader.read(nodes.num_entity_blocks);
+    reader.read(nodes.num_nodes);
+    reader.read(nodes.min_node_tag);
+    reader.read(nodes.max_node_tag);
     assert(in.good());
-    nodes.entity_blocks.resize(nodes.num_entity_blocks);
-    for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
-        NodeBlock& block = nodes.entity_blocks[i];
-        in >> block.entity_dim;
-        in >> block.entity_tag;
-        in >> block.parametric;
-        in >> block.num_nodes_in_block;
-        assert(in.good());
-
-        block.tags.resize(block.num_nodes_in_block);
-        for (size_t j = 0; j < block.num_nodes_in_block; j++) {
-            in >> block.tags[j];
-        }
-        assert(in.good());
-
-        assert(block.parametric >= 0 && block.parametric <= 3);
-        const size_t entries_per_node =
-            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
-        block.data.resize(block.num_nodes_in_block * entries_per_node);
-        for (size_t j = 0; j < block.num_nodes_in_block; j++) {
-            for (size_t k = 0; k < entries_per_node; k++) {
-                in >> block.data[j * entries_per_node + k];
-            }
-        }
-        assert(in.good());
-    }
 }
 
-void load_nodes_binary(std::istream& in, MshSpec& spec)
+void load_nodes_header_binary(std::istream& in, Nodes& nodes)
 {
-    Nodes& nodes = spec.nodes;
     eat_white_space(in, 1);
     in.read(reinterpret_cast<char*>(&nodes.num_entity_blocks), sizeof(size_t));
     in.read(reinterpret_cast<char*>(&nodes.num_nodes), sizeof(size_t));
     in.read(reinterpret_cast<char*>(&nodes.min_node_tag), sizeof(size_t));
     in.read(reinterpret_cast<char*>(&nodes.max_node_tag), sizeof(size_t));
     assert(in.good());
-    nodes.entity_blocks.resize(nodes.num_entity_blocks);
-    for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
-        NodeBlock& block = nodes.entity_blocks[i];
-        in.read(reinterpret_cast<char*>(&block.entity_dim), sizeof(int));
-        in.read(reinterpret_cast<char*>(&block.entity_tag), sizeof(int));
-        in.read(reinterpret_cast<char*>(&block.parametric), sizeof(int));
-        in.read(reinterpret_cast<char*>(&block.num_nodes_in_block), sizeof(size_t));
-        assert(in.good());
+}
 
-        block.tags.resize(block.num_nodes_in_block);
-        in.read(reinterpret_cast<char*>(block.tags.data()),
-            static_cast<std::streamsize>(sizeof(size_t) * block.num_nodes_in_block));
-        assert(in.good());
+void load_node_block_ascii(std::istream& in, NodeBlock& block, const LoadOptions& options)
+{
+    AsciiReader reader(in);
+    reader.read(block.entity_dim);
+    reader.read(block.entity_tag);
+    reader.read(block.parametric);
+    reader.read(block.num_nodes_in_block);
+    assert(in.good());
 
-        const size_t entries_per_node =
-            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
-        block.data.resize(block.num_nodes_in_block * entries_per_node);
-        in.read(reinterpret_cast<char*>(block.data.data()),
-            static_cast<std::streamsize>(
-                sizeof(double) * block.num_nodes_in_block * entries_per_node));
-        assert(in.good());
+    block.tags.resize(block.num_nodes_in_block);
+    for (size_t j = read_rows_parallel(
+             in, block.num_nodes_in_block, 1, block.tags.data(), options.num_threads);
+         j < block.num_nodes_in_block;
+         j++) {
+        reader.read(block.tags[j]);
     }
+    assert(in.good());
+
+    assert(block.parametric >= 0 && block.parametric <= 3);
+    const size_t entries_per_node =
+        static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
+    block.data.resize(block.num_nodes_in_block * entries_per_node);
+    for (size_t j = read_rows_parallel(in,
+             block.num_nodes_in_block,
+             entries_per_node,
+             block.data.data(),
+             options.num_threads);
+         j < block.num_nodes_in_block;
+         j++) {
+        for (size_t k = 0; k < entries_per_node; k++) {
+            reader.read(block.data[j * entries_per_node + k]);
+        }
+    }
+    assert(in.good());
 }
 
-} // namespace v41
+void load_node_block_header_binary(std::istream& in, NodeBlock& block)
+{
+    in.read(reinterpret_cast<char*>(&block.entity_dim), sizeof(int));
+    in.read(reinterpret_cast<char*>(&block.entity_tag), sizeof(int));
+    in.read(reinterpret_cast<char*>(&block.parametric), sizeof(int));
+    in.read(reinterpret_cast<char*>(&block.num_nodes_in_block), sizeof(size_t));
+    assert(in.good());
+}
 
-namespace v22 {
+size_t get_entries_per_node(const NodeBlock& block)
+{
+    return static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
+}
 
-void load_nodes_ascii(std::istream& in, MshSpec& spec)
+void load_node_block_data_binary(std::istream& in, NodeBlock& block)
 {
-    Nodes& nodes = spec.nodes;
-    nodes.num_entity_blocks++;
-    nodes.entity_blocks.emplace_back();
+    block.tags.resize(block.num_nodes_in_block);
+    in.read(reinterpret_cast<char*>(block.tags.data()),
+        static_cast<std::streamsize>(sizeof(size_t) * block.num_nodes_in_block));
+    assert(in.good());
 
-    NodeBlock& block = nodes.entity_blocks.back();
-    block.entity_dim = 0; // Will be determined once elements are loaded.
-    block.entity_tag = 0; // Same as above.
-    block.parametric = 0;
-    in >> block.num_nodes_in_block;
+    const size_t entries_per_node = get_entries_per_node(block);
+    block.data.resize(block.num_nodes_in_block * entries_per_node);
+    in.read(reinterpret_cast<char*>(block.data.data()),
+        static_cast<std::streamsize>(
+            sizeof(double) * block.num_nodes_in_block * entries_per_node));
     assert(in.good());
-    nodes.num_nodes += block.num_nodes_in_block;
+}
 
-    block.tags.resize(block.num_nodes_in_block);
-    block.data.resize(block.num_nodes_in_block * 3);
-    for (size_t i = 0; i < block.num_nodes_in_block; i++) {
-        in >> block.tags[i];
-        in >> block.data[i * 3];
-        in >> block.data[i * 3 + 1];
-        in >> block.data[i * 3 + 2];
-        assert(in.good());
-    }
+void skip_node_block_data_binary(std::istream& in, const NodeBlock& block)
+{
+    skip_bytes(in,
+        block.num_nodes_in_block * (sizeof(size_t) + sizeof(double) * get_entries_per_node(block)));
+}
+
+} // namespace v41
+
+namespace v22 {
 
-    if (block.num_nodes_in_block > 0) {
-        nodes.min_node_tag =
-            std::min(nodes.min_node_tag, *std::min_element(block.tags.begin(), block.tags.end()));
-        nodes.max_node_tag =
-            std::max(nodes.max_node_tag, *std::max_element(block.tags.begin(), block.tags.end()));
+void load_node_block_ascii(std::istream& in, NodeBlock& block, size_t num_nodes)
+{
+    AsciiReader reader(in);
+    block.num_nodes_in_block = num_nodes;
+    block.tags.resize(num_nodes);
+    block.data.resize(num_nodes * 3);
+    for (size_t i = 0; i < num_nodes; i++) {
+        reader.read(block.tags[i]);
+        reader.read(block.data[i * 3]);
+        reader.read(block.data[i * 3 + 1]);
+        reader.read(block.data[i * 3 + 2]);
+        assert(in.good());
     }
 }
 
-void load_nodes_binary(std::istream& in, MshSpec& spec)
+void load_node_block_binary(std::istream& in, NodeBlock& block, size_t num_nodes)
 {
-    Nodes& nodes = spec.nodes;
-    nodes.num_entity_blocks++;
-    nodes.entity_blocks.emplace_back();
-
-    NodeBlock& block = nodes.entity_blocks.back();
-    block.entity_dim = 0; // Will be determined once elements are loaded.
-    block.entity_tag = 0; // Same as above.
-    block.parametric = 0;
-    in >> block.num_nodes_in_block;
-    assert(in.good());
-    nodes.num_nodes += block.num_nodes_in_block;
-
-    block.tags.resize(block.num_nodes_in_block);
-    block.data.resize(block.num_nodes_in_block * 3);
-    eat_white_space(in, 1);
-    for (size_t i = 0; i < block.num_nodes_in_block; i++) {
+    block.num_nodes_in_block = num_nodes;
+    block.tags.resize(num_nodes);
+    block.data.resize(num_nodes * 3);
+    for (size_t i = 0; i < num_nodes; i++) {
         assert(in.good());
         int tag;
         in.read(reinterpret_cast<char*>(&tag), sizeof(int));
         block.tags[i] = static_cast<size_t>(tag);
         in.read(reinterpret_cast<char*>(block.data.data() + i * 3), sizeof(double) * 3);
     }
-
-    if (block.num_nodes_in_block > 0) {
-        nodes.min_node_tag =
-            std::min(nodes.min_node_tag, *std::min_element(block.tags.begin(), block.tags.end()));
-        nodes.max_node_tag =
-            std::max(nodes.max_node_tag, *std::max_element(block.tags.begin(), block.tags.end()));
-    }
 }
 
 } // namespace v22
 
-void load_nodes(std::istream& in, MshSpec& spec)
+NodeBlockLoader::NodeBlockLoader(std::istream& in,
+    const MeshFormat& format,
+    const LoadOptions& options,
+    size_t max_block_size)
+    : m_in(in)
+    , m_options(options)
+    , m_is_v22(format.version == "2.2")
+    , m_is_binary(format.file_type > 0)
+    , m_max_block_size(std::max<size_t>(max_block_size, 1))
 {
-    if (spec.nodes.entity_blocks.size() == 0) {
-        spec.nodes.min_node_tag = std::numeric_limits<size_t>::max();
-        spec.nodes.max_node_tag = 0;
-        spec.nodes.num_nodes = 0;
-    }
-    const std::string& version = spec.mesh_format.version;
-    const bool is_ascii = spec.mesh_format.file_type == 0;
-    if (version == "4.1") {
-        if (is_ascii)
-            v41::load_nodes_ascii(in, spec);
-        else
-            v41::load_nodes_binary(in, spec);
-    } else if (version == "2.2") {
-        if (is_ascii)
-            v22::load_nodes_ascii(in, spec);
+    if (format.version == "4.1") {
+        if (m_is_binary)
+            v41::load_nodes_header_binary(in, m_header);
         else
-            v22::load_nodes_binary(in, spec);
+            v41::load_nodes_header_ascii(in, m_header);
+        m_remaining = m_header.num_entity_blocks;
+    } else if (m_is_v22) {
+        AsciiReader reader(in);
+        reader.read(m_header.num_nodes);
+        assert(in.good());
+        if (m_is_binary) eat_white_space(in, 1);
+        m_header.num_entity_blocks = (m_header.num_nodes + m_max_block_size - 1) / m_max_block_size;
+        m_remaining = m_header.num_nodes;
     } else {
         std::stringstream msg;
-        msg << "Unsupported MSH version: " << version;
+        msg << "Unsupported MSH version: " << format.version;
         throw UnsupportedFeature(msg.str());
     }
 }
 
+bool NodeBlockLoader::load_next(NodeBlock& block)
+{
+    if (m_remaining == 0) return false;
+
+    if (!m_is_v22) {
+        while (m_remaining > 0) {
+            m_remaining--;
+            if (!m_is_binary) {
+                // ASCII blocks have to be parsed to find their end anyway.
+                v41::load_node_block_ascii(m_in, block, m_options);
+                if (is_selected(block.entity_dim, block.entity_tag)) return true;
+                continue;
+            }
+            v41::load_node_block_header_binary(m_in, block);
+            if (is_selected(block.entity_dim, block.entity_tag)) {
+                v41::load_node_block_data_binary(m_in, block);
+                return true;
+            }
+            v41::skip_node_block_data_binary(m_in, block);
+        }
+        return false;
+    }
+
+    block.entity_dim = 0; // Will be determined once elements are loaded.
+    block.entity_tag = 0; // Same as above.
+    block.parametric = 0;
+    const size_t num_nodes = std::min(m_remaining, m_max_block_size);
+    if (m_is_binary)
+        v22::load_node_block_binary(m_in, block, num_nodes);
+    else
+        v22::load_node_block_ascii(m_in, block, num_nodes);
+    m_remaining -= num_nodes;
+
+    if (num_nodes > 0) {
+        const auto min_max = std::minmax_element(block.tags.begin(), block.tags.end());
+        const bool first_block = m_remaining + num_nodes == m_header.num_nodes;
+        m_header.min_node_tag = first_block ? *min_max.first
+                                            : std::min(m_header.min_node_tag, *min_max.first);
+        m_header.max_node_tag = first_block ? *min_max.second
+                                            : std::max(m_header.max_node_tag, *min_max.second);
+    }
+    return true;
+}
+
+void load_nodes(std::istream& in, MshSpec& spec, const LoadOptions& options)
+{
+    Nodes& nodes = spec.nodes;
+    NodeBlockLoader loader(in, spec.mesh_format, options);
+    const Nodes& header = loader.header();
+
+    if (spec.mesh_format.version == "4.1" && options.partition > 0) {
+        loader.select_entities(get_partition_entities(spec, options.partition));
+        nodes = Nodes();
+        // Blocks are loaded in place, so that they use the allocator of the spec.
+        nodes.entity_blocks.emplace_back();
+        while (loader.load_next(nodes.entity_blocks.back())) {
+            for (size_t tag : nodes.entity_blocks.back().tags) {
+                const bool first = nodes.num_nodes == 0;
+                nodes.min_node_tag = first ? tag : std::min(nodes.min_node_tag, tag);
+                nodes.max_node_tag = first ? tag : std::max(nodes.max_node_tag, tag);
+                nodes.num_nodes++;
+            }
+            nodes.entity_blocks.emplace_back();
+        }
+        nodes.entity_blocks.pop_back();
+        nodes.num_entity_blocks = nodes.entity_blocks.size();
+        return;
+    }
+
+    if (spec.mesh_format.version == "4.1") {
+        nodes.num_entity_blocks = header.num_entity_blocks;
+        nodes.num_nodes = header.num_nodes;
+        nodes.min_node_tag = header.min_node_tag;
+        nodes.max_node_tag = header.max_node_tag;
+        nodes.entity_blocks.resize(nodes.num_entity_blocks);
+        for (auto& block : nodes.entity_blocks) {
+            loader.load_next(block);
+        }
+        return;
+    }
+
+    // MSH 2.2 files may contain several $Nodes sections, which are appended.
+    if (nodes.entity_blocks.size() == 0) {
+        nodes.min_node_tag = std::numeric_limits<size_t>::max();
+        nodes.max_node_tag = 0;
+        nodes.num_nodes = 0;
+    }
+    nodes.entity_blocks.emplace_back();
+    if (!loader.load_next(nodes.entity_blocks.back())) {
+        nodes.entity_blocks.pop_back();
+        return;
+    }
+    nodes.num_entity_blocks++;
+    nodes.num_nodes += header.num_nodes;
+    nodes.min_node_tag = std::min(nodes.min_node_tag, header.min_node_tag);
+    nodes.max_node_tag = std::max(nodes.max_node_tag, header.max_node_tag);
+}
+
 } // namespace mshio
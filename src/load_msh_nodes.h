@@ -1,11 +1,63 @@
 #pragma once
 
 #include <mshio/MshSpec.h>
+#include <mshio/options.h>
 
 #include <iostream>
+#include <limits>
+#include <set>
+#include <utility>
 
 namespace mshio {
 
-void load_nodes(std::istream& in, MshSpec& spec);
+void load_nodes(std::istream& in, MshSpec& spec, const LoadOptions& options);
 
-}
+// Incremental loader for the body of a $Nodes section, shared by load_nodes()
+// and the streaming APIs. The section header is read on construction, then
+// each call to `load_next()` parses one node block into `block`, reusing its
+// storage.
+//
+// MSH 2.2 files have a single list of nodes: it is split into blocks of at
+// most `max_block_size` nodes with entity 0. The min/max node tags of the
+// header are only known once all blocks have been loaded.
+class NodeBlockLoader
+{
+public:
+    NodeBlockLoader(std::istream& in,
+        const MeshFormat& format,
+        const LoadOptions& options,
+        size_t max_block_size = std::numeric_limits<size_t>::max());
+
+    const Nodes& header() const { return m_header; }
+
+    // Returns false once all blocks have been loaded.
+    bool load_next(NodeBlock& block);
+
+    // Only load the MSH 4.1 blocks of the given (dim, tag) entities. Binary
+    // blocks of other entities are skipped without being read.
+    void select_entities(std::set<std::pair<int, int>> entities)
+    {
+        m_selected_entities = std::move(entities);
+        m_select_entities = true;
+    }
+
+private:
+    bool is_selected(int entity_dim, int entity_tag) const
+    {
+        return !m_select_entities ||
+               m_selected_entities.count(std::make_pair(entity_dim, entity_tag)) > 0;
+    }
+
+private:
+    std::istream& m_in;
+    const LoadOptions& m_options;
+    Nodes m_header;
+    bool m_is_v22 = false;
+    bool m_is_binary = false;
+    size_t m_max_block_size;
+    size_t m_remaining = 0; // Blocks for MSH 4.1, nodes for MSH 2.2.
+    bool m_select_entities = false;
+    std::set<std::pair<int, int>> m_selected_entities;
+};
+
+} // namespace mshio
@@ -0,0 +1,177 @@
+#include "load_msh_partitioned_entities.h"
+#include "ascii_reader.h"
+#include "io_utils.h"
+
+#include <mshio/MshSpec.h>
+#include <mshio/exception.h>
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace mshio {
+
+namespace {
+
+// Reads the fields of a section either as ASCII tokens or as raw binary
+// values, so that both encodings share the same parser.
+class FieldReader
+{
+public:
+    FieldReader(std::istream& in, bool is_binary)
+        : m_in(in)
+        , m_reader(in)
+        , m_is_binary(is_binary)
+    {
+        if (m_is_binary) eat_white_space(in, 1);
+    }
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        if (m_is_binary) {
+            m_in.read(reinterpret_cast<char*>(&value), sizeof(T));
+            if (!m_in.good()) {
+                throw InvalidFormat("Unexpected end of file in binary section.");
+            }
+        } else {
+            m_reader.read(value);
+        }
+        return value;
+    }
+
+    // Read a size_t count followed by that many int tags.
+    void read_tags(Vector<int>& tags)
+    {
+        tags.resize(read<size_t>());
+        for (auto& tag : tags) {
+            tag = read<int>();
+        }
+    }
+
+private:
+    std::istream& m_in;
+    AsciiReader m_reader;
+    bool m_is_binary;
+};
+
+void load_partitioned_entity(FieldReader& reader, PartitionedEntity& entity, int dim)
+{
+    entity.tag = reader.read<int>();
+    entity.parent_dim = reader.read<int>();
+    entity.parent_tag = reader.read<int>();
+    reader.read_tags(entity.partition_tags);
+    entity.min_x = reader.read<double>();
+    entity.min_y = reader.read<double>();
+    entity.min_z = reader.read<double>();
+    if (dim > 0) {
+        entity.max_x = reader.read<double>();
+        entity.max_y = reader.read<double>();
+        entity.max_z = reader.read<double>();
+    }
+    reader.read_tags(entity.physical_group_tags);
+    if (dim > 0) {
+        reader.read_tags(entity.boundary_tags);
+    }
+}
+
+bool in_partition(const Vector<int>& partition_tags, int partition)
+{
+    return std::find(partition_tags.begin(), partition_tags.end(), partition) !=
+           partition_tags.end();
+}
+
+} // namespace
+
+void load_partitioned_entities(std::istream& in, MshSpec& spec)
+{
+    if (spec.mesh_format.version != "4.1") {
+        throw InvalidFormat("$PartitionedEntities section requires MSH version 4.1");
+    }
+    FieldReader reader(in, spec.mesh_format.file_type > 0);
+    PartitionedEntities& entities = spec.partitioned_entities;
+
+    entities.num_partitions = reader.read<size_t>();
+    entities.ghost_entities.resize(reader.read<size_t>());
+    for (auto& ghost : entities.ghost_entities) {
+        ghost.tag = reader.read<int>();
+        ghost.partition = reader.read<int>();
+    }
+
+    entities.points.resize(reader.read<size_t>());
+    entities.curves.resize(reader.read<size_t>());
+    entities.surfaces.resize(reader.read<size_t>());
+    entities.volumes.resize(reader.read<size_t>());
+    for (auto& point : entities.points) {
+        load_partitioned_entity(reader, point, 0);
+    }
+    for (auto& curve : entities.curves) {
+        load_partitioned_entity(reader, curve, 1);
+    }
+    for (auto& surface : entities.surfaces) {
+        load_partitioned_entity(reader, surface, 2);
+    }
+    for (auto& volume : entities.volumes) {
+        load_partitioned_entity(reader, volume, 3);
+    }
+    assert(in.good());
+}
+
+void load_ghost_elements(std::istream& in, MshSpec& spec, const LoadOptions& options)
+{
+    if (spec.mesh_format.version != "4.1") {
+        throw InvalidFormat("$GhostElements section requires MSH version 4.1");
+    }
+    FieldReader reader(in, spec.mesh_format.file_type > 0);
+    const size_t num_ghost_elements = reader.read<size_t>();
+    auto& ghost_elements = spec.ghost_elements;
+    ghost_elements.reserve(ghost_elements.size() + num_ghost_elements);
+
+    GhostElement element;
+    for (size_t i = 0; i < num_ghost_elements; i++) {
+        element.tag = reader.read<size_t>();
+        element.partition = reader.read<int>();
+        reader.read_tags(element.ghost_partition_tags);
+        if (options.partition == 0 || element.partition == options.partition ||
+            in_partition(element.ghost_partition_tags, options.partition)) {
+            ghost_elements.push_back(element);
+        }
+    }
+    assert(in.good());
+}
+
+std::set<std::pair<int, int>> get_partition_entities(const MshSpec& spec, int partition)
+{
+    const PartitionedEntities& entities = spec.partitioned_entities;
+    if (entities.empty()) {
+        throw InvalidFormat("Loading a single partition requires a $PartitionedEntities "
+                            "section before $Nodes and $Elements.");
+    }
+
+    std::set<std::pair<int, int>> selected;
+    const Vector<PartitionedEntity>* all_entities[] = {
+        &entities.points, &entities.curves, &entities.surfaces, &entities.volumes};
+    for (int dim = 0; dim < 4; dim++) {
+        for (const PartitionedEntity& entity : *all_entities[dim]) {
+            if (in_partition(entity.partition_tags, partition)) {
+                selected.emplace(dim, entity.tag);
+            }
+        }
+    }
+
+    // Ghost entities are listed without their dimension, which is that of the
+    // partitioned entity with the same tag. Ghost tags without one are skipped
+    // rather than matching unrelated entities of every dimension.
+    for (const GhostEntity& ghost : entities.ghost_entities) {
+        if (ghost.partition != partition) continue;
+        for (int dim = 0; dim < 4; dim++) {
+            for (const PartitionedEntity& entity : *all_entities[dim]) {
+                if (entity.tag == ghost.tag) selected.emplace(dim, ghost.tag);
+            }
+        }
+    }
+    return selected;
+}
+
+} // namespace mshio
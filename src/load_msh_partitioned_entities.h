@@ -0,0 +1,20 @@
+#pragma once
+#include <mshio/MshSpec.h>
+#include <mshio/options.h>
+
+#include <iostream>
+#include <set>
+#include <utility>
+
+namespace mshio {
+
+void load_partitioned_entities(std::istream& in, MshSpec& spec);
+
+// Ghost elements not involving `options.partition` are dropped.
+void load_ghost_elements(std::istream& in, MshSpec& spec, const LoadOptions& options);
+
+// (dim, tag) of the entities of `partition` and of its ghost entities, based
+// on the partitioned entities of `spec`.
+std::set<std::pair<int, int>> get_partition_entities(const MshSpec& spec, int partition);
+
+} // namespace mshio
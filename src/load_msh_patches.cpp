@@ -1,4 +1,5 @@
 #include "load_msh_patches.h"
+#include "ascii_reader.h"
 #include "io_utils.h"
 
 namespace mshio {
@@ -8,21 +9,22 @@ namespace {
 void load_patches_ascii(std::istream& in, MshSpec& spec)
 {
 #ifdef MSHIO_EXT_NANOSPLINE
+    AsciiReader reader(in);
     auto& patches = spec.patches;
     size_t num_patches;
-    in >> num_patches;
+    reader.read(num_patches);
     patches.resize(num_patches);
 
     for (size_t i = 0; i < num_patches; i++) {
         auto& patch = patches[i];
-        in >> patch.patch_tag;
-        in >> patch.patch_type;
-        in >> patch.degree_u;
-        in >> patch.degree_v;
-        in >> patch.num_control_points;
-        in >> patch.num_u_knots;
-        in >> patch.num_v_knots;
-        in >> patch.with_weights;
+        reader.read(patch.patch_tag);
+        reader.read(patch.patch_type);
+        reader.read(patch.degree_u);
+        reader.read(patch.degree_v);
+        reader.read(patch.num_control_points);
+        reader.read(patch.num_u_knots);
+        reader.read(patch.num_v_knots);
+        reader.read(patch.with_weights);
 
         const size_t dim = (patch.with_weights > 0) ? 4 : 3;
         const size_t num_entries =
@@ -30,7 +32,7 @@ void load_patches_ascii(std::istream& in, MshSpec& spec)
 
         patch.data.resize(num_entries);
         for (size_t j = 0; j < num_entries; j++) {
-            in >> patch.data[j];
+            reader.read(patch.data[j]);
         }
     }
 #endif
@@ -1,4 +1,5 @@
 #include "load_msh_physical_groups.h"
+#include "ascii_reader.h"
 
 #include <mshio/MshSpec.h>
 
@@ -12,13 +13,14 @@ namespace mshio {
 void load_physical_groups(std::istream& in, MshSpec& spec)
 {
     auto& groups = spec.physical_groups;
+    AsciiReader reader(in);
     int num_groups;
-    in >> num_groups;
+    reader.read(num_groups);
     spec.physical_groups.resize(num_groups);
     for (int i = 0; i < num_groups; i++) {
         auto& group = groups[i];
-        in >> group.dim;
-        in >> group.tag;
+        reader.read(group.dim);
+        reader.read(group.tag);
         in >> std::quoted(group.name);
     }
     assert(in.good());
@@ -1,112 +1,150 @@
 #include "load_msh_post_process.h"
 #include "element_utils.h"
+#include "parallel_utils.h"
 
 #include <mshio/MshSpec.h>
+#include <mshio/NodeIndex.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace mshio {
 namespace v22 {
 
-void regroup_nodes_into_blocks(MshSpec& spec)
+void regroup_nodes_into_blocks(MshSpec& spec, const LoadOptions& options)
 {
     auto& nodes = spec.nodes;
-    auto& elements = spec.elements;
-
-    std::vector<size_t> entity_dims(nodes.max_node_tag - nodes.min_node_tag + 1, 0);
-    std::vector<size_t> entity_tags(nodes.max_node_tag - nodes.min_node_tag + 1, 0);
-    auto node_index = [&](size_t node_tag) {
-        return static_cast<size_t>(node_tag - nodes.min_node_tag);
+    const auto& elements = spec.elements;
+    constexpr size_t chunk_size = 1 << 16;
+
+    // Nodes are numbered in file order, and looked up by tag through a
+    // NodeIndex. Duplicated tags resolve to a single node.
+    std::vector<std::pair<size_t, size_t>> node_chunks;
+    std::vector<size_t> offsets;
+    size_t num_nodes = 0;
+    for (size_t i = 0; i < nodes.entity_blocks.size(); i++) {
+        offsets.push_back(num_nodes);
+        for (size_t j = 0; j < nodes.entity_blocks[i].tags.size(); j += chunk_size) {
+            node_chunks.emplace_back(i, j);
+        }
+        num_nodes += nodes.entity_blocks[i].tags.size();
+    }
+    const NodeIndex node_index(nodes, options.num_threads);
+    auto position_of = [&](size_t tag) {
+        const NodeIndex::Location location = node_index.find(tag);
+        return location.valid() ? offsets[location.block] + location.index : NodeIndex::invalid;
     };
 
-    for (const auto& block : elements.entity_blocks) {
-        const auto n = nodes_per_element(block.element_type);
-        for (size_t i = 0; i < block.num_elements_in_block; i++) {
-            for (size_t j = 0; j < n; j++) {
-                size_t idx = node_index(block.data[i * (n + 1) + j + 1]);
-                entity_dims[idx] = block.entity_dim;
-                entity_tags[idx] = block.entity_tag;
-            }
+    // Each node belongs to the entity of the last element block referring to
+    // it. Blocks are ordered by the first appearance of their (entity, type)
+    // pair, so this need not be the entity of the last element of the file
+    // referring to the node. Element blocks are scanned in chunks, and block
+    // indices (offset by one, 0 meaning no element) are merged with an atomic
+    // max so that the result does not depend on the scheduling.
+    std::unique_ptr<std::atomic<size_t>[]> owners(new std::atomic<size_t>[num_nodes]());
+    std::vector<std::pair<size_t, size_t>> element_chunks;
+    for (size_t i = 0; i < elements.entity_blocks.size(); i++) {
+        const size_t num_elements = elements.entity_blocks[i].num_elements_in_block;
+        for (size_t j = 0; j < num_elements; j += chunk_size) {
+            element_chunks.emplace_back(i, j);
         }
     }
-
-    std::vector<NodeBlock> node_blocks;
-    node_blocks.reserve(16);
-
-    constexpr size_t INVALID = std::numeric_limits<size_t>::max();
-    size_t curr_dim = INVALID, curr_tag = INVALID;
-    for (auto& block : nodes.entity_blocks) {
-        for (size_t i = 0; i < block.num_nodes_in_block; i++) {
-            size_t idx = node_index(block.tags[i]);
-            size_t dim = entity_dims[idx];
-            size_t tag = entity_tags[idx];
-
-            if (dim != curr_dim || tag != curr_tag) {
-                node_blocks.emplace_back();
-                auto& curr_block = node_blocks.back();
-                curr_block.tags.reserve(block.num_nodes_in_block);
-                curr_block.data.reserve(block.num_nodes_in_block * 3);
-                curr_block.entity_dim = static_cast<int>(dim);
-                curr_block.entity_tag = static_cast<int>(tag);
-                curr_dim = dim;
-                curr_tag = tag;
+    parallel_for(element_chunks.size(), options.num_threads, [&](size_t c) {
+        const size_t owner = element_chunks[c].first + 1;
+        const auto& block = elements.entity_blocks[element_chunks[c].first];
+        const size_t n = nodes_per_element(block.element_type);
+        const size_t begin = element_chunks[c].second;
+        const size_t end = std::min(begin + chunk_size, block.num_elements_in_block);
+        for (size_t i = begin; i < end; i++) {
+            for (size_t j = 0; j < n; j++) {
+                const size_t idx = position_of(block.data[i * (n + 1) + j + 1]);
+                if (idx == NodeIndex::invalid) continue;
+                size_t curr = owners[idx].load(std::memory_order_relaxed);
+                while (curr < owner &&
+                       !owners[idx].compare_exchange_weak(curr, owner, std::memory_order_relaxed)) {
+                }
             }
-
-            assert(!node_blocks.empty());
-            auto& curr_block = node_blocks.back();
-            curr_block.tags.push_back(block.tags[i]);
-            curr_block.data.push_back(block.data[i * 3]);
-            curr_block.data.push_back(block.data[i * 3 + 1]);
-            curr_block.data.push_back(block.data[i * 3 + 2]);
         }
+    });
+
+    // Look up the owner of every node, in file order.
+    std::vector<size_t> node_owners(num_nodes);
+    parallel_for(node_chunks.size(), options.num_threads, [&](size_t c) {
+        const auto& block = nodes.entity_blocks[node_chunks[c].first];
+        const size_t begin = node_chunks[c].second;
+        const size_t end = std::min(begin + chunk_size, block.tags.size());
+        size_t* out = node_owners.data() + offsets[node_chunks[c].first];
+        for (size_t i = begin; i < end; i++) {
+            const size_t idx = position_of(block.tags[i]);
+            out[i] = (idx == NodeIndex::invalid) ? 0 : owners[idx].load(std::memory_order_relaxed);
+        }
+    });
+    owners.reset();
+
+    // Consecutive nodes of the same entity form a node block.
+    auto entity_of = [&](size_t owner) {
+        if (owner == 0) return std::make_pair(0, 0);
+        const auto& block = elements.entity_blocks[owner - 1];
+        return std::make_pair(block.entity_dim, block.entity_tag);
+    };
+    Vector<NodeBlock> node_blocks(spec.nodes.entity_blocks.get_allocator());
+    std::vector<size_t> block_starts;
+    for (size_t i = 0; i < num_nodes; i++) {
+        const auto entity = entity_of(node_owners[i]);
+        if (node_blocks.empty() || entity.first != node_blocks.back().entity_dim ||
+            entity.second != node_blocks.back().entity_tag) {
+            node_blocks.emplace_back();
+            node_blocks.back().entity_dim = entity.first;
+            node_blocks.back().entity_tag = entity.second;
+            block_starts.push_back(i);
+        }
+        node_blocks.back().num_nodes_in_block++;
     }
 
+    // Copy the nodes of each new block, which may span several old blocks.
+    // Blocks are sized on this thread, as the memory resource of the spec
+    // need not be thread-safe, and filled in parallel.
     for (auto& block : node_blocks) {
-        block.num_nodes_in_block = block.tags.size();
+        block.tags.resize(block.num_nodes_in_block);
+        block.data.resize(block.num_nodes_in_block * 3);
     }
-    std::swap(spec.nodes.entity_blocks, node_blocks);
-    spec.nodes.num_entity_blocks = spec.nodes.entity_blocks.size();
-}
-
-void regroup_elements_into_blocks(MshSpec& spec)
-{
-    auto& elements = spec.elements;
-
-    std::vector<ElementBlock> element_blocks;
-    element_blocks.reserve(elements.num_entity_blocks);
-
-    size_t curr_dim = 0, curr_tag = 0, curr_element_type = 0;
-    for (auto& block : elements.entity_blocks) {
-        if (block.entity_dim != curr_dim || block.entity_tag != curr_tag ||
-            block.element_type != curr_element_type) {
-            element_blocks.emplace_back();
-            auto& curr_block = element_blocks.back();
-            curr_block.entity_dim = block.entity_dim;
-            curr_block.entity_tag = block.entity_tag;
-            curr_block.element_type = block.element_type;
-
-            curr_dim = block.entity_dim;
-            curr_tag = block.entity_tag;
-            curr_element_type = block.element_type;
+    parallel_for(node_blocks.size(), options.num_threads, [&](size_t b) {
+        auto& curr_block = node_blocks[b];
+        size_t k = static_cast<size_t>(
+            std::upper_bound(offsets.begin(), offsets.end(), block_starts[b]) - offsets.begin() -
+            1);
+        size_t i = block_starts[b] - offsets[k];
+        size_t j = 0;
+        while (j < curr_block.num_nodes_in_block) {
+            const auto& block = nodes.entity_blocks[k];
+            if (i == block.tags.size()) {
+                k++;
+                i = 0;
+                continue;
+            }
+            curr_block.tags[j] = block.tags[i];
+            std::copy_n(block.data.begin() + static_cast<std::ptrdiff_t>(i * 3),
+                3,
+                curr_block.data.begin() + static_cast<std::ptrdiff_t>(j * 3));
+            i++;
+            j++;
         }
+    });
 
-        auto& curr_block = element_blocks.back();
-        curr_block.num_elements_in_block += block.num_elements_in_block;
-        curr_block.data.insert(curr_block.data.end(), block.data.begin(), block.data.end());
-    }
-
-    std::swap(spec.elements.entity_blocks, element_blocks);
-    spec.elements.num_entity_blocks = spec.elements.entity_blocks.size();
+    std::swap(spec.nodes.entity_blocks, node_blocks);
+    spec.nodes.num_entity_blocks = spec.nodes.entity_blocks.size();
 }
 
 } // namespace v22
 
-void load_msh_post_process(MshSpec& spec)
+void load_msh_post_process(MshSpec& spec, const LoadOptions& options)
 {
     if (spec.mesh_format.version == "2.2") {
-        v22::regroup_nodes_into_blocks(spec);
-        v22::regroup_elements_into_blocks(spec);
+        v22::regroup_nodes_into_blocks(spec, options);
     }
 }
 
@@ -1,9 +1,10 @@
 #pragma once
 
 #include <mshio/MshSpec.h>
+#include <mshio/options.h>
 
 namespace mshio {
 
-void load_msh_post_process(MshSpec& spec);
+void load_msh_post_process(MshSpec& spec, const LoadOptions& options);
 
 }
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <mshio/MshSpec.h>
+#include <mshio/options.h>
+
+#include <iostream>
+#include <string>
+
+namespace mshio {
+
+// Maximum number of nodes or elements per block reported for MSH 2.2 files by
+// the streaming APIs.
+constexpr size_t stream_block_size = 1 << 16;
+
+// Load the body of the section whose header token (e.g. "$Nodes") has just
+// been read from `in`. Unknown sections are reported and left unread, in which
+// case false is returned.
+bool load_section(std::istream& in,
+    const std::string& section,
+    MshSpec& spec,
+    const LoadOptions& options);
+
+// Whether `options` requests `section` to be skipped.
+bool is_skipped_section(const std::string& section, const LoadOptions& options);
+
+} // namespace mshio
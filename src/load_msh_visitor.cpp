@@ -0,0 +1,125 @@
+#include "compressed_streambuf.h"
+#include "io_utils.h"
+#include "load_msh_data.h"
+#include "load_msh_elements.h"
+#include "load_msh_entities.h"
+#include "load_msh_format.h"
+#include "load_msh_nodes.h"
+#include "load_msh_physical_groups.h"
+#include "load_msh_sections.h"
+#include "skip_msh_section.h"
+
+#include <mshio/MshSpec.h>
+#include <mshio/MshVisitor.h>
+#include <mshio/options.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace mshio {
+
+namespace {
+
+void visit_nodes(
+    std::istream& in, const MeshFormat& format, MshVisitor& visitor, const LoadOptions& options)
+{
+    NodeBlockLoader loader(in, format, options, stream_block_size);
+    visitor.on_nodes_begin(loader.header());
+    NodeBlock block;
+    while (loader.load_next(block)) {
+        visitor.on_node_block(block);
+    }
+    visitor.on_nodes_end(loader.header());
+}
+
+void visit_elements(
+    std::istream& in, const MeshFormat& format, MshVisitor& visitor, const LoadOptions& options)
+{
+    ElementBlockLoader loader(in, format, options, stream_block_size);
+    visitor.on_elements_begin(loader.header());
+    ElementBlock block;
+    while (loader.load_next(block)) {
+        visitor.on_element_block(block);
+    }
+    visitor.on_elements_end(loader.header());
+
+    if (format.version == "2.2") {
+        Entities entities;
+        loader.create_entities(entities);
+        visitor.on_entities(entities);
+    }
+}
+
+void visit_data(std::istream& in, const MeshFormat& format, MshVisitor& visitor, DataKind kind)
+{
+    DataEntryLoader loader(in, format, kind == DataKind::ElementNodeData);
+    visitor.on_data_begin(kind, loader.header());
+    DataEntry entry;
+    while (loader.load_next(entry)) {
+        visitor.on_data_entry(kind, entry);
+    }
+    visitor.on_data_end(kind);
+}
+
+} // namespace
+
+void load_msh(std::istream& in, MshVisitor& visitor, const LoadOptions& options)
+{
+    if (auto buffer = open_decompressing_streambuf(in)) {
+        std::istream decompressed(buffer.get());
+        decompressed.exceptions(std::ios_base::badbit);
+        return load_msh(decompressed, visitor, options);
+    }
+
+    MshSpec spec; // Holds the mesh format and the small sections being visited.
+    std::string buf, end_str;
+
+    while (!in.eof()) {
+        buf.clear();
+        in >> buf;
+        if (buf.size() == 0 || buf[0] != '$') continue;
+        end_str = "$End" + buf.substr(1);
+
+        const MeshFormat& format = spec.mesh_format;
+        if (is_skipped_section(buf, options)) {
+            skip_section(in, buf, format);
+            continue;
+        }
+        if (buf == "$MeshFormat") {
+            load_mesh_format(in, spec);
+            visitor.on_mesh_format(format);
+        } else if (buf == "$PhysicalNames") {
+            spec.physical_groups.clear();
+            load_physical_groups(in, spec);
+            visitor.on_physical_groups(spec.physical_groups);
+        } else if (buf == "$Entities") {
+            spec.entities = Entities();
+            load_entities(in, spec);
+            visitor.on_entities(spec.entities);
+        } else if (buf == "$Nodes") {
+            visit_nodes(in, format, visitor, options);
+        } else if (buf == "$Elements") {
+            visit_elements(in, format, visitor, options);
+        } else if (buf == "$NodeData") {
+            visit_data(in, format, visitor, DataKind::NodeData);
+        } else if (buf == "$ElementData") {
+            visit_data(in, format, visitor, DataKind::ElementData);
+        } else if (buf == "$ElementNodeData") {
+            visit_data(in, format, visitor, DataKind::ElementNodeData);
+        } else {
+            // Extension and unknown sections have no callbacks.
+            skip_section(in, buf, format);
+            continue;
+        }
+        forward_to(in, end_str);
+    }
+}
+
+void load_msh(const std::string& filename, MshVisitor& visitor, const LoadOptions& options)
+{
+    auto in = open_input(filename, options);
+    load_msh(*in, visitor, options);
+}
+
+} // namespace mshio
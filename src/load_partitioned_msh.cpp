@@ -0,0 +1,465 @@
+#include "element_utils.h"
+#include "parallel_utils.h"
+
+#include <mshio/MshSpec.h>
+#include <mshio/exception.h>
+#include <mshio/mshio.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mshio {
+
+namespace {
+
+std::string partition_filename(const std::string& basename, size_t part)
+{
+    // Gmsh names the partitions of "mesh.msh" "mesh_1.msh", "mesh_2.msh", ...
+    std::string stem = basename;
+    const std::string extension = ".msh";
+    if (stem.size() > extension.size() &&
+        stem.compare(stem.size() - extension.size(), extension.size(), extension) == 0) {
+        stem.resize(stem.size() - extension.size());
+    }
+    return stem + "_" + std::to_string(part) + extension;
+}
+
+bool file_exists(const std::string& filename)
+{
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    return fin.is_open();
+}
+
+// Tags stored every `stride` entries of `data`, e.g. the node tags of a block.
+struct TagRange
+{
+    const size_t* data = nullptr;
+    size_t size = 0; // Number of tags.
+    size_t stride = 1;
+    size_t first = 0; // Index of the first tag in the concatenation of all ranges.
+};
+
+// Flag the first occurrence of each tag in the concatenation of `ranges`.
+// Tags are bucketed into one shard per thread by hash with a counting sort,
+// then each shard is sorted by tag and file order by a single task, so no
+// synchronization is needed and the result does not depend on the number of
+// threads.
+std::vector<char> flag_first_occurrences(const std::vector<TagRange>& ranges, size_t num_threads)
+{
+    constexpr size_t chunk_size = size_t(1) << 16;
+    const size_t total = ranges.empty() ? 0 : ranges.back().first + ranges.back().size;
+    std::vector<char> is_first(total, 0);
+    const size_t num_shards = total < chunk_size ? 1 : resolve_num_threads(num_threads);
+    auto shard_of = [&](size_t tag) {
+        return static_cast<size_t>((static_cast<uint64_t>(tag) * 0x9E3779B97F4A7C15ull >> 32) %
+                                   num_shards);
+    };
+
+    // Chunks of at most `chunk_size` tags, as (range, begin) pairs.
+    std::vector<std::pair<size_t, size_t>> chunks;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        for (size_t j = 0; j < ranges[i].size; j += chunk_size) {
+            chunks.emplace_back(i, j);
+        }
+    }
+    const size_t num_chunks = chunks.size();
+    auto for_each_tag = [&](size_t c, auto&& fn) {
+        const TagRange& range = ranges[chunks[c].first];
+        const size_t end = std::min(range.size, chunks[c].second + chunk_size);
+        for (size_t i = chunks[c].second; i < end; i++) {
+            fn(range.data[i * range.stride], range.first + i);
+        }
+    };
+
+    std::vector<size_t> counts(num_chunks * num_shards, 0);
+    parallel_for(num_chunks, num_threads, [&](size_t c) {
+        size_t* chunk_counts = counts.data() + c * num_shards;
+        for_each_tag(c, [&](size_t tag, size_t) { chunk_counts[shard_of(tag)]++; });
+    });
+
+    // Offsets of each (shard, chunk) bucket, shard major.
+    std::vector<size_t> shard_offsets(num_shards + 1, 0);
+    size_t offset = 0;
+    for (size_t s = 0; s < num_shards; s++) {
+        shard_offsets[s] = offset;
+        for (size_t c = 0; c < num_chunks; c++) {
+            const size_t count = counts[c * num_shards + s];
+            counts[c * num_shards + s] = offset;
+            offset += count;
+        }
+    }
+    shard_offsets[num_shards] = offset;
+
+    // (tag, index in the concatenation) pairs.
+    std::vector<std::pair<size_t, size_t>> bucketed(total);
+    parallel_for(num_chunks, num_threads, [&](size_t c) {
+        size_t* chunk_offsets = counts.data() + c * num_shards;
+        for_each_tag(c, [&](size_t tag, size_t index) {
+            bucketed[chunk_offsets[shard_of(tag)]++] = {tag, index};
+        });
+    });
+
+    parallel_for(num_shards, num_threads, [&](size_t s) {
+        const auto begin = bucketed.begin() + static_cast<std::ptrdiff_t>(shard_offsets[s]);
+        const auto end = bucketed.begin() + static_cast<std::ptrdiff_t>(shard_offsets[s + 1]);
+        std::sort(begin, end);
+        for (auto itr = begin; itr != end; ++itr) {
+            if (itr == begin || itr->first != (itr - 1)->first) is_first[itr->second] = 1;
+        }
+    });
+    return is_first;
+}
+
+void append_range(std::vector<TagRange>& ranges, const size_t* data, size_t size, size_t stride)
+{
+    const size_t first = ranges.empty() ? 0 : ranges.back().first + ranges.back().size;
+    ranges.push_back({data, size, stride, first});
+}
+
+// Block of a partition contributing to a merged block.
+template <typename Block>
+struct BlockSource
+{
+    const Block* block = nullptr;
+    size_t first = 0; // Index of its first tag in the first occurrence flags.
+};
+
+// Keep the first of the entities sharing a tag.
+template <typename Section, typename Entity>
+void merge_entities(Vector<Entity>& merged,
+    const std::vector<MshSpec>& partitions,
+    Section MshSpec::*section,
+    Vector<Entity> Section::*entities)
+{
+    std::unordered_set<int> seen;
+    for (const MshSpec& partition : partitions) {
+        for (const Entity& entity : partition.*section.*entities) {
+            if (seen.insert(entity.tag).second) merged.push_back(entity);
+        }
+    }
+}
+
+void merge_nodes(Nodes& merged, const std::vector<MshSpec>& partitions, size_t num_threads)
+{
+    std::vector<TagRange> ranges;
+    std::vector<std::vector<BlockSource<NodeBlock>>> sources;
+    std::map<std::pair<int, int>, size_t> block_index;
+    for (const MshSpec& partition : partitions) {
+        for (const NodeBlock& block : partition.nodes.entity_blocks) {
+            append_range(ranges, block.tags.data(), block.num_nodes_in_block, 1);
+            const auto key = std::make_pair(block.entity_dim, block.entity_tag);
+            auto itr = block_index.find(key);
+            if (itr == block_index.end()) {
+                itr = block_index.emplace(key, sources.size()).first;
+                sources.emplace_back();
+            }
+            sources[itr->second].push_back({&block, ranges.back().first});
+        }
+    }
+    const std::vector<char> is_first = flag_first_occurrences(ranges, num_threads);
+
+    merged.entity_blocks.resize(sources.size());
+    parallel_for(sources.size(), num_threads, [&](size_t i) {
+        NodeBlock& merged_block = merged.entity_blocks[i];
+        const auto& first_block = *sources[i].front().block;
+        merged_block.entity_dim = first_block.entity_dim;
+        merged_block.entity_tag = first_block.entity_tag;
+        merged_block.parametric = first_block.parametric;
+        const size_t stride = first_block.parametric == 1
+                                  ? static_cast<size_t>(3 + first_block.entity_dim)
+                                  : 3;
+
+        for (const auto& source : sources[i]) {
+            const auto& block = *source.block;
+            if (block.parametric != merged_block.parametric) {
+                throw InvalidFormat("Partitions disagree on whether node block " +
+                                    std::to_string(block.entity_tag) + " is parametric.");
+            }
+            for (size_t j = 0; j < block.num_nodes_in_block; j++) {
+                if (!is_first[source.first + j]) continue;
+                merged_block.tags.push_back(block.tags[j]);
+                merged_block.data.insert(merged_block.data.end(),
+                    block.data.begin() + static_cast<std::ptrdiff_t>(j * stride),
+                    block.data.begin() + static_cast<std::ptrdiff_t>((j + 1) * stride));
+            }
+        }
+        merged_block.num_nodes_in_block = merged_block.tags.size();
+    });
+
+    merged.num_entity_blocks = merged.entity_blocks.size();
+    merged.num_nodes = 0;
+    merged.min_node_tag = 0;
+    merged.max_node_tag = 0;
+    for (const NodeBlock& block : merged.entity_blocks) {
+        for (size_t tag : block.tags) {
+            if (merged.num_nodes == 0 || tag < merged.min_node_tag) merged.min_node_tag = tag;
+            if (merged.num_nodes == 0 || tag > merged.max_node_tag) merged.max_node_tag = tag;
+            merged.num_nodes++;
+        }
+    }
+}
+
+void merge_elements(Elements& merged, const std::vector<MshSpec>& partitions, size_t num_threads)
+{
+    std::vector<TagRange> ranges;
+    std::vector<std::vector<BlockSource<ElementBlock>>> sources;
+    std::map<std::tuple<int, int, int>, size_t> block_index;
+    for (const MshSpec& partition : partitions) {
+        for (const ElementBlock& block : partition.elements.entity_blocks) {
+            const size_t stride = nodes_per_element(block.element_type) + 1;
+            append_range(ranges, block.data.data(), block.num_elements_in_block, stride);
+            const auto key =
+                std::make_tuple(block.entity_dim, block.entity_tag, block.element_type);
+            auto itr = block_index.find(key);
+            if (itr == block_index.end()) {
+                itr = block_index.emplace(key, sources.size()).first;
+                sources.emplace_back();
+            }
+            sources[itr->second].push_back({&block, ranges.back().first});
+        }
+    }
+    const std::vector<char> is_first = flag_first_occurrences(ranges, num_threads);
+
+    merged.entity_blocks.resize(sources.size());
+    parallel_for(sources.size(), num_threads, [&](size_t i) {
+        ElementBlock& merged_block = merged.entity_blocks[i];
+        const auto& first_block = *sources[i].front().block;
+        merged_block.entity_dim = first_block.entity_dim;
+        merged_block.entity_tag = first_block.entity_tag;
+        merged_block.element_type = first_block.element_type;
+        const size_t stride = nodes_per_element(first_block.element_type) + 1;
+
+        for (const auto& source : sources[i]) {
+            const auto& block = *source.block;
+            for (size_t j = 0; j < block.num_elements_in_block; j++) {
+                if (!is_first[source.first + j]) continue;
+                merged_block.data.insert(merged_block.data.end(),
+                    block.data.begin() + static_cast<std::ptrdiff_t>(j * stride),
+                    block.data.begin() + static_cast<std::ptrdiff_t>((j + 1) * stride));
+            }
+        }
+        merged_block.num_elements_in_block = merged_block.data.size() / stride;
+    });
+
+    merged.num_entity_blocks = merged.entity_blocks.size();
+    merged.num_elements = 0;
+    merged.min_element_tag = 0;
+    merged.max_element_tag = 0;
+    for (const ElementBlock& block : merged.entity_blocks) {
+        const size_t stride = nodes_per_element(block.element_type) + 1;
+        for (size_t j = 0; j < block.num_elements_in_block; j++) {
+            const size_t tag = block.data[j * stride];
+            if (merged.num_elements == 0 || tag < merged.min_element_tag) {
+                merged.min_element_tag = tag;
+            }
+            if (merged.num_elements == 0 || tag > merged.max_element_tag) {
+                merged.max_element_tag = tag;
+            }
+            merged.num_elements++;
+        }
+    }
+}
+
+// Merge the views of all partitions with the same name and time step. Entries
+// of tags already seen in an earlier partition are dropped.
+void merge_data(Vector<Data>& merged,
+    const std::vector<MshSpec>& partitions,
+    Vector<Data> MshSpec::*views,
+    bool is_element_node_data,
+    size_t num_threads)
+{
+    std::vector<std::vector<const Data*>> sources;
+    std::map<std::pair<std::string, int>, size_t> view_index;
+    for (const MshSpec& partition : partitions) {
+        for (const Data& data : partition.*views) {
+            const auto& header = data.header;
+            const auto key = std::make_pair(header.string_tags.empty() ? "" : header.string_tags[0],
+                header.int_tags.empty() ? 0 : header.int_tags[0]);
+            auto itr = view_index.find(key);
+            if (itr == view_index.end()) {
+                itr = view_index.emplace(key, sources.size()).first;
+                sources.emplace_back();
+            }
+            sources[itr->second].push_back(&data);
+        }
+    }
+
+    merged.resize(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        Data& merged_data = merged[i];
+        merged_data.header = sources[i].front()->header;
+        const size_t num_fields = merged_data.header.int_tags.size() > 1
+                                      ? static_cast<size_t>(merged_data.header.int_tags[1])
+                                      : 1;
+
+        std::vector<size_t> tags;
+        std::vector<TagRange> ranges;
+        for (const Data* data : sources[i]) {
+            const size_t first = tags.size();
+            if (data->is_compact()) {
+                tags.insert(tags.end(), data->tags.begin(), data->tags.end());
+            } else {
+                for (const DataEntry& entry : data->entries) {
+                    tags.push_back(entry.tag);
+                }
+            }
+            ranges.push_back({nullptr, tags.size() - first, 1, first});
+        }
+        for (TagRange& range : ranges) {
+            range.data = tags.data() + range.first;
+        }
+        const std::vector<char> is_first = flag_first_occurrences(ranges, num_threads);
+
+        size_t index = 0;
+        if (is_element_node_data && sources[i].front()->is_compact()) {
+            merged_data.offsets.push_back(0);
+        }
+        for (const Data* data : sources[i]) {
+            if (data->is_compact()) {
+                for (size_t j = 0; j < data->tags.size(); j++, index++) {
+                    if (!is_first[index]) continue;
+                    const size_t begin = is_element_node_data ? data->offsets[j] : j * num_fields;
+                    const size_t end =
+                        is_element_node_data ? data->offsets[j + 1] : (j + 1) * num_fields;
+                    merged_data.tags.push_back(data->tags[j]);
+                    merged_data.values.insert(merged_data.values.end(),
+                        data->values.begin() + static_cast<std::ptrdiff_t>(begin),
+                        data->values.begin() + static_cast<std::ptrdiff_t>(end));
+                    if (is_element_node_data) {
+                        merged_data.offsets.push_back(merged_data.values.size());
+                    }
+                }
+            } else {
+                for (const DataEntry& entry : data->entries) {
+                    if (is_first[index++]) merged_data.entries.push_back(entry);
+                }
+            }
+        }
+
+        // The merged view is no longer specific to a partition.
+        auto& int_tags = merged_data.header.int_tags;
+        if (int_tags.size() > 3) int_tags.resize(3);
+        if (int_tags.size() > 2) {
+            int_tags[2] = static_cast<int>(
+                merged_data.is_compact() ? merged_data.tags.size() : merged_data.entries.size());
+        }
+    }
+}
+
+} // namespace
+
+std::vector<MshSpec> load_msh_partitions(const std::string& basename, const LoadOptions& options)
+{
+    std::vector<std::string> filenames;
+    while (file_exists(partition_filename(basename, filenames.size() + 1))) {
+        filenames.push_back(partition_filename(basename, filenames.size() + 1));
+    }
+    if (filenames.empty()) {
+        throw std::runtime_error("Input file does not exist!");
+    }
+
+    // Threads left over once every partition has its own go to the parsers.
+    const size_t num_threads = resolve_num_threads(options.num_threads);
+    LoadOptions partition_options = options;
+    partition_options.num_threads = std::max<size_t>(1, num_threads / filenames.size());
+#ifdef MSHIO_WITH_PMR
+    // Partitions are loaded concurrently, and memory resources need not be
+    // thread-safe. The default resource also matches the allocator of
+    // `partitions`, so that moving the loaded specs into it is cheap.
+    partition_options.memory_resource = nullptr;
+#endif
+
+    std::vector<MshSpec> partitions(filenames.size());
+    parallel_for(filenames.size(), num_threads, [&](size_t i) {
+        partitions[i] = load_msh(filenames[i], partition_options);
+    });
+    return partitions;
+}
+
+MshSpec load_partitioned_msh(const std::string& basename, const LoadOptions& options)
+{
+    return merge_partitions(load_msh_partitions(basename, options), options.num_threads);
+}
+
+MshSpec merge_partitions(const std::vector<MshSpec>& partitions, size_t num_threads)
+{
+    MshSpec merged;
+    if (partitions.empty()) return merged;
+
+    const MshSpec& first = partitions.front();
+    merged.mesh_format = first.mesh_format;
+    merged.nanospline_format = first.nanospline_format;
+    merged.curves = first.curves;
+    merged.patches = first.patches;
+
+    merge_nodes(merged.nodes, partitions, num_threads);
+    merge_elements(merged.elements, partitions, num_threads);
+
+    merge_entities(merged.entities.points, partitions, &MshSpec::entities, &Entities::points);
+    merge_entities(merged.entities.curves, partitions, &MshSpec::entities, &Entities::curves);
+    merge_entities(
+        merged.entities.surfaces, partitions, &MshSpec::entities, &Entities::surfaces);
+    merge_entities(merged.entities.volumes, partitions, &MshSpec::entities, &Entities::volumes);
+
+    // Split partition files each list the partitioned entities they use.
+    auto& partitioned = merged.partitioned_entities;
+    for (const MshSpec& partition : partitions) {
+        partitioned.num_partitions =
+            std::max(partitioned.num_partitions, partition.partitioned_entities.num_partitions);
+    }
+    merge_entities(partitioned.ghost_entities,
+        partitions,
+        &MshSpec::partitioned_entities,
+        &PartitionedEntities::ghost_entities);
+    merge_entities(partitioned.points,
+        partitions,
+        &MshSpec::partitioned_entities,
+        &PartitionedEntities::points);
+    merge_entities(partitioned.curves,
+        partitions,
+        &MshSpec::partitioned_entities,
+        &PartitionedEntities::curves);
+    merge_entities(partitioned.surfaces,
+        partitions,
+        &MshSpec::partitioned_entities,
+        &PartitionedEntities::surfaces);
+    merge_entities(partitioned.volumes,
+        partitions,
+        &MshSpec::partitioned_entities,
+        &PartitionedEntities::volumes);
+
+    std::unordered_set<size_t> ghost_elements;
+    for (const MshSpec& partition : partitions) {
+        for (const GhostElement& element : partition.ghost_elements) {
+            if (ghost_elements.insert(element.tag).second) {
+                merged.ghost_elements.push_back(element);
+            }
+        }
+    }
+
+    std::set<std::pair<int, int>> groups;
+    for (const MshSpec& partition : partitions) {
+        for (const PhysicalGroup& group : partition.physical_groups) {
+            if (groups.insert(std::make_pair(group.dim, group.tag)).second) {
+                merged.physical_groups.push_back(group);
+            }
+        }
+    }
+
+    merge_data(merged.node_data, partitions, &MshSpec::node_data, false, num_threads);
+    merge_data(merged.element_data, partitions, &MshSpec::element_data, false, num_threads);
+    merge_data(
+        merged.element_node_data, partitions, &MshSpec::element_node_data, true, num_threads);
+    return merged;
+}
+
+} // namespace mshio
@@ -0,0 +1,147 @@
+#include "io_utils.h"
+#include "load_msh_data.h"
+#include "load_msh_format.h"
+#include "load_msh_sections.h"
+#include "skip_msh_section.h"
+
+#include <mshio/MshFile.h>
+#include <mshio/MshSpec.h>
+#include <mshio/exception.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace mshio {
+
+MshFile::MshFile(const std::string& filename, const LoadOptions& options)
+    : m_in(open_input(filename, options, true))
+    , m_options(options)
+{
+    std::istream& in = *m_in;
+    MshSpec spec; // Only the mesh format is needed to index the file.
+    std::string buf, end_str;
+    while (!in.eof()) {
+        buf.clear();
+        in >> buf;
+        if (buf.size() == 0 || buf[0] != '$') continue;
+        end_str = "$End" + buf.substr(1);
+
+        SectionInfo section;
+        section.name = buf;
+        section.begin = in.tellg();
+
+        if (buf == "$MeshFormat") {
+            load_mesh_format(in, spec);
+            forward_to(in, end_str);
+        } else {
+            DataSections* data_sections = nullptr;
+            if (buf == "$NodeData") {
+                data_sections = &m_node_data;
+            } else if (buf == "$ElementData") {
+                data_sections = &m_element_data;
+            } else if (buf == "$ElementNodeData") {
+                data_sections = &m_element_node_data;
+            }
+            if (data_sections != nullptr) {
+                data_sections->sections.push_back(m_sections.size());
+                data_sections->headers.emplace_back();
+                internal::load_data_header(in, data_sections->headers.back());
+                in.seekg(section.begin);
+            }
+            skip_section(in, buf, spec.mesh_format);
+        }
+        section.end = in.tellg();
+        if (in.fail() || section.end < 0) {
+            throw InvalidFormat("Missing " + end_str + " in MSH file.");
+        }
+        m_sections.push_back(std::move(section));
+    }
+    m_mesh_format = spec.mesh_format;
+}
+
+bool MshFile::has_section(const std::string& name) const
+{
+    for (const auto& section : m_sections) {
+        if (section.name == name) return true;
+    }
+    return false;
+}
+
+Nodes MshFile::load_nodes()
+{
+    return load_sections("$Nodes").nodes;
+}
+
+Elements MshFile::load_elements()
+{
+    return load_sections("$Elements").elements;
+}
+
+Entities MshFile::load_entities()
+{
+    return load_sections("$Entities").entities;
+}
+
+Vector<PhysicalGroup> MshFile::load_physical_groups()
+{
+    return load_sections("$PhysicalNames").physical_groups;
+}
+
+Data MshFile::load_node_data(size_t index)
+{
+    return load_data(m_node_data, index);
+}
+
+Data MshFile::load_element_data(size_t index)
+{
+    return load_data(m_element_data, index);
+}
+
+Data MshFile::load_element_node_data(size_t index)
+{
+    return load_data(m_element_node_data, index);
+}
+
+MshSpec MshFile::load_sections(const std::string& name)
+{
+    MshSpec spec;
+    spec.mesh_format = m_mesh_format;
+    auto load_all = [&](const std::string& section_name) {
+        for (const auto& section : m_sections) {
+            if (section.name != section_name) continue;
+            seek(section);
+            load_section(*m_in, section_name, spec, m_options);
+        }
+    };
+    if (m_options.partition > 0 && (name == "$Nodes" || name == "$Elements")) {
+        // The blocks of a partition are selected from its entities.
+        load_all("$PartitionedEntities");
+    }
+    load_all(name);
+    return spec;
+}
+
+Data MshFile::load_data(const DataSections& data_sections, size_t index)
+{
+    if (index >= data_sections.sections.size()) {
+        throw std::out_of_range("Data index out of range.");
+    }
+    const SectionInfo& section = m_sections[data_sections.sections[index]];
+
+    MshSpec spec;
+    spec.mesh_format = m_mesh_format;
+    seek(section);
+    load_section(*m_in, section.name, spec, m_options);
+
+    if (!spec.node_data.empty()) return std::move(spec.node_data.back());
+    if (!spec.element_data.empty()) return std::move(spec.element_data.back());
+    return std::move(spec.element_node_data.back());
+}
+
+void MshFile::seek(const SectionInfo& section)
+{
+    m_in->clear();
+    m_in->seekg(section.begin);
+}
+
+} // namespace mshio
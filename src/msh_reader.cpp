@@ -0,0 +1,146 @@
+#include "io_utils.h"
+#include "load_msh_elements.h"
+#include "load_msh_nodes.h"
+#include "load_msh_sections.h"
+#include "skip_msh_section.h"
+
+#include <mshio/MshReader.h>
+#include <mshio/MshSpec.h>
+
+#include <string>
+
+namespace mshio {
+
+namespace {
+
+// Position of bulk sections in the order mandated by the MSH format.
+int section_rank(const std::string& section)
+{
+    if (section == "$Nodes") return 0;
+    if (section == "$Elements") return 1;
+    return 2;
+}
+
+bool is_bulk_section(const std::string& section)
+{
+    return section == "$Nodes" || section == "$Elements" || section == "$NodeData" ||
+           section == "$ElementData" || section == "$ElementNodeData";
+}
+
+} // namespace
+
+MshReader::MshReader(const std::string& filename, const LoadOptions& options)
+    : m_file(open_input(filename, options))
+    , m_options(options)
+{
+    m_in = m_file.get();
+    init();
+}
+
+MshReader::MshReader(std::istream& in, const LoadOptions& options)
+    : m_in(&in)
+    , m_options(options)
+{
+    init();
+}
+
+MshReader::~MshReader() = default;
+
+void MshReader::init()
+{
+    // Load the sections preceding the mesh, such as the format and entities.
+    advance();
+}
+
+const NodeBlock* MshReader::next_node_block()
+{
+    while (!m_section.empty() || advance()) {
+        if (section_rank(m_section) > 0) return nullptr;
+
+        if (!m_node_loader) {
+            m_node_loader.reset(
+                new NodeBlockLoader(*m_in, m_spec.mesh_format, m_options, stream_block_size));
+            m_spec.nodes = m_node_loader->header();
+        }
+        if (m_node_loader->load_next(m_node_block)) return &m_node_block;
+        finish_current_section();
+    }
+    return nullptr;
+}
+
+const ElementBlock* MshReader::next_element_block()
+{
+    while (!m_section.empty() || advance()) {
+        const int rank = section_rank(m_section);
+        if (rank > 1) return nullptr;
+        if (rank < 1) {
+            skip_current_section();
+            continue;
+        }
+
+        if (!m_element_loader) {
+            m_element_loader.reset(
+                new ElementBlockLoader(*m_in, m_spec.mesh_format, m_options, stream_block_size));
+            m_spec.elements = m_element_loader->header();
+        }
+        if (m_element_loader->load_next(m_element_block)) return &m_element_block;
+        finish_current_section();
+    }
+    return nullptr;
+}
+
+bool MshReader::advance()
+{
+    std::istream& in = *m_in;
+    std::string buf;
+    while (!in.eof()) {
+        buf.clear();
+        in >> buf;
+        if (buf.size() == 0 || buf[0] != '$') continue;
+
+        if (is_skipped_section(buf, m_options)) {
+            skip_section(in, buf, m_spec.mesh_format);
+        } else if (is_bulk_section(buf)) {
+            m_section = buf;
+            return true;
+        } else if (load_section(in, buf, m_spec, m_options)) {
+            forward_to(in, "$End" + buf.substr(1));
+        } else {
+            skip_section(in, buf, m_spec.mesh_format);
+        }
+    }
+    return false;
+}
+
+void MshReader::skip_current_section()
+{
+    if (m_node_loader) {
+        while (m_node_loader->load_next(m_node_block)) {
+        }
+        finish_current_section();
+    } else if (m_element_loader) {
+        while (m_element_loader->load_next(m_element_block)) {
+        }
+        finish_current_section();
+    } else {
+        skip_section(*m_in, m_section, m_spec.mesh_format);
+        m_section.clear();
+    }
+}
+
+void MshReader::finish_current_section()
+{
+    if (m_node_loader) {
+        m_spec.nodes = m_node_loader->header();
+        m_node_loader.reset();
+    }
+    if (m_element_loader) {
+        m_spec.elements = m_element_loader->header();
+        m_element_loader->create_entities(m_spec.entities);
+        m_element_loader.reset();
+    }
+    forward_to(*m_in, "$End" + m_section.substr(1));
+    m_section.clear();
+}
+
+} // namespace mshio
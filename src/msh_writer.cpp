@@ -0,0 +1,322 @@
+#include "compressed_streambuf.h"
+#include "element_utils.h"
+#include "save_msh_data.h"
+#include "save_msh_elements.h"
+#include "save_msh_entities.h"
+#include "save_msh_format.h"
+#include "save_msh_nodes.h"
+#include "save_msh_physical_groups.h"
+
+#include <mshio/MshSpec.h>
+#include <mshio/MshWriter.h>
+#include <mshio/exception.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace mshio {
+
+namespace {
+
+// Room reserved in front of a text header whose counts are not known yet. It
+// is filled with spaces, which every MSH reader skips, once the header is
+// rewritten with the final counts.
+constexpr size_t header_padding = 80;
+
+template <typename Fn>
+std::string format_header(Fn fn)
+{
+    std::ostringstream out;
+    fn(out);
+    return out.str();
+}
+
+const char* data_section_name(DataKind kind)
+{
+    switch (kind) {
+    case DataKind::NodeData: return "$NodeData";
+    case DataKind::ElementData: return "$ElementData";
+    default: return "$ElementNodeData";
+    }
+}
+
+} // namespace
+
+MshWriter::MshWriter(
+    const std::string& filename, const MeshFormat& format, const SaveOptions& options)
+    : m_buffer(1 << 20)
+    , m_file(new std::ofstream())
+    , m_format(format)
+    , m_options(options)
+{
+    if (compression_from_extension(filename) != Compression::None) {
+        // Counts left at 0 are patched by seeking back, which compressed
+        // streams do not support.
+        throw UnsupportedFeature("MshWriter cannot write compressed files: " + filename);
+    }
+    m_file->rdbuf()->pubsetbuf(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_file->open(filename.c_str(), std::ios::binary);
+    if (!m_file->is_open()) {
+        throw std::runtime_error("Unable to open output file to write!");
+    }
+    m_file->exceptions(std::ios_base::badbit);
+    m_out = m_file.get();
+    init();
+}
+
+MshWriter::MshWriter(std::ostream& out, const MeshFormat& format, const SaveOptions& options)
+    : m_out(&out)
+    , m_format(format)
+    , m_options(options)
+{
+    init();
+}
+
+MshWriter::~MshWriter()
+{
+    // Best effort, errors are only reported by close().
+    if (m_file != nullptr) {
+        try {
+            m_file->close();
+        } catch (...) {
+        }
+    }
+}
+
+void MshWriter::close()
+{
+    if (m_out == nullptr) return;
+    check_section("");
+    m_out->flush();
+    if (m_file != nullptr) m_file->close();
+    const bool failed = m_out->fail();
+    m_out = nullptr;
+    m_file.reset();
+    if (failed) {
+        throw std::runtime_error("Unable to write output file!");
+    }
+}
+
+void MshWriter::init()
+{
+    if (m_format.version != "4.1" && m_format.version != "2.2") {
+        throw UnsupportedFeature("Unsupported MSH version: " + m_format.version);
+    }
+    MshSpec spec;
+    spec.mesh_format = m_format;
+    save_mesh_format(*m_out, spec);
+}
+
+void MshWriter::write_physical_groups(const Vector<PhysicalGroup>& physical_groups)
+{
+    check_section("");
+    MshSpec spec;
+    spec.mesh_format = m_format;
+    spec.physical_groups = physical_groups;
+    save_physical_groups(*m_out, spec);
+}
+
+void MshWriter::write_entities(const Entities& entities)
+{
+    check_section("");
+    MshSpec spec;
+    spec.mesh_format = m_format;
+    spec.entities = entities;
+    save_entities(*m_out, spec);
+}
+
+void MshWriter::begin_nodes(const Nodes& header)
+{
+    begin_section("$Nodes");
+    m_nodes = Nodes();
+    write_header(format_header([&](std::ostream& out) {
+        save_nodes_header(out, m_format, header);
+    }),
+        header.num_nodes == 0);
+}
+
+void MshWriter::write_node_block(const NodeBlock& block)
+{
+    check_section("$Nodes");
+    save_node_block(*m_out, m_format, block, m_options);
+
+    if (block.num_nodes_in_block > 0) {
+        const auto min_max =
+            std::minmax_element(block.tags.begin(), block.tags.begin() + block.num_nodes_in_block);
+        const bool first = m_nodes.num_nodes == 0;
+        m_nodes.min_node_tag =
+            first ? *min_max.first : std::min(m_nodes.min_node_tag, *min_max.first);
+        m_nodes.max_node_tag =
+            first ? *min_max.second : std::max(m_nodes.max_node_tag, *min_max.second);
+    }
+    m_nodes.num_entity_blocks++;
+    m_nodes.num_nodes += block.num_nodes_in_block;
+}
+
+void MshWriter::write_node_block(const NodeBlockView& block)
+{
+    check_section("$Nodes");
+    save_node_block(*m_out, m_format, block, m_options);
+
+    if (block.num_nodes_in_block > 0) {
+        const auto range = get_node_tag_range(block);
+        const bool first = m_nodes.num_nodes == 0;
+        m_nodes.min_node_tag = first ? range.first : std::min(m_nodes.min_node_tag, range.first);
+        m_nodes.max_node_tag =
+            first ? range.second : std::max(m_nodes.max_node_tag, range.second);
+    }
+    m_nodes.num_entity_blocks++;
+    m_nodes.num_nodes += block.num_nodes_in_block;
+}
+
+void MshWriter::end_nodes()
+{
+    check_section("$Nodes");
+    finish_header(format_header([&](std::ostream& out) {
+        save_nodes_header(out, m_format, m_nodes);
+    }));
+    end_section();
+}
+
+void MshWriter::begin_elements(const Elements& header)
+{
+    begin_section("$Elements");
+    m_elements = Elements();
+    write_header(format_header([&](std::ostream& out) {
+        save_elements_header(out, m_format, header);
+    }),
+        header.num_elements == 0);
+}
+
+void MshWriter::write_element_block(const ElementBlock& block)
+{
+    check_section("$Elements");
+    save_element_block(*m_out, m_format, block, m_options);
+
+    const size_t n = nodes_per_element(block.element_type);
+    for (size_t i = 0; i < block.num_elements_in_block; i++) {
+        const size_t tag = block.data[i * (n + 1)];
+        const bool first = m_elements.num_elements == 0 && i == 0;
+        m_elements.min_element_tag = first ? tag : std::min(m_elements.min_element_tag, tag);
+        m_elements.max_element_tag = first ? tag : std::max(m_elements.max_element_tag, tag);
+    }
+    m_elements.num_entity_blocks++;
+    m_elements.num_elements += block.num_elements_in_block;
+}
+
+void MshWriter::write_element_block(const ElementBlockView& block)
+{
+    check_section("$Elements");
+    save_element_block(*m_out, m_format, block, m_options);
+
+    if (block.num_elements_in_block > 0) {
+        const auto range = get_element_tag_range(block);
+        const bool first = m_elements.num_elements == 0;
+        m_elements.min_element_tag =
+            first ? range.first : std::min(m_elements.min_element_tag, range.first);
+        m_elements.max_element_tag =
+            first ? range.second : std::max(m_elements.max_element_tag, range.second);
+    }
+    m_elements.num_entity_blocks++;
+    m_elements.num_elements += block.num_elements_in_block;
+}
+
+void MshWriter::end_elements()
+{
+    check_section("$Elements");
+    finish_header(format_header([&](std::ostream& out) {
+        save_elements_header(out, m_format, m_elements);
+    }));
+    end_section();
+}
+
+void MshWriter::begin_data(DataKind kind, const DataHeader& header)
+{
+    if (header.int_tags.size() < 3) {
+        throw InvalidFormat("Data requires at least 3 int tags.");
+    }
+    begin_section(data_section_name(kind));
+    m_data_kind = kind;
+    m_data_header = header;
+    write_header(format_header([&](std::ostream& out) { save_data_header(out, header, m_options); }),
+        header.int_tags[2] == 0);
+    m_data_header.int_tags[2] = 0;
+}
+
+void MshWriter::write_data_entry(const DataEntry& entry)
+{
+    check_section(data_section_name(m_data_kind));
+    save_data_entry(
+        *m_out, m_format, entry, m_data_kind == DataKind::ElementNodeData, m_options);
+    m_data_header.int_tags[2]++;
+}
+
+void MshWriter::end_data()
+{
+    check_section(data_section_name(m_data_kind));
+    finish_header(format_header(
+        [&](std::ostream& out) { save_data_header(out, m_data_header, m_options); }));
+    end_section();
+}
+
+void MshWriter::begin_section(const std::string& name)
+{
+    check_section("");
+    *m_out << name << '\n';
+    m_section = name;
+}
+
+void MshWriter::check_section(const std::string& name) const
+{
+    if (m_out == nullptr) {
+        throw std::logic_error("MshWriter: writing after close().");
+    }
+    if (m_section != name) {
+        const std::string current = m_section.empty() ? "no section" : m_section;
+        const std::string expected = name.empty() ? "no section" : name;
+        throw std::logic_error(
+            "MshWriter: expecting " + expected + " but " + current + " is open.");
+    }
+}
+
+void MshWriter::end_section()
+{
+    *m_out << "$End" << m_section.substr(1) << '\n';
+    m_section.clear();
+}
+
+void MshWriter::write_header(const std::string& header, bool reserve)
+{
+    m_header = header;
+    m_header_pos = m_out->tellp();
+    // Only text headers can grow, binary MSH 4.1 headers have a fixed size.
+    const bool is_text = m_format.file_type == 0 || m_format.version == "2.2" ||
+                         (m_section != "$Nodes" && m_section != "$Elements");
+    const bool seekable = m_header_pos != std::streampos(-1);
+    m_header_padding = (reserve && is_text && seekable) ? header_padding : 0;
+    *m_out << std::string(m_header_padding, ' ');
+    m_out->write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+void MshWriter::finish_header(const std::string& header)
+{
+    if (header == m_header) return;
+
+    if (m_out->fail()) {
+        throw std::runtime_error("Unable to write output file!");
+    }
+    const size_t room = m_header.size() + m_header_padding;
+    if (m_header_pos == std::streampos(-1) || header.size() > room) {
+        throw InvalidFormat(m_section + " header does not match the written content.");
+    }
+    const std::streampos end = m_out->tellp();
+    m_out->seekp(m_header_pos);
+    *m_out << std::string(room - header.size(), ' ');
+    m_out->write(header.data(), static_cast<std::streamsize>(header.size()));
+    m_out->seekp(end);
+}
+
+} // namespace mshio
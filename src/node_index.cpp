@@ -0,0 +1,235 @@
+#include "parallel_utils.h"
+
+#include <mshio/NodeIndex.h>
+#include <mshio/exception.h>
+#include <mshio/mshio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mshio {
+
+namespace {
+
+// Number of nodes handled by each task of the parallel build.
+constexpr size_t chunk_size = size_t(1) << 16;
+
+struct NodeRange
+{
+    size_t block;
+    size_t begin;
+    size_t end;
+};
+
+// Split the nodes of all blocks into chunks of at most `chunk_size` nodes.
+std::vector<NodeRange> split_nodes(const Nodes& nodes)
+{
+    std::vector<NodeRange> ranges;
+    for (size_t i = 0; i < nodes.entity_blocks.size(); i++) {
+        const size_t num_nodes = nodes.entity_blocks[i].tags.size();
+        for (size_t begin = 0; begin < num_nodes; begin += chunk_size) {
+            ranges.push_back({i, begin, std::min(num_nodes, begin + chunk_size)});
+        }
+    }
+    return ranges;
+}
+
+int num_bits(size_t n)
+{
+    int bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+    return bits;
+}
+
+} // namespace
+
+NodeIndex::NodeIndex(const Nodes& nodes, size_t num_threads)
+{
+    const size_t num_blocks = nodes.entity_blocks.size();
+    if (num_blocks >= (size_t(1) << (64 - index_bits))) {
+        throw UnsupportedFeature("Too many node blocks to index: " + std::to_string(num_blocks));
+    }
+
+    m_block_data.reserve(num_blocks);
+    m_block_strides.reserve(num_blocks);
+    for (const auto& block : nodes.entity_blocks) {
+        const size_t stride =
+            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
+        if (block.data.size() < block.tags.size() * stride) {
+            throw CorruptData("Node block " + std::to_string(block.entity_tag) +
+                              " has fewer coordinates than tags.");
+        }
+        if (block.tags.size() > (size_t(1) << index_bits)) {
+            throw UnsupportedFeature(
+                "Node block " + std::to_string(block.entity_tag) + " is too large to index.");
+        }
+        m_block_data.push_back(block.data.data());
+        m_block_strides.push_back(stride);
+        m_size += block.tags.size();
+    }
+    if (m_size == 0) return;
+
+    const std::vector<NodeRange> ranges = split_nodes(nodes);
+    const size_t num_ranges = ranges.size();
+    auto pack = [](size_t block, size_t index) {
+        return (static_cast<uint64_t>(block) << index_bits) | static_cast<uint64_t>(index);
+    };
+
+    // The min/max node tags of the header are not trusted: they are only
+    // informative and may be stale once blocks have been edited.
+    std::vector<size_t> range_min(num_ranges), range_max(num_ranges);
+    parallel_for(num_ranges, num_threads, [&](size_t i) {
+        const NodeRange& range = ranges[i];
+        const auto& tags = nodes.entity_blocks[range.block].tags;
+        const auto minmax =
+            std::minmax_element(tags.begin() + static_cast<std::ptrdiff_t>(range.begin),
+                tags.begin() + static_cast<std::ptrdiff_t>(range.end));
+        range_min[i] = *minmax.first;
+        range_max[i] = *minmax.second;
+    });
+    const size_t min_tag = *std::min_element(range_min.begin(), range_min.end());
+    const size_t max_tag = *std::max_element(range_max.begin(), range_max.end());
+
+    m_dense = max_tag - min_tag < 2 * m_size;
+    if (m_dense) {
+        m_min_tag = min_tag;
+        // Packed values increase in file order, so keeping the largest one
+        // with an atomic max resolves duplicated tags to their last
+        // occurrence, as in the hash table, whatever the scheduling.
+        const size_t num_values = max_tag - min_tag + 1;
+        std::unique_ptr<std::atomic<uint64_t>[]> values(new std::atomic<uint64_t>[num_values]);
+        const size_t num_chunks = (num_values + chunk_size - 1) / chunk_size;
+        parallel_for(num_chunks, num_threads, [&](size_t chunk) {
+            const size_t end = std::min(num_values, (chunk + 1) * chunk_size);
+            for (size_t i = chunk * chunk_size; i < end; i++) {
+                values[i].store(empty_value, std::memory_order_relaxed);
+            }
+        });
+        parallel_for(num_ranges, num_threads, [&](size_t i) {
+            const NodeRange& range = ranges[i];
+            const auto& tags = nodes.entity_blocks[range.block].tags;
+            for (size_t j = range.begin; j < range.end; j++) {
+                std::atomic<uint64_t>& value = values[tags[j] - min_tag];
+                const uint64_t packed = pack(range.block, j);
+                uint64_t curr = value.load(std::memory_order_relaxed);
+                while ((curr == empty_value || curr < packed) &&
+                       !value.compare_exchange_weak(curr, packed, std::memory_order_relaxed)) {
+                }
+            }
+        });
+
+        m_dense_values.resize(num_values);
+        parallel_for(num_chunks, num_threads, [&](size_t chunk) {
+            const size_t end = std::min(num_values, (chunk + 1) * chunk_size);
+            for (size_t i = chunk * chunk_size; i < end; i++) {
+                m_dense_values[i] = values[i].load(std::memory_order_relaxed);
+            }
+        });
+        return;
+    }
+
+    // Sparse tags: nodes are first bucketed by region (top bits of their hash)
+    // with a counting sort, then each region is filled by a single task, so
+    // the table is built without locks and does not depend on `num_threads`.
+    m_region_bits = std::min(10, num_bits(m_size / 4096));
+    const size_t num_regions = size_t(1) << m_region_bits;
+    auto region_of = [&](size_t tag) {
+        return m_region_bits > 0 ? static_cast<size_t>(hash(tag) >> (64 - m_region_bits)) : 0;
+    };
+
+    std::vector<size_t> counts(num_ranges * num_regions, 0);
+    parallel_for(num_ranges, num_threads, [&](size_t i) {
+        const NodeRange& range = ranges[i];
+        const auto& tags = nodes.entity_blocks[range.block].tags;
+        size_t* range_counts = counts.data() + i * num_regions;
+        for (size_t j = range.begin; j < range.end; j++) {
+            range_counts[region_of(tags[j])]++;
+        }
+    });
+
+    // Offsets of each (region, range) bucket, region major.
+    std::vector<size_t> region_offsets(num_regions + 1, 0);
+    size_t max_region_size = 0;
+    size_t offset = 0;
+    for (size_t r = 0; r < num_regions; r++) {
+        region_offsets[r] = offset;
+        for (size_t i = 0; i < num_ranges; i++) {
+            const size_t count = counts[i * num_regions + r];
+            counts[i * num_regions + r] = offset;
+            offset += count;
+        }
+        max_region_size = std::max(max_region_size, offset - region_offsets[r]);
+    }
+    region_offsets[num_regions] = offset;
+
+    std::vector<Slot> bucketed(m_size);
+    parallel_for(num_ranges, num_threads, [&](size_t i) {
+        const NodeRange& range = ranges[i];
+        const auto& tags = nodes.entity_blocks[range.block].tags;
+        size_t* range_offsets = counts.data() + i * num_regions;
+        for (size_t j = range.begin; j < range.end; j++) {
+            bucketed[range_offsets[region_of(tags[j])]++] = {tags[j], pack(range.block, j)};
+        }
+    });
+
+    // Keep every region at most half full.
+    m_slot_bits = std::max(1, num_bits(2 * max_region_size));
+    const size_t region_size = size_t(1) << m_slot_bits;
+    const size_t mask = region_size - 1;
+    m_slots.resize(num_regions * region_size);
+    parallel_for(num_regions, num_threads, [&](size_t r) {
+        Slot* slots = m_slots.data() + r * region_size;
+        for (size_t k = region_offsets[r]; k < region_offsets[r + 1]; k++) {
+            const Slot& entry = bucketed[k];
+            size_t i =
+                static_cast<size_t>(hash(entry.tag) >> (64 - m_region_bits - m_slot_bits)) & mask;
+            while (slots[i].value != empty_value && slots[i].tag != entry.tag) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = entry;
+        }
+    });
+}
+
+void NodeIndex::gather_coords(
+    const size_t* tags, size_t num_tags, double* coords, size_t num_threads) const
+{
+    const size_t num_chunks = (num_tags + chunk_size - 1) / chunk_size;
+    parallel_for(num_chunks, num_threads, [&](size_t chunk) {
+        const size_t end = std::min(num_tags, (chunk + 1) * chunk_size);
+        for (size_t i = chunk * chunk_size; i < end; i++) {
+            const double* xyz = this->coords(tags[i]);
+            if (xyz == nullptr) {
+                throw CorruptData("Node " + std::to_string(tags[i]) + " does not exist.");
+            }
+            std::copy(xyz, xyz + 3, coords + 3 * i);
+        }
+    });
+}
+
+std::vector<double> NodeIndex::gather_coords(const ElementBlock& block, size_t num_threads) const
+{
+    const size_t n = nodes_per_element(block.element_type);
+    const size_t num_elements = block.num_elements_in_block;
+    if (block.data.size() < num_elements * (n + 1)) {
+        throw CorruptData("Element block " + std::to_string(block.entity_tag) +
+                          " has fewer values than expected.");
+    }
+
+    std::vector<double> result(num_elements * n * 3);
+    const size_t num_chunks = (num_elements + chunk_size - 1) / chunk_size;
+    parallel_for(num_chunks, num_threads, [&](size_t chunk) {
+        const size_t end = std::min(num_elements, (chunk + 1) * chunk_size);
+        for (size_t i = chunk * chunk_size; i < end; i++) {
+            // Each element is stored as its tag followed by its node tags.
+            const size_t* element = block.data.data() + i * (n + 1);
+            gather_coords(element + 1, n, result.data() + i * n * 3, 1);
+        }
+    });
+    return result;
+}
+
+} // namespace mshio
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace mshio {
+
+// Map the user facing thread count (0 means "all hardware threads") to an
+// actual number of threads.
+inline size_t resolve_num_threads(size_t num_threads)
+{
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    return num_threads;
+}
+
+// Run `fn(i)` for every i in [0, num_tasks) on up to `num_threads` threads,
+// including the calling thread, or fewer if threads cannot be created. The
+// first exception thrown by a task is rethrown once all threads have joined.
+template <typename Fn>
+void parallel_for(size_t num_tasks, size_t num_threads, Fn&& fn)
+{
+    num_threads = std::min(resolve_num_threads(num_threads), num_tasks);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < num_tasks; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_task(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next_task++) < num_tasks) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                next_task = num_tasks;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t i = 1; i < num_threads; i++) {
+        try {
+            threads.emplace_back(worker);
+        } catch (const std::system_error&) {
+            // The tasks are left to the threads already started.
+            break;
+        }
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+} // namespace mshio
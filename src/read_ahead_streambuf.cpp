@@ -0,0 +1,168 @@
+#include "read_ahead_streambuf.h"
+
+#include <cstdint>
+
+namespace mshio {
+
+namespace {
+
+constexpr size_t page_size = 4096;
+
+} // namespace
+
+ReadAheadStreamBuf::ReadAheadStreamBuf(std::streambuf& source, size_t buffer_size)
+    : m_source(source)
+    , m_buffer_size(buffer_size)
+    , m_buffers(num_buffers)
+{
+    for (auto& buffer : m_buffers) {
+        buffer.storage.reset(new char[m_buffer_size + page_size]);
+        const auto address = reinterpret_cast<uintptr_t>(buffer.storage.get());
+        buffer.data = buffer.storage.get() + (page_size - address % page_size) % page_size;
+    }
+    setg(nullptr, nullptr, nullptr);
+
+    // Positions are relative to where the source currently is.
+    const pos_type start_position = m_source.pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+    m_seekable = start_position != pos_type(off_type(-1));
+    m_position = m_seekable ? off_type(start_position) : 0;
+    start(m_position);
+}
+
+ReadAheadStreamBuf::~ReadAheadStreamBuf()
+{
+    stop();
+}
+
+void ReadAheadStreamBuf::start(off_type offset)
+{
+    m_num_filled = 0;
+    m_read_index = 0;
+    m_has_current = false;
+    m_done = false;
+    m_stop = false;
+    m_thread = std::thread(&ReadAheadStreamBuf::read_ahead, this, offset);
+}
+
+void ReadAheadStreamBuf::stop()
+{
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_free_cv.notify_all();
+    m_thread.join();
+}
+
+void ReadAheadStreamBuf::read_ahead(off_type offset)
+{
+    size_t write_index = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_free_cv.wait(lock, [&]() { return m_stop || m_num_filled < num_buffers; });
+            if (m_stop) return;
+        }
+
+        // The slot is not visible to the consumer until m_num_filled is
+        // incremented, so it is filled without holding the lock.
+        Buffer& buffer = m_buffers[write_index];
+        buffer.offset = offset;
+        buffer.size = static_cast<size_t>(
+            m_source.sgetn(buffer.data, static_cast<std::streamsize>(m_buffer_size)));
+        offset += static_cast<off_type>(buffer.size);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_num_filled++;
+            m_done = buffer.size < m_buffer_size;
+        }
+        m_filled_cv.notify_one();
+        if (buffer.size < m_buffer_size) return;
+        write_index = (write_index + 1) % num_buffers;
+    }
+}
+
+ReadAheadStreamBuf::int_type ReadAheadStreamBuf::underflow()
+{
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_has_current) {
+        // Hand the consumed buffer back to the I/O thread.
+        const Buffer& current = m_buffers[m_read_index];
+        m_position = current.offset + static_cast<off_type>(current.size);
+        m_has_current = false;
+        m_num_filled--;
+        m_read_index = (m_read_index + 1) % num_buffers;
+        m_free_cv.notify_one();
+    }
+
+    m_filled_cv.wait(lock, [&]() { return m_num_filled > 0 || m_done; });
+    if (m_num_filled == 0) {
+        setg(nullptr, nullptr, nullptr);
+        return traits_type::eof();
+    }
+
+    Buffer& buffer = m_buffers[m_read_index];
+    m_has_current = true;
+    setg(buffer.data, buffer.data, buffer.data + buffer.size);
+    if (buffer.size == 0) {
+        return traits_type::eof();
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+ReadAheadStreamBuf::pos_type ReadAheadStreamBuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+
+    // Positions are only meaningful if the source can seek back to them.
+    if (!m_seekable) return pos_type(off_type(-1));
+
+    off_type current = m_position;
+    if (m_has_current) {
+        current = m_buffers[m_read_index].offset + static_cast<off_type>(gptr() - eback());
+    }
+
+    off_type target = 0;
+    if (dir == std::ios_base::end) {
+        stop();
+        const pos_type end = m_source.pubseekoff(0, std::ios_base::end, std::ios_base::in);
+        target = off_type(end) + off;
+    } else {
+        target = (dir == std::ios_base::cur) ? current + off : off;
+        if (m_has_current) {
+            const Buffer& buffer = m_buffers[m_read_index];
+            if (target >= buffer.offset &&
+                target <= buffer.offset + static_cast<off_type>(buffer.size)) {
+                setg(eback(), eback() + (target - buffer.offset), egptr());
+                return pos_type(target);
+            }
+        }
+    }
+
+    stop();
+    setg(nullptr, nullptr, nullptr);
+    if (target < 0 || m_source.pubseekpos(pos_type(target), std::ios_base::in) !=
+                          pos_type(target)) {
+        // Leave the stream usable where it was.
+        m_source.pubseekpos(pos_type(current), std::ios_base::in);
+        m_position = current;
+        start(current);
+        return pos_type(off_type(-1));
+    }
+    m_position = target;
+    start(target);
+    return pos_type(target);
+}
+
+ReadAheadStreamBuf::pos_type ReadAheadStreamBuf::seekpos(
+    pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+} // namespace mshio
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+namespace mshio {
+
+// Input stream buffer reading `source` ahead of the consumer on a background
+// I/O thread, so that disk access overlaps with parsing.
+//
+// The I/O thread fills a ring of buffers of `buffer_size` bytes while the
+// parser consumes them in order. Seeking within the current buffer is free;
+// other seeks restart the I/O thread at the new position, and fail if `source`
+// is not seekable.
+class ReadAheadStreamBuf : public std::streambuf
+{
+public:
+    ReadAheadStreamBuf(std::streambuf& source, size_t buffer_size);
+    ~ReadAheadStreamBuf() override;
+
+    ReadAheadStreamBuf(const ReadAheadStreamBuf&) = delete;
+    ReadAheadStreamBuf& operator=(const ReadAheadStreamBuf&) = delete;
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type off,
+        std::ios_base::seekdir dir,
+        std::ios_base::openmode which = std::ios_base::in) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override;
+
+private:
+    struct Buffer
+    {
+        std::unique_ptr<char[]> storage;
+        char* data = nullptr; // Page aligned start of storage.
+        size_t size = 0; // Number of bytes read.
+        off_type offset = 0; // Position of data[0] in the source.
+    };
+
+    void start(off_type offset);
+    void stop();
+    void read_ahead(off_type offset);
+
+private:
+    static constexpr size_t num_buffers = 3;
+
+    std::streambuf& m_source;
+    bool m_seekable = false;
+    size_t m_buffer_size;
+    std::vector<Buffer> m_buffers;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_filled_cv;
+    std::condition_variable m_free_cv;
+    size_t m_num_filled = 0; // Buffers filled by the I/O thread, including the current one.
+    size_t m_read_index = 0; // Buffer being consumed.
+    bool m_has_current = false; // Whether m_buffers[m_read_index] backs the get area.
+    bool m_done = false; // The I/O thread reached the end of the source.
+    bool m_stop = false;
+    off_type m_position = 0; // Position of the get area end when no buffer is current.
+};
+
+} // namespace mshio
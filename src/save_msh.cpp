@@ -1,21 +1,27 @@
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
 
+#include "async_file_streambuf.h"
+#include "compressed_streambuf.h"
 #include "save_msh_curves.h"
 #include "save_msh_data.h"
 #include "save_msh_elements.h"
 #include "save_msh_entities.h"
 #include "save_msh_format.h"
 #include "save_msh_nodes.h"
+#include "save_msh_partitioned_entities.h"
 #include "save_msh_patches.h"
 #include "save_msh_physical_groups.h"
 #include "save_msh_nanospline_format.h"
 
 #include <cassert>
 #include <fstream>
+#include <memory>
+#include <vector>
 
 namespace mshio {
 
-void save_msh(std::ostream& out, const MshSpec& spec)
+void save_msh(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
 {
     save_mesh_format(out, spec);
     if (spec.physical_groups.size() > 0) {
@@ -24,20 +30,26 @@ void save_msh(std::ostream& out, const MshSpec& spec)
     if (!spec.entities.empty()) {
         save_entities(out, spec);
     }
+    if (!spec.partitioned_entities.empty()) {
+        save_partitioned_entities(out, spec, options);
+    }
     if (spec.nodes.num_nodes > 0) {
-        save_nodes(out, spec);
+        save_nodes(out, spec, options);
     }
     if (spec.elements.num_elements > 0) {
-        save_elements(out, spec);
+        save_elements(out, spec, options);
+    }
+    if (spec.ghost_elements.size() > 0) {
+        save_ghost_elements(out, spec, options);
     }
     if (spec.node_data.size() > 0) {
-        save_node_data(out, spec);
+        save_node_data(out, spec, options);
     }
     if (spec.element_data.size() > 0) {
-        save_element_data(out, spec);
+        save_element_data(out, spec, options);
     }
     if (spec.element_node_data.size() > 0) {
-        save_element_node_data(out, spec);
+        save_element_node_data(out, spec, options);
     }
 #ifdef MSHIO_EXT_NANOSPLINE
     save_nanospline_format(out, spec);
@@ -48,15 +60,91 @@ void save_msh(std::ostream& out, const MshSpec& spec)
         save_patches(out, spec);
     }
 #endif
+    out.flush();
 }
 
-void save_msh(const std::string& filename, const MshSpec& spec)
+void save_msh(std::ostream& out, const MshSpecView& spec, const SaveOptions& options)
 {
-    std::ofstream fout(filename.c_str(), std::ios::binary);
-    if (!fout.is_open()) {
-        throw std::runtime_error("Unable to open output file to write!");
+    // The header sections are small: they are saved through a MshSpec.
+    MshSpec header;
+    header.mesh_format = spec.mesh_format;
+    header.physical_groups = spec.physical_groups;
+    header.entities = spec.entities;
+
+    save_mesh_format(out, header);
+    if (header.physical_groups.size() > 0) {
+        save_physical_groups(out, header);
+    }
+    if (!header.entities.empty()) {
+        save_entities(out, header);
+    }
+    if (spec.node_blocks.size() > 0) {
+        save_nodes(out, spec, options);
+    }
+    if (spec.element_blocks.size() > 0) {
+        save_elements(out, spec, options);
+    }
+    if (spec.node_data.size() > 0) {
+        save_node_data(out, spec, options);
     }
-    save_msh(fout, spec);
+    if (spec.element_data.size() > 0) {
+        save_element_data(out, spec, options);
+    }
+    if (spec.element_node_data.size() > 0) {
+        save_element_node_data(out, spec, options);
+    }
+    out.flush();
+}
+
+namespace {
+
+template <typename Spec>
+void save_msh_file(const std::string& filename, const Spec& spec, const SaveOptions& options)
+{
+    std::unique_ptr<std::streambuf> file;
+    if (options.use_io_uring) {
+        file = open_async_output_file(filename, default_async_buffer_size);
+    }
+
+    // As for loading, a large stream buffer keeps the number of write calls low.
+    std::vector<char> buffer(1 << 20);
+    std::ofstream fout;
+    if (file == nullptr) {
+        fout.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        fout.open(filename.c_str(), std::ios::binary);
+        if (!fout.is_open()) {
+            throw std::runtime_error("Unable to open output file to write!");
+        }
+    }
+    std::streambuf& sink = file != nullptr ? *file : *fout.rdbuf();
+
+    const Compression compression = compression_from_extension(filename);
+    if (compression == Compression::None) {
+        std::ostream out(&sink);
+        out.exceptions(std::ios_base::badbit);
+        save_msh(out, spec, options);
+    } else {
+        auto compressor = open_compressing_streambuf(compression, sink, options.num_threads);
+        std::ostream compressed(compressor.get());
+        compressed.exceptions(std::ios_base::badbit);
+        save_msh(compressed, spec, options);
+        compressor->finish();
+    }
+    if (sink.pubsync() != 0) {
+        throw std::runtime_error("Unable to write output file!");
+    }
+}
+
+} // namespace
+
+void save_msh(const std::string& filename, const MshSpec& spec, const SaveOptions& options)
+{
+    save_msh_file(filename, spec, options);
+}
+
+void save_msh(const std::string& filename, const MshSpecView& spec, const SaveOptions& options)
+{
+    save_msh_file(filename, spec, options);
 }
 
 } // namespace mshio
@@ -13,7 +13,7 @@ void save_curves_ascii(std::ostream& out, const MshSpec& spec)
 {
 #ifdef MSHIO_EXT_NANOSPLINE
     const auto& curves = spec.curves;
-    out << curves.size() << std::endl;
+    out << curves.size() << '\n';
 
     for (const auto& curve : curves) {
         out << curve.curve_tag << " ";
@@ -21,7 +21,7 @@ void save_curves_ascii(std::ostream& out, const MshSpec& spec)
         out << curve.curve_degree << " ";
         out << curve.num_control_points << " ";
         out << curve.num_knots << " ";
-        out << curve.with_weights << std::endl;
+        out << curve.with_weights << '\n';
 
         const size_t dim = (curve.with_weights > 0) ? 4 : 3;
         const size_t num_entries = curve.num_control_points * dim + curve.num_knots;
@@ -31,7 +31,7 @@ void save_curves_ascii(std::ostream& out, const MshSpec& spec)
             for (size_t j = 0; j < dim; j++) {
                 out << curve.data[i * dim + j];
                 if (j + 1 == dim) {
-                    out << std::endl;
+                    out << '\n';
                 } else {
                     out << " ";
                 }
@@ -39,7 +39,7 @@ void save_curves_ascii(std::ostream& out, const MshSpec& spec)
         }
 
         for (size_t i = 0; i < curve.num_knots; i++) {
-            out << curve.data[curve.num_control_points * dim + i] << std::endl;
+            out << curve.data[curve.num_control_points * dim + i] << '\n';
         }
     }
 #endif
@@ -49,7 +49,7 @@ void save_curves_binary(std::ostream& out, const MshSpec& spec)
 {
 #ifdef MSHIO_EXT_NANOSPLINE
     const auto& curves = spec.curves;
-    out << curves.size() << std::endl;
+    out << curves.size() << '\n';
 
     for (const auto& curve : curves) {
         out << curve.curve_tag << " ";
@@ -57,7 +57,7 @@ void save_curves_binary(std::ostream& out, const MshSpec& spec)
         out << curve.curve_degree << " ";
         out << curve.num_control_points << " ";
         out << curve.num_knots << " ";
-        out << curve.with_weights << std::endl;
+        out << curve.with_weights << '\n';
 
         const size_t dim = (curve.with_weights > 0) ? 4 : 3;
         const size_t num_entries = curve.num_control_points * dim + curve.num_knots;
@@ -74,13 +74,13 @@ void save_curves(std::ostream& out, const MshSpec& spec)
 {
     const bool is_ascii = spec.mesh_format.file_type == 0;
 
-    out << "$Curves" << std::endl;
+    out << "$Curves\n";
     if (is_ascii) {
         save_curves_ascii(out, spec);
     } else {
         save_curves_binary(out, spec);
     }
-    out << "$EndCurves" << std::endl;
+    out << "$EndCurves\n";
 }
 
 } // namespace mshio
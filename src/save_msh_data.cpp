@@ -1,124 +1,309 @@
 #include "save_msh_data.h"
+#include "ascii_writer.h"
+#include "chunked_writer.h"
 
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
 #include <mshio/exception.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iomanip>
 #include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace mshio {
 
-namespace internal {
+void save_data_header(std::ostream& out, const DataHeader& header, const SaveOptions& options)
+{
+    out << header.string_tags.size() << '\n';
+    for (const std::string& tag : header.string_tags) {
+        out << std::quoted(tag) << '\n';
+    }
 
-void save_data(std::ostream& out,
-    const Data& data,
-    const std::string& version,
-    bool is_binary,
-    bool is_element_node_data)
+    // One number per line.
+    const size_t num_lines = 2 + header.real_tags.size() + header.int_tags.size();
+    AsciiWriter writer(out,
+        options.precision,
+        std::min(num_lines * (AsciiWriter::max_number_length + 1),
+            AsciiWriter::default_buffer_size));
+    writer << header.real_tags.size() << '\n';
+    for (const double& tag : header.real_tags) {
+        writer << tag << '\n';
+    }
+
+    writer << header.int_tags.size() << '\n';
+    for (const int& tag : header.int_tags) {
+        writer << tag << '\n';
+    }
+    writer.flush();
+}
+
+namespace {
+
+void save_data_entry_ascii(AsciiWriter& writer, const DataEntry& entry, bool is_element_node_data)
 {
-    out << data.header.string_tags.size() << std::endl;
-    for (const std::string& tag : data.header.string_tags) {
-        out << std::quoted(tag) << std::endl;
+    writer << entry.tag << ' ';
+    if (is_element_node_data) {
+        writer << entry.num_nodes_per_element << ' ';
     }
+    for (size_t i = 0; i < entry.data.size(); i++) {
+        writer << entry.data[i] << ((i == entry.data.size() - 1) ? '\n' : ' ');
+    }
+}
 
-    out << data.header.real_tags.size() << std::endl;
-    for (const double& tag : data.header.real_tags) {
-        out << tag << std::endl;
+void save_data_entry_binary(
+    std::ostream& out, const MeshFormat& format, const DataEntry& entry, bool is_element_node_data)
+{
+    if (format.version == "4.1") {
+        // TODO:
+        // Based on trial and error, it seems Gmsh 4.7.1 still expect 32
+        // bits tag, which is inconsistent with their spec.  Maybe
+        // report a bug?
+        const int32_t tag = static_cast<int32_t>(entry.tag);
+        out.write(reinterpret_cast<const char*>(&tag), 4);
+        // out.write(reinterpret_cast<const char*>(&entry.tag), sizeof(size_t));
+        if (is_element_node_data) {
+            out.write(reinterpret_cast<const char*>(&entry.num_nodes_per_element), sizeof(int));
+        }
+        out.write(reinterpret_cast<const char*>(entry.data.data()),
+            static_cast<std::streamsize>(sizeof(double) * entry.data.size()));
+    } else if (format.version == "2.2") {
+        const int32_t tag = static_cast<int32_t>(entry.tag);
+        out.write(reinterpret_cast<const char*>(&tag), 4);
+        if (is_element_node_data) {
+            const int32_t num_nodes_per_element =
+                static_cast<int32_t>(entry.num_nodes_per_element);
+            out.write(reinterpret_cast<const char*>(&num_nodes_per_element), 4);
+        }
+        out.write(reinterpret_cast<const char*>(entry.data.data()),
+            static_cast<std::streamsize>(sizeof(double) * entry.data.size()));
+    } else {
+        throw InvalidFormat("Unsupported version " + format.version);
     }
+}
 
-    out << data.header.int_tags.size() << std::endl;
-    for (const int& tag : data.header.int_tags) {
-        out << tag << std::endl;
+void save_data_view(std::ostream& out,
+    const DataView& data,
+    const MeshFormat& format,
+    bool is_element_node_data,
+    const SaveOptions& options)
+{
+    const bool is_binary = format.file_type > 0;
+    if (is_binary && format.version != "4.1" && format.version != "2.2") {
+        throw InvalidFormat("Unsupported version " + format.version);
+    }
+    if (is_element_node_data && data.num_entries > 0) {
+        if (data.offsets == nullptr ||
+            !std::is_sorted(data.offsets, data.offsets + data.num_entries + 1)) {
+            throw InvalidFormat("Element node data offsets do not match its tags.");
+        }
     }
 
-    if (is_binary) {
-        if (version == "4.1") {
-            int32_t tag;
-            for (const DataEntry& entry : data.entries) {
-                // TODO:
-                // Based on trial and error, it seems Gmsh 4.7.1 still expect 32
-                // bits tag, which is inconsistent with their spec.  Maybe
-                // report a bug?
-                tag = static_cast<int32_t>(entry.tag);
-                out.write(reinterpret_cast<const char*>(&tag), 4);
-                // out.write(reinterpret_cast<const char*>(&entry.tag), sizeof(size_t));
-                if (is_element_node_data) {
-                    out.write(
-                        reinterpret_cast<const char*>(&entry.num_nodes_per_element), sizeof(int));
+    const size_t num_fields = static_cast<size_t>(data.header.int_tags.at(1));
+    auto entry_range = [&](size_t i) {
+        return is_element_node_data ? std::make_pair(data.offsets[i], data.offsets[i + 1])
+                                    : std::make_pair(i * num_fields, (i + 1) * num_fields);
+    };
+    auto entry_tag = [&](size_t i) {
+        return data.tags != nullptr ? data.tags[i] : data.first_tag + i;
+    };
+
+    write_rows(out, data.num_entries, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            if (!is_binary) {
+                AsciiWriter writer(chunk, options.precision);
+                for (size_t i = begin; i < end; i++) {
+                    const auto range = entry_range(i);
+                    writer << entry_tag(i) << ' ';
+                    if (is_element_node_data) {
+                        writer << (num_fields > 0 ? (range.second - range.first) / num_fields : 0)
+                               << ' ';
+                    }
+                    for (size_t j = range.first; j < range.second; j++) {
+                        writer << data.values[j] << ((j + 1 == range.second) ? '\n' : ' ');
+                    }
                 }
-                out.write(reinterpret_cast<const char*>(entry.data.data()),
-                    static_cast<std::streamsize>(sizeof(double) * entry.data.size()));
+                writer.flush();
+                return;
             }
-        } else if (version == "2.2") {
-            int32_t tag, num_nodes_per_element;
-            for (const DataEntry& entry : data.entries) {
-                tag = static_cast<int32_t>(entry.tag);
-                out.write(reinterpret_cast<const char*>(&tag), 4);
+
+            // Same records as `save_data_entry_binary()`, encoded in batches.
+            std::vector<char> buffer;
+            for (size_t i = begin; i < end; i++) {
+                const auto range = entry_range(i);
+                const size_t num_values = range.second - range.first;
+                const size_t offset = buffer.size();
+                const size_t record_size =
+                    (is_element_node_data ? 8 : 4) + sizeof(double) * num_values;
+                buffer.resize(offset + record_size);
+                char* ptr = buffer.data() + offset;
+
+                const int32_t tag = static_cast<int32_t>(entry_tag(i));
+                std::memcpy(ptr, &tag, 4);
+                ptr += 4;
                 if (is_element_node_data) {
-                    num_nodes_per_element = static_cast<int32_t>(entry.num_nodes_per_element);
-                    out.write(reinterpret_cast<const char*>(&num_nodes_per_element), 4);
+                    const int32_t num_nodes_per_element =
+                        static_cast<int32_t>(num_fields > 0 ? num_values / num_fields : 0);
+                    std::memcpy(ptr, &num_nodes_per_element, 4);
+                    ptr += 4;
+                }
+                std::memcpy(ptr, data.values + range.first, sizeof(double) * num_values);
+
+                if (buffer.size() >= (1 << 16) || i + 1 == end) {
+                    chunk.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    buffer.clear();
                 }
-                out.write(reinterpret_cast<const char*>(entry.data.data()),
-                    static_cast<std::streamsize>(sizeof(double) * entry.data.size()));
             }
-        } else {
-            throw InvalidFormat("Unsupported version " + version);
-        }
+        });
+}
+
+} // namespace
+
+void save_data_entry(std::ostream& out,
+    const MeshFormat& format,
+    const DataEntry& entry,
+    bool is_element_node_data,
+    const SaveOptions& options)
+{
+    if (format.file_type > 0) {
+        save_data_entry_binary(out, format, entry, is_element_node_data);
     } else {
-        for (const DataEntry& entry : data.entries) {
-            out << entry.tag << " ";
-            if (is_element_node_data) {
-                out << entry.num_nodes_per_element << " ";
+        // Called once per entry by MshWriter, so the buffer is sized to it.
+        const size_t num_numbers = 2 + entry.data.size();
+        AsciiWriter writer(out,
+            options.precision,
+            std::min(num_numbers * (AsciiWriter::max_number_length + 1),
+                AsciiWriter::default_buffer_size));
+        save_data_entry_ascii(writer, entry, is_element_node_data);
+        writer.flush();
+    }
+}
+
+namespace internal {
+
+void save_data(std::ostream& out,
+    const Data& data,
+    const MeshFormat& format,
+    bool is_element_node_data,
+    const SaveOptions& options)
+{
+    if (data.is_compact()) {
+        const auto& int_tags = data.header.int_tags;
+        if (int_tags.size() < 3 || static_cast<size_t>(int_tags[2]) != data.tags.size()) {
+            throw InvalidFormat("Data int tags must hold its number of entries.");
+        }
+        if (is_element_node_data) {
+            if (data.offsets.size() != data.tags.size() + 1 ||
+                data.offsets.back() > data.values.size()) {
+                throw InvalidFormat("Element node data offsets do not match its tags.");
             }
-            for (size_t i = 0; i < entry.data.size(); i++) {
-                out << entry.data[i];
-                if (i == entry.data.size() - 1) {
-                    out << std::endl;
-                } else {
-                    out << ' ';
+        } else if (data.values.size() != data.tags.size() * static_cast<size_t>(int_tags[1])) {
+            throw InvalidFormat("Data values do not match its tags and fields.");
+        }
+    }
+
+    save_data_header(out, data.header, options);
+    if (data.is_compact()) {
+        DataView view;
+        view.header = data.header;
+        view.num_entries = data.tags.size();
+        view.tags = data.tags.data();
+        view.offsets = data.offsets.data();
+        view.values = data.values.data();
+        save_data_view(out, view, format, is_element_node_data, options);
+        return;
+    }
+
+    const bool is_binary = format.file_type > 0;
+    write_rows(out, data.entries.size(), options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            if (is_binary) {
+                for (size_t i = begin; i < end; i++) {
+                    save_data_entry_binary(chunk, format, data.entries[i], is_element_node_data);
+                }
+            } else {
+                AsciiWriter writer(chunk, options.precision);
+                for (size_t i = begin; i < end; i++) {
+                    save_data_entry_ascii(writer, data.entries[i], is_element_node_data);
                 }
+                writer.flush();
             }
-        }
+        });
+}
+
+void save_data(std::ostream& out,
+    const DataView& data,
+    const MeshFormat& format,
+    bool is_element_node_data,
+    const SaveOptions& options)
+{
+    if (data.header.int_tags.size() < 3 ||
+        static_cast<size_t>(data.header.int_tags[2]) != data.num_entries) {
+        throw InvalidFormat("Data view int tags must hold its number of entries.");
     }
+    save_data_header(out, data.header, options);
+    save_data_view(out, data, format, is_element_node_data, options);
 }
 
 } // namespace internal
 
-void save_node_data(std::ostream& out, const MshSpec& spec)
-{
-    const std::string& version = spec.mesh_format.version;
-    bool is_binary = spec.mesh_format.file_type > 0;
 
+void save_node_data(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
+{
     for (const Data& data : spec.node_data) {
-        out << "$NodeData" << std::endl;
-        internal::save_data(out, data, version, is_binary, false);
-        out << "$EndNodeData" << std::endl;
+        out << "$NodeData\n";
+        internal::save_data(out, data, spec.mesh_format, false, options);
+        out << "$EndNodeData\n";
     }
 }
 
-void save_element_data(std::ostream& out, const MshSpec& spec)
+void save_element_data(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
 {
-    const std::string& version = spec.mesh_format.version;
-    bool is_binary = spec.mesh_format.file_type > 0;
-
     for (const Data& data : spec.element_data) {
-        out << "$ElementData" << std::endl;
-        internal::save_data(out, data, version, is_binary, false);
-        out << "$EndElementData" << std::endl;
+        out << "$ElementData\n";
+        internal::save_data(out, data, spec.mesh_format, false, options);
+        out << "$EndElementData\n";
     }
 }
 
-void save_element_node_data(std::ostream& out, const MshSpec& spec)
+void save_element_node_data(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
 {
-    const std::string& version = spec.mesh_format.version;
-    bool is_binary = spec.mesh_format.file_type > 0;
-
     for (const Data& data : spec.element_node_data) {
-        out << "$ElementNodeData" << std::endl;
-        internal::save_data(out, data, version, is_binary, true);
-        out << "$EndElementNodeData" << std::endl;
+        out << "$ElementNodeData\n";
+        internal::save_data(out, data, spec.mesh_format, true, options);
+        out << "$EndElementNodeData\n";
+    }
+}
+
+void save_node_data(std::ostream& out, const MshSpecView& spec, const SaveOptions& options)
+{
+    for (const DataView& data : spec.node_data) {
+        out << "$NodeData\n";
+        internal::save_data(out, data, spec.mesh_format, false, options);
+        out << "$EndNodeData\n";
+    }
+}
+
+void save_element_data(std::ostream& out, const MshSpecView& spec, const SaveOptions& options)
+{
+    for (const DataView& data : spec.element_data) {
+        out << "$ElementData\n";
+        internal::save_data(out, data, spec.mesh_format, false, options);
+        out << "$EndElementData\n";
+    }
+}
+
+void save_element_node_data(
+    std::ostream& out, const MshSpecView& spec, const SaveOptions& options)
+{
+    for (const DataView& data : spec.element_node_data) {
+        out << "$ElementNodeData\n";
+        internal::save_data(out, data, spec.mesh_format, true, options);
+        out << "$EndElementNodeData\n";
     }
 }
 
@@ -1,14 +1,29 @@
 #pragma once
 
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
+#include <mshio/options.h>
 #include <iostream>
 
 namespace mshio {
 
-void save_node_data(std::ostream& out, const MshSpec& spec);
+void save_node_data(std::ostream& out, const MshSpec& spec, const SaveOptions& options);
 
-void save_element_data(std::ostream& out, const MshSpec& spec);
+void save_element_data(std::ostream& out, const MshSpec& spec, const SaveOptions& options);
 
-void save_element_node_data(std::ostream& out, const MshSpec& spec);
+void save_element_node_data(std::ostream& out, const MshSpec& spec, const SaveOptions& options);
+
+void save_node_data(std::ostream& out, const MshSpecView& spec, const SaveOptions& options);
+void save_element_data(std::ostream& out, const MshSpecView& spec, const SaveOptions& options);
+void save_element_node_data(
+    std::ostream& out, const MshSpecView& spec, const SaveOptions& options);
+
+// Building blocks of the functions above, shared with MshWriter.
+void save_data_header(std::ostream& out, const DataHeader& header, const SaveOptions& options);
+void save_data_entry(std::ostream& out,
+    const MeshFormat& format,
+    const DataEntry& entry,
+    bool is_element_node_data,
+    const SaveOptions& options);
 
 } // namespace mshio
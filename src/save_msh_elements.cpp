@@ -1,8 +1,11 @@
 #include "save_msh_elements.h"
+#include "ascii_writer.h"
+#include "chunked_writer.h"
 #include "element_utils.h"
 #include "io_utils.h"
 
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
 #include <mshio/exception.h>
 
 #include <algorithm>
@@ -10,141 +13,318 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 
 namespace mshio {
 
-namespace v41 {
+namespace {
 
-void save_elements_ascii(std::ostream& out, const MshSpec& spec)
+// Element rows of either an ElementBlock, where each row is the element tag
+// followed by its node tags, or an ElementBlockView with separate arrays.
+struct ElementRows
 {
-    const Elements& elements = spec.elements;
-    out << elements.num_entity_blocks << " " << elements.num_elements << " "
-        << elements.min_element_tag << " " << elements.max_element_tag << std::endl;
+    int entity_dim = 0;
+    int entity_tag = 0;
+    int element_type = 0;
+    size_t num_elements = 0;
+    size_t nodes_per_element = 0;
+    const size_t* tags = nullptr;
+    size_t tag_stride = 1;
+    size_t first_tag = 1;
+    const size_t* nodes = nullptr;
+    size_t node_stride = 0;
+    size_t node_offset = 0;
 
-    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
-        const ElementBlock& block = elements.entity_blocks[i];
-
-        out << block.entity_dim << " " << block.entity_tag << " "
-            << block.element_type << " " << block.num_elements_in_block << std::endl;
-
-        const size_t n = nodes_per_element(block.element_type);
-        for (size_t j = 0; j < block.num_elements_in_block; j++) {
-            for (size_t k = 0; k <= n; k++) {
-                out << block.data[j * (n + 1) + k];
-                if (k == n) {
-                    out << std::endl;
-                } else {
-                    out << ' ';
-                }
-            }
-        }
+    size_t tag(size_t i) const { return tags != nullptr ? tags[i * tag_stride] : first_tag + i; }
+    size_t node(size_t i, size_t k) const { return nodes[i * node_stride + k] + node_offset; }
+
+    // Whether the rows are laid out as in a MSH 4.1 binary file.
+    bool is_interleaved() const
+    {
+        return tags != nullptr && nodes == tags + 1 && tag_stride == nodes_per_element + 1 &&
+               node_stride == nodes_per_element + 1 && node_offset == 0;
     }
+};
+
+ElementRows get_element_rows(const ElementBlock& block)
+{
+    ElementRows rows;
+    rows.entity_dim = block.entity_dim;
+    rows.entity_tag = block.entity_tag;
+    rows.element_type = block.element_type;
+    rows.num_elements = block.num_elements_in_block;
+    rows.nodes_per_element = nodes_per_element(block.element_type);
+    rows.tags = block.data.data();
+    rows.tag_stride = rows.nodes_per_element + 1;
+    rows.nodes = block.data.data() + 1;
+    rows.node_stride = rows.nodes_per_element + 1;
+    return rows;
 }
 
-void save_elements_binary(std::ostream& out, const MshSpec& spec)
+ElementRows get_element_rows(const ElementBlockView& block)
+{
+    ElementRows rows;
+    rows.entity_dim = block.entity_dim;
+    rows.entity_tag = block.entity_tag;
+    rows.element_type = block.element_type;
+    rows.num_elements = block.num_elements_in_block;
+    rows.nodes_per_element = nodes_per_element(block.element_type);
+    rows.tags = block.tags;
+    rows.first_tag = block.first_tag;
+    rows.nodes = block.connectivity;
+    rows.node_stride = rows.nodes_per_element;
+    rows.node_offset = block.node_offset;
+    return rows;
+}
+
+} // namespace
+
+namespace v41 {
+
+void save_elements_header_ascii(std::ostream& out, const Elements& elements)
+{
+    out << elements.num_entity_blocks << " " << elements.num_elements << " "
+        << elements.min_element_tag << " " << elements.max_element_tag << '\n';
+}
+
+void save_elements_header_binary(std::ostream& out, const Elements& elements)
 {
-    const Elements& elements = spec.elements;
     out.write(reinterpret_cast<const char*>(&elements.num_entity_blocks), sizeof(size_t));
     out.write(reinterpret_cast<const char*>(&elements.num_elements), sizeof(size_t));
     out.write(reinterpret_cast<const char*>(&elements.min_element_tag), sizeof(size_t));
     out.write(reinterpret_cast<const char*>(&elements.max_element_tag), sizeof(size_t));
+}
 
-    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
-        const ElementBlock& block = elements.entity_blocks[i];
+void save_element_block_ascii(
+    std::ostream& out, const ElementRows& block, const SaveOptions& options)
+{
+    out << block.entity_dim << " " << block.entity_tag << " " << block.element_type << " "
+        << block.num_elements << '\n';
 
-        out.write(reinterpret_cast<const char*>(&block.entity_dim), sizeof(int));
-        out.write(reinterpret_cast<const char*>(&block.entity_tag), sizeof(int));
-        out.write(reinterpret_cast<const char*>(&block.element_type), sizeof(int));
-        out.write(reinterpret_cast<const char*>(&block.num_elements_in_block), sizeof(size_t));
+    const size_t n = block.nodes_per_element;
+    write_rows(out, block.num_elements, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            AsciiWriter writer(chunk);
+            for (size_t j = begin; j < end; j++) {
+                writer << block.tag(j);
+                for (size_t k = 0; k < n; k++) {
+                    writer << ' ' << block.node(j, k);
+                }
+                writer << '\n';
+            }
+            writer.flush();
+        });
+}
+
+void save_element_block_binary(
+    std::ostream& out, const ElementRows& block, const SaveOptions& options)
+{
+    out.write(reinterpret_cast<const char*>(&block.entity_dim), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&block.entity_tag), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&block.element_type), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&block.num_elements), sizeof(size_t));
 
-        out.write(reinterpret_cast<const char*>(block.data.data()),
-            static_cast<std::streamsize>(sizeof(size_t) * block.data.size()));
+    const size_t n = block.nodes_per_element;
+    if (block.is_interleaved()) {
+        out.write(reinterpret_cast<const char*>(block.tags),
+            static_cast<std::streamsize>(sizeof(size_t) * block.num_elements * (n + 1)));
+        return;
     }
+
+    // Interleave tags and nodes into a buffer, written in bulk.
+    write_rows(out, block.num_elements, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            constexpr size_t batch_size = 1 << 12;
+            std::vector<size_t> buffer(std::min(end - begin, batch_size) * (n + 1));
+            for (size_t first = begin; first < end; first += batch_size) {
+                const size_t last = std::min(first + batch_size, end);
+                size_t* ptr = buffer.data();
+                for (size_t j = first; j < last; j++) {
+                    *ptr++ = block.tag(j);
+                    for (size_t k = 0; k < n; k++) {
+                        *ptr++ = block.node(j, k);
+                    }
+                }
+                chunk.write(reinterpret_cast<const char*>(buffer.data()),
+                    static_cast<std::streamsize>(sizeof(size_t) * (ptr - buffer.data())));
+            }
+        });
 }
 
 } // namespace v41
 
 namespace v22 {
 
-void save_elements_ascii(std::ostream& out, const MshSpec& spec)
+void save_elements_header(std::ostream& out, const Elements& elements)
 {
-    const Elements& elements = spec.elements;
-    out << elements.num_elements << std::endl;
+    out << elements.num_elements << '\n';
+}
 
-    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
-        const ElementBlock& block = elements.entity_blocks[i];
-        int element_type = block.element_type;
-        const size_t n = nodes_per_element(element_type);
-        constexpr int num_tags = 1;
-        for (size_t j = 0; j < block.num_elements_in_block; j++) {
-            size_t element_number = block.data[j * (n + 1)];
-            out << element_number << " " << element_type << " " << num_tags << " "
-                << block.entity_tag << " ";
-            for (size_t k = 0; k < n; k++) {
-                out << block.data[j * (n + 1) + k + 1];
-                if (k == n - 1) {
-                    out << std::endl;
-                } else {
-                    out << ' ';
+void save_element_block_ascii(
+    std::ostream& out, const ElementRows& block, const SaveOptions& options)
+{
+    const int element_type = block.element_type;
+    const size_t n = block.nodes_per_element;
+    constexpr int num_tags = 1;
+    write_rows(out, block.num_elements, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            AsciiWriter writer(chunk);
+            for (size_t j = begin; j < end; j++) {
+                writer << block.tag(j) << ' ' << element_type << ' ' << num_tags << ' '
+                       << block.entity_tag;
+                for (size_t k = 0; k < n; k++) {
+                    writer << ' ' << block.node(j, k);
                 }
+                writer << '\n';
             }
-        }
-    }
+            writer.flush();
+        });
 }
 
-void save_elements_binary(std::ostream& out, const MshSpec& spec)
+void save_element_block_binary(
+    std::ostream& out, const ElementRows& block, const SaveOptions& options)
 {
-    const Elements& elements = spec.elements;
-    out << elements.num_elements << std::endl;
-    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
-        const ElementBlock& block = elements.entity_blocks[i];
-        const int32_t element_type = block.element_type;
-        constexpr int32_t num_tags = 1;
-        const int32_t num_element_in_block = static_cast<int32_t>(block.num_elements_in_block);
-        out.write(reinterpret_cast<const char*>(&element_type), 4);
-        out.write(reinterpret_cast<const char*>(&num_element_in_block), 4);
-        out.write(reinterpret_cast<const char*>(&num_tags), 4);
-
-        const size_t n = nodes_per_element(element_type);
-        const int32_t tag = static_cast<int32_t>(block.entity_tag);
-
-        for (size_t j = 0; j < block.num_elements_in_block; j++) {
-            const int32_t element_number = static_cast<int32_t>(block.data[j * (n + 1)]);
-            out.write(reinterpret_cast<const char*>(&element_number), 4);
-            out.write(reinterpret_cast<const char*>(&tag), 4);
-            for (size_t k = 0; k < n; k++) {
-                const int32_t node_id = static_cast<int32_t>(block.data[j * (n + 1) + k + 1]);
-                out.write(reinterpret_cast<const char*>(&node_id), 4);
+    const int32_t element_type = block.element_type;
+    constexpr int32_t num_tags = 1;
+    const int32_t num_element_in_block = static_cast<int32_t>(block.num_elements);
+    out.write(reinterpret_cast<const char*>(&element_type), 4);
+    out.write(reinterpret_cast<const char*>(&num_element_in_block), 4);
+    out.write(reinterpret_cast<const char*>(&num_tags), 4);
+
+    // Each element is written as 32 bits integers: its number, its tag and its
+    // nodes. Elements are narrowed into a buffer and written in bulk.
+    const size_t n = block.nodes_per_element;
+    const int32_t tag = static_cast<int32_t>(block.entity_tag);
+    write_rows(out, block.num_elements, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            constexpr size_t batch_size = 1 << 12;
+            std::vector<int32_t> buffer(std::min(end - begin, batch_size) * (n + 2));
+            for (size_t first = begin; first < end; first += batch_size) {
+                const size_t last = std::min(first + batch_size, end);
+                int32_t* ptr = buffer.data();
+                for (size_t j = first; j < last; j++) {
+                    *ptr++ = static_cast<int32_t>(block.tag(j));
+                    *ptr++ = tag;
+                    for (size_t k = 0; k < n; k++) {
+                        *ptr++ = static_cast<int32_t>(block.node(j, k));
+                    }
+                }
+                chunk.write(reinterpret_cast<const char*>(buffer.data()),
+                    static_cast<std::streamsize>(sizeof(int32_t) * (ptr - buffer.data())));
             }
-        }
-    }
+        });
 }
 
 } // namespace v22
 
-void save_elements(std::ostream& out, const MshSpec& spec)
+namespace {
+
+[[noreturn]] void throw_unsupported_version(const std::string& version)
 {
-    const std::string& version = spec.mesh_format.version;
-    const bool is_ascii = spec.mesh_format.file_type == 0;
-    out << "$Elements" << std::endl;
-    if (version == "4.1") {
+    std::stringstream msg;
+    msg << "Unsupported MSH version: " << version;
+    throw UnsupportedFeature(msg.str());
+}
+
+void save_element_rows(std::ostream& out,
+    const MeshFormat& format,
+    const ElementRows& block,
+    const SaveOptions& options)
+{
+    const bool is_ascii = format.file_type == 0;
+    if (format.version == "4.1") {
         if (is_ascii)
-            v41::save_elements_ascii(out, spec);
+            v41::save_element_block_ascii(out, block, options);
         else
-            v41::save_elements_binary(out, spec);
-    } else if (version == "2.2") {
+            v41::save_element_block_binary(out, block, options);
+    } else if (format.version == "2.2") {
         if (is_ascii)
-            v22::save_elements_ascii(out, spec);
+            v22::save_element_block_ascii(out, block, options);
         else
-            v22::save_elements_binary(out, spec);
+            v22::save_element_block_binary(out, block, options);
     } else {
-        std::stringstream msg;
-        msg << "Unsupported MSH version: " << version;
-        throw UnsupportedFeature(msg.str());
+        throw_unsupported_version(format.version);
     }
-    out << "$EndElements" << std::endl;
 }
 
+} // namespace
+
+void save_elements_header(std::ostream& out, const MeshFormat& format, const Elements& elements)
+{
+    const bool is_ascii = format.file_type == 0;
+    if (format.version == "4.1") {
+        if (is_ascii)
+            v41::save_elements_header_ascii(out, elements);
+        else
+            v41::save_elements_header_binary(out, elements);
+    } else if (format.version == "2.2") {
+        v22::save_elements_header(out, elements);
+    } else {
+        throw_unsupported_version(format.version);
+    }
+}
+
+void save_element_block(std::ostream& out,
+    const MeshFormat& format,
+    const ElementBlock& block,
+    const SaveOptions& options)
+{
+    save_element_rows(out, format, get_element_rows(block), options);
+}
+
+void save_element_block(std::ostream& out,
+    const MeshFormat& format,
+    const ElementBlockView& block,
+    const SaveOptions& options)
+{
+    save_element_rows(out, format, get_element_rows(block), options);
+}
+
+std::pair<size_t, size_t> get_element_tag_range(const ElementBlockView& block)
+{
+    if (block.num_elements_in_block == 0) return {0, 0};
+    if (block.tags == nullptr) {
+        return {block.first_tag, block.first_tag + block.num_elements_in_block - 1};
+    }
+    const auto min_max =
+        std::minmax_element(block.tags, block.tags + block.num_elements_in_block);
+    return {*min_max.first, *min_max.second};
+}
+
+void save_elements(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
+{
+    const Elements& elements = spec.elements;
+    out << "$Elements\n";
+    save_elements_header(out, spec.mesh_format, elements);
+    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
+        save_element_block(out, spec.mesh_format, elements.entity_blocks[i], options);
+    }
+    out << "$EndElements\n";
+}
+
+void save_elements(std::ostream& out, const MshSpecView& spec, const SaveOptions& options)
+{
+    Elements elements;
+    for (const ElementBlockView& block : spec.element_blocks) {
+        if (block.num_elements_in_block == 0) continue;
+        const auto range = get_element_tag_range(block);
+        const bool first = elements.num_elements == 0;
+        elements.min_element_tag =
+            first ? range.first : std::min(elements.min_element_tag, range.first);
+        elements.max_element_tag =
+            first ? range.second : std::max(elements.max_element_tag, range.second);
+        elements.num_elements += block.num_elements_in_block;
+    }
+    elements.num_entity_blocks = spec.element_blocks.size();
+
+    out << "$Elements\n";
+    save_elements_header(out, spec.mesh_format, elements);
+    for (const ElementBlockView& block : spec.element_blocks) {
+        save_element_block(out, spec.mesh_format, block, options);
+    }
+    out << "$EndElements\n";
+}
 
 } // namespace mshio
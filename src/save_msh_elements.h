@@ -1,11 +1,30 @@
 #pragma once
 
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
+#include <mshio/options.h>
 
 #include <iostream>
+#include <utility>
 
 namespace mshio {
 
-void save_elements(std::ostream& out, const MshSpec& spec);
+void save_elements(std::ostream& out, const MshSpec& spec, const SaveOptions& options);
+void save_elements(std::ostream& out, const MshSpecView& spec, const SaveOptions& options);
 
-}
+// Building blocks of save_elements(), shared with MshWriter. The entity blocks
+// of `elements` are ignored by save_elements_header().
+void save_elements_header(std::ostream& out, const MeshFormat& format, const Elements& elements);
+void save_element_block(std::ostream& out,
+    const MeshFormat& format,
+    const ElementBlock& block,
+    const SaveOptions& options);
+void save_element_block(std::ostream& out,
+    const MeshFormat& format,
+    const ElementBlockView& block,
+    const SaveOptions& options);
+
+// Smallest and largest tags of a non-empty block.
+std::pair<size_t, size_t> get_element_tag_range(const ElementBlockView& block);
+
+} // namespace mshio
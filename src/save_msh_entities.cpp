@@ -17,7 +17,7 @@ void save_entities_ascii(std::ostream& out, const MshSpec& spec)
 {
     const Entities& entities = spec.entities;
     out << entities.points.size() << " " << entities.curves.size() << " "
-        << entities.surfaces.size() << " " << entities.volumes.size() << std::endl;
+        << entities.surfaces.size() << " " << entities.volumes.size() << '\n';
 
     for (size_t i = 0; i < entities.points.size(); i++) {
         const PointEntity& point = entities.points[i];
@@ -26,7 +26,7 @@ void save_entities_ascii(std::ostream& out, const MshSpec& spec)
         for (size_t j = 0; j < point.physical_group_tags.size(); j++) {
             out << " " << point.physical_group_tags[j];
         }
-        out << std::endl;
+        out << '\n';
     }
 
     for (size_t i = 0; i < entities.curves.size(); i++) {
@@ -41,7 +41,7 @@ void save_entities_ascii(std::ostream& out, const MshSpec& spec)
         for (size_t j = 0; j < curve.boundary_point_tags.size(); j++) {
             out << " " << curve.boundary_point_tags[j];
         }
-        out << std::endl;
+        out << '\n';
     }
 
     for (size_t i = 0; i < entities.surfaces.size(); i++) {
@@ -56,7 +56,7 @@ void save_entities_ascii(std::ostream& out, const MshSpec& spec)
         for (size_t j = 0; j < surface.boundary_curve_tags.size(); j++) {
             out << " " << surface.boundary_curve_tags[j];
         }
-        out << std::endl;
+        out << '\n';
     }
 
     for (size_t i = 0; i < entities.volumes.size(); i++) {
@@ -71,7 +71,7 @@ void save_entities_ascii(std::ostream& out, const MshSpec& spec)
         for (size_t j = 0; j < volume.boundary_surface_tags.size(); j++) {
             out << " " << volume.boundary_surface_tags[j];
         }
-        out << std::endl;
+        out << '\n';
     }
 }
 
@@ -167,7 +167,7 @@ void save_entities(std::ostream& out, const MshSpec& spec)
         // version 2.2 has no $Entities section
         return;
     }
-    out << "$Entities" << std::endl;
+    out << "$Entities\n";
     if (version == "4.1") {
         if (is_ascii)
             v41::save_entities_ascii(out, spec);
@@ -178,7 +178,7 @@ void save_entities(std::ostream& out, const MshSpec& spec)
         msg << "Unsupported MSH version: " << version;
         throw UnsupportedFeature(msg.str());
     }
-    out << "$EndEntities" << std::endl;
+    out << "$EndEntities\n";
 }
 
 } // namespace mshio
@@ -1,132 +1,272 @@
 #include "save_msh_nodes.h"
+#include "ascii_writer.h"
+#include "chunked_writer.h"
 
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
 #include <mshio/exception.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <ostream>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 namespace mshio {
+
+namespace {
+
+size_t node_tag(const NodeBlockView& block, size_t i)
+{
+    return block.tags != nullptr ? block.tags[i] : block.first_tag + i;
+}
+
+size_t get_entries_per_node(const NodeBlockView& block)
+{
+    return static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
+}
+
+NodeBlockView make_node_block_view(const NodeBlock& block)
+{
+    NodeBlockView view;
+    view.entity_dim = block.entity_dim;
+    view.entity_tag = block.entity_tag;
+    view.parametric = block.parametric;
+    view.num_nodes_in_block = block.num_nodes_in_block;
+    view.tags = block.tags.data();
+    view.data = block.data.data();
+    return view;
+}
+
+} // namespace
+
 namespace v41 {
 
-void save_nodes_ascii(std::ostream& out, const MshSpec& spec)
+void save_nodes_header_ascii(std::ostream& out, const Nodes& nodes)
 {
-    const Nodes& nodes = spec.nodes;
     out << nodes.num_entity_blocks << " " << nodes.num_nodes << " "
-        << nodes.min_node_tag << " " << nodes.max_node_tag << std::endl;
-
-    for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
-        const NodeBlock& block = nodes.entity_blocks[i];
-        out << block.entity_dim << " " << block.entity_tag << " " << block.parametric << " "
-            << block.num_nodes_in_block << std::endl;
-        for (size_t j = 0; j < block.num_nodes_in_block; j++) {
-            out << block.tags[j] << std::endl;
-        }
-        const size_t entries_per_node =
-            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
-        for (size_t j = 0; j < block.num_nodes_in_block; j++) {
-            for (size_t k = 0; k < entries_per_node; k++) {
-                out << block.data[j * entries_per_node + k];
-                if (k == entries_per_node - 1) {
-                    out << std::endl;
-                } else {
-                    out << ' ';
-                }
-            }
-        }
-    }
+        << nodes.min_node_tag << " " << nodes.max_node_tag << '\n';
 }
 
-void save_nodes_binary(std::ostream& out, const MshSpec& spec)
+void save_nodes_header_binary(std::ostream& out, const Nodes& nodes)
 {
-    const Nodes& nodes = spec.nodes;
     out.write(reinterpret_cast<const char*>(&nodes.num_entity_blocks), sizeof(size_t));
     out.write(reinterpret_cast<const char*>(&nodes.num_nodes), sizeof(size_t));
     out.write(reinterpret_cast<const char*>(&nodes.min_node_tag), sizeof(size_t));
     out.write(reinterpret_cast<const char*>(&nodes.max_node_tag), sizeof(size_t));
+}
 
-    for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
-        const NodeBlock& block = nodes.entity_blocks[i];
-        out.write(reinterpret_cast<const char*>(&block.entity_dim), sizeof(int));
-        out.write(reinterpret_cast<const char*>(&block.entity_tag), sizeof(int));
-        out.write(reinterpret_cast<const char*>(&block.parametric), sizeof(int));
-        out.write(reinterpret_cast<const char*>(&block.num_nodes_in_block), sizeof(size_t));
+void save_node_block_ascii(
+    std::ostream& out, const NodeBlockView& block, const SaveOptions& options)
+{
+    out << block.entity_dim << " " << block.entity_tag << " " << block.parametric << " "
+        << block.num_nodes_in_block << '\n';
+    write_rows(out, block.num_nodes_in_block, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            AsciiWriter writer(chunk, options.precision);
+            for (size_t j = begin; j < end; j++) {
+                writer << node_tag(block, j) << '\n';
+            }
+            writer.flush();
+        });
 
-        out.write(reinterpret_cast<const char*>(block.tags.data()),
-            static_cast<std::streamsize>(sizeof(size_t) * block.num_nodes_in_block));
+    const size_t entries_per_node = get_entries_per_node(block);
+    write_rows(out, block.num_nodes_in_block, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            AsciiWriter writer(chunk, options.precision);
+            for (size_t j = begin; j < end; j++) {
+                for (size_t k = 0; k < entries_per_node; k++) {
+                    writer << block.data[j * entries_per_node + k];
+                    writer << ((k == entries_per_node - 1) ? '\n' : ' ');
+                }
+            }
+            writer.flush();
+        });
+}
+
+void save_node_block_binary(
+    std::ostream& out, const NodeBlockView& block, const SaveOptions& options)
+{
+    out.write(reinterpret_cast<const char*>(&block.entity_dim), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&block.entity_tag), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&block.parametric), sizeof(int));
+    out.write(reinterpret_cast<const char*>(&block.num_nodes_in_block), sizeof(size_t));
 
-        const size_t entries_per_node =
-            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
-        out.write(reinterpret_cast<const char*>(block.data.data()),
-            static_cast<std::streamsize>(
-                sizeof(double) * block.num_nodes_in_block * entries_per_node));
+    if (block.tags != nullptr) {
+        out.write(reinterpret_cast<const char*>(block.tags),
+            static_cast<std::streamsize>(sizeof(size_t) * block.num_nodes_in_block));
+    } else {
+        write_rows(out, block.num_nodes_in_block, options.num_threads,
+            [&](std::ostream& chunk, size_t begin, size_t end) {
+                constexpr size_t batch_size = 1 << 12;
+                std::vector<size_t> buffer(std::min(end - begin, batch_size));
+                for (size_t first = begin; first < end; first += batch_size) {
+                    const size_t last = std::min(first + batch_size, end);
+                    for (size_t j = first; j < last; j++) {
+                        buffer[j - first] = block.first_tag + j;
+                    }
+                    chunk.write(reinterpret_cast<const char*>(buffer.data()),
+                        static_cast<std::streamsize>(sizeof(size_t) * (last - first)));
+                }
+            });
     }
+
+    const size_t entries_per_node = get_entries_per_node(block);
+    out.write(reinterpret_cast<const char*>(block.data),
+        static_cast<std::streamsize>(
+            sizeof(double) * block.num_nodes_in_block * entries_per_node));
 }
 
 } // namespace v41
 
 namespace v22 {
 
-void save_nodes_ascii(std::ostream& out, const MshSpec& spec)
+void save_nodes_header(std::ostream& out, const Nodes& nodes)
 {
-    const Nodes& nodes = spec.nodes;
-    out << nodes.num_nodes << std::endl;
-
-    for (size_t i=0; i<nodes.num_entity_blocks; i++) {
-        const auto& block = nodes.entity_blocks[i];
-        const size_t entries_per_node =
-            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
-        for (size_t j = 0; j < block.num_nodes_in_block; j++) {
-            out << block.tags[j] << " " << block.data[j * entries_per_node] << " "
-                << block.data[j * entries_per_node + 1] << " "
-                << block.data[j * entries_per_node + 2] << std::endl;
-        }
-    }
+    out << nodes.num_nodes << '\n';
 }
 
-void save_nodes_binary(std::ostream& out, const MshSpec& spec)
+void save_node_block_ascii(
+    std::ostream& out, const NodeBlockView& block, const SaveOptions& options)
 {
-    const Nodes& nodes = spec.nodes;
-    out << nodes.num_nodes << std::endl;
-
-    for (size_t i=0; i<nodes.num_entity_blocks; i++) {
-        const auto& block = nodes.entity_blocks[i];
-        const size_t entries_per_node =
-            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
-        for (size_t j = 0; j < block.num_nodes_in_block; j++) {
-            const int32_t node_id = static_cast<int32_t>(block.tags[j]);
-            out.write(reinterpret_cast<const char*>(&node_id), 4);
-            out.write(reinterpret_cast<const char*>(block.data.data() + j * entries_per_node),
-                static_cast<std::streamsize>(sizeof(double) * 3));
-        }
-    }
+    const size_t entries_per_node = get_entries_per_node(block);
+    write_rows(out, block.num_nodes_in_block, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            AsciiWriter writer(chunk, options.precision);
+            for (size_t j = begin; j < end; j++) {
+                writer << node_tag(block, j) << ' ' << block.data[j * entries_per_node] << ' '
+                       << block.data[j * entries_per_node + 1] << ' '
+                       << block.data[j * entries_per_node + 2] << '\n';
+            }
+            writer.flush();
+        });
+}
+
+void save_node_block_binary(
+    std::ostream& out, const NodeBlockView& block, const SaveOptions& options)
+{
+    // Each node is a 32 bits tag followed by its 3 coordinates. Nodes are
+    // encoded into a buffer and written in bulk.
+    constexpr size_t node_size = 4 + 3 * sizeof(double);
+    const size_t entries_per_node = get_entries_per_node(block);
+    write_rows(out, block.num_nodes_in_block, options.num_threads,
+        [&](std::ostream& chunk, size_t begin, size_t end) {
+            constexpr size_t batch_size = 1 << 12;
+            std::vector<char> buffer(std::min(end - begin, batch_size) * node_size);
+            for (size_t first = begin; first < end; first += batch_size) {
+                const size_t last = std::min(first + batch_size, end);
+                char* ptr = buffer.data();
+                for (size_t j = first; j < last; j++) {
+                    const int32_t node_id = static_cast<int32_t>(node_tag(block, j));
+                    std::memcpy(ptr, &node_id, 4);
+                    std::memcpy(
+                        ptr + 4, block.data + j * entries_per_node, 3 * sizeof(double));
+                    ptr += node_size;
+                }
+                chunk.write(buffer.data(), static_cast<std::streamsize>(ptr - buffer.data()));
+            }
+        });
 }
 
 } // namespace v22
 
-void save_nodes(std::ostream& out, const MshSpec& spec)
+namespace {
+
+[[noreturn]] void throw_unsupported_version(const std::string& version)
+{
+    std::stringstream msg;
+    msg << "Unsupported MSH version: " << version;
+    throw UnsupportedFeature(msg.str());
+}
+
+} // namespace
+
+void save_nodes_header(std::ostream& out, const MeshFormat& format, const Nodes& nodes)
+{
+    const bool is_ascii = format.file_type == 0;
+    if (format.version == "4.1") {
+        if (is_ascii)
+            v41::save_nodes_header_ascii(out, nodes);
+        else
+            v41::save_nodes_header_binary(out, nodes);
+    } else if (format.version == "2.2") {
+        v22::save_nodes_header(out, nodes);
+    } else {
+        throw_unsupported_version(format.version);
+    }
+}
+
+std::pair<size_t, size_t> get_node_tag_range(const NodeBlockView& block)
 {
-    const std::string& version = spec.mesh_format.version;
-    const bool is_ascii = spec.mesh_format.file_type == 0;
+    if (block.num_nodes_in_block == 0) return {0, 0};
+    if (block.tags == nullptr) {
+        return {block.first_tag, block.first_tag + block.num_nodes_in_block - 1};
+    }
+    const auto min_max = std::minmax_element(block.tags, block.tags + block.num_nodes_in_block);
+    return {*min_max.first, *min_max.second};
+}
+
+void save_node_block(std::ostream& out,
+    const MeshFormat& format,
+    const NodeBlock& block,
+    const SaveOptions& options)
+{
+    save_node_block(out, format, make_node_block_view(block), options);
+}
 
-    out << "$Nodes" << std::endl;
-    if (version == "4.1") {
+void save_node_block(std::ostream& out,
+    const MeshFormat& format,
+    const NodeBlockView& block,
+    const SaveOptions& options)
+{
+    const bool is_ascii = format.file_type == 0;
+    if (format.version == "4.1") {
         if (is_ascii)
-            v41::save_nodes_ascii(out, spec);
+            v41::save_node_block_ascii(out, block, options);
         else
-            v41::save_nodes_binary(out, spec);
-    } else if (version == "2.2") {
+            v41::save_node_block_binary(out, block, options);
+    } else if (format.version == "2.2") {
         if (is_ascii)
-            v22::save_nodes_ascii(out, spec);
+            v22::save_node_block_ascii(out, block, options);
         else
-            v22::save_nodes_binary(out, spec);
+            v22::save_node_block_binary(out, block, options);
     } else {
-        std::stringstream msg;
-        msg << "Unsupported MSH version: " << version;
-        throw UnsupportedFeature(msg.str());
+        throw_unsupported_version(format.version);
+    }
+}
+
+void save_nodes(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
+{
+    const Nodes& nodes = spec.nodes;
+    out << "$Nodes\n";
+    save_nodes_header(out, spec.mesh_format, nodes);
+    for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
+        save_node_block(out, spec.mesh_format, nodes.entity_blocks[i], options);
+    }
+    out << "$EndNodes\n";
+}
+
+void save_nodes(std::ostream& out, const MshSpecView& spec, const SaveOptions& options)
+{
+    Nodes nodes;
+    for (const NodeBlockView& block : spec.node_blocks) {
+        if (block.num_nodes_in_block == 0) continue;
+        const auto range = get_node_tag_range(block);
+        const bool first = nodes.num_nodes == 0;
+        nodes.min_node_tag = first ? range.first : std::min(nodes.min_node_tag, range.first);
+        nodes.max_node_tag = first ? range.second : std::max(nodes.max_node_tag, range.second);
+        nodes.num_nodes += block.num_nodes_in_block;
+    }
+    nodes.num_entity_blocks = spec.node_blocks.size();
+
+    out << "$Nodes\n";
+    save_nodes_header(out, spec.mesh_format, nodes);
+    for (const NodeBlockView& block : spec.node_blocks) {
+        save_node_block(out, spec.mesh_format, block, options);
     }
-    out << "$EndNodes" << std::endl;
+    out << "$EndNodes\n";
 }
 
 } // namespace mshio
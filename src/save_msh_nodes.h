@@ -1,11 +1,30 @@
 #pragma once
 
 #include <mshio/MshSpec.h>
+#include <mshio/MshSpecView.h>
+#include <mshio/options.h>
 
 #include <iostream>
+#include <utility>
 
 namespace mshio {
 
-void save_nodes(std::ostream& out, const MshSpec& spec);
+void save_nodes(std::ostream& out, const MshSpec& spec, const SaveOptions& options);
+void save_nodes(std::ostream& out, const MshSpecView& spec, const SaveOptions& options);
 
-}
+// Building blocks of save_nodes(), shared with MshWriter. The entity blocks of
+// `nodes` are ignored by save_nodes_header().
+void save_nodes_header(std::ostream& out, const MeshFormat& format, const Nodes& nodes);
+void save_node_block(std::ostream& out,
+    const MeshFormat& format,
+    const NodeBlock& block,
+    const SaveOptions& options);
+void save_node_block(std::ostream& out,
+    const MeshFormat& format,
+    const NodeBlockView& block,
+    const SaveOptions& options);
+
+// Smallest and largest tags of a non-empty block.
+std::pair<size_t, size_t> get_node_tag_range(const NodeBlockView& block);
+
+} // namespace mshio
@@ -0,0 +1,148 @@
+#include "save_msh_partitioned_entities.h"
+#include "ascii_writer.h"
+
+#include <mshio/MshSpec.h>
+#include <mshio/exception.h>
+
+#include <string>
+#include <vector>
+
+namespace mshio {
+
+namespace {
+
+// Writes the fields of a section either as space separated ASCII tokens or as
+// raw binary values, mirroring the reader of load_msh_partitioned_entities.cpp.
+// ASCII fields are buffered until `flush()`, which must be called before
+// writing to `out` directly.
+class FieldWriter
+{
+public:
+    FieldWriter(std::ostream& out, bool is_binary, const SaveOptions& options)
+        : m_out(out)
+        , m_ascii(out, options.precision)
+        , m_is_binary(is_binary)
+    {}
+
+    template <typename T>
+    void write(T value)
+    {
+        if (m_is_binary) {
+            m_out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        } else {
+            if (!m_line_start) m_ascii << ' ';
+            m_ascii << value;
+            m_line_start = false;
+        }
+    }
+
+    // Write the size of `tags` as size_t followed by the tags.
+    void write_tags(const Vector<int>& tags)
+    {
+        write(tags.size());
+        for (int tag : tags) {
+            write(tag);
+        }
+    }
+
+    void end_line()
+    {
+        if (!m_is_binary) m_ascii << '\n';
+        m_line_start = true;
+    }
+
+    void flush() { m_ascii.flush(); }
+
+private:
+    std::ostream& m_out;
+    AsciiWriter m_ascii;
+    bool m_is_binary;
+    bool m_line_start = true;
+};
+
+void save_partitioned_entity(FieldWriter& writer, const PartitionedEntity& entity, int dim)
+{
+    writer.write(entity.tag);
+    writer.write(entity.parent_dim);
+    writer.write(entity.parent_tag);
+    writer.write_tags(entity.partition_tags);
+    writer.write(entity.min_x);
+    writer.write(entity.min_y);
+    writer.write(entity.min_z);
+    if (dim > 0) {
+        writer.write(entity.max_x);
+        writer.write(entity.max_y);
+        writer.write(entity.max_z);
+    }
+    writer.write_tags(entity.physical_group_tags);
+    if (dim > 0) {
+        writer.write_tags(entity.boundary_tags);
+    }
+    writer.end_line();
+}
+
+void check_version(const MshSpec& spec, const std::string& section)
+{
+    if (spec.mesh_format.version != "4.1") {
+        throw UnsupportedFeature(section + " section requires MSH version 4.1");
+    }
+}
+
+} // namespace
+
+void save_partitioned_entities(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
+{
+    check_version(spec, "$PartitionedEntities");
+    const PartitionedEntities& entities = spec.partitioned_entities;
+
+    out << "$PartitionedEntities\n";
+    FieldWriter writer(out, spec.mesh_format.file_type > 0, options);
+    writer.write(entities.num_partitions);
+    writer.end_line();
+    writer.write(entities.ghost_entities.size());
+    for (const GhostEntity& ghost : entities.ghost_entities) {
+        writer.write(ghost.tag);
+        writer.write(ghost.partition);
+    }
+    writer.end_line();
+
+    writer.write(entities.points.size());
+    writer.write(entities.curves.size());
+    writer.write(entities.surfaces.size());
+    writer.write(entities.volumes.size());
+    writer.end_line();
+    for (const auto& point : entities.points) {
+        save_partitioned_entity(writer, point, 0);
+    }
+    for (const auto& curve : entities.curves) {
+        save_partitioned_entity(writer, curve, 1);
+    }
+    for (const auto& surface : entities.surfaces) {
+        save_partitioned_entity(writer, surface, 2);
+    }
+    for (const auto& volume : entities.volumes) {
+        save_partitioned_entity(writer, volume, 3);
+    }
+    writer.flush();
+    out << "$EndPartitionedEntities\n";
+}
+
+void save_ghost_elements(std::ostream& out, const MshSpec& spec, const SaveOptions& options)
+{
+    check_version(spec, "$GhostElements");
+
+    out << "$GhostElements\n";
+    FieldWriter writer(out, spec.mesh_format.file_type > 0, options);
+    writer.write(spec.ghost_elements.size());
+    writer.end_line();
+    for (const GhostElement& element : spec.ghost_elements) {
+        writer.write(element.tag);
+        writer.write(element.partition);
+        writer.write_tags(element.ghost_partition_tags);
+        writer.end_line();
+    }
+    writer.flush();
+    out << "$EndGhostElements\n";
+}
+
+} // namespace mshio
@@ -0,0 +1,11 @@
+#pragma once
+#include <mshio/MshSpec.h>
+#include <mshio/options.h>
+#include <iostream>
+
+namespace mshio {
+
+void save_partitioned_entities(std::ostream& out, const MshSpec& spec, const SaveOptions& options);
+void save_ghost_elements(std::ostream& out, const MshSpec& spec, const SaveOptions& options);
+
+} // namespace mshio
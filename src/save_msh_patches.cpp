@@ -13,7 +13,7 @@ void save_patches_ascii(std::ostream& out, const MshSpec& spec)
 {
 #ifdef MSHIO_EXT_NANOSPLINE
     const auto& patches = spec.patches;
-    out << patches.size() << std::endl;
+    out << patches.size() << '\n';
     for (const auto& patch : patches) {
         out << patch.patch_tag << " ";
         out << patch.patch_type << " ";
@@ -22,7 +22,7 @@ void save_patches_ascii(std::ostream& out, const MshSpec& spec)
         out << patch.num_control_points << " ";
         out << patch.num_u_knots << " ";
         out << patch.num_v_knots << " ";
-        out << patch.with_weights << std::endl;
+        out << patch.with_weights << '\n';
 
         const size_t dim = (patch.with_weights > 0) ? 4 : 3;
         const size_t num_entries =
@@ -33,7 +33,7 @@ void save_patches_ascii(std::ostream& out, const MshSpec& spec)
             for (size_t j = 0; j < dim; j++) {
                 out << patch.data[i * dim + j];
                 if (j + 1 == dim) {
-                    out << std::endl;
+                    out << '\n';
                 } else {
                     out << ' ';
                 }
@@ -41,10 +41,10 @@ void save_patches_ascii(std::ostream& out, const MshSpec& spec)
         }
 
         for (size_t i = 0; i < patch.num_u_knots; i++) {
-            out << patch.data[patch.num_control_points * dim + i] << std::endl;
+            out << patch.data[patch.num_control_points * dim + i] << '\n';
         }
         for (size_t i = 0; i < patch.num_v_knots; i++) {
-            out << patch.data[patch.num_control_points * dim + patch.num_u_knots + i] << std::endl;
+            out << patch.data[patch.num_control_points * dim + patch.num_u_knots + i] << '\n';
         }
     }
 #endif
@@ -54,7 +54,7 @@ void save_patches_binary(std::ostream& out, const MshSpec& spec)
 {
 #ifdef MSHIO_EXT_NANOSPLINE
     const auto& patches = spec.patches;
-    out << patches.size() << std::endl;
+    out << patches.size() << '\n';
     for (const auto& patch : patches) {
         out << patch.patch_tag << " ";
         out << patch.patch_type << " ";
@@ -63,7 +63,7 @@ void save_patches_binary(std::ostream& out, const MshSpec& spec)
         out << patch.num_control_points << " ";
         out << patch.num_u_knots << " ";
         out << patch.num_v_knots << " ";
-        out << patch.with_weights << std::endl;
+        out << patch.with_weights << '\n';
 
         const size_t dim = (patch.with_weights > 0) ? 4 : 3;
         const size_t num_entries =
@@ -82,13 +82,13 @@ void save_patches(std::ostream& out, const MshSpec& spec)
 {
     const bool is_ascii = spec.mesh_format.file_type == 0;
 
-    out << "$Patches" << std::endl;
+    out << "$Patches\n";
     if (is_ascii) {
         save_patches_ascii(out, spec);
     } else {
         save_patches_binary(out, spec);
     }
-    out << "$EndPatches" << std::endl;
+    out << "$EndPatches\n";
 }
 
 } // namespace mshio
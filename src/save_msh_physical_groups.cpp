@@ -10,16 +10,16 @@ namespace mshio {
 
 void save_physical_groups(std::ostream& out, const MshSpec& spec)
 {
-    out << "$PhysicalNames" << std::endl;
+    out << "$PhysicalNames\n";
     const auto& groups = spec.physical_groups;
-    out << groups.size() << std::endl;
+    out << groups.size() << '\n';
 
     for (const auto& group: groups) {
         out << group.dim << " ";
         out << group.tag << " ";
-        out << std::quoted(group.name) << std::endl;
+        out << std::quoted(group.name) << '\n';
     }
-    out << "$EndPhysicalNames" << std::endl;
+    out << "$EndPhysicalNames\n";
 }
 
 } // namespace mshio
@@ -0,0 +1,277 @@
+#include "skip_msh_section.h"
+#include "element_utils.h"
+#include "io_utils.h"
+#include "load_msh_data.h"
+#include "load_msh_entities.h"
+#include "load_msh_partitioned_entities.h"
+
+#include <mshio/MshSpec.h>
+#include <mshio/exception.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace mshio {
+
+namespace {
+
+bool is_white_space(char ch)
+{
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+template <typename T>
+T read_binary(std::istream& in)
+{
+    T value;
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    if (!in.good()) {
+        throw InvalidFormat("Unexpected end of file in binary section.");
+    }
+    return value;
+}
+
+namespace v41 {
+
+void skip_nodes_binary(std::istream& in)
+{
+    eat_white_space(in, 1);
+    const size_t num_entity_blocks = read_binary<size_t>(in);
+    skip_bytes(in, 3 * sizeof(size_t)); // num_nodes, min_node_tag, max_node_tag.
+    for (size_t i = 0; i < num_entity_blocks; i++) {
+        const int entity_dim = read_binary<int>(in);
+        read_binary<int>(in); // entity_tag
+        const int parametric = read_binary<int>(in);
+        const size_t num_nodes_in_block = read_binary<size_t>(in);
+        const size_t entries_per_node =
+            static_cast<size_t>(3 + ((parametric == 1) ? entity_dim : 0));
+        skip_bytes(in,
+            num_nodes_in_block * (sizeof(size_t) + sizeof(double) * entries_per_node));
+    }
+}
+
+void skip_elements_binary(std::istream& in)
+{
+    eat_white_space(in, 1);
+    const size_t num_entity_blocks = read_binary<size_t>(in);
+    skip_bytes(in, 3 * sizeof(size_t)); // num_elements, min_element_tag, max_element_tag.
+    for (size_t i = 0; i < num_entity_blocks; i++) {
+        read_binary<int>(in); // entity_dim
+        read_binary<int>(in); // entity_tag
+        const int element_type = read_binary<int>(in);
+        const size_t num_elements_in_block = read_binary<size_t>(in);
+        const size_t n = nodes_per_element(element_type);
+        skip_bytes(in, num_elements_in_block * (n + 1) * sizeof(size_t));
+    }
+}
+
+} // namespace v41
+
+namespace v22 {
+
+void skip_nodes_binary(std::istream& in)
+{
+    size_t num_nodes;
+    in >> num_nodes;
+    eat_white_space(in, 1);
+    skip_bytes(in, num_nodes * (sizeof(int32_t) + 3 * sizeof(double)));
+}
+
+void skip_elements_binary(std::istream& in)
+{
+    size_t num_elements;
+    in >> num_elements;
+    eat_white_space(in, 1);
+    size_t num_skipped = 0;
+    while (num_skipped < num_elements) {
+        const int32_t element_type = read_binary<int32_t>(in);
+        const int32_t num_elements_in_block = read_binary<int32_t>(in);
+        const int32_t num_tags = read_binary<int32_t>(in);
+        if (num_elements_in_block <= 0 || num_tags < 0) {
+            throw InvalidFormat("Invalid element block header.");
+        }
+        const size_t n = nodes_per_element(element_type);
+        const size_t num_ints = 1 + static_cast<size_t>(num_tags) + n;
+        skip_bytes(in, static_cast<size_t>(num_elements_in_block) * num_ints * sizeof(int32_t));
+        num_skipped += static_cast<size_t>(num_elements_in_block);
+    }
+}
+
+} // namespace v22
+
+void skip_data_binary(std::istream& in, bool is_element_node_data)
+{
+    DataHeader header;
+    internal::load_data_header(in, header);
+    if (header.int_tags.size() < 3) {
+        throw InvalidFormat("Data requires at least 3 int tags.");
+    }
+    const size_t fields_per_entry = static_cast<size_t>(header.int_tags[1]);
+    const size_t num_entries = static_cast<size_t>(header.int_tags[2]);
+    eat_white_space(in, 1);
+
+    // Both v2.2 and v4.1 store 32 bits tags, see `load_data_entry`.
+    if (!is_element_node_data) {
+        skip_bytes(in, num_entries * (sizeof(int32_t) + sizeof(double) * fields_per_entry));
+        return;
+    }
+
+    // Element-node data entries have their own size, so walk the entries.
+    for (size_t i = 0; i < num_entries; i++) {
+        read_binary<int32_t>(in); // tag
+        const int32_t num_nodes_per_element = read_binary<int32_t>(in);
+        if (num_nodes_per_element < 0) {
+            throw InvalidFormat("Invalid number of nodes per element.");
+        }
+        skip_bytes(
+            in, sizeof(double) * fields_per_entry * static_cast<size_t>(num_nodes_per_element));
+    }
+}
+
+void skip_curves_binary(std::istream& in)
+{
+    size_t num_curves;
+    in >> num_curves;
+    for (size_t i = 0; i < num_curves; i++) {
+        size_t curve_tag, curve_type, curve_degree, num_control_points, num_knots, with_weights;
+        in >> curve_tag >> curve_type >> curve_degree >> num_control_points >> num_knots >>
+            with_weights;
+        eat_white_space(in, 1);
+        const size_t dim = (with_weights > 0) ? 4 : 3;
+        skip_bytes(in, sizeof(double) * (num_control_points * dim + num_knots));
+    }
+}
+
+void skip_patches_binary(std::istream& in)
+{
+    size_t num_patches;
+    in >> num_patches;
+    for (size_t i = 0; i < num_patches; i++) {
+        size_t patch_tag, patch_type, degree_u, degree_v, num_control_points, num_u_knots,
+            num_v_knots, with_weights;
+        in >> patch_tag >> patch_type >> degree_u >> degree_v >> num_control_points >>
+            num_u_knots >> num_v_knots >> with_weights;
+        eat_white_space(in, 1);
+        const size_t dim = (with_weights > 0) ? 4 : 3;
+        skip_bytes(in, sizeof(double) * (num_control_points * dim + num_u_knots + num_v_knots));
+    }
+}
+
+// Skip the payload of a binary section. Returns false if the section layout
+// is unknown.
+bool skip_binary_payload(std::istream& in, const std::string& section, const MeshFormat& format)
+{
+    const bool is_v41 = format.version == "4.1";
+    if (section == "$Nodes") {
+        is_v41 ? v41::skip_nodes_binary(in) : v22::skip_nodes_binary(in);
+    } else if (section == "$Elements") {
+        is_v41 ? v41::skip_elements_binary(in) : v22::skip_elements_binary(in);
+    } else if (section == "$NodeData" || section == "$ElementData") {
+        skip_data_binary(in, false);
+    } else if (section == "$ElementNodeData") {
+        skip_data_binary(in, true);
+    } else if (section == "$Entities") {
+        // Entities are small and their records have variable size.
+        MshSpec scratch;
+        scratch.mesh_format = format;
+        load_entities(in, scratch);
+    } else if (section == "$PartitionedEntities") {
+        MshSpec scratch;
+        scratch.mesh_format = format;
+        load_partitioned_entities(in, scratch);
+    } else if (section == "$GhostElements") {
+        MshSpec scratch;
+        scratch.mesh_format = format;
+        load_ghost_elements(in, scratch, LoadOptions());
+    } else if (section == "$Curves") {
+        skip_curves_binary(in);
+    } else if (section == "$Patches") {
+        skip_patches_binary(in);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void skip_section(std::istream& in, const std::string& section, const MeshFormat& format)
+{
+    const std::string end_str = "$End" + section.substr(1);
+    if (format.file_type != 0 && skip_binary_payload(in, section, format)) {
+        std::string buf;
+        in >> buf;
+        if (buf != end_str) {
+            throw InvalidFormat("Expecting " + end_str + " after skipping " + section + ".");
+        }
+    } else {
+        scan_to(in, end_str);
+    }
+}
+
+void scan_to(std::istream& in, const std::string& flag)
+{
+    const std::streamoff start = in.tellg();
+    if (start < 0) {
+        forward_to(in, flag);
+        return;
+    }
+
+    constexpr size_t chunk_size = 1 << 20;
+    const size_t len = flag.size();
+    std::vector<char> buffer(chunk_size + len);
+    std::streamoff base = start; // File offset of buffer[0].
+    char before = ' '; // Character preceding buffer[0].
+    size_t size = 0; // Number of valid bytes in buffer.
+
+    while (true) {
+        in.read(buffer.data() + size, static_cast<std::streamsize>(chunk_size));
+        size += static_cast<size_t>(in.gcount());
+        const bool eof = in.eof();
+
+        // A match must be followed by a white space, which has to be in the
+        // buffer unless the file ends right after the match.
+        size_t num_candidates = 0;
+        if (size >= len) {
+            num_candidates = eof ? size - len + 1 : size - len;
+        }
+
+        const char* data = buffer.data();
+        const char* p = data;
+        const char* candidates_end = data + num_candidates;
+        while (p < candidates_end) {
+            p = static_cast<const char*>(
+                std::memchr(p, flag[0], static_cast<size_t>(candidates_end - p)));
+            if (p == nullptr) break;
+            const size_t i = static_cast<size_t>(p - data);
+            const char prev = (i == 0) ? before : data[i - 1];
+            const bool ends_token = (i + len == size) || is_white_space(data[i + len]);
+            if (is_white_space(prev) && ends_token && std::memcmp(p, flag.data(), len) == 0) {
+                in.clear();
+                in.seekg(base + static_cast<std::streamoff>(i + len));
+                return;
+            }
+            p++;
+        }
+
+        if (eof) {
+            // Same state as `forward_to` running out of tokens.
+            in.clear();
+            in.seekg(0, std::ios_base::end);
+            in.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+            return;
+        }
+
+        // Keep the tail that may contain the beginning of a match.
+        if (num_candidates > 0) before = data[num_candidates - 1];
+        std::memmove(buffer.data(), data + num_candidates, size - num_candidates);
+        base += static_cast<std::streamoff>(num_candidates);
+        size -= num_candidates;
+    }
+}
+
+} // namespace mshio
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <mshio/MshSpec.h>
+
+#include <iostream>
+#include <string>
+
+namespace mshio {
+
+// Skip the section whose header token (e.g. "$Nodes") has just been read from
+// `in`, leaving the stream right after the matching "$End..." token.
+//
+// For binary files, the length of $Nodes, $Elements, data and extension
+// sections is computed from their headers and the payload is seeked over
+// without being read. Other sections are scanned for the closing token.
+void skip_section(std::istream& in, const std::string& section, const MeshFormat& format);
+
+// Move `in` right after the next occurrence of `flag` as a whitespace
+// delimited token. Seekable streams are scanned in large chunks with memchr.
+void scan_to(std::istream& in, const std::string& flag);
+
+} // namespace mshio
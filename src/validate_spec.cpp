@@ -1,60 +1,639 @@
+#include "parallel_utils.h"
+
 #include <mshio/MshSpec.h>
+#include <mshio/ValidationReport.h>
 #include <mshio/exception.h>
+#include <mshio/mshio.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace mshio {
 
-void validate_spec(const MshSpec& spec)
+namespace {
+
+// Number of nodes, elements or data entries checked by each task.
+constexpr size_t chunk_size = size_t(1) << 16;
+
+IssueSeverity default_severity(IssueKind kind)
+{
+    switch (kind) {
+    case IssueKind::MissingEntity:
+    case IssueKind::MissingPhysicalGroup:
+    case IssueKind::InvalidData: return IssueSeverity::Warning;
+    default: return IssueSeverity::Error;
+    }
+}
+
+// Issues found by one task. Lists are merged in task order, so that the report
+// does not depend on the number of threads.
+class IssueList
+{
+public:
+    // Warnings are dropped if `errors_only` is true.
+    IssueList(size_t max_issues, bool errors_only)
+        : m_max_issues(max_issues)
+        , m_errors_only(errors_only)
+    {}
+
+    // `message()` is only called for the first `max_issues` issues, so that
+    // heavily corrupted meshes do not build millions of strings.
+    template <typename Message>
+    void add(IssueKind kind, IssueSeverity severity, Message&& message)
+    {
+        if (m_errors_only && severity != IssueSeverity::Error) return;
+        if (m_report.issues.size() < m_max_issues) {
+            m_report.issues.push_back({kind, severity, message()});
+        }
+        m_report.num_issues++;
+        if (severity == IssueSeverity::Error) m_report.num_errors++;
+    }
+
+    template <typename Message>
+    void add(IssueKind kind, Message&& message)
+    {
+        add(kind, default_severity(kind), std::forward<Message>(message));
+    }
+
+    void append(IssueList& other)
+    {
+        for (auto& issue : other.m_report.issues) {
+            if (m_report.issues.size() == m_max_issues) break;
+            m_report.issues.push_back(std::move(issue));
+        }
+        m_report.num_issues += other.m_report.num_issues;
+        m_report.num_errors += other.m_report.num_errors;
+    }
+
+    // Empty list with the same settings, for a task.
+    IssueList child() const { return IssueList(m_max_issues, m_errors_only); }
+    ValidationReport& report() { return m_report; }
+
+private:
+    size_t m_max_issues;
+    bool m_errors_only;
+    ValidationReport m_report;
+};
+
+struct Chunk
+{
+    size_t block;
+    size_t begin;
+    size_t end;
+};
+
+template <typename Block, typename Size>
+std::vector<Chunk> split_blocks(const Vector<Block>& blocks, Size block_size)
+{
+    std::vector<Chunk> chunks;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        const size_t size = block_size(blocks[i]);
+        for (size_t begin = 0; begin < size; begin += chunk_size) {
+            chunks.push_back({i, begin, std::min(size, begin + chunk_size)});
+        }
+    }
+    return chunks;
+}
+
+// Run `fn(chunk, issues)` on every chunk and merge their issues into `issues`.
+template <typename Fn>
+void check_chunks(
+    const std::vector<Chunk>& chunks, size_t num_threads, IssueList& issues, Fn&& fn)
+{
+    std::vector<IssueList> chunk_issues(chunks.size(), issues.child());
+    parallel_for(chunks.size(), num_threads, [&](size_t i) { fn(chunks[i], chunk_issues[i]); });
+    for (auto& chunk_issue : chunk_issues) {
+        issues.append(chunk_issue);
+    }
+}
+
+// `size` tags, `stride` values apart.
+struct TagSpan
+{
+    const size_t* tags;
+    size_t size;
+    size_t stride;
+};
+
+// Set of node or element tags, built on several threads. Tags are stored in a
+// bitmap when their range is compact (at most 64 bits per tag), and in a
+// sorted array otherwise.
+class TagSet
+{
+public:
+    TagSet(const std::vector<TagSpan>& spans, size_t num_threads)
+    {
+        std::vector<size_t> min_tags(spans.size(), std::numeric_limits<size_t>::max());
+        std::vector<size_t> max_tags(spans.size(), 0);
+        parallel_for(spans.size(), num_threads, [&](size_t i) {
+            const TagSpan& span = spans[i];
+            for (size_t j = 0; j < span.size; j++) {
+                min_tags[i] = std::min(min_tags[i], span.tags[j * span.stride]);
+                max_tags[i] = std::max(max_tags[i], span.tags[j * span.stride]);
+            }
+        });
+
+        size_t num_tags = 0;
+        for (const auto& span : spans) {
+            num_tags += span.size;
+        }
+        m_size = num_tags;
+        if (num_tags == 0) return;
+        m_min_tag = *std::min_element(min_tags.begin(), min_tags.end());
+        const size_t range = *std::max_element(max_tags.begin(), max_tags.end()) - m_min_tag;
+        m_dense = range / 64 < num_tags;
+
+        // Tags found more than once by each span.
+        std::vector<std::vector<size_t>> duplicates(spans.size());
+        if (m_dense) {
+            m_num_words = range / 64 + 1;
+            m_bits.reset(new std::atomic<uint64_t>[m_num_words]());
+            parallel_for(spans.size(), num_threads, [&](size_t i) {
+                const TagSpan& span = spans[i];
+                for (size_t j = 0; j < span.size; j++) {
+                    const size_t k = span.tags[j * span.stride] - m_min_tag;
+                    const uint64_t bit = uint64_t(1) << (k % 64);
+                    if (m_bits[k / 64].fetch_or(bit, std::memory_order_relaxed) & bit) {
+                        duplicates[i].push_back(span.tags[j * span.stride]);
+                    }
+                }
+            });
+        } else {
+            std::vector<size_t> offsets(spans.size(), 0);
+            for (size_t i = 1; i < spans.size(); i++) {
+                offsets[i] = offsets[i - 1] + spans[i - 1].size;
+            }
+            m_sorted_tags.resize(num_tags);
+            parallel_for(spans.size(), num_threads, [&](size_t i) {
+                const TagSpan& span = spans[i];
+                for (size_t j = 0; j < span.size; j++) {
+                    m_sorted_tags[offsets[i] + j] = span.tags[j * span.stride];
+                }
+            });
+            std::sort(m_sorted_tags.begin(), m_sorted_tags.end());
+            for (size_t i = 1; i < m_sorted_tags.size(); i++) {
+                if (m_sorted_tags[i] == m_sorted_tags[i - 1]) {
+                    duplicates[0].push_back(m_sorted_tags[i]);
+                }
+            }
+            m_sorted_tags.erase(
+                std::unique(m_sorted_tags.begin(), m_sorted_tags.end()), m_sorted_tags.end());
+        }
+
+        for (const auto& tags : duplicates) {
+            m_duplicates.insert(m_duplicates.end(), tags.begin(), tags.end());
+        }
+        std::sort(m_duplicates.begin(), m_duplicates.end());
+        m_duplicates.erase(
+            std::unique(m_duplicates.begin(), m_duplicates.end()), m_duplicates.end());
+    }
+
+    // Number of tags, including duplicates.
+    size_t size() const { return m_size; }
+
+    bool contains(size_t tag) const
+    {
+        if (m_dense) {
+            if (tag < m_min_tag || (tag - m_min_tag) / 64 >= m_num_words) return false;
+            const size_t k = tag - m_min_tag;
+            return (m_bits[k / 64].load(std::memory_order_relaxed) >> (k % 64)) & 1;
+        }
+        return std::binary_search(m_sorted_tags.begin(), m_sorted_tags.end(), tag);
+    }
+
+    // Sorted tags found more than once.
+    const std::vector<size_t>& duplicates() const { return m_duplicates; }
+
+private:
+    size_t m_size = 0;
+    bool m_dense = true;
+    size_t m_min_tag = 0;
+    size_t m_num_words = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_bits;
+    std::vector<size_t> m_sorted_tags;
+    std::vector<size_t> m_duplicates;
+};
+
+uint64_t entity_key(int dim, int tag)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(dim)) << 32) |
+           static_cast<uint32_t>(tag >= 0 ? tag : -tag);
+}
+
+std::string entity_name(int dim, int tag)
+{
+    return "(" + std::to_string(dim) + ", " + std::to_string(tag) + ")";
+}
+
+// (dim, tag) of all entities and partitioned entities. References to entities
+// of a dimension are only checked if the spec has entities of that dimension,
+// since hand written files often omit them.
+class EntitySet
+{
+public:
+    explicit EntitySet(const MshSpec& spec)
+    {
+        add(spec.entities.points, 0);
+        add(spec.entities.curves, 1);
+        add(spec.entities.surfaces, 2);
+        add(spec.entities.volumes, 3);
+        add(spec.partitioned_entities.points, 0);
+        add(spec.partitioned_entities.curves, 1);
+        add(spec.partitioned_entities.surfaces, 2);
+        add(spec.partitioned_entities.volumes, 3);
+    }
+
+    bool is_missing(int dim, int tag) const
+    {
+        if (dim < 0 || dim > 3) return true;
+        return m_num_entities[dim] > 0 && m_keys.count(entity_key(dim, tag)) == 0;
+    }
+
+private:
+    template <typename Entity>
+    void add(const Vector<Entity>& entities, int dim)
+    {
+        for (const auto& entity : entities) {
+            m_keys.insert(entity_key(dim, entity.tag));
+        }
+        m_num_entities[dim] += entities.size();
+    }
+
+    std::unordered_set<uint64_t> m_keys;
+    size_t m_num_entities[4] = {0, 0, 0, 0};
+};
+
+void check_counts(const MshSpec& spec, IssueList& issues)
 {
     const Nodes& nodes = spec.nodes;
     const Elements& elements = spec.elements;
 
-    auto ASSERT = [](bool r, const std::string& msg) {
-        if (!r) {
-            throw CorruptData(msg);
+    size_t num_nodes = 0;
+    for (const auto& block : nodes.entity_blocks) {
+        num_nodes += block.num_nodes_in_block;
+    }
+    size_t num_elements = 0;
+    for (const auto& block : elements.entity_blocks) {
+        num_elements += block.num_elements_in_block;
+    }
+
+    if (nodes.num_entity_blocks != nodes.entity_blocks.size()) {
+        issues.add(IssueKind::InvalidHeader, [] { return "Inconsistent entity blocks in nodes."; });
+    }
+    if (nodes.num_nodes != num_nodes) {
+        issues.add(IssueKind::InvalidHeader, [] { return "Inconsistent number of nodes."; });
+    }
+    if (nodes.min_node_tag > nodes.max_node_tag) {
+        issues.add(IssueKind::InvalidHeader, [] { return "Min node tag > max node tag."; });
+    }
+    if (elements.num_entity_blocks != elements.entity_blocks.size()) {
+        issues.add(
+            IssueKind::InvalidHeader, [] { return "Inconsistent entity blocks in elements."; });
+    }
+    if (elements.num_elements != num_elements) {
+        issues.add(IssueKind::InvalidHeader, [] { return "Inconsistent number of elements."; });
+    }
+    if (elements.min_element_tag > elements.max_element_tag) {
+        issues.add(IssueKind::InvalidHeader, [] { return "Min element tag > max element tag."; });
+    }
+}
+
+template <typename Entity, typename GetBoundary>
+void check_boundaries(const EntitySet& entity_set,
+    const Vector<Entity>& entities,
+    int dim,
+    GetBoundary get_boundary,
+    IssueList& issues)
+{
+    for (const auto& entity : entities) {
+        for (int tag : get_boundary(entity)) {
+            if (entity_set.is_missing(dim - 1, tag)) {
+                issues.add(IssueKind::MissingEntity, [&] {
+                    return "Entity " + entity_name(dim, entity.tag) +
+                           " is bounded by unknown entity " + entity_name(dim - 1, tag) + ".";
+                });
+            }
+        }
+    }
+}
+
+template <typename Entity>
+void add_physical_groups(
+    std::unordered_set<uint64_t>& used, const Vector<Entity>& entities, int dim)
+{
+    for (const auto& entity : entities) {
+        for (int tag : entity.physical_group_tags) {
+            used.insert(entity_key(dim, tag));
         }
-    };
+    }
+}
+
+void check_entities(const MshSpec& spec, const EntitySet& entity_set, IssueList& issues)
+{
+    const Entities& entities = spec.entities;
+    check_boundaries(entity_set, entities.curves, 1,
+        [](const CurveEntity& curve) -> const Vector<int>& { return curve.boundary_point_tags; },
+        issues);
+    check_boundaries(entity_set, entities.surfaces, 2,
+        [](const SurfaceEntity& surface) -> const Vector<int>& {
+            return surface.boundary_curve_tags;
+        },
+        issues);
+    check_boundaries(entity_set, entities.volumes, 3,
+        [](const VolumeEntity& volume) -> const Vector<int>& {
+            return volume.boundary_surface_tags;
+        },
+        issues);
 
-    ASSERT(nodes.num_entity_blocks == nodes.entity_blocks.size(),
-        "Inconsistent entity blocks in nodes.");
-    ASSERT(elements.num_entity_blocks == elements.entity_blocks.size(),
-        "Inconsistent entity blocks in elements.");
+    const PartitionedEntities& partitioned = spec.partitioned_entities;
+    const Vector<PartitionedEntity>* partitioned_entities[] = {
+        &partitioned.points, &partitioned.curves, &partitioned.surfaces, &partitioned.volumes};
+    for (int dim = 0; dim < 4; dim++) {
+        const auto& entities_of_dim = *partitioned_entities[dim];
+        if (dim > 0) {
+            check_boundaries(entity_set, entities_of_dim, dim,
+                [](const PartitionedEntity& entity) -> const Vector<int>& {
+                    return entity.boundary_tags;
+                },
+                issues);
+        }
+        for (const auto& entity : entities_of_dim) {
+            if (entity.parent_tag != 0 &&
+                entity_set.is_missing(entity.parent_dim, entity.parent_tag)) {
+                issues.add(IssueKind::MissingEntity, [&] {
+                    return "Partitioned entity " + entity_name(dim, entity.tag) +
+                           " has unknown parent " +
+                           entity_name(entity.parent_dim, entity.parent_tag) + ".";
+                });
+            }
+        }
+    }
 
-    ASSERT(nodes.min_node_tag <= nodes.max_node_tag, "Min node tag > max node tag.");
-    ASSERT(
-        elements.min_element_tag <= elements.max_element_tag, "Min element tag > max element tag.");
+    // Physical groups must be used by at least one entity. Entities may use
+    // unnamed physical groups, which are not listed.
+    std::unordered_set<uint64_t> used;
+    add_physical_groups(used, entities.points, 0);
+    add_physical_groups(used, entities.curves, 1);
+    add_physical_groups(used, entities.surfaces, 2);
+    add_physical_groups(used, entities.volumes, 3);
+    for (int dim = 0; dim < 4; dim++) {
+        add_physical_groups(used, *partitioned_entities[dim], dim);
+    }
+    for (const auto& group : spec.physical_groups) {
+        if (used.count(entity_key(group.dim, group.tag)) == 0) {
+            issues.add(IssueKind::MissingPhysicalGroup, [&] {
+                return "Physical group " + entity_name(group.dim, group.tag) +
+                       " is not used by any entity.";
+            });
+        }
+    }
+}
 
-    for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
-        const NodeBlock& block = nodes.entity_blocks[i];
-        ASSERT(block.tags.size() == block.num_nodes_in_block, "Inconsist number of node tags.");
-        for (size_t j = 0; j < block.num_nodes_in_block; j++) {
-            ASSERT(block.tags[j] >= nodes.min_node_tag, "Node tag < min node tag.");
-            ASSERT(block.tags[j] <= nodes.max_node_tag, "Node tag > max node tag.");
+TagSet check_nodes(
+    const MshSpec& spec, const EntitySet& entity_set, size_t num_threads, IssueList& issues)
+{
+    const Nodes& nodes = spec.nodes;
+    for (const auto& block : nodes.entity_blocks) {
+        if (block.tags.size() != block.num_nodes_in_block) {
+            issues.add(IssueKind::InvalidBlock, [&] {
+                return "Inconsistent number of node tags in node block " +
+                       entity_name(block.entity_dim, block.entity_tag) + ".";
+            });
         }
+        const size_t stride =
+            static_cast<size_t>(3 + ((block.parametric == 1) ? block.entity_dim : 0));
+        if (block.data.size() != block.tags.size() * stride) {
+            issues.add(IssueKind::InvalidBlock, [&] {
+                return "Invalid node data size in node block " +
+                       entity_name(block.entity_dim, block.entity_tag) + ".";
+            });
+        }
+        // Nodes of MSH 2.2 files that no element uses are in entity (0, 0).
+        if (block.entity_tag != 0 && entity_set.is_missing(block.entity_dim, block.entity_tag)) {
+            issues.add(IssueKind::MissingEntity, [&] {
+                return "Node block refers to unknown entity " +
+                       entity_name(block.entity_dim, block.entity_tag) + ".";
+            });
+        }
+    }
 
-        if (block.parametric > 0) {
-            ASSERT(block.data.size() ==
-                       block.num_nodes_in_block * static_cast<size_t>(3 + block.entity_dim),
-                "Invalide node data size.");
-        } else {
-            ASSERT(block.data.size() == block.num_nodes_in_block * 3, "Invalid node data size.");
+    const auto chunks =
+        split_blocks(nodes.entity_blocks, [](const NodeBlock& block) { return block.tags.size(); });
+    std::vector<TagSpan> spans(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+        spans[i] = {nodes.entity_blocks[chunks[i].block].tags.data() + chunks[i].begin,
+            chunks[i].end - chunks[i].begin,
+            1};
+    }
+    TagSet node_tags(spans, num_threads);
+
+    check_chunks(chunks, num_threads, issues, [&](const Chunk& chunk, IssueList& chunk_issues) {
+        const NodeBlock& block = nodes.entity_blocks[chunk.block];
+        for (size_t i = chunk.begin; i < chunk.end; i++) {
+            const size_t tag = block.tags[i];
+            if (tag < nodes.min_node_tag || tag > nodes.max_node_tag) {
+                chunk_issues.add(IssueKind::InvalidHeader, [&] {
+                    return "Node tag " + std::to_string(tag) + " is out of range.";
+                });
+            }
         }
+    });
+    for (size_t tag : node_tags.duplicates()) {
+        issues.add(IssueKind::DuplicateNodeTag,
+            [&] { return "Node tag " + std::to_string(tag) + " appears more than once."; });
     }
+    return node_tags;
+}
 
-    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
+TagSet check_elements(const MshSpec& spec,
+    const EntitySet& entity_set,
+    const TagSet& node_tags,
+    size_t num_threads,
+    IssueList& issues)
+{
+    const Elements& elements = spec.elements;
+
+    // Number of nodes per element of each block, 0 for blocks that cannot be
+    // checked further.
+    std::vector<size_t> block_nodes(elements.entity_blocks.size(), 0);
+    for (size_t i = 0; i < elements.entity_blocks.size(); i++) {
         const ElementBlock& block = elements.entity_blocks[i];
-        const size_t entries_per_element = block.data.size() / block.num_elements_in_block;
-        ASSERT(block.data.size() % entries_per_element == 0, "Invalid element data size.");
-        for (size_t j = 0; j < block.data.size(); j++) {
-            if (j % entries_per_element == 0) {
-                ASSERT(block.data[j] >= elements.min_element_tag, "Element tag < min element tag.");
-                ASSERT(block.data[j] <= elements.max_element_tag, "Element tag > max element tag.");
-            } else {
-                ASSERT(block.data[j] >= nodes.min_node_tag, "Node tag in element < min node tag.");
-                ASSERT(block.data[j] <= nodes.max_node_tag, "Node tag in element > max node tag.");
+        const std::string name = entity_name(block.entity_dim, block.entity_tag);
+        if (block.element_type <= 0 || block.element_type >= 32) {
+            issues.add(IssueKind::InvalidBlock, [&] {
+                return "Unsupported element type " + std::to_string(block.element_type) +
+                       " in element block " + name + ".";
+            });
+            continue;
+        }
+        if (get_element_dim(block.element_type) != block.entity_dim) {
+            issues.add(IssueKind::InvalidBlock, IssueSeverity::Warning, [&] {
+                return "Element type " + std::to_string(block.element_type) +
+                       " does not match the dimension of element block " + name + ".";
+            });
+        }
+        if (entity_set.is_missing(block.entity_dim, block.entity_tag)) {
+            issues.add(IssueKind::MissingEntity,
+                [&] { return "Element block refers to unknown entity " + name + "."; });
+        }
+        const size_t n = nodes_per_element(block.element_type);
+        if (block.data.size() != block.num_elements_in_block * (n + 1)) {
+            issues.add(IssueKind::InvalidBlock,
+                [&] { return "Invalid element data size in element block " + name + "."; });
+            continue;
+        }
+        block_nodes[i] = n;
+    }
+
+    const auto chunks = split_blocks(elements.entity_blocks,
+        [](const ElementBlock& block) { return block.num_elements_in_block; });
+    std::vector<TagSpan> spans;
+    std::vector<Chunk> valid_chunks;
+    for (const auto& chunk : chunks) {
+        const size_t n = block_nodes[chunk.block];
+        if (n == 0) continue;
+        spans.push_back({elements.entity_blocks[chunk.block].data.data() + chunk.begin * (n + 1),
+            chunk.end - chunk.begin,
+            n + 1});
+        valid_chunks.push_back(chunk);
+    }
+    TagSet element_tags(spans, num_threads);
+
+    check_chunks(
+        valid_chunks, num_threads, issues, [&](const Chunk& chunk, IssueList& chunk_issues) {
+            const ElementBlock& block = elements.entity_blocks[chunk.block];
+            const size_t n = block_nodes[chunk.block];
+            for (size_t i = chunk.begin; i < chunk.end; i++) {
+                // Each element is stored as its tag followed by its node tags.
+                const size_t* element = block.data.data() + i * (n + 1);
+                if (element[0] < elements.min_element_tag ||
+                    element[0] > elements.max_element_tag) {
+                    chunk_issues.add(IssueKind::InvalidHeader, [&] {
+                        return "Element tag " + std::to_string(element[0]) + " is out of range.";
+                    });
+                }
+                for (size_t j = 1; j <= n; j++) {
+                    if (!node_tags.contains(element[j])) {
+                        chunk_issues.add(IssueKind::MissingNode, [&] {
+                            return "Element " + std::to_string(element[0]) +
+                                   " refers to unknown node " + std::to_string(element[j]) + ".";
+                        });
+                    }
+                }
+            }
+        });
+    for (size_t tag : element_tags.duplicates()) {
+        issues.add(IssueKind::DuplicateElementTag,
+            [&] { return "Element tag " + std::to_string(tag) + " appears more than once."; });
+    }
+    return element_tags;
+}
+
+// Data may be saved apart from the mesh it refers to, so entry tags are only
+// checked if the spec has nodes or elements.
+void check_data(const Vector<Data>& views,
+    DataKind kind,
+    const TagSet& tags,
+    size_t num_threads,
+    IssueList& issues)
+{
+    const char* target = (kind == DataKind::NodeData) ? "node" : "element";
+    for (const auto& view : views) {
+        const DataHeader& header = view.header;
+        const std::string name =
+            header.string_tags.empty() ? std::string("unnamed") : header.string_tags.front();
+        if (header.int_tags.size() < 3 || header.int_tags[1] <= 0 || header.int_tags[2] < 0) {
+            issues.add(IssueKind::InvalidHeader, IssueSeverity::Warning, [&] {
+                return "Invalid integer tags in data view \"" + name + "\".";
+            });
+            continue;
+        }
+        const size_t num_fields = static_cast<size_t>(header.int_tags[1]);
+        const size_t num_entries = view.is_compact() ? view.tags.size() : view.entries.size();
+        if (num_entries != static_cast<size_t>(header.int_tags[2])) {
+            issues.add(IssueKind::InvalidHeader, IssueSeverity::Warning, [&] {
+                return "Inconsistent number of entries in data view \"" + name + "\".";
+            });
+        }
+
+        if (view.is_compact()) {
+            const bool per_node = kind == DataKind::ElementNodeData;
+            if ((per_node && (view.offsets.size() != num_entries + 1 ||
+                                 view.offsets.back() != view.values.size())) ||
+                (!per_node && view.values.size() != num_entries * num_fields)) {
+                issues.add(IssueKind::InvalidData,
+                    [&] { return "Invalid number of values in data view \"" + name + "\"."; });
             }
         }
+
+        std::vector<Chunk> chunks;
+        for (size_t begin = 0; begin < num_entries; begin += chunk_size) {
+            chunks.push_back({0, begin, std::min(num_entries, begin + chunk_size)});
+        }
+        check_chunks(chunks, num_threads, issues, [&](const Chunk& chunk, IssueList& chunk_issues) {
+            for (size_t i = chunk.begin; i < chunk.end; i++) {
+                const size_t tag = view.is_compact() ? view.tags[i] : view.entries[i].tag;
+                if (tags.size() > 0 && !tags.contains(tag)) {
+                    chunk_issues.add(IssueKind::InvalidData, [&] {
+                        return "Data view \"" + name + "\" refers to unknown " + target + " " +
+                               std::to_string(tag) + ".";
+                    });
+                }
+                if (view.is_compact()) continue;
+
+                const DataEntry& entry = view.entries[i];
+                const bool per_node = kind == DataKind::ElementNodeData;
+                if ((per_node && entry.num_nodes_per_element <= 0) ||
+                    entry.data.size() !=
+                        num_fields *
+                            (per_node ? static_cast<size_t>(entry.num_nodes_per_element) : 1)) {
+                    chunk_issues.add(IssueKind::InvalidData, [&] {
+                        return "Invalid number of values for " + std::string(target) + " " +
+                               std::to_string(tag) + " in data view \"" + name + "\".";
+                    });
+                }
+            }
+        });
+    }
+}
+
+ValidationReport check(
+    const MshSpec& spec, size_t num_threads, size_t max_issues, bool errors_only)
+{
+    IssueList issues(max_issues, errors_only);
+    const EntitySet entity_set(spec);
+
+    check_counts(spec, issues);
+    check_entities(spec, entity_set, issues);
+    const TagSet node_tags = check_nodes(spec, entity_set, num_threads, issues);
+    const TagSet element_tags = check_elements(spec, entity_set, node_tags, num_threads, issues);
+    check_data(spec.node_data, DataKind::NodeData, node_tags, num_threads, issues);
+    check_data(spec.element_data, DataKind::ElementData, element_tags, num_threads, issues);
+    check_data(
+        spec.element_node_data, DataKind::ElementNodeData, element_tags, num_threads, issues);
+
+    return std::move(issues.report());
+}
+
+} // namespace
+
+ValidationReport check_spec(const MshSpec& spec, size_t num_threads, size_t max_issues)
+{
+    return check(spec, num_threads, max_issues, false);
+}
+
+void validate_spec(const MshSpec& spec, size_t num_threads)
+{
+    const ValidationReport report = check(spec, num_threads, 1, true);
+    if (report.has_errors()) {
+        throw CorruptData(report.issues.front().message);
     }
 }
 
@@ -1,8 +1,23 @@
 #include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <thread>
 
+#include <mshio/exception.h>
 #include <mshio/mshio.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace {
 
 using namespace mshio;
@@ -201,6 +216,45 @@ void save_and_load(MshSpec& spec)
     ASSERT_SAME(spec, spec2);
 }
 
+// A line of `N` nodes along x, at `i / x_divisor`, and the N - 1 segments
+// joining them.
+MshSpec make_line_mesh(size_t N, double x_divisor)
+{
+    MshSpec spec;
+    spec.nodes.num_entity_blocks = 1;
+    spec.nodes.num_nodes = N;
+    spec.nodes.min_node_tag = 1;
+    spec.nodes.max_node_tag = N;
+    spec.nodes.entity_blocks.resize(1);
+    auto& node_block = spec.nodes.entity_blocks[0];
+    node_block.entity_dim = 1;
+    node_block.entity_tag = 1;
+    node_block.num_nodes_in_block = N;
+    for (size_t i = 0; i < N; i++) {
+        node_block.tags.push_back(i + 1);
+        node_block.data.push_back(static_cast<double>(i) / x_divisor);
+        node_block.data.push_back(0.5);
+        node_block.data.push_back(-static_cast<double>(i % 7));
+    }
+
+    spec.elements.num_entity_blocks = 1;
+    spec.elements.num_elements = N - 1;
+    spec.elements.min_element_tag = 1;
+    spec.elements.max_element_tag = N - 1;
+    spec.elements.entity_blocks.resize(1);
+    auto& element_block = spec.elements.entity_blocks[0];
+    element_block.entity_dim = 1;
+    element_block.entity_tag = 1;
+    element_block.element_type = 1;
+    element_block.num_elements_in_block = N - 1;
+    for (size_t i = 0; i < N - 1; i++) {
+        element_block.data.push_back(i + 1);
+        element_block.data.push_back(i + 1);
+        element_block.data.push_back(i + 2);
+    }
+    return spec;
+}
+
 } // namespace
 
 TEST_CASE("Load", "[io]")
@@ -616,6 +670,115 @@ TEST_CASE("element node data")
     save_and_load(spec);
 }
 
+TEST_CASE("Compact data", "[data][io]")
+{
+    using namespace mshio;
+
+    MshSpec spec;
+    auto make_data = [](size_t num_entries, int num_fields, int num_nodes_per_element) {
+        Data data;
+        data.header.string_tags = {"field"};
+        data.header.real_tags = {0.5};
+        data.header.int_tags = {0, num_fields, static_cast<int>(num_entries), 0};
+        for (size_t i = 0; i < num_entries; i++) {
+            DataEntry entry;
+            entry.tag = i + 1;
+            entry.num_nodes_per_element = num_nodes_per_element;
+            const int num_nodes = num_nodes_per_element > 0 ? num_nodes_per_element : 1;
+            const size_t n = static_cast<size_t>(num_fields * num_nodes);
+            for (size_t j = 0; j < n; j++) {
+                entry.data.push_back(static_cast<double>(i * n + j) / 7);
+            }
+            data.entries.push_back(std::move(entry));
+        }
+        return data;
+    };
+    spec.node_data.push_back(make_data(10, 3, 0));
+    spec.element_data.push_back(make_data(5, 1, 0));
+    spec.element_node_data.push_back(make_data(4, 2, 3));
+
+    SECTION("v4.1")
+    {
+        spec.mesh_format.version = "4.1";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+    SECTION("v2.2")
+    {
+        spec.mesh_format.version = "2.2";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+
+    std::stringstream contents;
+    save_msh(contents, spec);
+
+    LoadOptions options;
+    options.compact_data = true;
+    MshSpec spec2 = load_msh(contents, options);
+    REQUIRE(spec2.node_data.size() == 1);
+    REQUIRE(spec2.element_data.size() == 1);
+    REQUIRE(spec2.element_node_data.size() == 1);
+
+    auto check_compact = [](const Data& expected, const Data& data, bool is_element_node_data) {
+        REQUIRE(data.is_compact());
+        REQUIRE(data.entries.empty());
+        REQUIRE(data.tags.size() == expected.entries.size());
+        REQUIRE(data.offsets.size() == (is_element_node_data ? data.tags.size() + 1 : 0));
+        size_t offset = 0;
+        for (size_t i = 0; i < expected.entries.size(); i++) {
+            const auto& entry = expected.entries[i];
+            REQUIRE(data.tags[i] == entry.tag);
+            if (is_element_node_data) REQUIRE(data.offsets[i] == offset);
+            for (size_t j = 0; j < entry.data.size(); j++) {
+                REQUIRE(data.values[offset + j] == entry.data[j]);
+            }
+            offset += entry.data.size();
+        }
+        REQUIRE(data.values.size() == offset);
+    };
+    check_compact(spec.node_data[0], spec2.node_data[0], false);
+    check_compact(spec.element_data[0], spec2.element_data[0], false);
+    check_compact(spec.element_node_data[0], spec2.element_node_data[0], true);
+
+    // Compact data is saved exactly like the equivalent entries.
+    std::stringstream contents2;
+    save_msh(contents2, spec2);
+    REQUIRE(contents2.str() == contents.str());
+
+    // Arrays that do not match the tags are rejected.
+    std::stringstream out;
+    MshSpec invalid = spec2;
+    invalid.node_data[0].values.pop_back();
+    REQUIRE_THROWS_AS(save_msh(out, invalid), InvalidFormat);
+    invalid = spec2;
+    invalid.node_data[0].header.int_tags[2]++;
+    REQUIRE_THROWS_AS(save_msh(out, invalid), InvalidFormat);
+    invalid = spec2;
+    std::swap(invalid.element_node_data[0].offsets[1], invalid.element_node_data[0].offsets[2]);
+    REQUIRE_THROWS_AS(save_msh(out, invalid), InvalidFormat);
+    invalid = spec2;
+    invalid.element_node_data[0].offsets.back()++;
+    REQUIRE_THROWS_AS(save_msh(out, invalid), InvalidFormat);
+
+    std::stringstream negative_count(
+        "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n"
+        "$ElementNodeData\n0\n0\n3\n0\n1\n1\n1 -1\n$EndElementNodeData\n");
+    REQUIRE_THROWS_AS(load_msh(negative_count, options), InvalidFormat);
+}
+
 TEST_CASE("physical group")
 {
     using namespace mshio;
@@ -814,3 +977,2026 @@ TEST_CASE("NanoSpline extension", "[nanospline][ext][io]")
     save_and_load(spec);
 }
 #endif
+
+TEST_CASE("Mapped load", "[mapped][io]")
+{
+    using namespace mshio;
+
+    SECTION("v4.1 binary")
+    {
+        const std::string filename = MSHIO_DATA_DIR "/test_4.1_bin.msh";
+        MshSpec spec = load_msh(filename);
+        MappedMsh mapped(filename);
+
+        const auto& nodes = mapped.nodes();
+        REQUIRE(nodes.num_entity_blocks == spec.nodes.num_entity_blocks);
+        REQUIRE(nodes.num_nodes == spec.nodes.num_nodes);
+        REQUIRE(nodes.min_node_tag == spec.nodes.min_node_tag);
+        REQUIRE(nodes.max_node_tag == spec.nodes.max_node_tag);
+        for (size_t i = 0; i < nodes.num_entity_blocks; i++) {
+            const auto& block = nodes.entity_blocks[i];
+            const auto& expected = spec.nodes.entity_blocks[i];
+            REQUIRE(block.entity_dim == expected.entity_dim);
+            REQUIRE(block.entity_tag == expected.entity_tag);
+            REQUIRE(block.num_nodes_in_block == expected.num_nodes_in_block);
+            for (size_t j = 0; j < block.num_nodes_in_block; j++) {
+                REQUIRE(block.tag(j) == expected.tags[j]);
+            }
+            for (size_t j = 0; j < expected.data.size(); j++) {
+                REQUIRE(block.coordinate(j) == expected.data[j]);
+            }
+        }
+
+        const auto& elements = mapped.elements();
+        REQUIRE(elements.num_entity_blocks == spec.elements.num_entity_blocks);
+        REQUIRE(elements.num_elements == spec.elements.num_elements);
+        for (size_t i = 0; i < elements.num_entity_blocks; i++) {
+            const auto& block = elements.entity_blocks[i];
+            const auto& expected = spec.elements.entity_blocks[i];
+            REQUIRE(block.element_type == expected.element_type);
+            REQUIRE(block.num_elements_in_block == expected.num_elements_in_block);
+            for (size_t j = 0; j < expected.data.size(); j++) {
+                REQUIRE(block.entry(j) == expected.data[j]);
+            }
+        }
+
+        REQUIRE(mapped.spec().entities.points.size() == spec.entities.points.size());
+        REQUIRE(mapped.spec().nodes.num_nodes == 0);
+    }
+
+    SECTION("v4.1 ascii")
+    {
+        REQUIRE_THROWS_AS(MappedMsh(MSHIO_DATA_DIR "/test_4.1_ascii.msh"), UnsupportedFeature);
+    }
+
+    SECTION("Wrapped around counts")
+    {
+        // A node count whose size in bytes wraps around to a few bytes.
+        const std::string filename = "mapped_wrapped.msh";
+        {
+            std::ofstream fout(filename, std::ios::binary);
+            const int one = 1;
+            fout << "$MeshFormat\n4.1 1 8\n";
+            fout.write(reinterpret_cast<const char*>(&one), sizeof(int));
+            fout << "\n$EndMeshFormat\n$Nodes\n";
+            const size_t header[] = {1, 1, 1, 1};
+            fout.write(reinterpret_cast<const char*>(header), sizeof(header));
+            const int block_header[] = {0, 1, 0};
+            fout.write(reinterpret_cast<const char*>(block_header), sizeof(block_header));
+            const size_t num_nodes = (size_t(1) << 61) + 1;
+            fout.write(reinterpret_cast<const char*>(&num_nodes), sizeof(size_t));
+            fout << std::string(64, '\0') << "\n$EndNodes\n";
+        }
+        REQUIRE_THROWS_AS(MappedMsh(filename), InvalidFormat);
+        std::remove(filename.c_str());
+    }
+}
+
+TEST_CASE("ASCII number parsing", "[ascii][io]")
+{
+    using namespace mshio;
+
+    const std::string header = "$MeshFormat\r\n4.1 0 8\r\n$EndMeshFormat\r\n";
+
+    SECTION("Signs, exponents and CRLF")
+    {
+        std::stringstream contents(header +
+                                   "$Nodes\r\n1 2 1 2\r\n0\t1 0 2\r\n1\r\n2\r\n"
+                                   "+1.5e+00 -2.5E-1 0.\r\n.25 1e3 -0\r\n$EndNodes\r\n");
+        MshSpec spec = load_msh(contents);
+        REQUIRE(spec.nodes.num_nodes == 2);
+        const auto& block = spec.nodes.entity_blocks[0];
+        REQUIRE(block.tags == Vector<size_t>{1, 2});
+        REQUIRE(block.data == Vector<double>{1.5, -0.25, 0.0, 0.25, 1000.0, 0.0});
+    }
+
+    SECTION("Malformed number")
+    {
+        std::stringstream contents(header + "$Nodes\n1 1 1 1\n0 1 0 1\n1\n0.0 x 0.0\n$EndNodes\n");
+        REQUIRE_THROWS_AS(load_msh(contents), InvalidFormat);
+    }
+
+    SECTION("Out of range integer")
+    {
+        std::stringstream tag(header + "$Nodes\n1 1 1 1\n0 1 0 1\n18446744073709551616\n"
+                                       "0 0 0\n$EndNodes\n");
+        REQUIRE_THROWS_AS(load_msh(tag), InvalidFormat);
+        std::stringstream dim(header + "$Nodes\n1 1 1 1\n4294967296 1 0 1\n1\n"
+                                       "0 0 0\n$EndNodes\n");
+        REQUIRE_THROWS_AS(load_msh(dim), InvalidFormat);
+        std::stringstream negative_tag(
+            header + "$Nodes\n1 1 1 1\n0 1 0 1\n-1\n0 0 0\n$EndNodes\n");
+        REQUIRE_THROWS_AS(load_msh(negative_tag), InvalidFormat);
+    }
+}
+
+TEST_CASE("ASCII number formatting", "[ascii][io]")
+{
+    using namespace mshio;
+
+    MshSpec spec;
+    spec.nodes.num_entity_blocks = 1;
+    spec.nodes.num_nodes = 2;
+    spec.nodes.min_node_tag = 1;
+    spec.nodes.max_node_tag = 18446744073709551615ull;
+    spec.nodes.entity_blocks.resize(1);
+    auto& block = spec.nodes.entity_blocks[0];
+    block.num_nodes_in_block = 2;
+    block.tags = {1, 18446744073709551615ull};
+    block.data = {0.1, 1.0 / 3.0, -2.5e10, 1e-300, -0.0, 123456789.0};
+
+    std::stringstream contents;
+    SECTION("Shortest round trip")
+    {
+        save_msh(contents, spec);
+        MshSpec spec2 = load_msh(contents);
+        REQUIRE(spec2.nodes.entity_blocks[0].tags == block.tags);
+        REQUIRE(spec2.nodes.entity_blocks[0].data == block.data);
+        REQUIRE(contents.str().find("\n0.1 0.3333333333333333 -2.5e+10\n") !=
+                std::string::npos);
+    }
+
+    SECTION("Fixed precision")
+    {
+        SaveOptions options;
+        options.precision = 3;
+        save_msh(contents, spec, options);
+        REQUIRE(contents.str().find("\n0.1 0.333 -2.5e+10\n1e-300 -0 1.23e+08\n") !=
+                std::string::npos);
+    }
+
+    SECTION("Write errors")
+    {
+        // A device that fills up in the middle of the node payload, as
+        // /dev/full does once the stream buffer is flushed.
+        save_msh(contents, spec);
+        struct FullBuffer : public std::streambuf
+        {
+            size_t free_space = 0;
+
+            std::streamsize xsputn(const char*, std::streamsize n) override
+            {
+                const size_t size = std::min(free_space, static_cast<size_t>(n));
+                free_space -= size;
+                return static_cast<std::streamsize>(size);
+            }
+            int_type overflow(int_type ch) override
+            {
+                if (free_space == 0) return traits_type::eof();
+                free_space--;
+                return traits_type::not_eof(ch);
+            }
+        } full;
+        full.free_space = contents.str().find("\n0.1 ");
+        std::ostream out(&full);
+        out.exceptions(std::ios_base::badbit);
+        REQUIRE_THROWS_AS(save_msh(out, spec), std::ios_base::failure);
+    }
+}
+
+TEST_CASE("Parallel ASCII load", "[parallel][ascii][io]")
+{
+    using namespace mshio;
+
+    // Large enough for blocks to be split across threads.
+    constexpr size_t N = 50000;
+
+    MshSpec spec = make_line_mesh(N, 1);
+    const auto& node_block = spec.nodes.entity_blocks[0];
+
+    LoadOptions options;
+    options.num_threads = 4;
+
+    SECTION("One entry per line")
+    {
+        std::stringstream contents;
+        save_msh(contents, spec);
+        MshSpec spec2 = load_msh(contents, options);
+        ASSERT_SAME(spec, spec2);
+    }
+
+    SECTION("Multiple entries per line")
+    {
+        std::stringstream contents;
+        contents << "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n";
+        contents << "$Nodes\n1 " << N << " 1 " << N << "\n1 1 0 " << N << "\n";
+        for (size_t i = 0; i < N; i++) {
+            contents << node_block.tags[i] << ((i % 2 == 0) ? " " : "\n");
+        }
+        for (size_t i = 0; i < 3 * N; i++) {
+            contents << node_block.data[i] << ((i % 6 == 5) ? "\n" : " ");
+        }
+        contents << "$EndNodes\n";
+        MshSpec spec2 = load_msh(contents, options);
+        ASSERT_SAME_NODES(spec, spec2);
+    }
+
+    SECTION("Layout change within a block")
+    {
+        std::stringstream contents;
+        contents << "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n";
+        contents << "$Nodes\n1 " << N << " 1 " << N << "\n1 1 0 " << N << "\n";
+        for (size_t i = 0; i < N; i++) {
+            contents << node_block.tags[i] << ((i >= N / 2 && i % 2 == 0) ? " " : "\n");
+        }
+        for (size_t i = 0; i < 3 * N; i++) {
+            contents << node_block.data[i] << ((i % 3 == 2) ? "\n" : " ");
+        }
+        contents << "$EndNodes\n";
+        MshSpec spec2 = load_msh(contents, options);
+        ASSERT_SAME_NODES(spec, spec2);
+    }
+
+    SECTION("Small stream buffer")
+    {
+        // Rows straddle the boundaries of the buffered text.
+        {
+            std::ofstream fout("parallel_ascii.msh");
+            save_msh(fout, spec);
+        }
+        std::vector<char> buffer(4000);
+        std::ifstream fin;
+        fin.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        fin.open("parallel_ascii.msh");
+        MshSpec spec2 = load_msh(fin, options);
+        ASSERT_SAME(spec, spec2);
+        fin.close();
+        std::remove("parallel_ascii.msh");
+    }
+}
+
+TEST_CASE("Parallel ASCII load of large sections", "[parallel][ascii][io]")
+{
+    using namespace mshio;
+
+    // Node coordinates span several windows of parsed text.
+    constexpr size_t N = 300000;
+
+    MshSpec spec = make_line_mesh(N, 3);
+    const auto& node_block = spec.nodes.entity_blocks[0];
+    std::stringstream contents;
+    save_msh(contents, spec);
+    const std::string text = contents.str();
+
+    LoadOptions options;
+    options.num_threads = 4;
+
+    SECTION("In place")
+    {
+        std::stringstream in(text);
+        ASSERT_SAME(spec, load_msh(in, options));
+    }
+
+    SECTION("Copied")
+    {
+        {
+            std::ofstream fout("parallel_ascii_large.msh", std::ios::binary);
+            fout << text;
+        }
+        std::vector<char> buffer(1 << 16);
+        std::ifstream fin;
+        fin.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        fin.open("parallel_ascii_large.msh", std::ios::binary);
+        ASSERT_SAME(spec, load_msh(fin, options));
+        fin.close();
+
+        options.read_ahead_buffer_size = 1 << 16;
+        ASSERT_SAME(spec, load_msh("parallel_ascii_large.msh", options));
+        std::remove("parallel_ascii_large.msh");
+    }
+
+    SECTION("Unseekable stream")
+    {
+        // Text comes in small pieces that cannot be read again.
+        struct PieceBuffer : public std::streambuf
+        {
+            explicit PieceBuffer(const std::string& text)
+                : data(text)
+            {}
+
+            int_type underflow() override
+            {
+                if (offset == data.size()) return traits_type::eof();
+                char* begin = &data[offset];
+                offset = std::min(offset + 4000, data.size());
+                setg(begin, begin, &data[0] + offset);
+                return traits_type::to_int_type(*begin);
+            }
+
+            std::string data;
+            size_t offset = 0;
+        } pieces(text);
+        std::istream in(&pieces);
+        ASSERT_SAME(spec, load_msh(in, options));
+    }
+
+    SECTION("Layout change in a later window")
+    {
+        std::stringstream changed;
+        changed.precision(17);
+        changed << "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n";
+        changed << "$Nodes\n1 " << N << " 1 " << N << "\n1 1 0 " << N << "\n";
+        for (size_t i = 0; i < N; i++) {
+            changed << node_block.tags[i] << "\n";
+        }
+        for (size_t i = 0; i < 3 * N; i++) {
+            const bool end_of_line = (i < 3 * N * 9 / 10) ? (i % 3 == 2) : (i % 6 == 5);
+            changed << node_block.data[i] << (end_of_line ? "\n" : " ");
+        }
+        changed << "$EndNodes\n";
+
+        MshSpec spec2 = load_msh(changed, options);
+        ASSERT_SAME_NODES(spec, spec2);
+
+        {
+            std::ofstream fout("parallel_ascii_large.msh", std::ios::binary);
+            fout << changed.str();
+        }
+        std::vector<char> buffer(1 << 16);
+        std::ifstream fin;
+        fin.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        fin.open("parallel_ascii_large.msh", std::ios::binary);
+        MshSpec spec3 = load_msh(fin, options);
+        ASSERT_SAME_NODES(spec, spec3);
+        fin.close();
+        std::remove("parallel_ascii_large.msh");
+    }
+}
+
+TEST_CASE("Parallel save", "[parallel][io]")
+{
+    using namespace mshio;
+
+    // Large enough for sections to be split into several chunks.
+    constexpr size_t N = 50000;
+
+    MshSpec spec = make_line_mesh(N, 3);
+
+    spec.node_data.resize(1);
+    auto& data = spec.node_data[0];
+    data.header.string_tags = {"values"};
+    data.header.real_tags = {0.0};
+    data.header.int_tags = {0, 1, static_cast<int>(N)};
+    data.entries.resize(N);
+    for (size_t i = 0; i < N; i++) {
+        data.entries[i].tag = i + 1;
+        data.entries[i].data = {static_cast<double>(i) * 0.1};
+    }
+
+    SECTION("v4.1")
+    {
+        spec.mesh_format.version = "4.1";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+    SECTION("v2.2")
+    {
+        spec.mesh_format.version = "2.2";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+
+    std::stringstream expected;
+    save_msh(expected, spec);
+
+    SaveOptions options;
+    options.num_threads = 4;
+    std::stringstream contents;
+    save_msh(contents, spec, options);
+    REQUIRE(contents.str() == expected.str());
+}
+
+TEST_CASE("Lazy section loading", "[lazy][io]")
+{
+    using namespace mshio;
+
+    std::string filename;
+    SECTION("v4.1 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_ascii.msh";
+    }
+    SECTION("v4.1 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_bin.msh";
+    }
+    SECTION("v2.2 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_ascii.msh";
+    }
+    SECTION("v2.2 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_bin.msh";
+    }
+
+    const MshSpec spec = load_msh(filename);
+    MshFile file(filename);
+    REQUIRE(file.mesh_format().version == spec.mesh_format.version);
+    REQUIRE(file.mesh_format().file_type == spec.mesh_format.file_type);
+    REQUIRE(file.has_section("$Nodes"));
+    REQUIRE(file.has_section("$Elements"));
+    REQUIRE_FALSE(file.has_section("$Periodic"));
+
+    // Load sections out of order to exercise seeking.
+    REQUIRE(file.node_data_headers().size() == spec.node_data.size());
+    for (size_t i = 0; i < spec.node_data.size(); i++) {
+        REQUIRE(file.node_data_headers()[i].string_tags == spec.node_data[i].header.string_tags);
+        Data data = file.load_node_data(i);
+        REQUIRE(data.entries.size() == spec.node_data[i].entries.size());
+        for (size_t j = 0; j < data.entries.size(); j++) {
+            REQUIRE(data.entries[j].tag == spec.node_data[i].entries[j].tag);
+            REQUIRE(data.entries[j].data == spec.node_data[i].entries[j].data);
+        }
+    }
+
+    Elements elements = file.load_elements();
+    REQUIRE(elements.num_elements == spec.elements.num_elements);
+    REQUIRE(elements.num_entity_blocks == spec.elements.num_entity_blocks);
+    for (size_t i = 0; i < elements.num_entity_blocks; i++) {
+        REQUIRE(elements.entity_blocks[i].data == spec.elements.entity_blocks[i].data);
+    }
+
+    Nodes nodes = file.load_nodes();
+    REQUIRE(nodes.num_nodes == spec.nodes.num_nodes);
+    REQUIRE(nodes.min_node_tag == spec.nodes.min_node_tag);
+    REQUIRE(nodes.max_node_tag == spec.nodes.max_node_tag);
+    if (spec.mesh_format.version == "4.1") {
+        REQUIRE(nodes.entity_blocks.size() == spec.nodes.entity_blocks.size());
+        REQUIRE(nodes.entity_blocks[0].data == spec.nodes.entity_blocks[0].data);
+    }
+
+    REQUIRE_THROWS_AS(file.load_node_data(spec.node_data.size()), std::out_of_range);
+}
+
+TEST_CASE("Read-ahead loading", "[read_ahead][io]")
+{
+    using namespace mshio;
+
+    std::string filename;
+    SECTION("v4.1 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_ascii.msh";
+    }
+    SECTION("v4.1 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_bin.msh";
+    }
+    SECTION("v2.2 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_ascii.msh";
+    }
+    SECTION("v2.2 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_bin.msh";
+    }
+    const MshSpec spec = load_msh(filename);
+
+    // Tiny buffers exercise buffer switches and seeks across buffers.
+    for (size_t buffer_size : {7, 64, 1 << 20}) {
+        LoadOptions options;
+        options.read_ahead_buffer_size = buffer_size;
+        ASSERT_SAME(spec, load_msh(filename, options));
+
+        options.skipped_sections = {"$NodeData"};
+        const MshSpec spec2 = load_msh(filename, options);
+        ASSERT_SAME_NODES(spec, spec2);
+        ASSERT_SAME_ELEMENTS(spec, spec2);
+        REQUIRE(spec2.node_data.empty());
+    }
+}
+
+TEST_CASE("io_uring file I/O", "[io_uring][io]")
+{
+    using namespace mshio;
+
+    std::string filename;
+    SECTION("v4.1 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_ascii.msh";
+    }
+    SECTION("v4.1 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_bin.msh";
+    }
+    SECTION("v2.2 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_ascii.msh";
+    }
+    SECTION("v2.2 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_bin.msh";
+    }
+    const MshSpec spec = load_msh(filename);
+
+    // Tiny buffers exercise buffer switches and seeks across buffers.
+    for (size_t buffer_size : {7, 64, 0}) {
+        LoadOptions options;
+        options.use_io_uring = true;
+        options.read_ahead_buffer_size = buffer_size;
+        ASSERT_SAME(spec, load_msh(filename, options));
+
+        options.skipped_sections = {"$NodeData"};
+        const MshSpec spec2 = load_msh(filename, options);
+        ASSERT_SAME_NODES(spec, spec2);
+        ASSERT_SAME_ELEMENTS(spec, spec2);
+        REQUIRE(spec2.node_data.empty());
+    }
+
+    std::ostringstream expected;
+    save_msh(expected, spec);
+    SaveOptions options;
+    options.use_io_uring = true;
+    save_msh("io_uring_test.msh", spec, options);
+    std::ifstream fin("io_uring_test.msh", std::ios::binary);
+    std::ostringstream actual;
+    actual << fin.rdbuf();
+    fin.close();
+    std::remove("io_uring_test.msh");
+    REQUIRE(actual.str() == expected.str());
+
+#ifndef _WIN32
+    // Pipes have no length, so they are read through a std::filebuf.
+    std::ifstream source(filename, std::ios::binary);
+    const std::string contents(
+        (std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+    const std::string fifo = "io_uring_test.fifo";
+    REQUIRE(mkfifo(fifo.c_str(), 0600) == 0);
+    std::thread writer([&]() {
+        // Report a reader closing early as a short write rather than SIGPIPE.
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        const int fd = open(fifo.c_str(), O_WRONLY);
+        for (size_t offset = 0; fd >= 0 && offset < contents.size();) {
+            const ssize_t n = write(fd, contents.data() + offset, contents.size() - offset);
+            if (n <= 0) break;
+            offset += static_cast<size_t>(n);
+        }
+        if (fd >= 0) close(fd);
+    });
+    LoadOptions fifo_options;
+    fifo_options.use_io_uring = true;
+    MshSpec spec2;
+    REQUIRE_NOTHROW(spec2 = load_msh(fifo, fifo_options));
+    writer.join();
+    std::remove(fifo.c_str());
+    ASSERT_SAME(spec, spec2);
+#endif
+}
+
+TEST_CASE("Skip sections", "[skip][io]")
+{
+    using namespace mshio;
+
+    MshSpec spec;
+    spec.nodes.num_entity_blocks = 1;
+    spec.nodes.num_nodes = 3;
+    spec.nodes.min_node_tag = 1;
+    spec.nodes.max_node_tag = 3;
+    spec.nodes.entity_blocks.resize(1);
+    auto& node_block = spec.nodes.entity_blocks[0];
+    node_block.entity_dim = 2;
+    node_block.entity_tag = 1;
+    node_block.num_nodes_in_block = 3;
+    node_block.tags = {1, 2, 3};
+    node_block.data = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+
+    spec.elements.num_entity_blocks = 1;
+    spec.elements.num_elements = 1;
+    spec.elements.min_element_tag = 1;
+    spec.elements.max_element_tag = 1;
+    spec.elements.entity_blocks.resize(1);
+    auto& element_block = spec.elements.entity_blocks[0];
+    element_block.entity_dim = 2;
+    element_block.entity_tag = 1;
+    element_block.element_type = 2;
+    element_block.num_elements_in_block = 1;
+    element_block.data = {1, 1, 2, 3};
+
+    Data node_data;
+    node_data.header.string_tags = {"node field"};
+    node_data.header.real_tags = {0.0};
+    node_data.header.int_tags = {0, 1, 3};
+    for (size_t i = 1; i <= 3; i++) {
+        DataEntry entry;
+        entry.tag = i;
+        entry.data = {static_cast<double>(i)};
+        node_data.entries.push_back(entry);
+    }
+    spec.node_data.push_back(node_data);
+
+    Data element_node_data;
+    element_node_data.header.string_tags = {"element node field"};
+    element_node_data.header.real_tags = {0.0};
+    element_node_data.header.int_tags = {0, 2, 1};
+    DataEntry entry;
+    entry.tag = 1;
+    entry.num_nodes_per_element = 3;
+    entry.data = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+    element_node_data.entries.push_back(entry);
+    spec.element_node_data.push_back(element_node_data);
+
+    SECTION("v4.1")
+    {
+        spec.mesh_format.version = "4.1";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+    SECTION("v2.2")
+    {
+        spec.mesh_format.version = "2.2";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+
+    std::stringstream contents;
+    save_msh(contents, spec);
+
+    LoadOptions options;
+    options.skipped_sections = {"$Nodes", "$Elements", "$ElementNodeData"};
+    MshSpec spec2 = load_msh(contents, options);
+    REQUIRE(spec2.nodes.num_nodes == 0);
+    REQUIRE(spec2.elements.num_elements == 0);
+    REQUIRE(spec2.element_node_data.empty());
+    REQUIRE(spec2.node_data.size() == 1);
+    ASSERT_SAME_NODE_DATA(spec, spec2);
+
+    options.skipped_sections = {"$NodeData"};
+    contents.clear();
+    contents.seekg(0);
+    MshSpec spec3 = load_msh(contents, options);
+    REQUIRE(spec3.node_data.empty());
+    ASSERT_SAME_NODES(spec, spec3);
+    ASSERT_SAME_ELEMENTS(spec, spec3);
+    ASSERT_SAME_ELEMENT_NODE_DATA(spec, spec3);
+}
+
+TEST_CASE("Skip unknown section", "[skip][io]")
+{
+    using namespace mshio;
+
+    std::stringstream contents(
+        "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n"
+        "$Unknown\n$EndUnknownX x$EndUnknown $EndUnknow\n$EndUnknown\n"
+        "$Nodes\n1 1 7 7\n0 1 0 1\n7\n1.0 2.0 3.0\n$EndNodes\n");
+    MshSpec spec = load_msh(contents);
+    REQUIRE(spec.nodes.num_nodes == 1);
+    REQUIRE(spec.nodes.entity_blocks[0].tags[0] == 7);
+}
+
+TEST_CASE("MSH 2.2 element grouping", "[v22][io]")
+{
+    using namespace mshio;
+
+    // Elements of the same entity and type are grouped even when they are not
+    // consecutive in the file.
+    std::stringstream contents(
+        "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n"
+        "$Nodes\n4\n1 0 0 0\n2 1 0 0\n3 1 1 0\n4 0 1 0\n$EndNodes\n"
+        "$Elements\n5\n"
+        "1 2 2 7 1 1 2 3\n"
+        "2 1 2 8 2 1 2\n"
+        "3 2 2 9 1 1 3 4\n"
+        "4 2 2 7 3 1 2 4\n"
+        "5 1 2 8 2 3 4\n"
+        "$EndElements\n");
+    MshSpec spec = load_msh(contents);
+
+    const auto& blocks = spec.elements.entity_blocks;
+    REQUIRE(spec.elements.num_entity_blocks == 3);
+    REQUIRE(blocks.size() == 3);
+    REQUIRE(blocks[0].entity_tag == 1);
+    REQUIRE(blocks[0].element_type == 2);
+    REQUIRE(blocks[0].num_elements_in_block == 2);
+    REQUIRE(blocks[0].data == Vector<size_t>{1, 1, 2, 3, 3, 1, 3, 4});
+    REQUIRE(blocks[1].entity_tag == 2);
+    REQUIRE(blocks[1].element_type == 1);
+    REQUIRE(blocks[1].data == Vector<size_t>{2, 1, 2, 5, 3, 4});
+    REQUIRE(blocks[2].entity_tag == 3);
+    REQUIRE(blocks[2].num_elements_in_block == 1);
+
+    REQUIRE(spec.entities.curves.size() == 1);
+    REQUIRE(spec.entities.curves[0].physical_group_tags == Vector<int>{8});
+    REQUIRE(spec.entities.surfaces.size() == 2);
+    REQUIRE(spec.entities.surfaces[0].tag == 1);
+    REQUIRE(spec.entities.surfaces[0].physical_group_tags == Vector<int>{7, 9});
+    REQUIRE(spec.entities.surfaces[1].tag == 3);
+    REQUIRE(spec.entities.surfaces[1].physical_group_tags == Vector<int>{7});
+
+    SECTION("Several $Elements sections")
+    {
+        // Entities of the second section are merged into those of the first.
+        std::stringstream sections(
+            "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n"
+            "$Nodes\n4\n1 0 0 0\n2 1 0 0\n3 1 1 0\n4 0 1 0\n$EndNodes\n"
+            "$Elements\n2\n"
+            "1 2 2 7 1 1 2 3\n"
+            "2 2 2 7 3 1 3 4\n"
+            "$EndElements\n"
+            "$Elements\n2\n"
+            "3 2 2 9 1 1 2 4\n"
+            "4 2 2 7 2 2 3 4\n"
+            "$EndElements\n");
+        MshSpec spec2 = load_msh(sections);
+        REQUIRE(spec2.elements.num_elements == 4);
+        REQUIRE(spec2.elements.num_entity_blocks == 3);
+        const auto& surfaces = spec2.entities.surfaces;
+        REQUIRE(surfaces.size() == 3);
+        REQUIRE(surfaces[0].tag == 1);
+        REQUIRE(surfaces[0].physical_group_tags == Vector<int>{7, 9});
+        REQUIRE(surfaces[1].tag == 2);
+        REQUIRE(surfaces[1].physical_group_tags == Vector<int>{7});
+        REQUIRE(surfaces[2].tag == 3);
+        REQUIRE(surfaces[2].physical_group_tags == Vector<int>{7});
+    }
+
+    SECTION("Node ownership")
+    {
+        // Nodes 2 and 3 are last referred to by a triangle of surface 1, but
+        // belong to curve 2 as its block comes after the triangles of surface 1.
+        std::stringstream shared(
+            "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n"
+            "$Nodes\n4\n1 0 0 0\n2 1 0 0\n3 1 1 0\n4 0 1 0\n$EndNodes\n"
+            "$Elements\n3\n"
+            "1 2 2 0 1 1 2 3\n"
+            "2 1 2 0 2 2 3\n"
+            "3 2 2 0 1 2 3 4\n"
+            "$EndElements\n");
+        MshSpec spec2 = load_msh(shared);
+        const auto& node_blocks = spec2.nodes.entity_blocks;
+        REQUIRE(node_blocks.size() == 3);
+        REQUIRE(node_blocks[0].entity_dim == 2);
+        REQUIRE(node_blocks[0].entity_tag == 1);
+        REQUIRE(node_blocks[0].tags == Vector<size_t>{1});
+        REQUIRE(node_blocks[1].entity_dim == 1);
+        REQUIRE(node_blocks[1].entity_tag == 2);
+        REQUIRE(node_blocks[1].tags == Vector<size_t>{2, 3});
+        REQUIRE(node_blocks[2].entity_dim == 2);
+        REQUIRE(node_blocks[2].entity_tag == 1);
+        REQUIRE(node_blocks[2].tags == Vector<size_t>{4});
+    }
+}
+
+TEST_CASE("MSH 2.2 duplicated node tags", "[v22][io]")
+{
+    using namespace mshio;
+
+    // Enough nodes for the node index to be built by several threads, with
+    // the tag of node 5 repeated by the last node, in another chunk.
+    constexpr size_t N = 70000;
+    std::stringstream contents;
+    contents << "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n";
+    contents << "$Nodes\n" << N << "\n";
+    for (size_t i = 1; i <= N; i++) {
+        contents << (i == N ? 5 : i) << " " << i << " 0 0\n";
+    }
+    contents << "$EndNodes\n";
+    contents << "$Elements\n" << N - 1 << "\n";
+    for (size_t i = 1; i < N - 1; i++) {
+        contents << i << " 1 2 0 1 " << i << " " << i + 1 << "\n";
+    }
+    contents << N - 1 << " 15 2 0 2 5\n";
+    contents << "$EndElements\n";
+    const std::string text = contents.str();
+
+    auto load = [&](size_t num_threads) {
+        std::stringstream in(text);
+        LoadOptions options;
+        options.num_threads = num_threads;
+        return load_msh(in, options);
+    };
+    const MshSpec spec = load(1);
+    ASSERT_SAME(spec, load(4));
+
+    // Both copies of node 5 belong to the entity of the point element.
+    size_t num_copies = 0;
+    for (const auto& block : spec.nodes.entity_blocks) {
+        for (size_t tag : block.tags) {
+            if (tag != 5) continue;
+            num_copies++;
+            REQUIRE(block.entity_dim == 0);
+            REQUIRE(block.entity_tag == 2);
+        }
+    }
+    REQUIRE(num_copies == 2);
+}
+
+TEST_CASE("MSH 2.2 sparse node tags", "[v22][io]")
+{
+    using namespace mshio;
+
+    // Regrouping must not allocate memory proportional to the tag range.
+    std::stringstream contents(
+        "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n"
+        "$Nodes\n4\n1 0 0 0\n2000000000 1 0 0\n7 1 1 0\n1000000000 0 1 0\n"
+        "$EndNodes\n"
+        "$Elements\n2\n"
+        "1 1 2 1 3 1 2000000000\n"
+        "2 15 2 1 5 7\n"
+        "$EndElements\n");
+
+    LoadOptions options;
+    SECTION("Serial")
+    {
+        options.num_threads = 1;
+    }
+    SECTION("Parallel")
+    {
+        options.num_threads = 4;
+    }
+    MshSpec spec = load_msh(contents, options);
+
+    const auto& blocks = spec.nodes.entity_blocks;
+    REQUIRE(spec.nodes.num_nodes == 4);
+    REQUIRE(spec.nodes.min_node_tag == 1);
+    REQUIRE(spec.nodes.max_node_tag == 2000000000);
+    REQUIRE(blocks.size() == 3);
+    REQUIRE(blocks[0].entity_dim == 1);
+    REQUIRE(blocks[0].entity_tag == 3);
+    REQUIRE(blocks[0].tags == Vector<size_t>{1, 2000000000});
+    REQUIRE(blocks[1].entity_dim == 0);
+    REQUIRE(blocks[1].entity_tag == 5);
+    REQUIRE(blocks[1].tags == Vector<size_t>{7});
+    REQUIRE(blocks[1].data == Vector<double>{1, 1, 0});
+    REQUIRE(blocks[2].entity_dim == 0);
+    REQUIRE(blocks[2].entity_tag == 0);
+    REQUIRE(blocks[2].tags == Vector<size_t>{1000000000});
+}
+
+TEST_CASE("Partitioned files", "[partition][io]")
+{
+    using namespace mshio;
+
+    // Nodes 3 and 4 lie on the partition boundary, and partition 2 holds a
+    // ghost copy of element 2.
+    const std::vector<std::string> contents = {
+        "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n"
+        "$Nodes\n1 4 1 4\n2 1 0 4\n1\n2\n3\n4\n0 0 0\n1 0 0\n1 1 0\n0 1 0\n$EndNodes\n"
+        "$Elements\n1 2 1 2\n2 1 2 2\n1 1 2 3\n2 1 3 4\n$EndElements\n"
+        "$NodeData\n1\n\"u\"\n1\n0.0\n4\n0\n1\n4\n1\n1 1.0\n2 2.0\n3 3.0\n4 4.0\n$EndNodeData\n",
+        "$MeshFormat\n4.1 0 8\n$EndMeshFormat\n"
+        "$Nodes\n1 4 3 6\n2 2 0 4\n3\n4\n5\n6\n1 1 0\n0 1 0\n1 2 0\n0 2 0\n$EndNodes\n"
+        "$Elements\n2 3 2 4\n2 1 2 1\n2 1 3 4\n2 2 2 2\n3 4 3 5\n4 4 5 6\n$EndElements\n"
+        "$NodeData\n1\n\"u\"\n1\n0.0\n4\n0\n1\n4\n2\n3 3.0\n4 4.0\n5 5.0\n6 6.0\n$EndNodeData\n"};
+    for (size_t i = 0; i < contents.size(); i++) {
+        std::ofstream fout("partitioned_" + std::to_string(i + 1) + ".msh");
+        fout << contents[i];
+    }
+
+    LoadOptions options;
+    const std::vector<MshSpec> partitions = load_msh_partitions("partitioned.msh", options);
+    REQUIRE(partitions.size() == 2);
+
+    const MshSpec spec = load_partitioned_msh("partitioned", options);
+    const auto& node_blocks = spec.nodes.entity_blocks;
+    REQUIRE(spec.nodes.num_entity_blocks == 2);
+    REQUIRE(spec.nodes.num_nodes == 6);
+    REQUIRE(spec.nodes.min_node_tag == 1);
+    REQUIRE(spec.nodes.max_node_tag == 6);
+    REQUIRE(node_blocks[0].tags == Vector<size_t>{1, 2, 3, 4});
+    REQUIRE(node_blocks[1].entity_tag == 2);
+    REQUIRE(node_blocks[1].tags == Vector<size_t>{5, 6});
+    REQUIRE(node_blocks[1].data == Vector<double>{1, 2, 0, 0, 2, 0});
+
+    const auto& element_blocks = spec.elements.entity_blocks;
+    REQUIRE(spec.elements.num_entity_blocks == 2);
+    REQUIRE(spec.elements.num_elements == 4);
+    REQUIRE(element_blocks[0].data == Vector<size_t>{1, 1, 2, 3, 2, 1, 3, 4});
+    REQUIRE(element_blocks[1].data == Vector<size_t>{3, 4, 3, 5, 4, 4, 5, 6});
+
+    REQUIRE(spec.node_data.size() == 1);
+    const Data& data = spec.node_data[0];
+    REQUIRE(data.header.int_tags == Vector<int>{0, 1, 6});
+    REQUIRE(data.entries.size() == 6);
+    for (size_t i = 0; i < 6; i++) {
+        REQUIRE(data.entries[i].tag == i + 1);
+        REQUIRE(data.entries[i].data == Vector<double>{static_cast<double>(i + 1)});
+    }
+    validate_spec(spec);
+
+    // The result does not depend on the number of threads.
+    options.num_threads = 4;
+    ASSERT_SAME(spec, load_partitioned_msh("partitioned.msh", options));
+
+    options.compact_data = true;
+    const MshSpec compact = load_partitioned_msh("partitioned.msh", options);
+    REQUIRE(compact.node_data[0].tags == Vector<size_t>{1, 2, 3, 4, 5, 6});
+    REQUIRE(compact.node_data[0].values == Vector<double>{1, 2, 3, 4, 5, 6});
+
+    for (size_t i = 0; i < contents.size(); i++) {
+        std::remove(("partitioned_" + std::to_string(i + 1) + ".msh").c_str());
+    }
+    REQUIRE_THROWS(load_partitioned_msh("partitioned.msh"));
+
+    SECTION("Large partitions")
+    {
+        // Partitions sharing half of their nodes, enough of them to be merged
+        // by several threads.
+        constexpr size_t n = 50000;
+        for (size_t i = 0; i < 2; i++) {
+            MshSpec part;
+            part.mesh_format.file_type = 1;
+            part.nodes.num_entity_blocks = 1;
+            part.nodes.num_nodes = n;
+            part.nodes.min_node_tag = i * n / 2 + 1;
+            part.nodes.max_node_tag = i * n / 2 + n;
+            part.nodes.entity_blocks.resize(1);
+            auto& block = part.nodes.entity_blocks[0];
+            block.entity_dim = 2;
+            block.entity_tag = 1;
+            block.num_nodes_in_block = n;
+            for (size_t j = 0; j < n; j++) {
+                const size_t tag = part.nodes.max_node_tag - j;
+                block.tags.push_back(tag);
+                block.data.insert(block.data.end(), {static_cast<double>(tag), 0, 0});
+            }
+            save_msh("partitioned_large_" + std::to_string(i + 1) + ".msh", part);
+        }
+
+        options = LoadOptions();
+        const MshSpec merged = load_partitioned_msh("partitioned_large.msh", options);
+        REQUIRE(merged.nodes.num_nodes == 3 * n / 2);
+        REQUIRE(merged.nodes.min_node_tag == 1);
+        REQUIRE(merged.nodes.max_node_tag == 3 * n / 2);
+        const auto& tags = merged.nodes.entity_blocks[0].tags;
+        REQUIRE(tags.front() == n);
+        REQUIRE(tags[n] == 3 * n / 2);
+        REQUIRE(tags.back() == n + 1);
+        options.num_threads = 4;
+        ASSERT_SAME(merged, load_partitioned_msh("partitioned_large.msh", options));
+
+        for (size_t i = 0; i < 2; i++) {
+            std::remove(("partitioned_large_" + std::to_string(i + 1) + ".msh").c_str());
+        }
+    }
+}
+
+TEST_CASE("Partitioned entities and ghost elements", "[partition][io]")
+{
+    using namespace mshio;
+
+    // Two partitions of surface 1 with interface curve 21. Partition 1 sees
+    // element 2 of partition 2 through ghost entity 13.
+    MshSpec spec;
+    spec.entities.surfaces.resize(1);
+    spec.entities.surfaces[0].tag = 1;
+
+    auto& partitioned = spec.partitioned_entities;
+    partitioned.num_partitions = 2;
+    partitioned.ghost_entities = {{13, 1}};
+    partitioned.curves.resize(1);
+    partitioned.curves[0].tag = 21;
+    partitioned.curves[0].parent_dim = 2;
+    partitioned.curves[0].parent_tag = 1;
+    partitioned.curves[0].partition_tags = {1, 2};
+    partitioned.curves[0].max_x = 1.0 / 3.0; // Needs all digits to round-trip.
+    partitioned.curves[0].boundary_tags = {-31, 32};
+    partitioned.surfaces.resize(3);
+    for (int i = 0; i < 3; i++) {
+        auto& surface = partitioned.surfaces[static_cast<size_t>(i)];
+        surface.tag = 11 + i;
+        surface.parent_dim = 2;
+        surface.parent_tag = 1;
+        // The ghost entity is only selected as such.
+        if (i < 2) surface.partition_tags = {i + 1};
+        surface.physical_group_tags = {100};
+        surface.boundary_tags = {21};
+    }
+    spec.ghost_elements.resize(2);
+    for (size_t i = 0; i < 2; i++) {
+        spec.ghost_elements[i].tag = i + 1;
+        spec.ghost_elements[i].partition = static_cast<int>(i + 1);
+        spec.ghost_elements[i].ghost_partition_tags = {static_cast<int>(2 - i)};
+    }
+
+    const std::vector<std::pair<int, int>> node_entities = {{2, 11}, {1, 21}, {2, 12}};
+    spec.nodes.num_entity_blocks = 3;
+    spec.nodes.num_nodes = 6;
+    spec.nodes.min_node_tag = 1;
+    spec.nodes.max_node_tag = 6;
+    spec.nodes.entity_blocks.resize(3);
+    for (size_t i = 0; i < 3; i++) {
+        auto& block = spec.nodes.entity_blocks[i];
+        block.entity_dim = node_entities[i].first;
+        block.entity_tag = node_entities[i].second;
+        block.num_nodes_in_block = 2;
+        block.tags = {2 * i + 1, 2 * i + 2};
+        block.data = {0.0, static_cast<double>(i), 0.0, 1.0, static_cast<double>(i), 0.0};
+    }
+
+    const std::vector<int> element_entities = {11, 12, 13};
+    const std::vector<Vector<size_t>> element_data = {
+        {1, 1, 3, 4}, {2, 3, 5, 4}, {2, 3, 5, 4}};
+    spec.elements.num_entity_blocks = 3;
+    spec.elements.num_elements = 3;
+    spec.elements.min_element_tag = 1;
+    spec.elements.max_element_tag = 2;
+    spec.elements.entity_blocks.resize(3);
+    for (size_t i = 0; i < 3; i++) {
+        auto& block = spec.elements.entity_blocks[i];
+        block.entity_dim = 2;
+        block.entity_tag = element_entities[i];
+        block.element_type = 2;
+        block.num_elements_in_block = 1;
+        block.data = element_data[i];
+    }
+
+    for (int file_type : {0, 1}) {
+        spec.mesh_format.file_type = file_type;
+        std::stringstream data;
+        save_msh(data, spec);
+        const std::string contents = data.str();
+
+        data.clear();
+        data.str(contents);
+        MshSpec spec2 = load_msh(data);
+        ASSERT_SAME(spec, spec2);
+        const auto& partitioned2 = spec2.partitioned_entities;
+        REQUIRE(partitioned2.num_partitions == 2);
+        REQUIRE(partitioned2.ghost_entities.size() == 1);
+        REQUIRE(partitioned2.ghost_entities[0].tag == 13);
+        REQUIRE(partitioned2.ghost_entities[0].partition == 1);
+        REQUIRE(partitioned2.points.empty());
+        REQUIRE(partitioned2.curves.size() == 1);
+        REQUIRE(partitioned2.curves[0].partition_tags == Vector<int>{1, 2});
+        REQUIRE(partitioned2.curves[0].max_x == 1.0 / 3.0);
+        REQUIRE(partitioned2.curves[0].boundary_tags == Vector<int>{-31, 32});
+        REQUIRE(partitioned2.surfaces.size() == 3);
+        REQUIRE(partitioned2.surfaces[1].tag == 12);
+        REQUIRE(partitioned2.surfaces[1].parent_tag == 1);
+        REQUIRE(partitioned2.surfaces[1].physical_group_tags == Vector<int>{100});
+        REQUIRE(spec2.ghost_elements.size() == 2);
+        REQUIRE(spec2.ghost_elements[1].tag == 2);
+        REQUIRE(spec2.ghost_elements[1].partition == 2);
+        REQUIRE(spec2.ghost_elements[1].ghost_partition_tags == Vector<int>{1});
+
+        // Partition 1 has its surface, the interface and its ghost elements.
+        LoadOptions options;
+        options.partition = 1;
+        data.clear();
+        data.str(contents);
+        spec2 = load_msh(data, options);
+        REQUIRE(spec2.nodes.num_entity_blocks == 2);
+        REQUIRE(spec2.nodes.num_nodes == 4);
+        REQUIRE(spec2.nodes.min_node_tag == 1);
+        REQUIRE(spec2.nodes.max_node_tag == 4);
+        REQUIRE(spec2.elements.num_entity_blocks == 2);
+        REQUIRE(spec2.elements.entity_blocks[1].entity_tag == 13);
+        REQUIRE(spec2.elements.num_elements == 2);
+        REQUIRE(spec2.ghost_elements.size() == 2);
+
+        options.partition = 2;
+        data.clear();
+        data.str(contents);
+        spec2 = load_msh(data, options);
+        REQUIRE(spec2.nodes.num_entity_blocks == 2);
+        REQUIRE(spec2.nodes.min_node_tag == 3);
+        REQUIRE(spec2.nodes.max_node_tag == 6);
+        REQUIRE(spec2.elements.num_entity_blocks == 1);
+        REQUIRE(spec2.elements.entity_blocks[0].entity_tag == 12);
+        REQUIRE(spec2.partitioned_entities.surfaces.size() == 3);
+        validate_spec(spec2);
+
+        options.partition = 0;
+        options.skipped_sections = {"$PartitionedEntities", "$GhostElements"};
+        data.clear();
+        data.str(contents);
+        spec2 = load_msh(data, options);
+        REQUIRE(spec2.partitioned_entities.empty());
+        REQUIRE(spec2.ghost_elements.empty());
+        ASSERT_SAME_NODES(spec, spec2);
+
+        // Selecting a partition requires the partitioned entities.
+        options.partition = 1;
+        data.clear();
+        data.str(contents);
+        REQUIRE_THROWS_AS(load_msh(data, options), InvalidFormat);
+
+        // MshFile loads them before the nodes and elements of a partition.
+        const std::string filename = "partitioned_entities.msh";
+        {
+            std::ofstream fout(filename, std::ios::binary);
+            fout << contents;
+        }
+        options.skipped_sections.clear();
+        {
+            MshFile file(filename, options);
+            const Nodes nodes = file.load_nodes();
+            REQUIRE(nodes.num_entity_blocks == 2);
+            REQUIRE(nodes.num_nodes == 4);
+            const Elements elements = file.load_elements();
+            REQUIRE(elements.num_entity_blocks == 2);
+            REQUIRE(elements.entity_blocks[1].entity_tag == 13);
+        }
+        std::remove(filename.c_str());
+    }
+
+    // A ghost entity without a partitioned entity is skipped.
+    spec.mesh_format.file_type = 0;
+    spec.partitioned_entities.surfaces.pop_back();
+    std::stringstream data;
+    save_msh(data, spec);
+    LoadOptions options;
+    options.partition = 1;
+    const MshSpec spec2 = load_msh(data, options);
+    REQUIRE(spec2.elements.num_entity_blocks == 1);
+    REQUIRE(spec2.elements.entity_blocks[0].entity_tag == 11);
+}
+
+TEST_CASE("Node index", "[node_index]")
+{
+    using namespace mshio;
+
+    size_t num_threads = 1;
+    SECTION("Serial")
+    {
+        num_threads = 1;
+    }
+    SECTION("Parallel")
+    {
+        num_threads = 4;
+    }
+
+    // Two blocks with enough nodes to span several build chunks. The second
+    // block is parametric, so its coordinates have a stride of 5.
+    auto make_nodes = [](size_t tag_step) {
+        Nodes nodes;
+        nodes.entity_blocks.resize(2);
+        NodeBlock& block0 = nodes.entity_blocks[0];
+        block0.entity_dim = 3;
+        block0.num_nodes_in_block = 100000;
+        for (size_t i = 0; i < block0.num_nodes_in_block; i++) {
+            block0.tags.push_back(1 + 2 * i * tag_step);
+            block0.data.insert(block0.data.end(), {double(i), 0, 1});
+        }
+        NodeBlock& block1 = nodes.entity_blocks[1];
+        block1.entity_dim = 2;
+        block1.parametric = 1;
+        block1.num_nodes_in_block = 100000;
+        for (size_t i = 0; i < block1.num_nodes_in_block; i++) {
+            block1.tags.push_back(2 + 2 * i * tag_step);
+            block1.data.insert(block1.data.end(), {double(i), 1, 2, 0.5, 0.5});
+        }
+        nodes.num_entity_blocks = 2;
+        nodes.num_nodes = 200000;
+        return nodes;
+    };
+
+    auto check_index = [](const NodeIndex& index, size_t tag_step) {
+        REQUIRE(index.size() == 200000);
+        for (size_t i = 0; i < 100000; i += 997) {
+            const auto location = index.find(1 + 2 * i * tag_step);
+            REQUIRE(location.valid());
+            REQUIRE(location.block == 0);
+            REQUIRE(location.index == i);
+            const double* xyz = index.coords(2 + 2 * i * tag_step);
+            REQUIRE(xyz != nullptr);
+            REQUIRE(std::vector<double>(xyz, xyz + 3) == std::vector<double>{double(i), 1, 2});
+        }
+        REQUIRE(!index.contains(0));
+        REQUIRE(!index.contains(1000000000000));
+        REQUIRE(!index.find(2 + 200000 * tag_step).valid());
+        REQUIRE(index.coords(0) == nullptr);
+
+        ElementBlock block;
+        block.element_type = 1;
+        block.num_elements_in_block = 2;
+        block.data = {1, 1, 2, 2, 1 + 2 * tag_step, 2 + 2 * tag_step};
+        REQUIRE(index.gather_coords(block, 2) ==
+                std::vector<double>{0, 0, 1, 0, 1, 2, 1, 0, 1, 1, 1, 2});
+
+        const std::vector<size_t> tags = {2, 2 + 200000 * tag_step};
+        std::vector<double> coords(6);
+        REQUIRE_THROWS_AS(index.gather_coords(tags.data(), 2, coords.data()), CorruptData);
+    };
+
+    SECTION("Dense tags")
+    {
+        Nodes nodes = make_nodes(1);
+        NodeIndex index(nodes, num_threads);
+        REQUIRE(index.is_dense());
+        check_index(index, 1);
+    }
+    SECTION("Sparse tags")
+    {
+        Nodes nodes = make_nodes(1000003);
+        NodeIndex index(nodes, num_threads);
+        REQUIRE(!index.is_dense());
+        check_index(index, 1000003);
+    }
+    SECTION("Duplicated tags")
+    {
+        // Duplicates in different build chunks resolve to the last occurrence.
+        for (size_t tag_step : {size_t(1), size_t(1000003)}) {
+            Nodes nodes = make_nodes(tag_step);
+            auto& tags0 = nodes.entity_blocks[0].tags;
+            auto& tags1 = nodes.entity_blocks[1].tags;
+            tags0[70000] = tags0[3];
+            tags1[99999] = tags0[5];
+            NodeIndex index(nodes, num_threads);
+            REQUIRE(index.is_dense() == (tag_step == 1));
+            const auto location = index.find(tags0[3]);
+            REQUIRE(location.block == 0);
+            REQUIRE(location.index == 70000);
+            const auto location2 = index.find(tags0[5]);
+            REQUIRE(location2.block == 1);
+            REQUIRE(location2.index == 99999);
+        }
+    }
+    SECTION("Empty")
+    {
+        Nodes nodes;
+        NodeIndex index(nodes, num_threads);
+        REQUIRE(index.size() == 0);
+        REQUIRE(!index.contains(1));
+    }
+}
+
+TEST_CASE("Flatten", "[flatten]")
+{
+    using namespace mshio;
+
+    size_t num_threads = 1;
+    SECTION("Serial")
+    {
+        num_threads = 1;
+    }
+    SECTION("Parallel")
+    {
+        num_threads = 4;
+    }
+
+    // Sparse node tags, two element types and a physical group.
+    std::stringstream contents(
+        "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n"
+        "$Nodes\n4\n1 0 0 0\n2000000000 1 0 0\n7 1 1 0\n1000000000 0 1 0\n"
+        "$EndNodes\n"
+        "$Elements\n3\n"
+        "4 2 2 9 2 1 2000000000 7\n"
+        "5 1 2 0 3 7 1000000000\n"
+        "6 2 2 9 2 1 7 1000000000\n"
+        "$EndElements\n");
+    const MshSpec spec = load_msh(contents);
+    const FlatMesh mesh = flatten(spec, num_threads);
+
+    REQUIRE(mesh.num_nodes == 4);
+    REQUIRE(mesh.node_tags == std::vector<size_t>{1, 2000000000, 7, 1000000000});
+    REQUIRE(mesh.coords == std::vector<double>{0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0});
+
+    REQUIRE(mesh.element_types.size() == 2);
+    const FlatElements& triangles = mesh.element_types[0];
+    REQUIRE(triangles.element_type == 2);
+    REQUIRE(triangles.nodes_per_element == 3);
+    REQUIRE(triangles.num_elements == 2);
+    REQUIRE(triangles.connectivity == std::vector<size_t>{0, 1, 2, 0, 2, 3});
+    REQUIRE(triangles.tags == std::vector<size_t>{4, 6});
+    REQUIRE(triangles.entity_tags == std::vector<int>{2, 2});
+    REQUIRE(triangles.physical_tags == std::vector<int>{9, 9});
+
+    const FlatElements& lines = mesh.element_types[1];
+    REQUIRE(lines.element_type == 1);
+    REQUIRE(lines.connectivity == std::vector<size_t>{2, 3});
+    REQUIRE(lines.tags == std::vector<size_t>{5});
+    REQUIRE(lines.entity_tags == std::vector<int>{3});
+    REQUIRE(lines.physical_tags == std::vector<int>{0});
+
+    // Elements must refer to existing nodes.
+    MshSpec invalid = spec;
+    invalid.elements.entity_blocks[0].data[1] = 3;
+    REQUIRE_THROWS_AS(flatten(invalid, num_threads), CorruptData);
+}
+
+TEST_CASE("Save views", "[view][io]")
+{
+    using namespace mshio;
+
+    MeshFormat format;
+    SECTION("v4.1")
+    {
+        format.version = "4.1";
+        SECTION("ASCII")
+        {
+            format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            format.file_type = 1;
+        }
+    }
+    SECTION("v2.2")
+    {
+        format.version = "2.2";
+        SECTION("ASCII")
+        {
+            format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            format.file_type = 1;
+        }
+    }
+
+    // Caller owned arrays: consecutive tags and 0-based connectivity.
+    const std::vector<double> coords = {0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0};
+    const std::vector<size_t> triangles = {0, 1, 2, 0, 2, 3};
+    const std::vector<size_t> triangle_tags = {10, 20};
+    const std::vector<double> values = {0.5, 1.5, 2.5, 3.5};
+
+    MshSpecView view;
+    view.mesh_format = format;
+    view.node_blocks.resize(1);
+    view.node_blocks[0].entity_dim = 2;
+    view.node_blocks[0].entity_tag = 1;
+    view.node_blocks[0].num_nodes_in_block = 4;
+    view.node_blocks[0].data = coords.data();
+    view.element_blocks.resize(1);
+    view.element_blocks[0].entity_dim = 2;
+    view.element_blocks[0].entity_tag = 1;
+    view.element_blocks[0].element_type = 2;
+    view.element_blocks[0].num_elements_in_block = 2;
+    view.element_blocks[0].tags = triangle_tags.data();
+    view.element_blocks[0].connectivity = triangles.data();
+    view.element_blocks[0].node_offset = 1;
+    view.node_data.resize(1);
+    view.node_data[0].header.string_tags = {"u"};
+    view.node_data[0].header.real_tags = {0};
+    view.node_data[0].header.int_tags = {0, 1, 4};
+    view.node_data[0].num_entries = 4;
+    view.node_data[0].values = values.data();
+
+    // The same mesh, copied into a MshSpec.
+    MshSpec spec;
+    spec.mesh_format = format;
+    spec.nodes.num_entity_blocks = 1;
+    spec.nodes.num_nodes = 4;
+    spec.nodes.min_node_tag = 1;
+    spec.nodes.max_node_tag = 4;
+    spec.nodes.entity_blocks.resize(1);
+    spec.nodes.entity_blocks[0].entity_dim = 2;
+    spec.nodes.entity_blocks[0].entity_tag = 1;
+    spec.nodes.entity_blocks[0].num_nodes_in_block = 4;
+    spec.nodes.entity_blocks[0].tags = {1, 2, 3, 4};
+    spec.nodes.entity_blocks[0].data.assign(coords.begin(), coords.end());
+    spec.elements.num_entity_blocks = 1;
+    spec.elements.num_elements = 2;
+    spec.elements.min_element_tag = 10;
+    spec.elements.max_element_tag = 20;
+    spec.elements.entity_blocks.resize(1);
+    spec.elements.entity_blocks[0].entity_dim = 2;
+    spec.elements.entity_blocks[0].entity_tag = 1;
+    spec.elements.entity_blocks[0].element_type = 2;
+    spec.elements.entity_blocks[0].num_elements_in_block = 2;
+    spec.elements.entity_blocks[0].data = {10, 1, 2, 3, 20, 1, 3, 4};
+    spec.node_data.resize(1);
+    spec.node_data[0].header = view.node_data[0].header;
+    for (size_t i = 0; i < 4; i++) {
+        DataEntry entry;
+        entry.tag = i + 1;
+        entry.data = {values[i]};
+        spec.node_data[0].entries.push_back(entry);
+    }
+
+    // Compare the files once loaded and saved again, as the streaming writer
+    // pads its headers.
+    auto resave = [](std::stringstream& contents) {
+        std::stringstream out;
+        save_msh(out, load_msh(contents));
+        return out.str();
+    };
+    std::stringstream expected;
+    save_msh(expected, spec);
+
+    std::stringstream contents;
+    SaveOptions options;
+    options.num_threads = 2;
+    save_msh(contents, view, options);
+#ifndef MSHIO_EXT_NANOSPLINE
+    REQUIRE(contents.str() == expected.str());
+#endif
+    const std::string expected_contents = resave(expected);
+    REQUIRE(resave(contents) == expected_contents);
+
+    std::stringstream streamed;
+    {
+        MshWriter writer(streamed, format);
+        writer.begin_nodes();
+        writer.write_node_block(view.node_blocks[0]);
+        writer.end_nodes();
+        writer.begin_elements();
+        writer.write_element_block(view.element_blocks[0]);
+        writer.end_elements();
+    }
+    spec.node_data.clear();
+    std::stringstream expected_mesh;
+    save_msh(expected_mesh, spec);
+    REQUIRE(resave(streamed) == resave(expected_mesh));
+
+    // The number of entries of data views must be consistent.
+    view.node_data[0].header.int_tags[2] = 3;
+    std::stringstream invalid;
+    REQUIRE_THROWS_AS(save_msh(invalid, view), InvalidFormat);
+}
+
+TEST_CASE("Validation", "[validate]")
+{
+    using namespace mshio;
+
+    size_t num_threads = 1;
+    SECTION("Serial")
+    {
+        num_threads = 1;
+    }
+    SECTION("Parallel")
+    {
+        num_threads = 4;
+    }
+
+    for (const char* filename : {"/test_2.2_ascii.msh", "/test_4.1_bin.msh"}) {
+        const MshSpec valid = load_msh(std::string(MSHIO_DATA_DIR) + filename);
+        REQUIRE(check_spec(valid, num_threads).valid());
+    }
+
+    auto count = [](const ValidationReport& report, IssueKind kind) {
+        return std::count_if(report.issues.begin(),
+            report.issues.end(),
+            [&](const ValidationIssue& issue) { return issue.kind == kind; });
+    };
+
+    // Sparse node tags are kept in a sorted array, dense ones in a bitmap.
+    for (size_t sparse : {0, 1}) {
+        const std::string big_tag = sparse ? "2000000000" : "2";
+        std::stringstream contents(
+            "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n"
+            "$PhysicalNames\n1\n2 9 \"domain\"\n$EndPhysicalNames\n"
+            "$Nodes\n4\n1 0 0 0\n" + big_tag + " 1 0 0\n7 1 1 0\n8 0 1 0\n$EndNodes\n"
+            "$Elements\n2\n"
+            "4 2 2 9 2 1 " + big_tag + " 7\n"
+            "5 2 2 9 2 1 7 8\n"
+            "$EndElements\n"
+            "$NodeData\n1\n\"u\"\n1\n0.0\n3\n0\n1\n3\n1 0.5\n7 1.5\n8 2.5\n$EndNodeData\n");
+        MshSpec spec = load_msh(contents);
+        REQUIRE(check_spec(spec, num_threads).valid());
+
+        // Duplicate tags, a dangling node and an unknown data tag.
+        spec.nodes.entity_blocks[0].tags[3] = 7;
+        spec.elements.entity_blocks[0].data[4] = 4;
+        spec.node_data[0].entries[0].tag = 3;
+        spec.physical_groups.push_back({1, 10, "unused"});
+        const ValidationReport report = check_spec(spec, num_threads);
+        REQUIRE(!report.valid());
+        REQUIRE(report.num_issues == report.issues.size());
+        REQUIRE(count(report, IssueKind::DuplicateNodeTag) == 1);
+        REQUIRE(count(report, IssueKind::DuplicateElementTag) == 1);
+        REQUIRE(count(report, IssueKind::MissingNode) == 1);
+        REQUIRE(count(report, IssueKind::MissingPhysicalGroup) == 1);
+        REQUIRE(count(report, IssueKind::InvalidData) == 2); // Tags 3 and 8.
+        REQUIRE(report.num_errors == 3);
+        for (const ValidationIssue& issue : report.issues) {
+            const bool is_warning = issue.kind == IssueKind::MissingPhysicalGroup ||
+                                    issue.kind == IssueKind::InvalidData;
+            REQUIRE((issue.severity == IssueSeverity::Warning) == is_warning);
+        }
+
+        // Only the first issues are kept, in the same order.
+        const ValidationReport first = check_spec(spec, num_threads, 2);
+        REQUIRE(first.num_issues == report.num_issues);
+        REQUIRE(first.issues.size() == 2);
+        REQUIRE(first.issues[1].message == report.issues[1].message);
+        REQUIRE_THROWS_AS(validate_spec(spec, num_threads), CorruptData);
+
+        // Warnings alone do not make validate_spec() throw.
+        MshSpec unused_group = load_msh(std::string(MSHIO_DATA_DIR) + "/test_2.2_ascii.msh");
+        unused_group.physical_groups.push_back({1, 10, "unused"});
+        unused_group.elements.entity_blocks[0].entity_dim++;
+        const ValidationReport warnings = check_spec(unused_group, num_threads);
+        REQUIRE(!warnings.valid());
+        REQUIRE(!warnings.has_errors());
+        validate_spec(unused_group, num_threads);
+    }
+}
+
+TEST_CASE("Load phases", "[io]")
+{
+    using namespace mshio;
+
+    std::vector<std::string> phases;
+    LoadOptions options;
+    options.skipped_sections = {"$Entities"};
+    options.on_phase = [&](const std::string& phase, bool begin) {
+        phases.push_back((begin ? "+" : "-") + phase);
+    };
+    load_msh(MSHIO_DATA_DIR "/test_4.1_bin.msh", options);
+
+    // Skipped sections are not reported.
+    REQUIRE(std::find(phases.begin(), phases.end(), "+$Entities") == phases.end());
+    REQUIRE(phases.front() == "+$MeshFormat");
+    REQUIRE(std::find(phases.begin(), phases.end(), "-$Nodes") ==
+            std::find(phases.begin(), phases.end(), "+$Nodes") + 1);
+    REQUIRE(phases[phases.size() - 2] == "+post_process");
+    REQUIRE(phases.back() == "-post_process");
+}
+
+#ifdef MSHIO_WITH_PMR
+namespace {
+
+// Memory resource recording the largest number of threads using it at once.
+class ProbeResource : public std::pmr::memory_resource
+{
+public:
+    int max_concurrency() const { return m_max_active; }
+
+private:
+    template <typename Fn>
+    auto probe(Fn&& fn)
+    {
+        const int active = ++m_active;
+        int max_active = m_max_active;
+        while (active > max_active && !m_max_active.compare_exchange_weak(max_active, active)) {
+        }
+        // Give other threads a chance to overlap.
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+        auto result = fn();
+        m_active--;
+        return result;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        return probe([&]() {
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        });
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        probe([&]() {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            return 0;
+        });
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::atomic<int> m_active{0};
+    std::atomic<int> m_max_active{0};
+};
+
+} // namespace
+
+TEST_CASE("Memory resource", "[pmr][io]")
+{
+    using namespace mshio;
+
+    std::string filename;
+    SECTION("v4.1")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_bin.msh";
+    }
+    SECTION("v2.2")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_bin.msh";
+    }
+
+    // Memory resources need not be thread-safe, so only the calling thread
+    // allocates from them.
+    ProbeResource probe;
+    LoadOptions options;
+    options.memory_resource = &probe;
+    options.num_threads = 8;
+    ASSERT_SAME(load_msh(filename, options), load_msh(filename));
+    REQUIRE(probe.max_concurrency() == 1);
+
+    // Partitions are loaded concurrently, from the default resource.
+    const MshSpec part = load_msh(filename);
+    save_msh("pmr_partitioned_1.msh", part);
+    save_msh("pmr_partitioned_2.msh", part);
+    const std::vector<MshSpec> partitions = load_msh_partitions("pmr_partitioned.msh", options);
+    REQUIRE(partitions.size() == 2);
+    REQUIRE(probe.max_concurrency() == 1);
+    for (const MshSpec& partition : partitions) {
+        REQUIRE(partition.nodes.entity_blocks.get_allocator().resource() ==
+                std::pmr::get_default_resource());
+        ASSERT_SAME(partition, part);
+    }
+    std::remove("pmr_partitioned_1.msh");
+    std::remove("pmr_partitioned_2.msh");
+
+    std::pmr::monotonic_buffer_resource arena;
+    options = LoadOptions();
+    options.memory_resource = &arena;
+    const MshSpec spec = load_msh(filename, options);
+    ASSERT_SAME(spec, load_msh(filename));
+
+    // Nested containers allocate from the same resource.
+    REQUIRE(spec.nodes.entity_blocks.get_allocator().resource() == &arena);
+    REQUIRE(spec.elements.entity_blocks.get_allocator().resource() == &arena);
+    for (const auto& block : spec.nodes.entity_blocks) {
+        REQUIRE(block.tags.get_allocator().resource() == &arena);
+        REQUIRE(block.data.get_allocator().resource() == &arena);
+    }
+    for (const auto& block : spec.elements.entity_blocks) {
+        REQUIRE(block.data.get_allocator().resource() == &arena);
+    }
+    for (const auto& surface : spec.entities.surfaces) {
+        REQUIRE(surface.boundary_curve_tags.get_allocator().resource() == &arena);
+    }
+}
+#endif
+
+#if defined(MSHIO_WITH_ZLIB) || defined(MSHIO_WITH_ZSTD)
+TEST_CASE("Compressed files", "[compression][io]")
+{
+    using namespace mshio;
+
+    MshSpec spec = load_msh(MSHIO_DATA_DIR "/test_4.1_ascii.msh");
+    std::string filename;
+#ifdef MSHIO_WITH_ZLIB
+    SECTION("gzip")
+    {
+        filename = "test_compressed.msh.gz";
+    }
+#endif
+#ifdef MSHIO_WITH_ZSTD
+    SECTION("zstd")
+    {
+        filename = "test_compressed.msh.zst";
+    }
+#endif
+    for (int file_type : {0, 1}) {
+        spec.mesh_format.file_type = file_type;
+
+        SaveOptions options;
+        options.num_threads = 2;
+        save_msh(filename, spec, options);
+
+        std::stringstream expected;
+        save_msh(expected, spec);
+        std::ifstream fin(filename, std::ios::binary);
+        const std::string contents(
+            (std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+        REQUIRE(contents.size() > 0);
+        REQUIRE(contents != expected.str());
+
+        ASSERT_SAME(spec, load_msh(filename));
+
+        // Every file based entry point decompresses, whatever the I/O options.
+        LoadOptions load_options;
+        load_options.read_ahead_buffer_size = 1 << 12;
+        ASSERT_SAME(spec, load_msh(filename, load_options));
+        load_options.use_io_uring = true;
+        ASSERT_SAME(spec, load_msh(filename, load_options));
+        MshReader reader(filename, load_options);
+        REQUIRE(reader.mesh_format().file_type == file_type);
+        size_t num_nodes = 0;
+        while (const NodeBlock* block = reader.next_node_block()) {
+            num_nodes += block->num_nodes_in_block;
+        }
+        REQUIRE(num_nodes == spec.nodes.num_nodes);
+        MshFile file(filename, load_options);
+        REQUIRE(file.load_elements().num_elements == spec.elements.num_elements);
+        REQUIRE(file.load_nodes().num_nodes == spec.nodes.num_nodes);
+
+        // Compression is detected from the content, not the name.
+        std::stringstream in(contents);
+        ASSERT_SAME(spec, load_msh(in));
+
+        // Truncated files are reported.
+        std::stringstream truncated(contents.substr(0, contents.size() / 2));
+        REQUIRE_THROWS_AS(load_msh(truncated), CorruptData);
+    }
+    std::remove(filename.c_str());
+}
+#endif
+
+TEST_CASE("Streaming visitor", "[visitor][io]")
+{
+    using namespace mshio;
+
+    // Rebuilds a MshSpec from the callbacks.
+    struct SpecBuilder : public MshVisitor
+    {
+        MshSpec spec;
+        size_t num_data_entries = 0;
+
+        void on_mesh_format(const MeshFormat& format) override { spec.mesh_format = format; }
+        void on_physical_groups(const Vector<PhysicalGroup>& groups) override
+        {
+            spec.physical_groups = groups;
+        }
+        void on_entities(const Entities& entities) override { spec.entities = entities; }
+
+        void on_node_block(NodeBlock& block) override { spec.nodes.entity_blocks.push_back(block); }
+        void on_nodes_end(const Nodes& header) override
+        {
+            spec.nodes.num_entity_blocks = header.num_entity_blocks;
+            spec.nodes.num_nodes = header.num_nodes;
+            spec.nodes.min_node_tag = header.min_node_tag;
+            spec.nodes.max_node_tag = header.max_node_tag;
+        }
+
+        void on_element_block(ElementBlock& block) override
+        {
+            spec.elements.entity_blocks.push_back(block);
+        }
+        void on_elements_end(const Elements& header) override
+        {
+            spec.elements.num_entity_blocks = header.num_entity_blocks;
+            spec.elements.num_elements = header.num_elements;
+            spec.elements.min_element_tag = header.min_element_tag;
+            spec.elements.max_element_tag = header.max_element_tag;
+        }
+
+        void on_data_begin(DataKind kind, const DataHeader& header) override
+        {
+            data(kind).emplace_back();
+            data(kind).back().header = header;
+        }
+        void on_data_entry(DataKind kind, DataEntry& entry) override
+        {
+            data(kind).back().entries.push_back(entry);
+            num_data_entries++;
+        }
+
+        Vector<Data>& data(DataKind kind)
+        {
+            switch (kind) {
+            case DataKind::NodeData: return spec.node_data;
+            case DataKind::ElementData: return spec.element_data;
+            default: return spec.element_node_data;
+            }
+        }
+    };
+
+    std::string filename;
+    SECTION("v4.1 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_ascii.msh";
+    }
+    SECTION("v4.1 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_bin.msh";
+    }
+    SECTION("v2.2 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_ascii.msh";
+    }
+    SECTION("v2.2 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_bin.msh";
+    }
+
+    const MshSpec spec = load_msh(filename);
+    SpecBuilder builder;
+    load_msh(filename, builder);
+    const MshSpec& spec2 = builder.spec;
+
+    REQUIRE(spec2.mesh_format.version == spec.mesh_format.version);
+    REQUIRE(spec2.mesh_format.file_type == spec.mesh_format.file_type);
+    REQUIRE(spec2.physical_groups.size() == spec.physical_groups.size());
+    REQUIRE(spec2.entities.volumes.size() == spec.entities.volumes.size());
+    ASSERT_SAME_ELEMENTS(spec, spec2);
+    ASSERT_SAME_NODE_DATA(spec, spec2);
+    ASSERT_SAME_ELEMENT_DATA(spec, spec2);
+    ASSERT_SAME_ELEMENT_NODE_DATA(spec, spec2);
+    size_t num_data_entries = 0;
+    for (const auto& data : spec.node_data) num_data_entries += data.entries.size();
+    for (const auto& data : spec.element_data) num_data_entries += data.entries.size();
+    for (const auto& data : spec.element_node_data) num_data_entries += data.entries.size();
+    REQUIRE(builder.num_data_entries == num_data_entries);
+
+    if (spec.mesh_format.version == "4.1") {
+        ASSERT_SAME_NODES(spec, spec2);
+    } else {
+        // MSH 2.2 nodes are streamed in file order, without regrouping.
+        REQUIRE(spec2.nodes.num_nodes == spec.nodes.num_nodes);
+        REQUIRE(spec2.nodes.min_node_tag == spec.nodes.min_node_tag);
+        REQUIRE(spec2.nodes.max_node_tag == spec.nodes.max_node_tag);
+        size_t num_nodes = 0;
+        for (const auto& block : spec2.nodes.entity_blocks) {
+            REQUIRE(block.entity_tag == 0);
+            num_nodes += block.num_nodes_in_block;
+        }
+        REQUIRE(num_nodes == spec.nodes.num_nodes);
+    }
+}
+
+TEST_CASE("Pull reader", "[reader][io]")
+{
+    using namespace mshio;
+
+    std::string filename;
+    SECTION("v4.1 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_ascii.msh";
+    }
+    SECTION("v4.1 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_4.1_bin.msh";
+    }
+    SECTION("v2.2 ascii")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_ascii.msh";
+    }
+    SECTION("v2.2 binary")
+    {
+        filename = MSHIO_DATA_DIR "/test_2.2_bin.msh";
+    }
+
+    const MshSpec spec = load_msh(filename);
+    const bool is_v41 = spec.mesh_format.version == "4.1";
+
+    MshReader reader(filename);
+    REQUIRE(reader.mesh_format().version == spec.mesh_format.version);
+    REQUIRE(reader.physical_groups().size() == spec.physical_groups.size());
+
+    size_t num_node_blocks = 0, num_nodes = 0;
+    while (const NodeBlock* block = reader.next_node_block()) {
+        if (is_v41) {
+            REQUIRE(block->tags == spec.nodes.entity_blocks[num_node_blocks].tags);
+            REQUIRE(block->data == spec.nodes.entity_blocks[num_node_blocks].data);
+        }
+        num_node_blocks++;
+        num_nodes += block->num_nodes_in_block;
+    }
+    REQUIRE(num_nodes == spec.nodes.num_nodes);
+    REQUIRE(reader.nodes().min_node_tag == spec.nodes.min_node_tag);
+    REQUIRE(reader.nodes().max_node_tag == spec.nodes.max_node_tag);
+    REQUIRE(reader.next_node_block() == nullptr);
+
+    size_t num_element_blocks = 0;
+    while (const ElementBlock* block = reader.next_element_block()) {
+        const ElementBlock& expected = spec.elements.entity_blocks[num_element_blocks];
+        REQUIRE(block->entity_tag == expected.entity_tag);
+        REQUIRE(block->element_type == expected.element_type);
+        REQUIRE(block->data == expected.data);
+        num_element_blocks++;
+    }
+    REQUIRE(num_element_blocks == spec.elements.num_entity_blocks);
+    REQUIRE(reader.elements().num_elements == spec.elements.num_elements);
+    REQUIRE(reader.entities().curves.size() == spec.entities.curves.size());
+    REQUIRE(reader.next_element_block() == nullptr);
+
+    // Asking for elements first skips the nodes.
+    MshReader reader2(filename);
+    const ElementBlock* block = reader2.next_element_block();
+    REQUIRE(block != nullptr);
+    REQUIRE(block->data == spec.elements.entity_blocks[0].data);
+    REQUIRE(reader2.next_node_block() == nullptr);
+}
+
+TEST_CASE("Streaming writer", "[writer][io]")
+{
+    using namespace mshio;
+
+    MshSpec spec = load_msh(MSHIO_DATA_DIR "/test_4.1_ascii.msh");
+    SECTION("v4.1")
+    {
+        spec.mesh_format.version = "4.1";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+    SECTION("v2.2")
+    {
+        spec.mesh_format.version = "2.2";
+        SECTION("ASCII")
+        {
+            spec.mesh_format.file_type = 0;
+        }
+        SECTION("Binary")
+        {
+            spec.mesh_format.file_type = 1;
+        }
+    }
+
+    auto write = [&](std::ostream& out, bool with_counts) {
+        MshWriter writer(out, spec.mesh_format);
+        if (spec.mesh_format.version == "4.1") writer.write_entities(spec.entities);
+        writer.begin_nodes(with_counts ? spec.nodes : Nodes());
+        for (const auto& block : spec.nodes.entity_blocks) writer.write_node_block(block);
+        writer.end_nodes();
+        writer.begin_elements(with_counts ? spec.elements : Elements());
+        for (const auto& block : spec.elements.entity_blocks) writer.write_element_block(block);
+        writer.end_elements();
+        for (const auto& data : spec.node_data) {
+            DataHeader header = data.header;
+            if (!with_counts) header.int_tags[2] = 0;
+            writer.begin_data(DataKind::NodeData, header);
+            for (const auto& entry : data.entries) writer.write_data_entry(entry);
+            writer.end_data();
+        }
+    };
+
+    std::stringstream expected;
+    save_msh(expected, spec);
+    const MshSpec spec2 = load_msh(expected);
+
+    SECTION("Known counts")
+    {
+        std::stringstream contents;
+        write(contents, true);
+#ifndef MSHIO_EXT_NANOSPLINE
+        REQUIRE(contents.str() == expected.str());
+#endif
+        ASSERT_SAME(spec2, load_msh(contents));
+    }
+
+    SECTION("Counts patched at the end")
+    {
+        std::stringstream contents;
+        write(contents, false);
+        ASSERT_SAME(spec2, load_msh(contents));
+    }
+
+    SECTION("Non-seekable output")
+    {
+        // A stream buffer without seek support.
+        struct SinkBuf : public std::streambuf
+        {
+            int overflow(int ch) override { return ch; }
+        } sink;
+        std::ostream out(&sink);
+        REQUIRE_NOTHROW(write(out, true));
+        REQUIRE_THROWS_AS(write(out, false), InvalidFormat);
+    }
+
+    SECTION("Write errors")
+    {
+        // A stream buffer that cannot write anything.
+        struct FullBuf : public std::streambuf
+        {
+            std::streamsize xsputn(const char*, std::streamsize) override { return 0; }
+            int_type overflow(int_type) override { return traits_type::eof(); }
+        } full;
+        std::ostream out(&full);
+        MshWriter writer(out, spec.mesh_format);
+        writer.begin_nodes(spec.nodes);
+        for (const auto& block : spec.nodes.entity_blocks) writer.write_node_block(block);
+        writer.end_nodes();
+        REQUIRE_THROWS_AS(writer.close(), std::runtime_error);
+        REQUIRE_THROWS_AS(writer.begin_elements(), std::logic_error);
+
+#ifdef __linux__
+        // Writes to /dev/full fail once the file buffer is flushed.
+        MshWriter file_writer("/dev/full", spec.mesh_format);
+        file_writer.begin_nodes(spec.nodes);
+        for (const auto& block : spec.nodes.entity_blocks) file_writer.write_node_block(block);
+        file_writer.end_nodes();
+        REQUIRE_THROWS_AS(file_writer.close(), std::runtime_error);
+#endif
+    }
+
+    SECTION("Closed file")
+    {
+        {
+            MshWriter writer("streaming_closed.msh", spec.mesh_format);
+            writer.begin_nodes(spec.nodes);
+            for (const auto& block : spec.nodes.entity_blocks) writer.write_node_block(block);
+            writer.end_nodes();
+            writer.close();
+            writer.close();
+        }
+        const MshSpec nodes_only = load_msh("streaming_closed.msh");
+        ASSERT_SAME_NODES(spec2, nodes_only);
+        std::remove("streaming_closed.msh");
+    }
+
+    SECTION("Compressed file")
+    {
+        REQUIRE_THROWS_AS(MshWriter("streaming.msh.gz", spec.mesh_format), UnsupportedFeature);
+        REQUIRE_THROWS_AS(MshWriter("streaming.msh.zst", spec.mesh_format), UnsupportedFeature);
+        REQUIRE_FALSE(std::ifstream("streaming.msh.gz").is_open());
+    }
+}